@@ -0,0 +1,222 @@
+/**
+ * Synthetic Program Generator
+ * Writes a parameterized program in the subset the compiler accepts, for
+ * the throughput benchmarks (make bench). Every dimension that stresses a
+ * fixed-size table or a scan in the compiler has its own knob:
+ *
+ *   --functions N     functions besides main        (activation records, IR)
+ *   --depth D         nesting of for/while/if       (basic blocks, labels)
+ *   --switch-cases S  cases in each function's switch
+ *   --expr-length E   operators in each expression chain (temporaries)
+ *   --globals G       global int variables          (symbol table, .data)
+ *   --arrays A        global arrays ...
+ *   --array-size K    ... of K ints each
+ *   --seed X          constants and operator choice
+ *
+ * Output is deterministic for a given set of options.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+struct GeneratorOptions {
+    int functions;
+    int depth;
+    int switchCases;
+    int exprLength;
+    int globals;
+    int arrays;
+    int arraySize;
+    unsigned seed;
+};
+
+static unsigned nextRandom(GeneratorOptions& opts) {
+    opts.seed = opts.seed * 1103515245u + 12345u;
+    return (opts.seed >> 16) & 0x7fff;
+}
+
+static void indent(int level) {
+    for (int i = 0; i < level; i++) fputs("    ", stdout);
+}
+
+/**
+ * A left-to-right chain of `length` operators over the function's locals
+ * and globals; divisors and moduli are constants so it never traps
+ */
+static void emitExpression(GeneratorOptions& opts, int length) {
+    static const char* const ops[] = { "+", "-", "*", "&", "|", "^", "/", "%" };
+    printf("x");
+    for (int i = 0; i < length; i++) {
+        int op = nextRandom(opts) % 8;
+        printf(" %s ", ops[op]);
+        if (op >= 6) {
+            printf("%u", 2 + nextRandom(opts) % 7);
+        } else if (opts.globals > 0 && nextRandom(opts) % 3 == 0) {
+            printf("g%u", nextRandom(opts) % opts.globals);
+        } else {
+            switch (nextRandom(opts) % 3) {
+                case 0: printf("y"); break;
+                case 1: printf("(x + %u)", nextRandom(opts) % 100); break;
+                default: printf("i"); break;
+            }
+        }
+    }
+}
+
+/**
+ * Loops and conditionals nested `depth` levels deep, each level with its
+ * own counter so every loop terminates after a few iterations
+ */
+static void emitNest(GeneratorOptions& opts, int level, int depth) {
+    int pad = level + 1;
+    if (level == depth) {
+        indent(pad);
+        printf("y = ");
+        emitExpression(opts, opts.exprLength < 4 ? opts.exprLength : 4);
+        printf(";\n");
+        if (opts.arrays > 0) {
+            indent(pad);
+            printf("arr%u[(x & 1023) %% %d] = y;\n", nextRandom(opts) % opts.arrays, opts.arraySize);
+        }
+        return;
+    }
+    switch (level % 3) {
+        case 0:
+            indent(pad);
+            printf("for (c%d = 0; c%d < 3; c%d++) {\n", level, level, level);
+            break;
+        case 1:
+            indent(pad);
+            printf("c%d = 0;\n", level);
+            indent(pad);
+            printf("while (c%d < 2) {\n", level);
+            indent(pad + 1);
+            printf("c%d = c%d + 1;\n", level, level);
+            break;
+        default:
+            indent(pad);
+            printf("if (x > %u) {\n", nextRandom(opts) % 50);
+            break;
+    }
+    emitNest(opts, level + 1, depth);
+    indent(pad);
+    if (level % 3 == 2) {
+        printf("} else {\n");
+        indent(pad + 1);
+        printf("x = x + 1;\n");
+        indent(pad);
+    }
+    printf("}\n");
+}
+
+static void emitFunction(GeneratorOptions& opts, int index) {
+    printf("int f%d(int a, int b) {\n", index);
+    printf("    int x = a;\n");
+    printf("    int y = b;\n");
+    printf("    int i = %d;\n", index);
+    for (int level = 0; level < opts.depth; level++) {
+        printf("    int c%d = 0;\n", level);
+    }
+    emitNest(opts, 0, opts.depth);
+
+    printf("    x = ");
+    emitExpression(opts, opts.exprLength);
+    printf(";\n");
+
+    if (opts.switchCases > 0) {
+        printf("    switch (x %% %d) {\n", opts.switchCases);
+        for (int c = 0; c < opts.switchCases; c++) {
+            printf("        case %d:\n", c);
+            printf("            y = y + %u;\n", nextRandom(opts) % 1000);
+            printf("            break;\n");
+        }
+        printf("        default:\n");
+        printf("            y = 0;\n");
+        printf("            break;\n");
+        printf("    }\n");
+    }
+
+    // Call the previous function so the call graph is a chain
+    if (index > 0) {
+        printf("    y = y + f%d(x & 255, y & 255);\n", index - 1);
+    }
+    printf("    return x + y;\n");
+    printf("}\n\n");
+}
+
+static void emitProgram(GeneratorOptions& opts) {
+    printf("#include <stdio.h>\n\n");
+    for (int g = 0; g < opts.globals; g++) {
+        printf("int g%d = %u;\n", g, nextRandom(opts) % 100);
+    }
+    for (int a = 0; a < opts.arrays; a++) {
+        printf("int arr%d[%d];\n", a, opts.arraySize);
+    }
+    printf("\n");
+    for (int f = 0; f < opts.functions; f++) {
+        emitFunction(opts, f);
+    }
+    printf("int main() {\n");
+    printf("    int total = 0;\n");
+    if (opts.functions > 0) {
+        printf("    total = f%d(%u, %u);\n", opts.functions - 1, nextRandom(opts) % 100, nextRandom(opts) % 100);
+    }
+    printf("    printf(\"%%d\\n\", total);\n");
+    printf("    return 0;\n");
+    printf("}\n");
+}
+
+static void usage(const char* program) {
+    fprintf(stderr, "Usage: %s [--functions N] [--depth D] [--switch-cases S] [--expr-length E]\n", program);
+    fprintf(stderr, "       [--globals G] [--arrays A] [--array-size K] [--seed X]\n");
+}
+
+int main(int argc, char** argv) {
+    GeneratorOptions opts;
+    opts.functions = 10;
+    opts.depth = 3;
+    opts.switchCases = 8;
+    opts.exprLength = 8;
+    opts.globals = 10;
+    opts.arrays = 1;
+    opts.arraySize = 100;
+    opts.seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        int value = atoi(argv[i + 1]);
+        if (strcmp(argv[i], "--functions") == 0) {
+            opts.functions = value;
+        } else if (strcmp(argv[i], "--depth") == 0) {
+            opts.depth = value;
+        } else if (strcmp(argv[i], "--switch-cases") == 0) {
+            opts.switchCases = value;
+        } else if (strcmp(argv[i], "--expr-length") == 0) {
+            opts.exprLength = value;
+        } else if (strcmp(argv[i], "--globals") == 0) {
+            opts.globals = value;
+        } else if (strcmp(argv[i], "--arrays") == 0) {
+            opts.arrays = value;
+        } else if (strcmp(argv[i], "--array-size") == 0) {
+            opts.arraySize = value;
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            opts.seed = (unsigned)value;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+    if (opts.functions < 0 || opts.depth < 0 || opts.switchCases < 0 || opts.exprLength < 0
+        || opts.globals < 0 || opts.arrays < 0 || opts.arraySize < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    emitProgram(opts);
+    return 0;
+}
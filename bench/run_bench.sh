@@ -0,0 +1,107 @@
+#!/bin/bash
+# Compile-throughput benchmark (make bench)
+#
+# usage: bench/run_bench.sh <compiler> <generator> [results_dir]
+#
+# Generates one synthetic program per case below, compiles it REPEAT times
+# with --time-report=csv and keeps the fastest run. Results are appended
+# to <results_dir>/summary.csv (one row per case: size, throughput, peak
+# memory) and <results_dir>/phases.csv (one row per phase), tagged with
+# the date and commit so runs can be compared over time.
+
+COMPILER=$1
+GENERATOR=$2
+RESULTS_DIR=${3:-bench/results}
+REPEAT=${REPEAT:-3}
+JOBS=${JOBS:-1}
+
+if [ ! -x "${COMPILER}" ] || [ ! -x "${GENERATOR}" ]; then
+    echo "usage: $0 <compiler> <generator> [results_dir]"
+    exit 1
+fi
+
+# name|generator options[|compiler options]; each case pushes one
+# dimension towards the compiler's fixed limits (MAX_FUNCTIONS,
+# MAX_IR_SIZE, MAX_BASIC_BLOCKS, MAX_SYMBOLS, MAX_VARIABLES) while staying
+# inside them. Compiler options default to --generate-mips; lexing_1mb is
+# about 1 MB of source, too large for the IR tables, so it stops after
+# parsing and times the scanner and parser
+CASES=(
+    "baseline|"
+    "many_functions|--functions 95 --depth 2 --switch-cases 4 --expr-length 4"
+    "deep_nesting|--functions 4 --depth 60 --switch-cases 2"
+    "huge_switch|--functions 3 --switch-cases 300 --depth 1"
+    "long_expressions|--functions 8 --expr-length 150 --depth 1 --switch-cases 2"
+    "many_globals|--functions 5 --globals 1500"
+    "large_arrays|--functions 10 --arrays 200 --array-size 5000"
+    "lexing_1mb|--functions 200 --depth 3 --switch-cases 20 --expr-length 600 --globals 100|--syntax-only"
+)
+
+PROGRAM_DIR="${RESULTS_DIR}/programs"
+mkdir -p "${PROGRAM_DIR}"
+SUMMARY="${RESULTS_DIR}/summary.csv"
+PHASES="${RESULTS_DIR}/phases.csv"
+if [ ! -f "${SUMMARY}" ]; then
+    echo "date,commit,case,status,source_lines,tokens,quads,mips_lines,wall_ms,cpu_ms,process_peak_rss_kb,lines_per_sec,quads_per_sec" > "${SUMMARY}"
+fi
+if [ ! -f "${PHASES}" ]; then
+    echo "date,commit,case,phase,runs,wall_ms,cpu_ms,process_peak_rss_kb,count,unit,count,unit" > "${PHASES}"
+fi
+
+DATE=$(date -u +%Y-%m-%dT%H:%M:%SZ)
+COMMIT=$(git rev-parse --short HEAD 2>/dev/null || echo unknown)
+REPORT=$(mktemp)
+BEST=$(mktemp)
+trap 'rm -f "${REPORT}" "${BEST}"' EXIT
+
+printf "%-18s %-6s %8s %8s %10s %12s %12s %10s\n" case status lines quads wall_ms lines/sec quads/sec rss_kb
+for entry in "${CASES[@]}"; do
+    name=${entry%%|*}
+    options=${entry#*|}
+    flags=--generate-mips
+    if [[ "${options}" == *"|"* ]]; then
+        flags=${options#*|}
+        options=${options%%|*}
+    fi
+    program="${PROGRAM_DIR}/${name}.txt"
+    "${GENERATOR}" ${options} > "${program}" || exit 1
+
+    status=ok
+    bestWall=""
+    : > "${BEST}"
+    for run in $(seq 1 "${REPEAT}"); do
+        if ! "${COMPILER}" "${program}" ${flags} --jobs "${JOBS}" --time-report=csv \
+                > /dev/null 2> "${REPORT}"; then
+            status=failed
+        fi
+        wall=$(grep -F "${program},total," "${REPORT}" | cut -d, -f4)
+        if [ -z "${wall}" ]; then
+            status=crashed
+            break
+        fi
+        if [ -z "${bestWall}" ] || awk "BEGIN { exit !(${wall} < ${bestWall}) }"; then
+            bestWall=${wall}
+            grep -F "${program}," "${REPORT}" > "${BEST}"
+        fi
+    done
+
+    # file,phase,runs,wall_ms,cpu_ms,process_peak_rss_kb,count,unit,count,unit
+    sed "s|^${program},|${DATE},${COMMIT},${name},|" "${BEST}" >> "${PHASES}"
+    awk -F, -v date="${DATE}" -v commit="${COMMIT}" -v name="${name}" -v status="${status}" '
+        $2 == "read_input"    { lines = $7 }
+        $2 == "parse"         { tokens = $7 }
+        $2 == "generate_ir"   { quads = $7 }
+        $2 == "generate_mips" { mips = $7 }
+        $2 == "total"         { wall = $4; cpu = $5; rss = $6 }
+        END {
+            seconds = wall / 1000.0
+            lps = seconds > 0 ? lines / seconds : 0
+            qps = seconds > 0 ? quads / seconds : 0
+            printf "%s,%s,%s,%s,%d,%d,%d,%d,%.3f,%.3f,%d,%.0f,%.0f\n", date, commit, name, status,
+                   lines, tokens, quads, mips, wall, cpu, rss, lps, qps >> "'"${SUMMARY}"'"
+            printf "%-18s %-6s %8d %8d %10.3f %12.0f %12.0f %10d\n", name, status, lines, quads, wall, lps, qps, rss
+        }' "${BEST}"
+done
+
+echo ""
+echo "Results appended to ${SUMMARY} and ${PHASES}"
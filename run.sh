@@ -25,16 +25,67 @@ echo "============================================"
 echo "Generating IR and MIPS Assembly files..."
 echo "============================================"
 
-# Generate both IR and MIPS assembly files for all test cases
-find "${TEST_DIR}" -name "*.txt" -type f | sort -V | while IFS= read -r test_file; do
+# Generate both IR and MIPS assembly files for all test cases in one process.
+# The list file starts with a comment and a blank line, which --batch skips,
+# and two workers exercise the forked batch path.
+TEST_LIST=$(mktemp)
+{
+    echo "# Test programs compiled by run.sh"
+    echo ""
+    find "${TEST_DIR}" -name "*.txt" -type f | sort -V
+} > "${TEST_LIST}"
+rm -f "${TEST_DIR}"/*.s
+./ir_generator --batch @"${TEST_LIST}" --generate-mips --jobs 2
+batch_status=$?
+
+failed=()
+if [ $batch_status -ne 0 ]; then
+    failed+=("--batch exited with status ${batch_status}")
+fi
+while read -r txt_file; do
+    if [ ! -f "${txt_file%.txt}.s" ]; then
+        failed+=("$(basename "${txt_file}"): no assembly generated")
+    fi
+done < <(grep -v '^#' "${TEST_LIST}" | grep -v '^$')
+rm -f "${TEST_LIST}"
+
+echo ""
+echo "============================================"
+echo "Running MIPS assembly on the built-in simulator..."
+echo "============================================"
+
+# A program reads stdin from <name>.input and takes its command line from
+# <name>.args when they exist; a simulator error fails the test
+while read -r asm_file; do
+    base="${asm_file%.s}"
+    input_file="${base}.input"
+    [ -f "$input_file" ] || input_file=/dev/null
+    args=()
+    if [ -f "${base}.args" ]; then
+        read -r -a args < "${base}.args"
+    fi
+
+    echo ""
     echo "--------------------------------------------"
-    echo "Processing: ${test_file}"
+    echo "Simulating: ${asm_file}"
     echo "--------------------------------------------"
-    ./ir_generator "${test_file}" --generate-mips
-    echo ""
-done
+    ./ir_generator --simulate "${asm_file}" --max-steps 50000000 -- "${args[@]}" < "$input_file"
+    status=$?
+    if [ $status -ne 0 ]; then
+        failed+=("$(basename "${asm_file}"): simulator exited with status ${status}")
+    fi
+done < <(find "${TEST_DIR}" -name "*.s" -type f | sort -V)
 
 echo ""
 echo "============================================"
-echo "All .ir and .s files generated successfully!"
+if [ ${#failed[@]} -eq 0 ]; then
+    echo "All .ir and .s files generated and simulated successfully!"
+    echo "============================================"
+    exit 0
+fi
+echo "${#failed[@]} failure(s):"
+for failure in "${failed[@]}"; do
+    echo "  ${failure}"
+done
 echo "============================================"
+exit 1
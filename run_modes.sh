@@ -0,0 +1,75 @@
+#!/bin/bash
+
+# Compile every test program in each code generation mode, run it on the
+# built-in simulator and check that its output matches the default mode.
+# Usage: ./run_modes.sh [compiler]   (default: ./ir_generator)
+
+COMPILER=${1:-./ir_generator}
+TEST_DIR=./test
+MAX_STEPS=50000000
+
+MODES=(
+    ""
+    "--mips-target=real"
+    "--schedule"
+    "--io-runtime=shared"
+    "--io-runtime=auto"
+)
+
+if [ ! -x "$COMPILER" ]; then
+    echo "Error: compiler '$COMPILER' not found; run make first"
+    exit 1
+fi
+COMPILER=$(cd "$(dirname "$COMPILER")" && pwd)/$(basename "$COMPILER")
+
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+echo "============================================"
+echo "Running test programs in every codegen mode"
+echo "============================================"
+
+failures=0
+runs=0
+while read -r txt_file; do
+    base=$(basename "${txt_file}" .txt)
+    input_file="${TEST_DIR}/${base}.input"
+    [ -f "$input_file" ] || input_file=/dev/null
+    args=()
+    if [ -f "${TEST_DIR}/${base}.args" ]; then
+        read -r -a args < "${TEST_DIR}/${base}.args"
+    fi
+
+    for index in "${!MODES[@]}"; do
+        mode=${MODES[$index]}
+        mode_dir="${WORK_DIR}/${index}"
+        mkdir -p "$mode_dir"
+        cp "$txt_file" "$mode_dir/"
+        cp "${TEST_DIR}"/*.h "$mode_dir/" 2>/dev/null
+
+        (cd "$mode_dir" && "$COMPILER" "${base}.txt" --generate-mips $mode > "${base}.log" 2>&1)
+        status=$?
+        if [ -f "${mode_dir}/${base}.s" ]; then
+            (cd "$mode_dir" && "$COMPILER" --simulate "${base}.s" --max-steps $MAX_STEPS -- "${args[@]}") \
+                < "$input_file" > "${mode_dir}/${base}.out" 2> "${mode_dir}/${base}.err"
+            echo "compile=${status} run=$?" >> "${mode_dir}/${base}.out"
+        else
+            echo "compile=${status} no assembly" > "${mode_dir}/${base}.out"
+        fi
+        runs=$((runs + 1))
+
+        if [ "$index" -ne 0 ] && ! cmp -s "${WORK_DIR}/0/${base}.out" "${mode_dir}/${base}.out"; then
+            echo "FAIL: ${base} ${mode}"
+            diff "${WORK_DIR}/0/${base}.out" "${mode_dir}/${base}.out" | head -10
+            failures=$((failures + 1))
+        fi
+    done
+
+    result=$(tail -1 "${WORK_DIR}/0/${base}.out")
+    echo "${base}: ${result}"
+done < <(find "${TEST_DIR}" -name "*.txt" -type f | sort -V)
+
+echo "============================================"
+echo "${runs} runs, ${failures} differing from the default mode"
+echo "============================================"
+[ "$failures" -eq 0 ]
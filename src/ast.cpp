@@ -1,8 +1,15 @@
 #include "ast.h"
+#include "compiler_context.h"
 #include <cstdlib>
 #include <cstring>
+#include <string>
+#include <unordered_set>
 
-extern int yylineno;
+// Identifier spellings of one compilation; node-based, so the c_str() of
+// an element stays put while the set grows
+struct IdentifierPool {
+    std::unordered_set<std::string> names;
+};
 
 TreeNode* createNode(NodeType type, const char* value) {
     TreeNode* node = static_cast<TreeNode*>(malloc(sizeof(TreeNode)));
@@ -13,10 +20,36 @@ TreeNode* createNode(NodeType type, const char* value) {
     node->children = nullptr;
     node->childCount = 0;
     node->childCapacity = 0;
-    node->lineNumber = yylineno;
+    node->lineNumber = currentLineNumber();
+    node->valueInterned = 0;
+    ctx->astNodeCount++;
     return node;
 }
 
+const char* internIdentifier(const char* text, int length) {
+    if (!ctx->identifiers) {
+        ctx->identifiers = new IdentifierPool();
+        ctx->identifiers->names.reserve(1024);
+    }
+    return ctx->identifiers->names.insert(std::string(text, length)).first->c_str();
+}
+
+TreeNode* createIdentifierNode(NodeType type, const char* text, int length) {
+    TreeNode* node = createNode(type, nullptr);
+    node->value = const_cast<char*>(internIdentifier(text, length));
+    node->valueInterned = 1;
+    return node;
+}
+
+void resetIdentifierPool(void) {
+    // Keep the buckets: a reused context usually sees similar names
+    if (ctx->identifiers) ctx->identifiers->names.clear();
+}
+
+void freeIdentifierPool(IdentifierPool* pool) {
+    delete pool;
+}
+
 void addChild(TreeNode* parent, TreeNode* child) {
     if (!parent || !child) return;
     if (parent->childCount >= parent->childCapacity) {
@@ -29,7 +62,7 @@ void addChild(TreeNode* parent, TreeNode* child) {
 
 void freeNode(TreeNode* node) {
     if (!node) return;
-    if (node->value) free(node->value);
+    if (node->value && !node->valueInterned) free(node->value);
     if (node->dataType) free(node->dataType);
     
     for (int i = 0; i < node->childCount; i++) {
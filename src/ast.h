@@ -26,6 +26,8 @@ typedef enum NodeType {
     NODE_PREPROCESSOR
 } NodeType;
 
+struct IdentifierPool;
+
 typedef struct TreeNode {
     NodeType type;
     char* value;
@@ -35,9 +37,23 @@ typedef struct TreeNode {
     int childCount;
     int childCapacity;
     int lineNumber;
+    int valueInterned;      // value is owned by the identifier pool
 } TreeNode;
 
 TreeNode* createNode(NodeType type, const char* value);
+
+/**
+ * Create an identifier/type-name node whose value is the pooled copy of
+ * `text[0..length)`; every occurrence of a name shares one string
+ */
+TreeNode* createIdentifierNode(NodeType type, const char* text, int length);
+
+/**
+ * Pooled copy of `text[0..length)`, valid until the context is reset
+ */
+const char* internIdentifier(const char* text, int length);
+void resetIdentifierPool(void);
+void freeIdentifierPool(struct IdentifierPool* pool);
 void addChild(TreeNode* parent, TreeNode* child);
 void freeNode(TreeNode* node);
 
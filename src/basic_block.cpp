@@ -10,17 +10,15 @@
 
 #include "basic_block.h"
 #include "ir_context.h"
+#include "compiler_context.h"
+#include "time_report.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
-
-// Global data structures for analysis
-BasicBlock blocks[MAX_BASIC_BLOCKS];
-int blockCount = 0;
-
-// Next-use and liveness information for each variable at each IR instruction
-NextUseInfo nextUseTable[MAX_IR_SIZE];
+#include <thread>
+#include <atomic>
+#include <vector>
 
 /**
  * Check if an IR instruction is a label
@@ -97,7 +95,7 @@ void findLeaders(bool leaders[], int start, int end) {
     
     // Scan all instructions
     for (int i = start; i <= end; i++) {
-        Quadruple* quad = &IR[i];
+        Quadruple* quad = &ctx->IR[i];
         
         // Rule 2: Any label is a leader
         if (isLabel(quad)) {
@@ -118,9 +116,11 @@ void findLeaders(bool leaders[], int start, int end) {
  * - Each leader starts a new basic block
  * - Block extends from leader to (but not including) next leader
  */
-int buildBasicBlocksForFunction(int funcStart, int funcEnd) {
+int buildBasicBlocksForFunction(FunctionAnalysis* func) {
     bool leaders[MAX_IR_SIZE];
-    int localBlockCount = 0;
+    int funcStart = func->funcStart;
+    int funcEnd = func->funcEnd;
+    func->blockCount = 0;
     
     // Find all leaders in this function
     findLeaders(leaders, funcStart, funcEnd);
@@ -131,13 +131,13 @@ int buildBasicBlocksForFunction(int funcStart, int funcEnd) {
         if (leaders[i]) {
             // If we had a previous block, close it
             if (blockStart != -1) {
-                blocks[blockCount].startIndex = blockStart;
-                blocks[blockCount].endIndex = i - 1;
-                blocks[blockCount].id = blockCount;
-                blocks[blockCount].successorCount = 0;
-                blocks[blockCount].predecessorCount = 0;
-                blockCount++;
-                localBlockCount++;
+                BasicBlock* block = &func->blocks[func->blockCount];
+                block->startIndex = blockStart;
+                block->endIndex = i - 1;
+                block->id = func->blockCount;
+                block->successorCount = 0;
+                block->predecessorCount = 0;
+                func->blockCount++;
             }
             // Start new block
             blockStart = i;
@@ -146,27 +146,27 @@ int buildBasicBlocksForFunction(int funcStart, int funcEnd) {
     
     // Close the last block
     if (blockStart != -1) {
-        blocks[blockCount].startIndex = blockStart;
-        blocks[blockCount].endIndex = funcEnd;
-        blocks[blockCount].id = blockCount;
-        blocks[blockCount].successorCount = 0;
-        blocks[blockCount].predecessorCount = 0;
-        blockCount++;
-        localBlockCount++;
+        BasicBlock* block = &func->blocks[func->blockCount];
+        block->startIndex = blockStart;
+        block->endIndex = funcEnd;
+        block->id = func->blockCount;
+        block->successorCount = 0;
+        block->predecessorCount = 0;
+        func->blockCount++;
     }
     
-    return localBlockCount;
+    return func->blockCount;
 }
 
 /**
  * Find basic block containing a specific label
  */
-int findBlockByLabel(const char* label, int startBlock, int numBlocks) {
-    for (int b = startBlock; b < startBlock + numBlocks; b++) {
-        for (int i = blocks[b].startIndex; i <= blocks[b].endIndex; i++) {
-            if (isLabel(&IR[i])) {
+int findBlockByLabel(const FunctionAnalysis* func, const char* label) {
+    for (int b = 0; b < func->blockCount; b++) {
+        for (int i = func->blocks[b].startIndex; i <= func->blocks[b].endIndex; i++) {
+            if (isLabel(&ctx->IR[i])) {
                 char labelName[128];
-                extractLabelName(&IR[i], labelName);
+                extractLabelName(&ctx->IR[i], labelName);
                 if (strcmp(labelName, label) == 0) {
                     return b;
                 }
@@ -184,10 +184,11 @@ int findBlockByLabel(const char* label, int startBlock, int numBlocks) {
  *   1. B2 immediately follows B1 (fall-through), OR
  *   2. B1 ends with jump to B2's label
  */
-void buildFlowGraph(int startBlock, int numBlocks) {
-    for (int b = startBlock; b < startBlock + numBlocks; b++) {
-        BasicBlock* block = &blocks[b];
-        Quadruple* lastQuad = &IR[block->endIndex];
+void buildFlowGraph(FunctionAnalysis* func) {
+    BasicBlock* fblocks = func->blocks;
+    for (int b = 0; b < func->blockCount; b++) {
+        BasicBlock* block = &fblocks[b];
+        Quadruple* lastQuad = &ctx->IR[block->endIndex];
         
         // Case 1: If last instruction is not an unconditional jump,
         // add fall-through edge to next block
@@ -197,10 +198,10 @@ void buildFlowGraph(int startBlock, int numBlocks) {
             strcmp(lastQuad->op, "RETURN") != 0 &&
             strcmp(lastQuad->op, "func_end") != 0 &&
             strcmp(lastQuad->op, "FUNC_END") != 0 &&
-            b + 1 < startBlock + numBlocks) {
+            b + 1 < func->blockCount) {
             
             block->successors[block->successorCount++] = b + 1;
-            blocks[b + 1].predecessors[blocks[b + 1].predecessorCount++] = b;
+            fblocks[b + 1].predecessors[fblocks[b + 1].predecessorCount++] = b;
         }
         
         // Case 2: If last instruction is a jump, add edge to target
@@ -213,11 +214,11 @@ void buildFlowGraph(int startBlock, int numBlocks) {
             
             // Target label is in result field
             const char* targetLabel = lastQuad->result;
-            int targetBlock = findBlockByLabel(targetLabel, startBlock, numBlocks);
+            int targetBlock = findBlockByLabel(func, targetLabel);
             
             if (targetBlock != -1) {
                 block->successors[block->successorCount++] = targetBlock;
-                blocks[targetBlock].predecessors[blocks[targetBlock].predecessorCount++] = b;
+                fblocks[targetBlock].predecessors[fblocks[targetBlock].predecessorCount++] = b;
             }
         }
     }
@@ -304,9 +305,7 @@ void updateNextUse(NextUseInfo* info, const char* varName, bool live, int nextUs
  *   2. Mark result as "dead" (no next use)
  *   3. Mark arg1 and arg2 as "live" with next use = S
  */
-void computeNextUseForBlock(int blockId) {
-    BasicBlock* block = &blocks[blockId];
-    
+void computeNextUseForBlock(const BasicBlock* block) {
     // Symbol table for tracking next-use within this block
     // Maps variable name -> {isLive, nextUseIndex}
     NextUseInfo currentState;
@@ -314,15 +313,15 @@ void computeNextUseForBlock(int blockId) {
     
     // Scan block BACKWARDS from end to start
     for (int i = block->endIndex; i >= block->startIndex; i--) {
-        Quadruple* quad = &IR[i];
+        Quadruple* quad = &ctx->IR[i];
         
         // Initialize next-use info for this instruction
-        initNextUse(&nextUseTable[i]);
+        initNextUse(&ctx->nextUseTable[i]);
         
         // Step 1: Attach current next-use information to this statement
         // Copy current state to this instruction's next-use info
         for (int v = 0; v < currentState.varCount; v++) {
-            updateNextUse(&nextUseTable[i], 
+            updateNextUse(&ctx->nextUseTable[i], 
                          currentState.varNames[v],
                          currentState.isLive[v],
                          currentState.nextUse[v]);
@@ -352,49 +351,130 @@ void computeNextUseForBlock(int blockId) {
 /**
  * Compute next-use information for all basic blocks
  */
-void computeNextUseInformation(int startBlock, int numBlocks) {
-    for (int b = startBlock; b < startBlock + numBlocks; b++) {
-        computeNextUseForBlock(b);
+void computeNextUseInformation(FunctionAnalysis* func) {
+    for (int b = 0; b < func->blockCount; b++) {
+        computeNextUseForBlock(&func->blocks[b]);
+    }
+}
+
+/**
+ * Analyze one function: basic blocks, flow graph and next-use info.
+ * Touches only the function's own blocks and IR range, so different
+ * functions can be analyzed concurrently.
+ */
+void analyzeFunction(FunctionAnalysis* func) {
+    // A function can't have more blocks than instructions
+    func->blocks = (BasicBlock*)malloc(sizeof(BasicBlock) * (func->funcEnd - func->funcStart + 1));
+    func->blockCount = 0;
+    if (!func->blocks) {
+        fprintf(stderr, "Error: Cannot allocate basic blocks for function at IR %d\n", func->funcStart);
+        return;
     }
+    
+    buildBasicBlocksForFunction(func);
+    
+    // Build control flow graph for this function
+    buildFlowGraph(func);
+    
+    // Compute next-use information
+    computeNextUseInformation(func);
+}
+
+/**
+ * Set the number of worker threads used by analyzeIR
+ */
+void setAnalysisThreadCount(int threads) {
+    ctx->analysisThreads = (threads < 1) ? 1 : threads;
 }
 
 /**
  * Main entry point: Partition IR into basic blocks and compute next-use info
  */
 void analyzeIR() {
-    blockCount = 0;
+    ctx->blockCount = 0;
     
-    // Initialize next-use table
-    for (int i = 0; i < MAX_IR_SIZE; i++) {
-        initNextUse(&nextUseTable[i]);
+    // Initialize next-use table (entries past irCount are never read)
+    for (int i = 0; i <= ctx->irCount && i < MAX_IR_SIZE; i++) {
+        initNextUse(&ctx->nextUseTable[i]);
     }
     
-    // Find all functions in the IR and analyze each one
+    // Find all functions in the IR
+    std::vector<FunctionAnalysis> funcs;
     int i = 0;
-    while (i < irCount) {
-        if (isFuncBegin(&IR[i])) {
-            int funcStart = i;
+    while (i < ctx->irCount) {
+        if (isFuncBegin(&ctx->IR[i])) {
             int funcEnd = i;
             
             // Find the end of this function
-            while (funcEnd < irCount && !isFuncEnd(&IR[funcEnd])) {
+            while (funcEnd < ctx->irCount && !isFuncEnd(&ctx->IR[funcEnd])) {
                 funcEnd++;
             }
             
-            int startBlock = blockCount;
-            int numBlocks = buildBasicBlocksForFunction(funcStart, funcEnd);
-            
-            // Build control flow graph for this function
-            buildFlowGraph(startBlock, numBlocks);
-            
-            // Compute next-use information
-            computeNextUseInformation(startBlock, numBlocks);
+            FunctionAnalysis func;
+            func.funcStart = i;
+            func.funcEnd = funcEnd;
+            func.blocks = NULL;
+            func.blockCount = 0;
+            funcs.push_back(func);
             
             i = funcEnd + 1;
         } else {
             i++;
         }
     }
+    
+    // Analyze each function, on worker threads if requested
+    int numFuncs = (int)funcs.size();
+    // Workers run against the compilation context of the calling thread
+    CompilerContext* owner = ctx;
+    std::atomic<int> nextFunc(0);
+    auto worker = [&]() {
+        setCompilerContext(owner);
+        int f;
+        while ((f = nextFunc.fetch_add(1)) < numFuncs) {
+            analyzeFunction(&funcs[f]);
+        }
+    };
+    
+    int numThreads = ctx->analysisThreads < numFuncs ? ctx->analysisThreads : numFuncs;
+    if (numThreads <= 1) {
+        worker();
+    } else {
+        std::vector<std::thread> pool;
+        for (int t = 0; t < numThreads; t++) {
+            pool.push_back(std::thread([&]() {
+                worker();
+                addWorkerThreadCpuTime();
+            }));
+        }
+        for (size_t t = 0; t < pool.size(); t++) {
+            pool[t].join();
+        }
+    }
+    
+    // Merge into the global block table in source order, renumbering
+    // function-local block ids so the result is independent of thread count
+    for (int f = 0; f < numFuncs; f++) {
+        FunctionAnalysis* func = &funcs[f];
+        if (ctx->blockCount + func->blockCount > MAX_BASIC_BLOCKS) {
+            fprintf(stderr, "Error: Too many basic blocks (max %d)\n", MAX_BASIC_BLOCKS);
+        } else {
+            int base = ctx->blockCount;
+            for (int b = 0; b < func->blockCount; b++) {
+                BasicBlock* block = &ctx->blocks[base + b];
+                *block = func->blocks[b];
+                block->id += base;
+                for (int s = 0; s < block->successorCount; s++) {
+                    block->successors[s] += base;
+                }
+                for (int p = 0; p < block->predecessorCount; p++) {
+                    block->predecessors[p] += base;
+                }
+            }
+            ctx->blockCount += func->blockCount;
+        }
+        free(func->blocks);
+    }
 }
 
 /**
@@ -405,8 +485,8 @@ void printBasicBlocks() {
     printf("BASIC BLOCK ANALYSIS RESULTS\n");
     printf("========================================\n\n");
     
-    for (int b = 0; b < blockCount; b++) {
-        BasicBlock* block = &blocks[b];
+    for (int b = 0; b < ctx->blockCount; b++) {
+        BasicBlock* block = &ctx->blocks[b];
         
         printf("Block B%d: [%d-%d]\n", block->id, block->startIndex, block->endIndex);
         
@@ -414,14 +494,14 @@ void printBasicBlocks() {
         printf("  Instructions:\n");
         for (int i = block->startIndex; i <= block->endIndex; i++) {
             printf("    [%d] %s %s %s %s\n", i,
-                   IR[i].op, IR[i].arg1, IR[i].arg2, IR[i].result);
+                   ctx->IR[i].op, ctx->IR[i].arg1, ctx->IR[i].arg2, ctx->IR[i].result);
         }
         
         // Print successors
         if (block->successorCount > 0) {
             printf("  Successors: ");
             for (int s = 0; s < block->successorCount; s++) {
-                printf("B%d ", blocks[block->successors[s]].id);
+                printf("B%d ", ctx->blocks[block->successors[s]].id);
             }
             printf("\n");
         }
@@ -430,7 +510,7 @@ void printBasicBlocks() {
         if (block->predecessorCount > 0) {
             printf("  Predecessors: ");
             for (int p = 0; p < block->predecessorCount; p++) {
-                printf("B%d ", blocks[block->predecessors[p]].id);
+                printf("B%d ", ctx->blocks[block->predecessors[p]].id);
             }
             printf("\n");
         }
@@ -447,17 +527,17 @@ void printNextUseInfo() {
     printf("NEXT-USE INFORMATION\n");
     printf("========================================\n\n");
     
-    for (int i = 0; i < irCount; i++) {
-        if (nextUseTable[i].varCount > 0) {
+    for (int i = 0; i < ctx->irCount; i++) {
+        if (ctx->nextUseTable[i].varCount > 0) {
             printf("[%d] %s %s %s %s\n", i,
-                   IR[i].op, IR[i].arg1, IR[i].arg2, IR[i].result);
+                   ctx->IR[i].op, ctx->IR[i].arg1, ctx->IR[i].arg2, ctx->IR[i].result);
             printf("  Next-use info:\n");
             
-            for (int v = 0; v < nextUseTable[i].varCount; v++) {
+            for (int v = 0; v < ctx->nextUseTable[i].varCount; v++) {
                 printf("    %s: %s, next-use=%d\n",
-                       nextUseTable[i].varNames[v],
-                       nextUseTable[i].isLive[v] ? "live" : "dead",
-                       nextUseTable[i].nextUse[v]);
+                       ctx->nextUseTable[i].varNames[v],
+                       ctx->nextUseTable[i].isLive[v] ? "live" : "dead",
+                       ctx->nextUseTable[i].nextUse[v]);
             }
         }
     }
@@ -467,11 +547,11 @@ void printNextUseInfo() {
  * Get next-use information for a variable at a specific IR instruction
  */
 bool getNextUseInfo(int irIndex, const char* varName, bool* isLive, int* nextUse) {
-    if (irIndex < 0 || irIndex >= irCount) {
+    if (irIndex < 0 || irIndex >= ctx->irCount) {
         return false;
     }
     
-    NextUseInfo* info = &nextUseTable[irIndex];
+    NextUseInfo* info = &ctx->nextUseTable[irIndex];
     int idx = findVarInNextUse(info, varName);
     
     if (idx != -1) {
@@ -47,15 +47,27 @@ typedef struct NextUseInfo {
     int varCount;                                   // Number of variables tracked
 } NextUseInfo;
 
-// Global data structures
-extern BasicBlock blocks[MAX_BASIC_BLOCKS];
-extern int blockCount;
-extern NextUseInfo nextUseTable[];  // One entry per IR instruction
+/**
+ * Per-function analysis result
+ * Blocks are numbered from 0 within the function so that functions can be
+ * analyzed independently; analyzeIR renumbers them into the global blocks[]
+ * in source order. Next-use info is written to the function's own slice of
+ * nextUseTable (IR ranges of different functions never overlap).
+ */
+typedef struct FunctionAnalysis {
+    int funcStart;                       // FUNC_BEGIN index
+    int funcEnd;                         // FUNC_END index
+    BasicBlock* blocks;                  // Function-local blocks
+    int blockCount;
+} FunctionAnalysis;
+
+// blocks[], blockCount and nextUseTable live in CompilerContext
 
 // Main analysis functions
 void analyzeIR();                    // Main entry point: analyze entire IR
 void printBasicBlocks();             // Print basic block information
 void printNextUseInfo();             // Print next-use information
+void setAnalysisThreadCount(int threads);  // Worker threads the current context's analyzeIR uses (1 = serial)
 
 // Helper functions
 bool isLabel(const Quadruple* quad);
@@ -65,10 +77,11 @@ bool getNextUseInfo(int irIndex, const char* varName, bool* isLive, int* nextUse
 
 // Internal analysis functions
 void findLeaders(bool leaders[], int start, int end);
-int buildBasicBlocksForFunction(int funcStart, int funcEnd);
-void buildFlowGraph(int startBlock, int numBlocks);
-void computeNextUseInformation(int startBlock, int numBlocks);
-void computeNextUseForBlock(int blockId);
+void analyzeFunction(FunctionAnalysis* func);
+int buildBasicBlocksForFunction(FunctionAnalysis* func);
+void buildFlowGraph(FunctionAnalysis* func);
+void computeNextUseInformation(FunctionAnalysis* func);
+void computeNextUseForBlock(const BasicBlock* block);
 
 #ifdef __cplusplus
 }
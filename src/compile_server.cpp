@@ -0,0 +1,286 @@
+#include "compile_server.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <atomic>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using namespace std;
+
+// Outcome of one client session
+enum SessionEnd {
+    SESSION_EOF,
+    SESSION_QUIT,
+    SESSION_SHUTDOWN
+};
+
+// Contexts of finished requests, kept warm for the next session
+static mutex poolMutex;
+static vector<CompilerContext*> idleContexts;
+
+static atomic<bool> stopping(false);
+static int listenFd = -1;
+
+// Socket sessions still running; the server waits for all of them before
+// it tears down the shared state
+static mutex connectionMutex;
+static condition_variable connectionsDone;
+static vector<int> connectionFds;        // Sockets not yet closed
+static int activeConnections = 0;
+
+static CompilerContext* acquireContext() {
+    {
+        lock_guard<mutex> lock(poolMutex);
+        if (!idleContexts.empty()) {
+            CompilerContext* context = idleContexts.back();
+            idleContexts.pop_back();
+            return context;
+        }
+    }
+    return createCompilerContext();
+}
+
+static void releaseContext(CompilerContext* context) {
+    if (!context) return;
+    lock_guard<mutex> lock(poolMutex);
+    idleContexts.push_back(context);
+}
+
+static void destroyIdleContexts() {
+    lock_guard<mutex> lock(poolMutex);
+    for (size_t i = 0; i < idleContexts.size(); i++) {
+        destroyCompilerContext(idleContexts[i]);
+    }
+    idleContexts.clear();
+}
+
+// Same naming as the command-line driver: replace the last extension
+static string outputPathFor(const string& inputPath, const char* extension) {
+    size_t lastDot = inputPath.find_last_of('.');
+    if (lastDot != string::npos) {
+        return inputPath.substr(0, lastDot) + extension;
+    }
+    return inputPath + extension;
+}
+
+/**
+ * Handle "compile [flags...] <input>"; the input is the rest of the line
+ * so paths may contain spaces
+ */
+static void serveCompile(CompilerContext* context, const char* args, FILE* out,
+                         CompileRequestHandler handler) {
+    vector<string> flags;
+    const char* p = args;
+    for (;;) {
+        while (*p == ' ' || *p == '\t') p++;
+        if (strncmp(p, "--", 2) != 0) break;
+        const char* end = p;
+        while (*end && *end != ' ' && *end != '\t') end++;
+        flags.push_back(string(p, end - p));
+        p = end;
+    }
+    string inputPath(p);
+    if (inputPath.empty()) {
+        fprintf(out, "error 1 missing input file\n");
+        return;
+    }
+
+    vector<char*> flagPtrs;
+    bool generateMIPS = false;
+    for (size_t i = 0; i < flags.size(); i++) {
+        flagPtrs.push_back(&flags[i][0]);
+        if (flags[i] == "--generate-mips") generateMIPS = true;
+    }
+
+    int status = handler(context, inputPath.c_str(), (int)flagPtrs.size(),
+                         flagPtrs.empty() ? NULL : &flagPtrs[0]);
+    fflush(stdout);
+    if (status != 0) {
+        int errors = context->error_count > 0 ? context->error_count : 1;
+        fprintf(out, "error %d %s\n", errors, inputPath.c_str());
+    } else if (generateMIPS) {
+        fprintf(out, "ok %s %s\n", outputPathFor(inputPath, ".ir").c_str(),
+                outputPathFor(inputPath, ".s").c_str());
+    } else {
+        fprintf(out, "ok %s\n", outputPathFor(inputPath, ".ir").c_str());
+    }
+}
+
+/**
+ * Read requests from `in` until end of input, "quit" or "shutdown"
+ */
+static SessionEnd serveSession(FILE* in, FILE* out, CompileRequestHandler handler) {
+    CompilerContext* context = acquireContext();
+    if (!context) {
+        fprintf(out, "error 1 cannot allocate compiler context\n");
+        fflush(out);
+        return SESSION_EOF;
+    }
+
+    SessionEnd result = SESSION_EOF;
+    char line[4096];
+    while (fgets(line, sizeof(line), in)) {
+        size_t len = strlen(line);
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+            line[--len] = '\0';
+        }
+        if (len == 0) continue;
+
+        if (strcmp(line, "quit") == 0) {
+            result = SESSION_QUIT;
+            break;
+        } else if (strcmp(line, "shutdown") == 0) {
+            result = SESSION_SHUTDOWN;
+            break;
+        } else if (strncmp(line, "compile ", 8) == 0) {
+            serveCompile(context, line + 8, out, handler);
+        } else {
+            fprintf(out, "error 1 unknown request '%s'\n", line);
+        }
+        fflush(out);
+    }
+
+    releaseContext(context);
+    return result;
+}
+
+static void stopListening() {
+    stopping = true;
+    if (listenFd >= 0) {
+        shutdown(listenFd, SHUT_RDWR);
+    }
+}
+
+static void connectionStarted(int fd) {
+    lock_guard<mutex> lock(connectionMutex);
+    connectionFds.push_back(fd);
+    activeConnections++;
+}
+
+// Called before the socket is closed, so its number is never shut down
+// after being reused
+static void connectionClosing(int fd) {
+    lock_guard<mutex> lock(connectionMutex);
+    connectionFds.erase(find(connectionFds.begin(), connectionFds.end(), fd));
+}
+
+static void connectionFinished() {
+    lock_guard<mutex> lock(connectionMutex);
+    if (--activeConnections == 0) {
+        connectionsDone.notify_all();
+    }
+}
+
+/**
+ * Let every open session finish the request it is compiling, then wait
+ * for their threads: shutting down the read side makes the next read of
+ * each session see end of input
+ */
+static void drainConnections() {
+    unique_lock<mutex> lock(connectionMutex);
+    for (size_t i = 0; i < connectionFds.size(); i++) {
+        shutdown(connectionFds[i], SHUT_RD);
+    }
+    connectionsDone.wait(lock, [] { return activeConnections == 0; });
+}
+
+static void serveConnection(int fd, CompileRequestHandler handler) {
+    FILE* in = fdopen(fd, "r");
+    int outFd = dup(fd);
+    FILE* out = (outFd >= 0) ? fdopen(outFd, "w") : NULL;
+    if (in && out) {
+        if (serveSession(in, out, handler) == SESSION_SHUTDOWN) {
+            stopListening();
+        }
+    } else {
+        fprintf(stderr, "Error: Cannot open compile server connection\n");
+    }
+    connectionClosing(fd);
+    if (out) fclose(out); else if (outFd >= 0) close(outFd);
+    if (in) fclose(in); else close(fd);
+    connectionFinished();
+}
+
+static int serveStdin(CompileRequestHandler handler) {
+    // Replies own stdout; everything the compiler prints goes to stderr
+    fflush(stdout);
+    int replyFd = dup(STDOUT_FILENO);
+    FILE* reply = (replyFd >= 0) ? fdopen(replyFd, "w") : NULL;
+    if (!reply) {
+        fprintf(stderr, "Error: Cannot open compile server reply stream\n");
+        return 1;
+    }
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+
+    serveSession(stdin, reply, handler);
+    fclose(reply);
+    return 0;
+}
+
+static int serveSocket(const char* socketPath, CompileRequestHandler handler) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(socketPath) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Error: Socket path too long: %s\n", socketPath);
+        return 1;
+    }
+    strcpy(addr.sun_path, socketPath);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        fprintf(stderr, "Error: Cannot create socket: %s\n", strerror(errno));
+        return 1;
+    }
+    unlink(socketPath);
+    if (bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(listenFd, 16) < 0) {
+        fprintf(stderr, "Error: Cannot listen on %s: %s\n", socketPath, strerror(errno));
+        close(listenFd);
+        listenFd = -1;
+        return 1;
+    }
+
+    // A client closing early must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+    fprintf(stderr, "Compile server listening on %s\n", socketPath);
+
+    while (!stopping) {
+        int fd = accept(listenFd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (!stopping) {
+                fprintf(stderr, "Error: accept failed: %s\n", strerror(errno));
+            }
+            break;
+        }
+        connectionStarted(fd);
+        thread(serveConnection, fd, handler).detach();
+    }
+
+    close(listenFd);
+    listenFd = -1;
+    unlink(socketPath);
+    drainConnections();
+    return 0;
+}
+
+int runCompileServer(const char* socketPath, CompileRequestHandler handler) {
+    // Warm up before the first request: one ready context and the
+    // rendered runtime library
+    releaseContext(createCompilerContext());
+    getRuntimeLibraryAsm();
+
+    int status = socketPath ? serveSocket(socketPath, handler) : serveStdin(handler);
+    destroyIdleContexts();
+    return status;
+}
@@ -0,0 +1,43 @@
+/**
+ * Compile Server
+ * Long-lived daemon mode: compile requests arrive over stdin or a local
+ * Unix socket and are served from warm compiler contexts, so repeated
+ * builds skip process start-up and table initialization.
+ *
+ * Protocol (one request per line):
+ *   compile [--analyze-blocks] [--activation-records] [--generate-mips] <input>
+ *       -> "ok <input>.ir [<input>.s]"  or  "error <count> <input>"
+ *   quit      -> ends the session (stdin: stops the server)
+ *   shutdown  -> stops the server once every open session has finished
+ *                its current request
+ */
+
+#ifndef COMPILE_SERVER_H
+#define COMPILE_SERVER_H
+
+#include "compiler_context.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Compile one input file with `context`; `flags` are the option tokens of
+ * the request. Returns 0 on success, 1 on error.
+ */
+typedef int (*CompileRequestHandler)(CompilerContext* context, const char* inputPath,
+                                     int flagCount, char** flags);
+
+/**
+ * Serve requests until "quit"/"shutdown" or end of input. With a NULL
+ * `socketPath` requests are read from stdin and replies written to stdout
+ * (compiler diagnostics are redirected to stderr); otherwise each socket
+ * connection is served on its own thread. Returns the process exit status.
+ */
+int runCompileServer(const char* socketPath, CompileRequestHandler handler);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COMPILE_SERVER_H
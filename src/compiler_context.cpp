@@ -0,0 +1,176 @@
+#include "compiler_context.h"
+#include "preprocessor.h"
+#include "time_report.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Reentrant scanner/parser entry points (lex.yy.c, parser.tab.c)
+typedef void* yyscan_t;
+extern int yylex_init_extra(CompilerContext* extra, yyscan_t* scanner);
+extern int yylex_destroy(yyscan_t scanner);
+extern int yyget_lineno(yyscan_t scanner);
+extern int yyparse(yyscan_t scanner);
+extern void resetLexerState(yyscan_t scanner, char* source, size_t size);
+extern void resetParserState();
+
+thread_local CompilerContext* ctx = NULL;
+
+CompilerContext* createCompilerContext(void) {
+    // The context embeds the fixed-size tables, so it lives on the heap
+    CompilerContext* context = (CompilerContext*)calloc(1, sizeof(CompilerContext));
+    if (!context) {
+        fprintf(stderr, "Error: Cannot allocate compiler context\n");
+        return NULL;
+    }
+    if (yylex_init_extra(context, &context->scanner) != 0) {
+        fprintf(stderr, "Error: Cannot initialize scanner\n");
+        free(context);
+        return NULL;
+    }
+    resetCompilerContext(context);
+    return context;
+}
+
+void destroyCompilerContext(CompilerContext* context) {
+    if (!context) return;
+    if (ctx == context) {
+        ctx = NULL;
+    }
+    closeCompilerInput(context);
+    free(context->lineStarts);
+    yylex_destroy(context->scanner);
+    freeTypeTable(context->types);
+    freeIdentifierPool(context->identifiers);
+    freeTimeReport(context->timeReport);
+    free(context);
+}
+
+void resetCompilerContext(CompilerContext* context) {
+    setCompilerContext(context);
+    resetSymbolTable();
+    resetIRContext();
+    resetIRGenerator();
+    resetParserState();
+    resetIdentifierPool();
+    resetTimeReport();
+    context->pch = NULL;
+    context->astNodeCount = 0;
+    context->tokenCount = 0;
+    context->mipsLineCount = 0;
+
+    // Defaults; the driver applies the unit's own options after the reset
+    setAnalysisThreadCount(1);
+    setCodegenThreadCount(1);
+    setCodegenCacheDir(NULL);
+    setIORuntimeMode(IO_RUNTIME_INLINE);
+    setMIPSTarget(MIPS_TARGET_SPIM);
+    setInstructionScheduling(NULL);
+}
+
+// Record where every line of the source starts, for diagnostics
+static void indexLines(CompilerContext* context) {
+    context->lineCount = 0;
+    const char* text = context->source;
+    const char* end = text + context->sourceSize;
+    const char* line = text;
+    for (;;) {
+        if (context->lineCount >= context->lineCapacity) {
+            context->lineCapacity = context->lineCapacity == 0 ? 256 : context->lineCapacity * 2;
+            context->lineStarts = (size_t*)realloc(context->lineStarts,
+                                                   context->lineCapacity * sizeof(size_t));
+        }
+        context->lineStarts[context->lineCount++] = line - text;
+        const char* newline = (const char*)memchr(line, '\n', end - line);
+        if (!newline) break;
+        line = newline + 1;
+    }
+}
+
+int openCompilerInput(CompilerContext* context, const char* inputPath) {
+    closeCompilerInput(context);
+
+    int fd = open(inputPath, O_RDONLY);
+    if (fd < 0) return 1;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return 1;
+    }
+    size_t size = (size_t)st.st_size;
+
+    // The scanner needs two NUL bytes after the text. A private mapping
+    // provides them for free when the last page has room (the tail of a
+    // partial page reads as zeros); otherwise read into the heap.
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    char* source = NULL;
+    if (size % pageSize != 0 && pageSize - size % pageSize >= 2) {
+        void* map = mmap(NULL, size + 2, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            source = (char*)map;
+            context->sourceMapLength = size + 2;
+        }
+    }
+    if (!source) {
+        source = (char*)malloc(size + 2);
+        size_t done = 0;
+        while (source && done < size) {
+            ssize_t n = read(fd, source + done, size - done);
+            if (n <= 0) break;
+            done += (size_t)n;
+        }
+        if (!source || done < size) {
+            free(source);
+            close(fd);
+            return 1;
+        }
+        source[size] = '\0';
+        source[size + 1] = '\0';
+        context->sourceMapLength = 0;
+    }
+    close(fd);
+
+    context->source = source;
+    context->sourceSize = size;
+    if (needsPreprocessing(source, size)) {
+        size_t expandedSize;
+        char* expanded = preprocessSource(inputPath, source, size, &expandedSize);
+        closeCompilerInput(context);
+        if (!expanded) return 2;
+        context->source = expanded;
+        context->sourceSize = expandedSize;
+    }
+    indexLines(context);
+    resetLexerState(context->scanner, context->source, context->sourceSize);
+    return 0;
+}
+
+void closeCompilerInput(CompilerContext* context) {
+    if (!context->source) return;
+    resetLexerState(context->scanner, NULL, 0);
+    if (context->sourceMapLength > 0) {
+        munmap(context->source, context->sourceMapLength);
+    } else {
+        free(context->source);
+    }
+    context->source = NULL;
+    context->sourceSize = 0;
+    context->sourceMapLength = 0;
+    context->lineCount = 0;
+}
+
+void setCompilerContext(CompilerContext* context) {
+    ctx = context;
+}
+
+int parseTranslationUnit(void) {
+    return yyparse(ctx->scanner);
+}
+
+int currentLineNumber(void) {
+    return yyget_lineno(ctx->scanner);
+}
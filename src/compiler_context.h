@@ -0,0 +1,200 @@
+/**
+ * Compiler Context
+ * Owns all state of one compilation: symbol table, IR, analysis results,
+ * activation records, parser flags and the (reentrant) scanner.
+ *
+ * Every module reads and writes its state through the thread-local `ctx`
+ * pointer, so independent compilations can run on different threads as
+ * long as each thread installs its own context.
+ */
+
+#ifndef COMPILER_CONTEXT_H
+#define COMPILER_CONTEXT_H
+
+#include <stdio.h>
+#include "ast.h"
+#include "symbol_table.h"
+#include "ir_context.h"
+#include "ir_generator.h"
+#include "basic_block.h"
+#include "mips_codegen.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAX_LOOP_DEPTH 100
+#define MAX_PENDING_GOTOS 100
+#define MAX_PENDING_PARAMS 32
+
+// Goto statement awaiting label validation (parser)
+typedef struct {
+    char label_name[256];
+    int line_number;
+} GotoRef;
+
+// Parameter information collected while parsing a declarator (parser)
+typedef struct {
+    char name[256];
+    char type[256];
+    int ptrLevel;
+    int isReference;
+} ParamInfo;
+
+typedef struct CompilerContext {
+    // Symbol table (symbol_table.cpp)
+    Symbol symtab[MAX_SYMBOLS];
+    int symCount;
+    int current_scope;
+    int parent_scopes[100];          // Stack to track parent scope relationships
+    int scope_depth;                 // Current depth in scope stack
+    int current_offset;
+    char currentType[128];
+    char current_function[128];      // Track which function we're currently in
+    int next_scope;                  // Always use 1 for function scopes (not sequential)
+    int current_block_id;            // Current nested block ID
+    int next_block_id;               // Counter for unique block IDs
+    int parent_blocks[100];          // Stack of parent block IDs
+    StructDef structTable[MAX_STRUCTS];
+    int structCount;
+    StructDef unionTable[MAX_STRUCTS];
+    int unionCount;
+    char function_pointers[MAX_SYMBOLS][128];
+    int function_pointer_count;
+    struct TypeTable* types;         // Hash-consed Type graph
+
+    // IR buffer (ir_context.cpp)
+    Quadruple IR[MAX_IR_SIZE];
+    int irCount;
+    int tempCount;
+    int labelCount;
+    StaticVarInfo staticVars[MAX_STATIC_VARS];
+    int staticVarCount;
+
+    // IR generator (ir_generator.cpp)
+    char current_function_name[256];
+    LoopContext loopStack[MAX_LOOP_DEPTH];
+    int loopDepth;
+    SwitchContext switchStack[MAX_LOOP_DEPTH];
+    int switchDepth;
+    int switchCount;
+    JumpList* break_lists[MAX_LOOP_DEPTH];
+    bool last_was_unconditional_jump;
+
+    // Basic block analysis (basic_block.cpp)
+    BasicBlock blocks[MAX_BASIC_BLOCKS];
+    int blockCount;
+    NextUseInfo nextUseTable[MAX_IR_SIZE];  // One entry per IR instruction
+
+    // Activation records (mips_codegen.cpp)
+    ActivationRecord activationRecords[MAX_FUNCTIONS];
+    int activationRecordCount;
+    long mipsLineCount;              // Lines written to the .s file
+
+    // Options of this unit; reset to the defaults with the context
+    int analysisThreads;             // Workers of analyzeIR (basic_block.cpp)
+    int codegenThreads;              // Workers of generateTextSection (mips_codegen.cpp)
+    char codegenCacheDir[1024];      // Per-function assembly cache, "" = disabled
+    IORuntimeMode ioRuntimeMode;
+    MIPSTarget mipsTarget;
+    int scheduleInstructions;        // List-schedule blocks for `pipelineModel`
+    MIPSPipelineModel pipelineModel;
+
+    // Parser flags (parser.y)
+    int error_count;
+    int semantic_error_count;
+    int anonymous_union_counter;
+    int anonymous_struct_counter;
+    int current_enum_value;          // Track current enum constant value
+    int recovering_from_error;
+    int in_typedef;
+    int is_static;                   // Current declaration is static
+    int has_const_before_ptr;        // "const int*" (pointer to const)
+    int has_const_after_ptr;         // "int* const" (const pointer)
+    int in_function_body;            // In a function body compound statement
+    int param_count_temp;            // Temporary counter for function parameters
+    int parsing_function_decl;       // Parsing a function declaration
+    int in_function_definition;      // Parsing a function definition (not just a declaration)
+    char function_return_type[128];  // Function return type saved before parsing parameters
+    char saved_declaration_type[128];  // Type from declaration_specifiers before declarator parsing
+    int loop_depth;                  // Loop nesting (break/continue validation)
+    int switch_depth;                // Switch nesting (break validation)
+    int parsing_parameters;          // Parsing function/function pointer parameters
+    int parsing_expression_context;  // Parsing inside expression (e.g., sizeof)
+    GotoRef pending_gotos[MAX_PENDING_GOTOS];
+    int pending_goto_count;
+    ParamInfo pending_params[MAX_PENDING_PARAMS];
+    int pending_param_count;
+    TreeNode* ast_root;              // Root of the parsed translation unit
+    long astNodeCount;               // Nodes created for this unit
+    struct IdentifierPool* identifiers;  // Interned identifier spellings (ast.cpp)
+    const struct PrecompiledHeader* pch;  // Snapshot the unit started from, if any
+
+    // Source of the translation unit (compiler_context.cpp)
+    char* source;                    // File contents followed by two NUL bytes
+    size_t sourceSize;               // Length of the contents
+    size_t sourceMapLength;          // Length of the mmap, 0 if heap-allocated
+    size_t* lineStarts;              // Offset of each line in `source`
+    int lineCount;
+    int lineCapacity;
+
+    // Scanner (lexer.l)
+    void* scanner;                   // yyscan_t of the reentrant scanner
+    void* scanBuffer;                // YY_BUFFER_STATE scanning `source` in place
+    int token_processed;
+    long tokenCount;                 // Tokens returned to the parser
+
+    struct TimeReport* timeReport;   // Phase statistics (time_report.cpp)
+} CompilerContext;
+
+/**
+ * Allocate a context with a fresh scanner and all state reset
+ */
+CompilerContext* createCompilerContext(void);
+
+/**
+ * Release a context and its scanner
+ */
+void destroyCompilerContext(CompilerContext* context);
+
+/**
+ * Reset a context so another translation unit can be compiled with it
+ */
+void resetCompilerContext(CompilerContext* context);
+
+/**
+ * Map (or, when the file leaves no room for the scanner's terminating NUL
+ * bytes, read) `inputPath` and point the scanner at it. The scanner works
+ * on the buffer in place. Returns 0 on success, 1 if the file cannot be
+ * read and 2 if preprocessing it fails (the preprocessor reports why).
+ */
+int openCompilerInput(CompilerContext* context, const char* inputPath);
+
+/**
+ * Detach the scanner from the current source and release it
+ */
+void closeCompilerInput(CompilerContext* context);
+
+/**
+ * Install `context` as the current thread's compilation context
+ */
+void setCompilerContext(CompilerContext* context);
+
+/**
+ * Parse the current context's input; returns the yyparse result
+ */
+int parseTranslationUnit(void);
+
+/**
+ * Line the scanner of the current context is on (for diagnostics)
+ */
+int currentLineNumber(void);
+
+#ifdef __cplusplus
+}
+
+// Context of the compilation running on this thread
+extern thread_local CompilerContext* ctx;
+#endif
+
+#endif // COMPILER_CONTEXT_H
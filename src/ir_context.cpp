@@ -1,4 +1,5 @@
 #include "ir_context.h"
+#include "compiler_context.h"
 #include <iostream>
 #include <fstream>
 #include <iomanip>
@@ -10,70 +11,69 @@
 
 using namespace std;
 
-Quadruple IR[MAX_IR_SIZE];
-int irCount = 0;
-int tempCount = 0;
-int labelCount = 0;
-
-// Static variable tracking
-StaticVarInfo staticVars[MAX_STATIC_VARS];
-int staticVarCount = 0;
-
 void emit(const char* op, const char* arg1, const char* arg2, const char* result) {
-    if (irCount >= MAX_IR_SIZE) {
+    if (ctx->irCount >= MAX_IR_SIZE) {
         cerr << "Error: IR size limit exceeded" << endl;
         return;
     }
-    strcpy(IR[irCount].op, op);
-    strcpy(IR[irCount].arg1, arg1 ? arg1 : "");
-    strcpy(IR[irCount].arg2, arg2 ? arg2 : "");
-    strcpy(IR[irCount].result, result ? result : "");
-    strcpy(IR[irCount].resultType, "");  // Default: no type info
-    irCount++;
+    strcpy(ctx->IR[ctx->irCount].op, op);
+    strcpy(ctx->IR[ctx->irCount].arg1, arg1 ? arg1 : "");
+    strcpy(ctx->IR[ctx->irCount].arg2, arg2 ? arg2 : "");
+    strcpy(ctx->IR[ctx->irCount].result, result ? result : "");
+    strcpy(ctx->IR[ctx->irCount].resultType, "");  // Default: no type info
+    ctx->irCount++;
 }
 
 // Function: emit and return the index
 int emitWithIndex(const char* op, const char* arg1, const char* arg2, const char* result) {
-    if (irCount >= MAX_IR_SIZE) {
+    if (ctx->irCount >= MAX_IR_SIZE) {
         cerr << "Error: IR size limit exceeded" << endl;
         return -1;
     }
-    strcpy(IR[irCount].op, op);
-    strcpy(IR[irCount].arg1, arg1 ? arg1 : "");
-    strcpy(IR[irCount].arg2, arg2 ? arg2 : "");
-    strcpy(IR[irCount].result, result ? result : "");
-    strcpy(IR[irCount].resultType, "");  // Default: no type info
-    return irCount++;
+    strcpy(ctx->IR[ctx->irCount].op, op);
+    strcpy(ctx->IR[ctx->irCount].arg1, arg1 ? arg1 : "");
+    strcpy(ctx->IR[ctx->irCount].arg2, arg2 ? arg2 : "");
+    strcpy(ctx->IR[ctx->irCount].result, result ? result : "");
+    strcpy(ctx->IR[ctx->irCount].resultType, "");  // Default: no type info
+    return ctx->irCount++;
 }
 
 // Function: emit with type information
 void emitTyped(const char* op, const char* arg1, const char* arg2, const char* result, const char* type) {
-    if (irCount >= MAX_IR_SIZE) {
+    if (ctx->irCount >= MAX_IR_SIZE) {
         cerr << "Error: IR size limit exceeded" << endl;
         return;
     }
-    strcpy(IR[irCount].op, op);
-    strcpy(IR[irCount].arg1, arg1 ? arg1 : "");
-    strcpy(IR[irCount].arg2, arg2 ? arg2 : "");
-    strcpy(IR[irCount].result, result ? result : "");
-    strcpy(IR[irCount].resultType, type ? type : "");
-    irCount++;
+    strcpy(ctx->IR[ctx->irCount].op, op);
+    strcpy(ctx->IR[ctx->irCount].arg1, arg1 ? arg1 : "");
+    strcpy(ctx->IR[ctx->irCount].arg2, arg2 ? arg2 : "");
+    strcpy(ctx->IR[ctx->irCount].result, result ? result : "");
+    strcpy(ctx->IR[ctx->irCount].resultType, type ? type : "");
+    ctx->irCount++;
 }
 
 // Return the next available quad index
 int nextQuad() {
-    return irCount;
+    return ctx->irCount;
+}
+
+// Discard the IR and counters of the previous translation unit
+void resetIRContext() {
+    ctx->irCount = 0;
+    ctx->tempCount = 0;
+    ctx->labelCount = 0;
+    ctx->staticVarCount = 0;
 }
 
 char* newTemp() {
-    static char temp[16];
-    sprintf(temp, "t%d", tempCount++);
+    static thread_local char temp[16];
+    sprintf(temp, "t%d", ctx->tempCount++);
     return strdup(temp);
 }
 
 char* newLabel() {
-    static char label[32];
-    sprintf(label, "L%d", labelCount++);
+    static thread_local char label[32];
+    sprintf(label, "L%d", ctx->labelCount++);
     return strdup(label);
 }
 
@@ -108,11 +108,11 @@ void backpatch(JumpList* list, const char* target_label) {
     JumpListNode* current = list->head;
     while (current != NULL) {
         int index = current->quad_index;
-        if (index >= 0 && index < irCount) {
-            if (strcmp(IR[index].op, "GOTO") == 0) {
-                strcpy(IR[index].arg1, target_label);
+        if (index >= 0 && index < ctx->irCount) {
+            if (strcmp(ctx->IR[index].op, "GOTO") == 0) {
+                strcpy(ctx->IR[index].arg1, target_label);
             } else {
-                strcpy(IR[index].arg2, target_label);
+                strcpy(ctx->IR[index].arg2, target_label);
             }
         }
         current = current->next;
@@ -132,20 +132,20 @@ void freeJumpList(JumpList* list) {
 }
 
 void registerStaticVar(const char* name, const char* init_value) {
-    if (staticVarCount >= MAX_STATIC_VARS) {
+    if (ctx->staticVarCount >= MAX_STATIC_VARS) {
         cerr << "Error: Too many static variables" << endl;
         return;
     }
     
-    strcpy(staticVars[staticVarCount].name, name);
+    strcpy(ctx->staticVars[ctx->staticVarCount].name, name);
     if (init_value && strlen(init_value) > 0) {
-        strcpy(staticVars[staticVarCount].init_value, init_value);
-        staticVars[staticVarCount].is_initialized = 1;
+        strcpy(ctx->staticVars[ctx->staticVarCount].init_value, init_value);
+        ctx->staticVars[ctx->staticVarCount].is_initialized = 1;
     } else {
-        strcpy(staticVars[staticVarCount].init_value, "0");
-        staticVars[staticVarCount].is_initialized = 0;
+        strcpy(ctx->staticVars[ctx->staticVarCount].init_value, "0");
+        ctx->staticVars[ctx->staticVarCount].is_initialized = 0;
     }
-    staticVarCount++;
+    ctx->staticVarCount++;
 }
 
 string convertToThreeAddress(const Quadruple& quad) {
@@ -342,11 +342,11 @@ void printIR(const char* filename) {
     
     bool hasGlobalsOrStatics = false;
     
-    for (int i = 0; i < irCount; i++) {
-        if (strcmp(IR[i].op, "ASSIGN") == 0 && strcmp(IR[i].op, "FUNC_BEGIN") != 0) {
+    for (int i = 0; i < ctx->irCount; i++) {
+        if (strcmp(ctx->IR[i].op, "ASSIGN") == 0 && strcmp(ctx->IR[i].op, "FUNC_BEGIN") != 0) {
             bool beforeAnyFunction = true;
             for (int j = 0; j < i; j++) {
-                if (strcmp(IR[j].op, "FUNC_BEGIN") == 0) {
+                if (strcmp(ctx->IR[j].op, "FUNC_BEGIN") == 0) {
                     beforeAnyFunction = false;
                     break;
                 }
@@ -360,27 +360,27 @@ void printIR(const char* filename) {
         }
     }
     
-    if (staticVarCount > 0) {
+    if (ctx->staticVarCount > 0) {
         if (!hasGlobalsOrStatics) {
             fp << "DATA:" << endl;
             hasGlobalsOrStatics = true;
         }
-        for (int i = 0; i < staticVarCount; i++) {
-            fp << "    " << staticVars[i].name << " = " << staticVars[i].init_value << endl;
+        for (int i = 0; i < ctx->staticVarCount; i++) {
+            fp << "    " << ctx->staticVars[i].name << " = " << ctx->staticVars[i].init_value << endl;
         }
     }
     
-    for (int i = 0; i < irCount; i++) {
-        if (strcmp(IR[i].op, "ASSIGN") == 0) {
+    for (int i = 0; i < ctx->irCount; i++) {
+        if (strcmp(ctx->IR[i].op, "ASSIGN") == 0) {
             bool beforeAnyFunction = true;
             for (int j = 0; j < i; j++) {
-                if (strcmp(IR[j].op, "FUNC_BEGIN") == 0) {
+                if (strcmp(ctx->IR[j].op, "FUNC_BEGIN") == 0) {
                     beforeAnyFunction = false;
                     break;
                 }
             }
             if (beforeAnyFunction) {
-                string instruction = convertToThreeAddress(IR[i]);
+                string instruction = convertToThreeAddress(ctx->IR[i]);
                 fp << "    " << instruction << endl;
             }
         }
@@ -391,35 +391,35 @@ void printIR(const char* filename) {
     }
     
     bool inFunction = false;
-    for (int i = 0; i < irCount; i++) {
-        if (strlen(IR[i].op) > 0) {
-            if (strcmp(IR[i].op, "FUNC_BEGIN") == 0) {
-                fp << "func_begin " << IR[i].arg1 << endl;
+    for (int i = 0; i < ctx->irCount; i++) {
+        if (strlen(ctx->IR[i].op) > 0) {
+            if (strcmp(ctx->IR[i].op, "FUNC_BEGIN") == 0) {
+                fp << "func_begin " << ctx->IR[i].arg1 << endl;
                 inFunction = true;
-            } else if (strcmp(IR[i].op, "FUNC_END") == 0) {
-                fp << "func_end " << IR[i].arg1 << endl << endl;
+            } else if (strcmp(ctx->IR[i].op, "FUNC_END") == 0) {
+                fp << "func_end " << ctx->IR[i].arg1 << endl << endl;
                 inFunction = false;
-            } else if (strcmp(IR[i].op, "LABEL") == 0) {
-                fp << IR[i].arg1 << ":" << endl;
-            } else if (strcmp(IR[i].op, "ASSIGN") == 0) {
+            } else if (strcmp(ctx->IR[i].op, "LABEL") == 0) {
+                fp << ctx->IR[i].arg1 << ":" << endl;
+            } else if (strcmp(ctx->IR[i].op, "ASSIGN") == 0) {
                 bool beforeAnyFunction = true;
                 for (int j = 0; j < i; j++) {
-                    if (strcmp(IR[j].op, "FUNC_BEGIN") == 0) {
+                    if (strcmp(ctx->IR[j].op, "FUNC_BEGIN") == 0) {
                         beforeAnyFunction = false;
                         break;
                     }
                 }
                 if (!beforeAnyFunction || inFunction) {
-                    string instruction = convertToThreeAddress(IR[i]);
+                    string instruction = convertToThreeAddress(ctx->IR[i]);
                     fp << "    " << instruction << endl;
                 }
             } else {
-                string instruction = convertToThreeAddress(IR[i]);
+                string instruction = convertToThreeAddress(ctx->IR[i]);
                 fp << "    " << instruction << endl;
             }
         }
     }
     
     fp.close();
-    cerr << "IR: " << filename << " (" << irCount << " instructions)" << endl;
+    cerr << "IR: " << filename << " (" << ctx->irCount << " instructions)" << endl;
 }
@@ -33,15 +33,7 @@ typedef struct {
     char resultType[32];  // Type of result: "int", "float", "double", "bool", etc.
 } Quadruple;
 
-// Global IR infrastructure
-extern Quadruple IR[MAX_IR_SIZE];
-extern int irCount;
-extern int tempCount;
-extern int labelCount;
-
-// Static variable tracking
-extern StaticVarInfo staticVars[MAX_STATIC_VARS];
-extern int staticVarCount;
+// IR buffer, counters and static variable table live in CompilerContext
 
 // Function prototypes
 void emit(const char* op, const char* arg1, const char* arg2, const char* result);
@@ -53,6 +45,7 @@ int nextQuad();
 void printIR(const char* filename);
 void registerStaticVar(const char* name, const char* init_value);
 void emitStaticVarInitializations();
+void resetIRContext();
 
 // Backpatching functions
 JumpList* makelist(int quad_index);
@@ -1,6 +1,7 @@
 #include "ir_generator.h"
 #include "ir_context.h"
 #include "symbol_table.h"
+#include "compiler_context.h"
 #include <iostream>
 #include <cstdio>
 #include <cstdlib>
@@ -11,11 +12,7 @@
 
 using namespace std;
 
-static std::set<std::string> variables_to_allocate;
-static char current_function_name[256] = "";
 static int isReferenceVariable(const char* var_name) {
-    extern Symbol symtab[];
-    extern int symCount;
     extern Symbol* lookupSymbol(const char* name);
     
     Symbol* sym = lookupSymbol(var_name);
@@ -23,23 +20,21 @@ static int isReferenceVariable(const char* var_name) {
 }
 
 static int isStaticVariable(const char* var_name) {
-    extern Symbol symtab[];
-    extern int symCount;
     
-    if (current_function_name[0] != '\0') {
-        for (int i = 0; i < symCount; i++) {
-            if (strcmp(symtab[i].name, var_name) == 0 &&
-                strcmp(symtab[i].function_scope, current_function_name) == 0 &&
-                symtab[i].is_static && !symtab[i].is_function) {
+    if (ctx->current_function_name[0] != '\0') {
+        for (int i = 0; i < ctx->symCount; i++) {
+            if (strcmp(ctx->symtab[i].name, var_name) == 0 &&
+                strcmp(ctx->symtab[i].function_scope, ctx->current_function_name) == 0 &&
+                ctx->symtab[i].is_static && !ctx->symtab[i].is_function) {
                 return 1;
             }
         }
     }
     
-    for (int i = 0; i < symCount; i++) {
-        if (strcmp(symtab[i].name, var_name) == 0 &&
-            symtab[i].function_scope[0] == '\0' &&
-            symtab[i].is_static && !symtab[i].is_function) {
+    for (int i = 0; i < ctx->symCount; i++) {
+        if (strcmp(ctx->symtab[i].name, var_name) == 0 &&
+            ctx->symtab[i].function_scope[0] == '\0' &&
+            ctx->symtab[i].is_static && !ctx->symtab[i].is_function) {
             return 1;
         }
     }
@@ -48,27 +43,25 @@ static int isStaticVariable(const char* var_name) {
 }
 
 static char* getStaticVarName(const char* var_name) {
-    extern Symbol symtab[];
-    extern int symCount;
     
     Symbol* sym = NULL;
-    if (current_function_name[0] != '\0') {
-        for (int i = 0; i < symCount; i++) {
-            if (strcmp(symtab[i].name, var_name) == 0 &&
-                strcmp(symtab[i].function_scope, current_function_name) == 0 &&
-                symtab[i].is_static && !symtab[i].is_function) {
-                sym = &symtab[i];
+    if (ctx->current_function_name[0] != '\0') {
+        for (int i = 0; i < ctx->symCount; i++) {
+            if (strcmp(ctx->symtab[i].name, var_name) == 0 &&
+                strcmp(ctx->symtab[i].function_scope, ctx->current_function_name) == 0 &&
+                ctx->symtab[i].is_static && !ctx->symtab[i].is_function) {
+                sym = &ctx->symtab[i];
                 break;
             }
         }
     }
     
     if (!sym) {
-        for (int i = 0; i < symCount; i++) {
-            if (strcmp(symtab[i].name, var_name) == 0 &&
-                symtab[i].function_scope[0] == '\0' &&
-                symtab[i].is_static && !symtab[i].is_function) {
-                sym = &symtab[i];
+        for (int i = 0; i < ctx->symCount; i++) {
+            if (strcmp(ctx->symtab[i].name, var_name) == 0 &&
+                ctx->symtab[i].function_scope[0] == '\0' &&
+                ctx->symtab[i].is_static && !ctx->symtab[i].is_function) {
+                sym = &ctx->symtab[i];
                 break;
             }
         }
@@ -82,7 +75,7 @@ static char* getStaticVarName(const char* var_name) {
         return strdup(var_name);
     }
     
-    static char full_name[512];
+    static thread_local char full_name[512];
     sprintf(full_name, "%s.%s", sym->function_scope, var_name);
     return strdup(full_name);
 }
@@ -103,92 +96,144 @@ struct CaseLabel {
     char* label;
 };
 
-static void emitConditionalJump(const char* op, const char* operand, const char* label, const char* dataType) {
+static int emitConditionalJump(const char* op, const char* operand, const char* label, const char* dataType) {
     if (dataType && strcmp(dataType, "float") == 0) {
         if (strcmp(op, "IF_FALSE_GOTO") == 0) {
-            emit("IF_FALSE_GOTO_FLOAT", operand, label, "");
+            return emitWithIndex("IF_FALSE_GOTO_FLOAT", operand, label, "");
         } else if (strcmp(op, "IF_TRUE_GOTO") == 0) {
-            emit("IF_TRUE_GOTO_FLOAT", operand, label, "");
-        } else {
-            emit(op, operand, label, "");
+            return emitWithIndex("IF_TRUE_GOTO_FLOAT", operand, label, "");
         }
-    } else {
-        emit(op, operand, label, "");
     }
+    return emitWithIndex(op, operand, label, "");
 }
 
-#define MAX_LOOP_DEPTH 100
-static LoopContext loopStack[MAX_LOOP_DEPTH];
-static int loopDepth = 0;
-static SwitchContext switchStack[MAX_LOOP_DEPTH];
-static int switchDepth = 0;
-static int switchCount = 0;
+// Conditions built from &&, || and ! are translated as jumping code
+static bool isJumpingCondition(TreeNode* node) {
+    if (!node) return false;
+    if (node->type == NODE_LOGICAL_AND_EXPRESSION || node->type == NODE_LOGICAL_OR_EXPRESSION) {
+        return true;
+    }
+    return node->type == NODE_UNARY_EXPRESSION && node->value && strcmp(node->value, "!") == 0 &&
+           node->childCount > 0 && isJumpingCondition(node->children[0]);
+}
+
+/*
+ * Jumping code for a condition in an if/while/for: control leaves through
+ * the returned list of unfilled jumps when the condition equals
+ * jumpWhenTrue and falls through otherwise. No 0/1 value is built for
+ * &&, || or !; a && b jumps out as soon as a is false, and so on.
+ * The caller backpatches the list with its target label.
+ */
+static JumpList* generate_condition(TreeNode* node, bool jumpWhenTrue) {
+    if (node->type == NODE_LOGICAL_AND_EXPRESSION || node->type == NODE_LOGICAL_OR_EXPRESSION) {
+        // Either operand decides the outcome when it is false (&&) or true (||)
+        bool decidingValue = (node->type == NODE_LOGICAL_OR_EXPRESSION);
+        if (jumpWhenTrue == decidingValue) {
+            JumpList* left = generate_condition(node->children[0], jumpWhenTrue);
+            return merge(left, generate_condition(node->children[1], jumpWhenTrue));
+        }
+        // Otherwise the left operand deciding means falling through
+        JumpList* skip = generate_condition(node->children[0], decidingValue);
+        JumpList* jumps = generate_condition(node->children[1], jumpWhenTrue);
+        char* skip_label = newLabel();
+        backpatch(skip, skip_label);
+        freeJumpList(skip);
+        emit("LABEL", skip_label, "", "");
+        return jumps;
+    }
+    if (node->type == NODE_UNARY_EXPRESSION && node->value && strcmp(node->value, "!") == 0 &&
+        node->childCount > 0) {
+        return generate_condition(node->children[0], !jumpWhenTrue);
+    }
+    
+    char* result = generate_ir(node);
+    const char* type = node->dataType ? node->dataType : "int";
+    int jump_index = emitConditionalJump(jumpWhenTrue ? "IF_TRUE_GOTO" : "IF_FALSE_GOTO", result, "", type);
+    return jump_index >= 0 ? makelist(jump_index) : NULL;
+}
+
+// Jumps to `label` when a jumping condition equals jumpWhenTrue
+static void emitJumpingCondition(TreeNode* cond, bool jumpWhenTrue, const char* label) {
+    JumpList* jumps = generate_condition(cond, jumpWhenTrue);
+    backpatch(jumps, label);
+    freeJumpList(jumps);
+}
+
+// Clear per-unit generator state (loop/switch stacks, current function)
+void resetIRGenerator() {
+    ctx->current_function_name[0] = '\0';
+    ctx->loopDepth = 0;
+    ctx->switchDepth = 0;
+    ctx->switchCount = 0;
+    for (int i = 0; i < MAX_LOOP_DEPTH; i++) {
+        ctx->break_lists[i] = NULL;
+    }
+    ctx->last_was_unconditional_jump = false;
+}
 
-static JumpList* break_lists[MAX_LOOP_DEPTH] = {NULL};
-static bool last_was_unconditional_jump = false;
 static void pushLoopLabels(char* continue_label, char* break_label) {
-    if (loopDepth >= MAX_LOOP_DEPTH) {
+    if (ctx->loopDepth >= MAX_LOOP_DEPTH) {
         cerr << "Error: Loop nesting too deep" << endl;
         return;
     }
-    loopStack[loopDepth].continue_label = continue_label;
-    loopStack[loopDepth].break_label = break_label;
-    break_lists[loopDepth] = NULL;
-    loopDepth++;
+    ctx->loopStack[ctx->loopDepth].continue_label = continue_label;
+    ctx->loopStack[ctx->loopDepth].break_label = break_label;
+    ctx->break_lists[ctx->loopDepth] = NULL;
+    ctx->loopDepth++;
 }
 
 static void popLoopLabels() {
-    if (loopDepth > 0) loopDepth--;
+    if (ctx->loopDepth > 0) ctx->loopDepth--;
 }
 
 static char* getCurrentLoopContinue() {
-    return (loopDepth > 0) ? loopStack[loopDepth - 1].continue_label : NULL;
+    return (ctx->loopDepth > 0) ? ctx->loopStack[ctx->loopDepth - 1].continue_label : NULL;
 }
 
 static char* getCurrentLoopBreak() {
-    return (loopDepth > 0) ? loopStack[loopDepth - 1].break_label : NULL;
+    return (ctx->loopDepth > 0) ? ctx->loopStack[ctx->loopDepth - 1].break_label : NULL;
 }
 
 static void addBreakJump(int jump_index) {
-    if (loopDepth > 0) {
+    if (ctx->loopDepth > 0) {
         JumpList* new_jump = makelist(jump_index);
-        break_lists[loopDepth - 1] = merge(break_lists[loopDepth - 1], new_jump);
+        ctx->break_lists[ctx->loopDepth - 1] = merge(ctx->break_lists[ctx->loopDepth - 1], new_jump);
     }
 }
 
 static void pushSwitchLabel(char* end_label, char* default_label) {
-    if (switchDepth >= MAX_LOOP_DEPTH) {
+    if (ctx->switchDepth >= MAX_LOOP_DEPTH) {
         cerr << "Error: Switch nesting too deep" << endl;
         return;
     }
-    switchStack[switchDepth].switch_id = switchCount++;
-    switchStack[switchDepth].end_label = end_label;
-    switchStack[switchDepth].default_label = default_label;
-    switchDepth++;
+    ctx->switchStack[ctx->switchDepth].switch_id = ctx->switchCount++;
+    ctx->switchStack[ctx->switchDepth].end_label = end_label;
+    ctx->switchStack[ctx->switchDepth].default_label = default_label;
+    ctx->switchDepth++;
 }
 
 static void popSwitchLabel() {
-    if (switchDepth > 0) switchDepth--;
+    if (ctx->switchDepth > 0) ctx->switchDepth--;
 }
 
 static char* getCurrentSwitchEnd() {
-    return (switchDepth > 0) ? switchStack[switchDepth - 1].end_label : NULL;
+    return (ctx->switchDepth > 0) ? ctx->switchStack[ctx->switchDepth - 1].end_label : NULL;
 }
 
 static int getCurrentSwitchId() {
-    return (switchDepth > 0) ? switchStack[switchDepth - 1].switch_id : -1;
+    return (ctx->switchDepth > 0) ? ctx->switchStack[ctx->switchDepth - 1].switch_id : -1;
 }
 
 static char* getCurrentSwitchDefault() {
-    return (switchDepth > 0) ? switchStack[switchDepth - 1].default_label : NULL;
+    return (ctx->switchDepth > 0) ? ctx->switchStack[ctx->switchDepth - 1].default_label : NULL;
 }
 
 static char* get_constant_value_from_expression(TreeNode* node) {
     if (!node) return NULL;
     
     // Use a rotating set of static buffers to avoid reuse issues
-    static char value_buffers[4][64];
-    static int buffer_index = 0;
+    static thread_local char value_buffers[4][64];
+    static thread_local int buffer_index = 0;
     char* current_buffer = value_buffers[buffer_index];
     buffer_index = (buffer_index + 1) % 4;
     
@@ -259,16 +304,14 @@ static void find_case_labels(TreeNode* node, std::vector<CaseLabel>& cases, char
             
             if (const_val) {
                 if (strchr(const_val, '.') != NULL) {
-                    extern int yylineno;
                     fprintf(stderr, "Semantic Error on line %d: floating-point constant '%s' in case label (only integer constants allowed)\n", 
-                            yylineno, const_val);
+                            currentLineNumber(), const_val);
                 }
                 
                 for (const auto& existing_case : cases) {
                     if (strcmp(existing_case.value, const_val) == 0) {
-                        extern int yylineno;
                         fprintf(stderr, "Semantic Error on line %d: duplicate case value '%s' in switch statement\n", 
-                                yylineno, const_val);
+                                currentLineNumber(), const_val);
                         break;
                     }
                 }
@@ -277,9 +320,8 @@ static void find_case_labels(TreeNode* node, std::vector<CaseLabel>& cases, char
                     extern Symbol* lookupSymbol(const char* name);
                     Symbol* sym = lookupSymbol(case_expr->value);
                     if (sym && sym->is_const) {
-                        extern int yylineno;
                         fprintf(stderr, "Semantic Error on line %d: case label '%s' is not an integer constant expression (const variable not allowed)\n", 
-                                yylineno, case_expr->value);
+                                currentLineNumber(), case_expr->value);
                     }
                 }
                 
@@ -323,22 +365,21 @@ static void find_case_labels(TreeNode* node, std::vector<CaseLabel>& cases, char
 static char* convertType(char* place, const char* from_type, const char* to_type) {
     if (strcmp(from_type, to_type) == 0) return place;
     
-    if (strstr(from_type, "[") != NULL || strstr(to_type, "[") != NULL) {
+    // Interned types are canonical (typedefs resolved): equal types are
+    // the same node
+    const Type* from = internType(from_type);
+    const Type* to = internType(to_type);
+    if (from == to) {
         return place;
     }
     
-    if (strstr(from_type, "*") != NULL || strstr(to_type, "*") != NULL) {
+    if (from->kind == TYPE_KIND_ARRAY || to->kind == TYPE_KIND_ARRAY ||
+        from->kind == TYPE_KIND_POINTER || to->kind == TYPE_KIND_POINTER) {
         return place;
     }
     
-    char* resolved_from = resolveTypedef(from_type);
-    char* resolved_to = resolveTypedef(to_type);
-    if (resolved_from && resolved_to && strcmp(resolved_from, resolved_to) == 0) {
-        return place;
-    }
-    
-    bool from_is_enum_or_int = (resolved_from && (strcmp(resolved_from, "enum") == 0 || strcmp(resolved_from, "int") == 0));
-    bool to_is_enum_or_int = (resolved_to && (strcmp(resolved_to, "enum") == 0 || strcmp(resolved_to, "int") == 0));
+    bool from_is_enum_or_int = (strcmp(from->name, "enum") == 0 || strcmp(from->name, "int") == 0);
+    bool to_is_enum_or_int = (strcmp(to->name, "enum") == 0 || strcmp(to->name, "int") == 0);
     if (from_is_enum_or_int && to_is_enum_or_int) {
         return place;
     }
@@ -434,13 +475,11 @@ char* generate_ir(TreeNode* node) {
             char* func_name = NULL;
             if (declarator && declarator->value) {
                 func_name = declarator->value;
-                strcpy(current_function_name, func_name);
+                strcpy(ctx->current_function_name, func_name);
                 
-                extern int current_scope;
-                int saved_scope = current_scope;
-                current_scope = 1;  // Function scope
+                int saved_scope = ctx->current_scope;
+                ctx->current_scope = 1;  // Function scope
                 
-                variables_to_allocate.clear();
                 
                 emit("FUNC_BEGIN", func_name, "", "");
             
@@ -456,9 +495,8 @@ char* generate_ir(TreeNode* node) {
                 
                 emit("FUNC_END", func_name, "", "");
                 
-                current_scope = saved_scope;
-                current_function_name[0] = '\0';
-                variables_to_allocate.clear();
+                ctx->current_scope = saved_scope;
+                ctx->current_function_name[0] = '\0';
             } else {
                 if (node->childCount > 2) {
                     generate_ir(node->children[2]);
@@ -488,10 +526,10 @@ char* generate_ir(TreeNode* node) {
         
         case NODE_COMPOUND_STATEMENT:
         {
-            bool saved_flag = last_was_unconditional_jump;
+            bool saved_flag = ctx->last_was_unconditional_jump;
             
             for (int i = 0; i < node->childCount; i++) {
-                last_was_unconditional_jump = false;
+                ctx->last_was_unconditional_jump = false;
                 generate_ir(node->children[i]);
             }
             
@@ -510,11 +548,16 @@ char* generate_ir(TreeNode* node) {
         case NODE_SELECTION_STATEMENT: // if, if-else, switch
         {
             if (strcmp(node->value, "if") == 0) {
-                char* cond_result = generate_ir(node->children[0]);
+                bool jumping = isJumpingCondition(node->children[0]);
+                char* cond_result = jumping ? NULL : generate_ir(node->children[0]);
                 
                 char* end_label = newLabel();
                 
-                int jump_index = emitWithIndex("IF_FALSE_GOTO", cond_result, end_label, "");
+                if (jumping) {
+                    emitJumpingCondition(node->children[0], false, end_label);
+                } else {
+                    emit("IF_FALSE_GOTO", cond_result, end_label, "");
+                }
                 
                 if (node->childCount > 1) {
                     generate_ir(node->children[1]);
@@ -523,26 +566,31 @@ char* generate_ir(TreeNode* node) {
                 emit("LABEL", end_label, "", "");
             }
             else if (strcmp(node->value, "if_else") == 0) {
-                char* cond_result = generate_ir(node->children[0]);
+                bool jumping = isJumpingCondition(node->children[0]);
+                char* cond_result = jumping ? NULL : generate_ir(node->children[0]);
                 
                 char* else_label = newLabel();
                 char* end_label = newLabel();
                 
-                int false_jump_index = emitWithIndex("IF_FALSE_GOTO", cond_result, else_label, "");
+                if (jumping) {
+                    emitJumpingCondition(node->children[0], false, else_label);
+                } else {
+                    emit("IF_FALSE_GOTO", cond_result, else_label, "");
+                }
                 
-                last_was_unconditional_jump = false;
+                ctx->last_was_unconditional_jump = false;
                 
                 if (node->childCount > 1) {
                     generate_ir(node->children[1]);
                 }
                 
                 JumpList* end_list = NULL;
-                if (!last_was_unconditional_jump) {
+                if (!ctx->last_was_unconditional_jump) {
                     int end_jump_index = emitWithIndex("GOTO", "PLACEHOLDER", "", "");
                     end_list = makelist(end_jump_index);
                 }
                 
-                last_was_unconditional_jump = false;
+                ctx->last_was_unconditional_jump = false;
                 
                 emit("LABEL", else_label, "", "");
                 
@@ -554,18 +602,18 @@ char* generate_ir(TreeNode* node) {
                     backpatch(end_list, end_label);
                     freeJumpList(end_list);
                     emit("LABEL", end_label, "", "");
-                } else if (!last_was_unconditional_jump) {
+                } else if (!ctx->last_was_unconditional_jump) {
                     emit("LABEL", end_label, "", "");
                 }
                 
-                last_was_unconditional_jump = false;
+                ctx->last_was_unconditional_jump = false;
             }
             else if (strcmp(node->value, "switch") == 0) {
                 
                 char* switch_expr = generate_ir(node->children[0]);
                 char* switch_end = newLabel();
                 
-                int current_switch_id = switchCount;
+                int current_switch_id = ctx->switchCount;
                 
                 std::vector<CaseLabel> case_labels;
                 char* default_label = NULL;
@@ -615,9 +663,12 @@ char* generate_ir(TreeNode* node) {
                 
                 emit("LABEL", start_label, "", "");
                 
-                char* cond_result = generate_ir(node->children[0]);
-                
-                int false_jump_index = emitWithIndex("IF_FALSE_GOTO", cond_result, end_label, "");
+                if (isJumpingCondition(node->children[0])) {
+                    emitJumpingCondition(node->children[0], false, end_label);
+                } else {
+                    char* cond_result = generate_ir(node->children[0]);
+                    emit("IF_FALSE_GOTO", cond_result, end_label, "");
+                }
                 
                 pushLoopLabels(start_label, end_label);
                 
@@ -627,12 +678,12 @@ char* generate_ir(TreeNode* node) {
                 
                 emit("GOTO", start_label, "", "");
                 
-                JumpList* break_list = (loopDepth > 0) ? break_lists[loopDepth - 1] : NULL;
+                JumpList* break_list = (ctx->loopDepth > 0) ? ctx->break_lists[ctx->loopDepth - 1] : NULL;
                 backpatch(break_list, end_label);
                 freeJumpList(break_list);
                 
-                if (loopDepth > 0) {
-                    break_lists[loopDepth - 1] = NULL;
+                if (ctx->loopDepth > 0) {
+                    ctx->break_lists[ctx->loopDepth - 1] = NULL;
                 }
                 
                 emit("LABEL", end_label, "", "");
@@ -656,7 +707,9 @@ char* generate_ir(TreeNode* node) {
                 emit("LABEL", test_label, "", "");
                 
                 char* cond_result = NULL;
-                if (node->childCount > 0) { 
+                if (node->childCount > 0 && isJumpingCondition(node->children[0])) {
+                    emitJumpingCondition(node->children[0], strcmp(node->value, "do_while") == 0, start_label);
+                } else if (node->childCount > 0) { 
                     cond_result = generate_ir(node->children[0]);
                 }
                 
@@ -668,12 +721,12 @@ char* generate_ir(TreeNode* node) {
                     }
                 }
                 
-                JumpList* break_list = (loopDepth > 0) ? break_lists[loopDepth - 1] : NULL;
+                JumpList* break_list = (ctx->loopDepth > 0) ? ctx->break_lists[ctx->loopDepth - 1] : NULL;
                 backpatch(break_list, end_label);
                 freeJumpList(break_list);
                 
-                if (loopDepth > 0) {
-                    break_lists[loopDepth - 1] = NULL;
+                if (ctx->loopDepth > 0) {
+                    ctx->break_lists[ctx->loopDepth - 1] = NULL;
                 }
                 
                 emit("LABEL", end_label, "", "");
@@ -698,9 +751,13 @@ char* generate_ir(TreeNode* node) {
                 if (node->childCount > 1 && node->children[1]) {
                     if (!(node->children[1]->type == NODE_EXPRESSION_STATEMENT && 
                           (!node->children[1]->value || strlen(node->children[1]->value) == 0))) {
-                        char* cond_result = generate_ir(node->children[1]);
-                        if (cond_result && strlen(cond_result) > 0) {
-                            emit("IF_FALSE_GOTO", cond_result, end_label, "");
+                        if (isJumpingCondition(node->children[1])) {
+                            emitJumpingCondition(node->children[1], false, end_label);
+                        } else {
+                            char* cond_result = generate_ir(node->children[1]);
+                            if (cond_result && strlen(cond_result) > 0) {
+                                emit("IF_FALSE_GOTO", cond_result, end_label, "");
+                            }
                         }
                     }
                 }
@@ -722,12 +779,12 @@ char* generate_ir(TreeNode* node) {
                 
                 emit("GOTO", cond_label, "", "");
                 
-                JumpList* break_list = (loopDepth > 0) ? break_lists[loopDepth - 1] : NULL;
+                JumpList* break_list = (ctx->loopDepth > 0) ? ctx->break_lists[ctx->loopDepth - 1] : NULL;
                 backpatch(break_list, end_label);
                 freeJumpList(break_list);
                 
-                if (loopDepth > 0) {
-                    break_lists[loopDepth - 1] = NULL;
+                if (ctx->loopDepth > 0) {
+                    ctx->break_lists[ctx->loopDepth - 1] = NULL;
                 }
                 
                 emit("LABEL", end_label, "", "");
@@ -742,14 +799,14 @@ char* generate_ir(TreeNode* node) {
             if (strcmp(node->value, "goto") == 0) {
                 if (node->childCount > 0 && node->children[0]->value) {
                     emit("GOTO", node->children[0]->value, "", "");
-                    last_was_unconditional_jump = true;
+                    ctx->last_was_unconditional_jump = true;
                 }
             }
             else if (strcmp(node->value, "continue") == 0) {
                 char* continue_label = getCurrentLoopContinue();
                 if (continue_label) {
                     emit("GOTO", continue_label, "", "");
-                    last_was_unconditional_jump = true;
+                    ctx->last_was_unconditional_jump = true;
                 } else {
                     cerr << "Error: continue statement outside loop" << endl;
                 }
@@ -762,12 +819,12 @@ char* generate_ir(TreeNode* node) {
                 if (switch_end_label) {
                     // Inside a switch - break from switch
                     emit("GOTO", switch_end_label, "", "");
-                    last_was_unconditional_jump = true;
-                } else if (loopDepth > 0) {
+                    ctx->last_was_unconditional_jump = true;
+                } else if (ctx->loopDepth > 0) {
                     // Inside a loop (but not in a switch) - break from loop
                     int break_jump_index = emitWithIndex("GOTO", "0", "", "");
                     addBreakJump(break_jump_index);
-                    last_was_unconditional_jump = true;
+                    ctx->last_was_unconditional_jump = true;
                 } else {
                     cerr << "Error: break statement outside loop or switch" << endl;
                 }
@@ -779,7 +836,7 @@ char* generate_ir(TreeNode* node) {
                 } else {
                     emit("RETURN", "", "", "");
                 }
-                last_was_unconditional_jump = true;
+                ctx->last_was_unconditional_jump = true;
             }
             return NULL;
         }
@@ -955,7 +1012,7 @@ char* generate_ir(TreeNode* node) {
                                 }
                             } else {
                                 TreeNode* rhs_node = node->children[1];
-                                char* resolved_lhs_type = lhs_sym ? resolveTypedef(lhs_sym->type) : NULL;
+                                const char* resolved_lhs_type = lhs_sym ? resolvedTypedefName(lhs_sym->type) : NULL;
                                 if (resolved_lhs_type && strstr(resolved_lhs_type, "char[") != NULL &&
                                     rhs_node->type == NODE_STRING_LITERAL) {
                                     const char* str_value = rhs_result;
@@ -995,9 +1052,7 @@ char* generate_ir(TreeNode* node) {
                                     char offset_str[32];
                                     sprintf(offset_str, "%d", idx);
                                     emit("STORE_OFFSET", arr_addr, offset_str, "'\\0'");
-                                    free(resolved_lhs_type);
                                 } else {
-                                    if (resolved_lhs_type) free(resolved_lhs_type);
                                     emit("ASSIGN", rhs_result, "", lhs_name);
                                 }
                             }
@@ -1019,7 +1074,7 @@ char* generate_ir(TreeNode* node) {
                         
                         if (base->dataType) {
                             // CRITICAL: Resolve typedef to get actual struct type
-                            char* resolved_type = resolveTypedef(base->dataType);
+                            const char* resolved_type = resolvedTypedefName(base->dataType);
                             const char* actual_type = resolved_type ? resolved_type : base->dataType;
                             
                             if (strncmp(actual_type, "struct ", 7) == 0) {
@@ -1039,7 +1094,6 @@ char* generate_ir(TreeNode* node) {
                                 }
                             }
                             
-                            if (resolved_type) free(resolved_type);
                         }
                         
                         if (member_type && node->children[1]->dataType && 
@@ -1073,7 +1127,7 @@ char* generate_ir(TreeNode* node) {
                             }
                             char* base_member = base->children[1]->value;
                             
-                            static char full_path[256];
+                            static thread_local char full_path[256];
                             snprintf(full_path, sizeof(full_path), "%s.%s.%s", base_path, base_member, member);
                             emit("ASSIGN", rhs_result, "", full_path);
                             return base_path;
@@ -1087,7 +1141,7 @@ char* generate_ir(TreeNode* node) {
                         
                         if (sym && sym->type) {
                             // CRITICAL: Resolve typedef to get actual struct type
-                            char* resolved_type = resolveTypedef(sym->type);
+                            const char* resolved_type = resolvedTypedefName(sym->type);
                             const char* actual_type = resolved_type ? resolved_type : sym->type;
                             
                             if (strncmp(actual_type, "struct ", 7) == 0) {
@@ -1105,7 +1159,6 @@ char* generate_ir(TreeNode* node) {
                                 }
                             }
                             
-                            if (resolved_type) free(resolved_type);
                         }
                         
                         if (target_type && node->children[1]->dataType && 
@@ -1119,7 +1172,7 @@ char* generate_ir(TreeNode* node) {
                         int member_offset = 0;
                         if (sym && sym->type) {
                             // CRITICAL: Resolve typedef to get actual struct type
-                            char* resolved_type = resolveTypedef(sym->type);
+                            const char* resolved_type = resolvedTypedefName(sym->type);
                             const char* actual_type = resolved_type ? resolved_type : sym->type;
                             
                             if (strncmp(actual_type, "struct ", 7) == 0) {
@@ -1136,7 +1189,6 @@ char* generate_ir(TreeNode* node) {
                                 }
                             }
                             
-                            if (resolved_type) free(resolved_type);
                         }
                         
                         char offset_str[32];
@@ -2046,7 +2098,7 @@ char* generate_ir(TreeNode* node) {
                     
                     if (base->dataType) {
                         // CRITICAL: Resolve typedef to get actual struct type
-                        char* resolved_type = resolveTypedef(base->dataType);
+                        const char* resolved_type = resolvedTypedefName(base->dataType);
                         const char* actual_type = resolved_type ? resolved_type : base->dataType;
                         
                         if (strncmp(actual_type, "struct ", 7) == 0) {
@@ -2065,7 +2117,6 @@ char* generate_ir(TreeNode* node) {
                             }
                         }
                         
-                        if (resolved_type) free(resolved_type);
                     }
                     
                     char* elem_addr = newTemp();
@@ -2096,7 +2147,7 @@ char* generate_ir(TreeNode* node) {
                         }
                         char* base_member = base->children[1]->value;
                         
-                        static char full_path[256];
+                        static thread_local char full_path[256];
                         snprintf(full_path, sizeof(full_path), "%s.%s.%s", base_path, base_member, member);
                         
                         char* temp = newTemp();
@@ -2112,7 +2163,7 @@ char* generate_ir(TreeNode* node) {
                     Symbol* sym = lookupSymbol(struct_var);
                     if (sym && sym->type) {
                         // CRITICAL: Resolve typedef to get actual struct/union type
-                        char* resolved_type = resolveTypedef(sym->type);
+                        const char* resolved_type = resolvedTypedefName(sym->type);
                         const char* actual_type = resolved_type ? resolved_type : sym->type;
                         
                         if (strncmp(actual_type, "struct ", 7) == 0) {
@@ -2144,7 +2195,6 @@ char* generate_ir(TreeNode* node) {
                             }
                         }
                         
-                        if (resolved_type) free(resolved_type);
                     }
                     
                     char* struct_addr = newTemp();
@@ -2178,7 +2228,7 @@ char* generate_ir(TreeNode* node) {
                     }
                     
                     // CRITICAL: Resolve typedef to get actual struct type
-                    char* resolved_type = resolveTypedef(struct_type);
+                    const char* resolved_type = resolvedTypedefName(struct_type);
                     const char* actual_type = resolved_type ? resolved_type : struct_type;
                     
                     if (strncmp(actual_type, "struct ", 7) == 0) {
@@ -2196,7 +2246,6 @@ char* generate_ir(TreeNode* node) {
                         }
                     }
                     
-                    if (resolved_type) free(resolved_type);
                 }
                 
                 char offset_str[32];
@@ -2358,7 +2407,7 @@ char* generate_ir(TreeNode* node) {
                         extern Symbol* lookupSymbol(const char* name);
                         Symbol* sym = lookupSymbol(lhs_name);
                         
-                        char* resolved_type = sym ? resolveTypedef(sym->type) : NULL;
+                        const char* resolved_type = sym ? resolvedTypedefName(sym->type) : NULL;
                         if (resolved_type && strstr(resolved_type, "char[") != NULL && 
                             rhs->type == NODE_STRING_LITERAL && rhs_result) {
                             const char* str_value = rhs_result;
@@ -2394,12 +2443,10 @@ char* generate_ir(TreeNode* node) {
                             char index_str[32];
                             sprintf(index_str, "%d", idx);
                             emit("ASSIGN_ARRAY", index_str, lhs_name, "'\\0'");
-                            free(resolved_type);
                         }
                         else if (sym && sym->type && rhs->dataType && 
                                  strcmp(sym->type, rhs->dataType) != 0 &&
                                  strstr(sym->type, "[") == NULL && strstr(rhs->dataType, "[") == NULL) {
-                            if (resolved_type) free(resolved_type);
                             rhs_result = convertType(rhs_result, rhs->dataType, sym->type);
                             // Check if this is a reference variable initialization
                             if (sym && sym->is_reference) {
@@ -2412,7 +2459,6 @@ char* generate_ir(TreeNode* node) {
                             }
                         }
                         else {
-                            if (resolved_type) free(resolved_type);
                             // Check if this is a reference variable initialization
                             if (sym && sym->is_reference) {
                                 // Reference initialization: store ADDRESS of rhs into the reference
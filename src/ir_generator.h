@@ -8,6 +8,7 @@ extern "C" {
 #endif
 
 char* generate_ir(TreeNode* node);
+void resetIRGenerator();
 
 typedef struct {
     char* continue_label;
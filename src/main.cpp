@@ -1,62 +1,164 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <vector>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
 #include "ast.h"
 #include "ir_generator.h"
 #include "ir_context.h"
 #include "symbol_table.h"
 #include "basic_block.h"
 #include "mips_codegen.h"
+#include "compiler_context.h"
+#include "compile_server.h"
+#include "precompiled_header.h"
+#include "time_report.h"
+#include "mips_simulator.h"
 
 using namespace std;
 
-extern int yyparse();
-extern FILE* yyin;
-extern int error_count;
-extern TreeNode* ast_root;
+// Options shared by every translation unit
+struct CompileOptions {
+    bool analyzeBlocks;
+    bool computeActivationRecs;
+    bool generateMIPS;
+    bool syntaxOnly;                // Stop after parsing and semantic checks
+    const PrecompiledHeader* pch;   // Global scope to start every unit from
+    const char* emitPchPath;        // Write the unit's global scope here instead of IR
+    TimeReportFormat timeReport;    // Per-phase statistics printed to stderr
+    int jobs;                       // Analysis and code generation worker threads
+    const char* cacheDir;           // Per-function assembly cache, NULL = off
+    IORuntimeMode ioRuntime;
+    MIPSTarget mipsTarget;
+    bool schedule;                  // List-schedule blocks for `pipeline`
+    MIPSPipelineModel pipeline;
+};
 
-int main(int argc, char **argv) {
-    if (argc < 2) {
-        cerr << "Usage: " << argv[0] << " <input_file> [options]" << endl;
-        cerr << "Options:" << endl;
-        cerr << "  --analyze-blocks       : Perform basic block analysis and print results" << endl;
-        cerr << "  --activation-records   : Compute and print activation records for functions" << endl;
-        cerr << "  --generate-mips        : Generate MIPS assembly code" << endl;
-        return 1;
+// Options given to --server at startup; every request starts from them
+static CompileOptions serverOptions;
+
+/**
+ * Apply a per-file compile option. Returns 1 if `arg` is one, 0 if it is
+ * not, and -1 (after reporting it) if its value is invalid.
+ */
+static int parseCompileFlag(const char* arg, CompileOptions& opts) {
+    if (strcmp(arg, "--analyze-blocks") == 0) {
+        opts.analyzeBlocks = true;
+    } else if (strcmp(arg, "--activation-records") == 0) {
+        opts.computeActivationRecs = true;
+    } else if (strcmp(arg, "--generate-mips") == 0) {
+        opts.generateMIPS = true;
+        cout << "MIPS generation flag detected" << endl;
+    } else if (strcmp(arg, "--syntax-only") == 0) {
+        opts.syntaxOnly = true;
+    } else if (strcmp(arg, "--time-report") == 0) {
+        opts.timeReport = TIME_REPORT_TEXT;
+    } else if (strcmp(arg, "--time-report=json") == 0) {
+        opts.timeReport = TIME_REPORT_JSON;
+    } else if (strcmp(arg, "--time-report=csv") == 0) {
+        opts.timeReport = TIME_REPORT_CSV;
+    } else if (strncmp(arg, "--jobs=", 7) == 0) {
+        opts.jobs = atoi(arg + 7);
+    } else if (strncmp(arg, "--cache-dir=", 12) == 0) {
+        opts.cacheDir = arg + 12;
+    } else if (strcmp(arg, "--io-runtime=inline") == 0) {
+        opts.ioRuntime = IO_RUNTIME_INLINE;
+    } else if (strcmp(arg, "--io-runtime=auto") == 0) {
+        opts.ioRuntime = IO_RUNTIME_AUTO;
+    } else if (strcmp(arg, "--io-runtime=shared") == 0) {
+        opts.ioRuntime = IO_RUNTIME_SHARED;
+    } else if (strcmp(arg, "--mips-target=spim") == 0) {
+        opts.mipsTarget = MIPS_TARGET_SPIM;
+    } else if (strcmp(arg, "--mips-target=real") == 0) {
+        opts.mipsTarget = MIPS_TARGET_REAL;
+    } else if (strcmp(arg, "--schedule") == 0 || strncmp(arg, "--schedule=", 11) == 0) {
+        // Defaults are the built-in simulator's latencies
+        MIPSPipelineModel model = { 1, 11, 34 };
+        if (arg[10] == '=' &&
+            (sscanf(arg + 11, "%d,%d,%d", &model.loadLatency, &model.multiplyLatency, &model.divideLatency) != 3 ||
+             model.loadLatency < 0 || model.multiplyLatency < 0 || model.divideLatency < 0)) {
+            cerr << "Error: --schedule= expects LOAD,MUL,DIV latencies in cycles" << endl;
+            return -1;
+        }
+        opts.schedule = true;
+        opts.pipeline = model;
+    } else {
+        return 0;
     }
-    
-    // Check for optional flags
-    bool analyzeBlocks = false;
-    bool computeActivationRecs = false;
-    bool generateMIPS = false;
-    for (int i = 2; i < argc; i++) {
-        if (strcmp(argv[i], "--analyze-blocks") == 0) {
-            analyzeBlocks = true;
-        } else if (strcmp(argv[i], "--activation-records") == 0) {
-            computeActivationRecs = true;
-        } else if (strcmp(argv[i], "--generate-mips") == 0) {
-            generateMIPS = true;
-            cout << "MIPS generation flag detected" << endl;
-        }
-    }
-    
-    yyin = fopen(argv[1], "r");
-    if (!yyin) {
-        cerr << "Error: Cannot open file " << argv[1] << endl;
+    return 1;
+}
+
+/**
+ * Compile a single input file with the given context, which is reset
+ * first. Returns 0 on success, 1 on error.
+ */
+static int compileFile(CompilerContext* context, const char* inputPath, const CompileOptions& opts) {
+    resetCompilerContext(context);
+    setAnalysisThreadCount(opts.jobs);
+    setCodegenThreadCount(opts.jobs);
+    setCodegenCacheDir(opts.cacheDir);
+    setIORuntimeMode(opts.ioRuntime);
+    setMIPSTarget(opts.mipsTarget);
+    setInstructionScheduling(opts.schedule ? &opts.pipeline : NULL);
+    if (opts.timeReport != TIME_REPORT_OFF) {
+        startTimeReport();
+    }
+    if (opts.pch) {
+        beginPhase(PHASE_LOAD_PCH);
+        int status = applyPrecompiledHeader(opts.pch);
+        endPhase(PHASE_LOAD_PCH);
+        if (status != 0) {
+            ctx->error_count++;
+            finishTimeReport(inputPath, opts.timeReport);
+            return 1;
+        }
+    }
+    beginPhase(PHASE_READ_INPUT);
+    int opened = openCompilerInput(context, inputPath);
+    endPhase(PHASE_READ_INPUT);
+    if (opened != 0) {
+        if (opened == 1) {
+            cerr << "Error: Cannot open file " << inputPath << endl;
+            ctx->error_count++;
+        }
+        finishTimeReport(inputPath, opts.timeReport);
         return 1;
     }
 
-    // cout << "[" << argv[1] << "]" << endl;
+    // cout << "[" << inputPath << "]" << endl;
 
-    if (yyparse() == 0 && error_count == 0) {
+    beginPhase(PHASE_PARSE);
+    bool parsed = (parseTranslationUnit() == 0 && ctx->error_count == 0);
+    endPhase(PHASE_PARSE);
+    if (parsed && opts.emitPchPath) {
+        // A header may only declare: anything that generates code would be
+        // lost from the snapshot
+        if (ctx->ast_root) {
+            generate_ir(ctx->ast_root);
+        }
+        if (ctx->irCount > 0 || ctx->staticVarCount > 0) {
+            cerr << "Error: " << inputPath << " contains definitions; only declarations can be precompiled" << endl;
+            ctx->error_count++;
+        } else if (writePrecompiledHeader(opts.emitPchPath, inputPath) != 0) {
+            ctx->error_count++;
+        } else {
+            cout << "Precompiled header: " << opts.emitPchPath << endl;
+        }
+    } else if (parsed && opts.syntaxOnly) {
+        // Nothing to write; diagnostics were reported while parsing
+    } else if (parsed) {
         // printSymbolTable();  // Commented for clean MIPS output
-        if (ast_root) {
-            generate_ir(ast_root);
+        if (ctx->ast_root) {
+            beginPhase(PHASE_GENERATE_IR);
+            generate_ir(ctx->ast_root);
+            endPhase(PHASE_GENERATE_IR);
 
-            string inputFile(argv[1]);
+            string inputFile(inputPath);
             string outputFile;
             size_t lastDot = inputFile.find_last_of('.');
             if (lastDot != string::npos) {
@@ -64,27 +166,31 @@ int main(int argc, char **argv) {
             } else {
                 outputFile = inputFile + ".ir";
             }
-            
+
+            beginPhase(PHASE_PRINT_IR);
             printIR(outputFile.c_str());
-            
+            endPhase(PHASE_PRINT_IR);
+
             // Perform basic block analysis if requested
-            if (analyzeBlocks) {
+            if (opts.analyzeBlocks) {
                 cout << "\n=== PERFORMING BASIC BLOCK ANALYSIS ===" << endl;
+                beginPhase(PHASE_ANALYZE_IR);
                 analyzeIR();
+                endPhase(PHASE_ANALYZE_IR);
                 printBasicBlocks();
                 printNextUseInfo();
                 cout << "\n=== BASIC BLOCK ANALYSIS COMPLETED ===" << endl;
             }
-            
+
             // Compute activation records if requested
-            if (computeActivationRecs) {
+            if (opts.computeActivationRecs) {
                 cout << "\n=== COMPUTING ACTIVATION RECORDS ===" << endl;
                 testActivationRecords();
                 cout << "\n=== ACTIVATION RECORDS COMPUTATION COMPLETED ===" << endl;
             }
-            
+
             // Generate MIPS assembly code if requested
-            if (generateMIPS) {
+            if (opts.generateMIPS) {
                 // Generate .s filename from input file (same pattern as .ir)
                 string asmFile;
                 if (lastDot != string::npos) {
@@ -100,11 +206,329 @@ int main(int argc, char **argv) {
 
     } else {
         cout << "=== PARSING FAILED ===" << endl;
-        if (error_count > 0) {
-            cout << "Total errors: " << error_count << endl;
+        if (ctx->error_count > 0) {
+            cout << "Total errors: " << ctx->error_count << endl;
         }
     }
 
-    fclose(yyin);
-    return (error_count > 0) ? 1 : 0;
+    closeCompilerInput(context);
+    finishTimeReport(inputPath, opts.timeReport);
+    return (ctx->error_count > 0) ? 1 : 0;
+}
+
+/**
+ * Append the file names listed in a @listfile (one per line, '#' comments)
+ */
+static bool readListFile(const char* listPath, vector<string>& files) {
+    ifstream in(listPath);
+    if (!in) {
+        cerr << "Error: Cannot open list file " << listPath << endl;
+        return false;
+    }
+    string line;
+    while (getline(in, line)) {
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == string::npos || line[first] == '#') continue;
+        size_t last = line.find_last_not_of(" \t\r");
+        files.push_back(line.substr(first, last - first + 1));
+    }
+    return true;
+}
+
+// Output of one unit in a forked batch worker: stdout and stderr go to
+// temporary files until the unit is done
+struct UnitOutput {
+    FILE* files[2];
+    int savedFds[2];
+};
+
+static const int unitOutputFds[2] = { STDOUT_FILENO, STDERR_FILENO };
+
+// File the batch workers fcntl-lock while copying a unit's output out
+static int outputLockFd = -1;
+
+static void flushAllOutput() {
+    cout.flush();
+    cerr.flush();
+    fflush(stdout);
+    fflush(stderr);
+}
+
+static void beginUnitOutput(UnitOutput& out) {
+    flushAllOutput();
+    for (int s = 0; s < 2; s++) {
+        out.files[s] = tmpfile();
+        out.savedFds[s] = out.files[s] ? dup(unitOutputFds[s]) : -1;
+        if (out.savedFds[s] < 0 || dup2(fileno(out.files[s]), unitOutputFds[s]) < 0) {
+            // Cannot capture: write straight through
+            if (out.savedFds[s] >= 0) close(out.savedFds[s]);
+            if (out.files[s]) fclose(out.files[s]);
+            out.files[s] = NULL;
+            out.savedFds[s] = -1;
+        }
+    }
+}
+
+static void writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written <= 0) return;
+        data += written;
+        size -= (size_t)written;
+    }
+}
+
+static void endUnitOutput(UnitOutput& out) {
+    flushAllOutput();
+    struct flock lock;
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    if (outputLockFd >= 0) fcntl(outputLockFd, F_SETLKW, &lock);
+    for (int s = 0; s < 2; s++) {
+        if (!out.files[s]) continue;
+        dup2(out.savedFds[s], unitOutputFds[s]);
+        close(out.savedFds[s]);
+        string text;
+        char chunk[8192];
+        size_t n;
+        rewind(out.files[s]);
+        while ((n = fread(chunk, 1, sizeof(chunk), out.files[s])) > 0) {
+            text.append(chunk, n);
+        }
+        fclose(out.files[s]);
+        writeAll(unitOutputFds[s], text.data(), text.size());
+    }
+    lock.l_type = F_UNLCK;
+    if (outputLockFd >= 0) fcntl(outputLockFd, F_SETLK, &lock);
+}
+
+/**
+ * Compile every file in sequence, reusing one context between units. With
+ * `bufferOutput`, each unit's output is held back and written in one piece.
+ */
+static int compileBatch(const vector<string>& files, size_t first, size_t stride, const CompileOptions& opts,
+                        bool bufferOutput) {
+    CompilerContext* context = createCompilerContext();
+    if (!context) {
+        return (int)files.size();
+    }
+    int failures = 0;
+    for (size_t f = first; f < files.size(); f += stride) {
+        UnitOutput out;
+        if (bufferOutput) beginUnitOutput(out);
+        cout << "--------------------------------------------" << endl;
+        cout << "Processing: " << files[f] << endl;
+        cout << "--------------------------------------------" << endl;
+        failures += compileFile(context, files[f].c_str(), opts);
+        cout << endl;
+        if (bufferOutput) endUnitOutput(out);
+    }
+    destroyCompilerContext(context);
+    return failures;
+}
+
+/**
+ * Compile server callback: options come with each request, on top of the
+ * code generation settings the server was started with. They only affect
+ * the request's own context.
+ */
+static int serveCompileRequest(CompilerContext* context, const char* inputPath, int flagCount, char** flags) {
+    CompileOptions opts = serverOptions;
+    opts.analyzeBlocks = false;
+    opts.computeActivationRecs = false;
+    opts.generateMIPS = false;
+    opts.syntaxOnly = false;
+    opts.emitPchPath = NULL;
+    opts.timeReport = TIME_REPORT_OFF;
+    for (int i = 0; i < flagCount; i++) {
+        if (parseCompileFlag(flags[i], opts) < 0) {
+            return 1;
+        }
+    }
+    return compileFile(context, inputPath, opts);
+}
+
+/**
+ * --simulate <file.s>: run generated assembly on the built-in simulator,
+ * optionally printing its execution statistics to stderr; arguments after
+ * "--" are passed to the program's main
+ */
+static int runSimulator(int argc, char** argv) {
+    SimulationOptions options;
+    memset(&options, 0, sizeof(options));
+    options.statsFormat = SIM_STATS_OFF;
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--") == 0) {
+            options.argc = argc - i - 1;
+            options.argv = argv + i + 1;
+            break;
+        } else if (strcmp(argv[i], "--sim-stats") == 0) {
+            options.statsFormat = SIM_STATS_TEXT;
+        } else if (strcmp(argv[i], "--sim-stats=json") == 0) {
+            options.statsFormat = SIM_STATS_JSON;
+        } else if (strcmp(argv[i], "--max-steps") == 0 && i + 1 < argc) {
+            options.maxInstructions = atoll(argv[++i]);
+        } else {
+            cerr << "Error: Unknown simulator option " << argv[i] << endl;
+            return 1;
+        }
+    }
+    SimulationStats stats;
+    if (simulateMIPSFile(argv[2], &options, &stats) != 0) {
+        return 1;
+    }
+    return stats.exitCode;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " <input_file> [options]" << endl;
+        cerr << "       " << argv[0] << " --batch <file|@listfile>... [options]" << endl;
+        cerr << "       " << argv[0] << " --server [socket_path] [--jobs N]" << endl;
+        cerr << "       " << argv[0] << " --simulate <file.s> [--sim-stats[=json]] [--max-steps N] [-- args...]" << endl;
+        cerr << "Options:" << endl;
+        cerr << "  --analyze-blocks       : Perform basic block analysis and print results" << endl;
+        cerr << "  --activation-records   : Compute and print activation records for functions" << endl;
+        cerr << "  --generate-mips        : Generate MIPS assembly code" << endl;
+        cerr << "  --syntax-only          : Only parse and check the input; write no IR or assembly" << endl;
+        cerr << "  --jobs N, --jobs=N     : Analyze and translate functions on N worker threads" << endl;
+        cerr << "  --time-report[=FMT]    : Print time, peak memory and item counts per phase to stderr (FMT: json, csv)" << endl;
+        cerr << "  --cache-dir[=]<dir>    : Reuse the assembly of unchanged functions from <dir>" << endl;
+        cerr << "  --io-runtime=MODE      : printf/scanf code: inline (default), auto or shared routines" << endl;
+        cerr << "  --mips-target=TARGET   : spim (default) or real: no pseudo-instructions, filled delay slots" << endl;
+        cerr << "  --schedule[=L,M,D]     : Reorder each block for load/multiply/divide latencies (default 1,11,34)" << endl;
+        cerr << "  --workers N            : In batch mode, split the files across N processes" << endl;
+        cerr << "  --emit-pch <file>      : Write the input header's declarations to a precompiled header" << endl;
+        cerr << "  --pch <file>           : Start every unit from a precompiled header" << endl;
+        return 1;
+    }
+
+    if (strcmp(argv[1], "--simulate") == 0) {
+        if (argc < 3) {
+            cerr << "Error: --simulate requires an assembly file" << endl;
+            return 1;
+        }
+        return runSimulator(argc, argv);
+    }
+
+    // Check for optional flags
+    CompileOptions opts;
+    opts.analyzeBlocks = false;
+    opts.computeActivationRecs = false;
+    opts.generateMIPS = false;
+    opts.syntaxOnly = false;
+    opts.pch = NULL;
+    opts.emitPchPath = NULL;
+    opts.timeReport = TIME_REPORT_OFF;
+    opts.jobs = 1;
+    opts.cacheDir = NULL;
+    opts.ioRuntime = IO_RUNTIME_INLINE;
+    opts.mipsTarget = MIPS_TARGET_SPIM;
+    opts.schedule = false;
+    memset(&opts.pipeline, 0, sizeof(opts.pipeline));
+    const char* pchPath = NULL;
+    bool batchMode = (strcmp(argv[1], "--batch") == 0);
+    bool serverMode = (strcmp(argv[1], "--server") == 0);
+    const char* socketPath = NULL;
+    int workers = 1;
+    vector<string> batchFiles;
+    int firstOption = 2;
+    if (serverMode && argc > 2 && strncmp(argv[2], "--", 2) != 0) {
+        socketPath = argv[2];
+        firstOption = 3;
+    }
+    for (int i = firstOption; i < argc; i++) {
+        int flag = parseCompileFlag(argv[i], opts);
+        if (flag < 0) {
+            return 1;
+        } else if (flag > 0) {
+            continue;
+        } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            opts.jobs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--cache-dir") == 0 && i + 1 < argc) {
+            opts.cacheDir = argv[++i];
+        } else if (strcmp(argv[i], "--pch") == 0 && i + 1 < argc) {
+            pchPath = argv[++i];
+        } else if (strcmp(argv[i], "--emit-pch") == 0 && i + 1 < argc) {
+            opts.emitPchPath = argv[++i];
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            workers = atoi(argv[++i]);
+            if (workers < 1) workers = 1;
+        } else if (batchMode && argv[i][0] == '@') {
+            if (!readListFile(argv[i] + 1, batchFiles)) {
+                return 1;
+            }
+        } else if (batchMode && strncmp(argv[i], "--", 2) != 0) {
+            batchFiles.push_back(argv[i]);
+        }
+    }
+
+    // Mapped once; forked batch workers share the mapping
+    if (pchPath) {
+        opts.pch = loadPrecompiledHeader(pchPath);
+        if (!opts.pch) {
+            return 1;
+        }
+    }
+
+    if (serverMode) {
+        serverOptions = opts;
+        return runCompileServer(socketPath, serveCompileRequest);
+    }
+
+    if (!batchMode) {
+        CompilerContext* context = createCompilerContext();
+        if (!context) {
+            return 1;
+        }
+        int status = compileFile(context, argv[1], opts);
+        destroyCompilerContext(context);
+        return status;
+    }
+
+    if (batchFiles.empty()) {
+        cerr << "Error: --batch requires at least one input file" << endl;
+        return 1;
+    }
+
+    if (workers > (int)batchFiles.size()) {
+        workers = (int)batchFiles.size();
+    }
+    if (workers <= 1) {
+        return (compileBatch(batchFiles, 0, 1, opts, false) > 0) ? 1 : 0;
+    }
+
+    // Each compilation owns its CompilerContext, but the modules report
+    // straight to stdout and stderr, so parallel batches run in forked
+    // workers that hold back each file's output and copy it out under a lock
+    // shared by all workers; worker w compiles files w, w+workers, ...
+    FILE* outputLock = tmpfile();
+    outputLockFd = outputLock ? fileno(outputLock) : -1;
+    flushAllOutput();
+    vector<pid_t> children;
+    for (int w = 0; w < workers; w++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            cerr << "Error: Cannot fork batch worker" << endl;
+            break;
+        }
+        if (pid == 0) {
+            int failures = compileBatch(batchFiles, w, workers, opts, true);
+            flushAllOutput();
+            _exit(failures > 0 ? 1 : 0);
+        }
+        children.push_back(pid);
+    }
+
+    int status = ((int)children.size() == workers) ? 0 : 1;
+    for (size_t c = 0; c < children.size(); c++) {
+        int childStatus = 0;
+        if (waitpid(children[c], &childStatus, 0) < 0 ||
+            !WIFEXITED(childStatus) || WEXITSTATUS(childStatus) != 0) {
+            status = 1;
+        }
+    }
+    if (outputLock) fclose(outputLock);
+    return status;
 }
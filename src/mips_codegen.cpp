@@ -8,18 +8,24 @@
 #include "ir_context.h"
 #include "symbol_table.h"
 #include "basic_block.h"
+#include "compiler_context.h"
+#include "time_report.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
-// External symbol table reference
-extern Symbol symtab[MAX_SYMBOLS];
-extern int symCount;
-
-// Global activation records for all functions
-static ActivationRecord activationRecords[MAX_FUNCTIONS];
-static int activationRecordCount = 0;
 
 // ============================================================================
 // Task 1.1: Helper Functions & Initialization
@@ -178,8 +184,8 @@ bool isFunctionEnd(const Quadruple* quad) {
  * Find a function in IR by name, returns start index
  */
 int findFunctionInIR(const char* funcName) {
-    for (int i = 0; i < irCount; i++) {
-        if (isFunctionBegin(&IR[i]) && strcmp(IR[i].arg1, funcName) == 0) {
+    for (int i = 0; i < ctx->irCount; i++) {
+        if (isFunctionBegin(&ctx->IR[i]) && strcmp(ctx->IR[i].arg1, funcName) == 0) {
             return i;
         }
     }
@@ -190,21 +196,21 @@ int findFunctionInIR(const char* funcName) {
  * Find function end index given start index
  */
 int findFunctionEnd(int funcStart) {
-    for (int i = funcStart + 1; i < irCount; i++) {
-        if (isFunctionEnd(&IR[i])) {
+    for (int i = funcStart + 1; i < ctx->irCount; i++) {
+        if (isFunctionEnd(&ctx->IR[i])) {
             return i;
         }
     }
-    return irCount - 1;
+    return ctx->irCount - 1;
 }
 
 /**
  * Get parameter count from symbol table
  */
 int getParameterCount(const char* funcName) {
-    for (int i = 0; i < symCount; i++) {
-        if (strcmp(symtab[i].name, funcName) == 0 && symtab[i].is_function) {
-            return symtab[i].param_count;
+    for (int i = 0; i < ctx->symCount; i++) {
+        if (strcmp(ctx->symtab[i].name, funcName) == 0 && ctx->symtab[i].is_function) {
+            return ctx->symtab[i].param_count;
         }
     }
     return 0;
@@ -215,12 +221,12 @@ int getParameterCount(const char* funcName) {
  */
 void getParameterNames(const char* funcName, char params[][128], int* count) {
     *count = 0;
-    for (int i = 0; i < symCount; i++) {
-        if (strcmp(symtab[i].name, funcName) == 0 && symtab[i].is_function) {
-            for (int p = 0; p < symtab[i].param_count; p++) {
-                strcpy(params[p], symtab[i].param_names[p]);
+    for (int i = 0; i < ctx->symCount; i++) {
+        if (strcmp(ctx->symtab[i].name, funcName) == 0 && ctx->symtab[i].is_function) {
+            for (int p = 0; p < ctx->symtab[i].param_count; p++) {
+                strcpy(params[p], ctx->symtab[i].param_names[p]);
             }
-            *count = symtab[i].param_count;
+            *count = ctx->symtab[i].param_count;
             return;
         }
     }
@@ -236,11 +242,11 @@ void getParameterNames(const char* funcName, char params[][128], int* count) {
 int countLocalsInFunction(const char* funcName) {
     int count = 0;
     
-    for (int i = 0; i < symCount; i++) {
+    for (int i = 0; i < ctx->symCount; i++) {
         // Check if variable belongs to this function's scope
-        if (strcmp(symtab[i].function_scope, funcName) == 0 && 
-            !symtab[i].is_function && 
-            strcmp(symtab[i].kind, "variable") == 0) {
+        if (strcmp(ctx->symtab[i].function_scope, funcName) == 0 && 
+            !ctx->symtab[i].is_function && 
+            strcmp(ctx->symtab[i].kind, "variable") == 0) {
             count++;
         }
     }
@@ -257,7 +263,7 @@ int countTemporariesInFunction(int funcStart, int funcEnd) {
     
     // Scan IR instructions in this function
     for (int i = funcStart + 1; i < funcEnd; i++) {
-        Quadruple* quad = &IR[i];
+        Quadruple* quad = &ctx->IR[i];
         
         // Check result field for temporaries
         if (strlen(quad->result) > 0 && isTemporary(quad->result)) {
@@ -349,6 +355,97 @@ int calculateFrameSize(const char* funcName, int funcStart, int funcEnd) {
 // Task 1.3: Variable Offset Assignment
 // ============================================================================
 
+/**
+ * Symbol `name` resolves to inside funcName: its own local or parameter,
+ * otherwise the global one
+ */
+static const Symbol* findFunctionSymbol(const char* funcName, const char* name) {
+    const Symbol* global = NULL;
+    for (int i = 0; i < ctx->symCount; i++) {
+        const Symbol* sym = &ctx->symtab[i];
+        if (strcmp(sym->name, name) != 0) {
+            continue;
+        }
+        if (strcmp(sym->function_scope, funcName) == 0) {
+            return sym;
+        }
+        if (global == NULL && sym->scope_level == 0) {
+            global = sym;
+        }
+    }
+    return global;
+}
+
+/**
+ * Whether a variable holds a double (8 bytes, kept in an FP register pair)
+ */
+static bool isDoubleSymbol(const Symbol* sym) {
+    return sym != NULL && !sym->is_function && !sym->is_array && sym->ptr_level == 0 &&
+           strstr(sym->type, "double") != NULL && strchr(sym->type, '*') == NULL;
+}
+
+/**
+ * Whether a double array, or a pointer to double, is indexed in steps of 8
+ */
+static bool hasDoubleElements(const Symbol* sym) {
+    return sym != NULL && !sym->is_function && strstr(sym->type, "double") != NULL &&
+           (sym->is_array ? sym->ptr_level == 0 : sym->ptr_level == 1);
+}
+
+/**
+ * Whether a declared type (of a parameter, or a return type) is double
+ */
+static bool isDoubleType(const char* type) {
+    return strstr(type, "double") != NULL && strchr(type, '*') == NULL && strchr(type, '[') == NULL;
+}
+
+/**
+ * Whether function funcName returns a double (in the $f0 pair)
+ */
+static bool returnsDouble(const char* funcName) {
+    for (int i = 0; i < ctx->symCount; i++) {
+        if (ctx->symtab[i].is_function && strcmp(ctx->symtab[i].name, funcName) == 0) {
+            return isDoubleType(ctx->symtab[i].return_type);
+        }
+    }
+    return false;
+}
+
+/**
+ * Whether the temporary a quad defines is a double: conversions to double,
+ * double arithmetic and copies, double array elements and dereferenced
+ * double pointers, and calls of functions returning double
+ */
+static bool definesDoubleTemporary(const char* funcName, const Quadruple* quad, const std::set<std::string>& doubles) {
+    const char* op = quad->op;
+    if (strstr(op, "_to_double") != NULL || strcmp(op, "FLOAT_TO_DOUBLE") == 0) {
+        return true;
+    }
+    if (strstr(op, "CAST") != NULL) {
+        return false;
+    }
+    
+    bool arg1Double = isTemporary(quad->arg1) ? doubles.count(quad->arg1) > 0
+                                               : isDoubleSymbol(findFunctionSymbol(funcName, quad->arg1));
+    if (strcmp(op, "ADD") == 0 || strcmp(op, "SUB") == 0 || strcmp(op, "MUL") == 0 || strcmp(op, "DIV") == 0 ||
+        strcmp(op, "+") == 0 || strcmp(op, "-") == 0 || strcmp(op, "*") == 0 || strcmp(op, "/") == 0) {
+        return strcmp(quad->resultType, "double") == 0;
+    }
+    if (strcmp(op, "NEG") == 0) {
+        return arg1Double;
+    }
+    if (strcmp(op, "ASSIGN") == 0 || strcmp(op, "=") == 0) {
+        return strcmp(quad->resultType, "double") == 0 || arg1Double;
+    }
+    if (strcmp(op, "ARRAY_ACCESS") == 0 || strcmp(op, "DEREF") == 0) {
+        return hasDoubleElements(findFunctionSymbol(funcName, quad->arg1));
+    }
+    if (strcmp(op, "CALL") == 0 || strcmp(op, "call") == 0) {
+        return returnsDouble(quad->arg1);
+    }
+    return false;
+}
+
 /**
  * Assign memory offsets to all variables in a function
  * 
@@ -375,36 +472,42 @@ void assignVariableOffsets(ActivationRecord* record, const char* funcName,
     // 1. Saving across function calls (especially recursive calls)
     // 2. Taking addresses of parameters (&param)
     // 3. Preserving values when $a0-$a3 get reused for nested calls
+    // A double takes two slots, its low word at the lower address
     for (int p = 0; p < paramCount; p++) {
         if (record->varCount < MAX_VARIABLES) {
+            bool isDouble = isDoubleSymbol(findFunctionSymbol(funcName, params[p]));
+            if (isDouble) {
+                offset -= 4;
+            }
             strcpy(record->variables[record->varCount].varName, params[p]);
             record->variables[record->varCount].offset = offset;
-            record->variables[record->varCount].size = 4;
+            record->variables[record->varCount].size = isDouble ? 8 : 4;
+            record->variables[record->varCount].isDouble = isDouble;
             record->varCount++;
             offset -= 4;
         }
     }
     
     // 2. Assign offsets to local variables (from symbol table)
-    for (int i = 0; i < symCount; i++) {
-        if (strcmp(symtab[i].function_scope, funcName) == 0 && 
-            !symtab[i].is_function && 
-            strcmp(symtab[i].kind, "variable") == 0) {
+    for (int i = 0; i < ctx->symCount; i++) {
+        if (strcmp(ctx->symtab[i].function_scope, funcName) == 0 && 
+            !ctx->symtab[i].is_function && 
+            strcmp(ctx->symtab[i].kind, "variable") == 0) {
             
             // Skip if it's a parameter (already handled)
             bool isParam = false;
             for (int p = 0; p < paramCount; p++) {
-                if (strcmp(symtab[i].name, params[p]) == 0) {
+                if (strcmp(ctx->symtab[i].name, params[p]) == 0) {
                     isParam = true;
                     break;
                 }
             }
             
             if (!isParam && record->varCount < MAX_VARIABLES) {
-                strcpy(record->variables[record->varCount].varName, symtab[i].name);
+                strcpy(record->variables[record->varCount].varName, ctx->symtab[i].name);
                 
                 // Calculate aligned size (CRITICAL FIX: ensure 4-byte alignment)
-                int varSize = symtab[i].size > 0 ? symtab[i].size : 4;
+                int varSize = ctx->symtab[i].size > 0 ? ctx->symtab[i].size : 4;
                 int alignedSize = ((varSize + 3) / 4) * 4;  // Round up to multiple of 4
                 
                 //  CRITICAL FIX: For arrays, offset should point to the BEGINNING of the array
@@ -427,6 +530,7 @@ void assignVariableOffsets(ActivationRecord* record, const char* funcName,
                 }
                 
                 record->variables[record->varCount].size = varSize;  // Store actual size
+                record->variables[record->varCount].isDouble = isDoubleSymbol(&ctx->symtab[i]);
                 record->varCount++;
             }
         }
@@ -440,7 +544,7 @@ void assignVariableOffsets(ActivationRecord* record, const char* funcName,
     
     // Collect unique temporaries
     for (int i = funcStart + 1; i < funcEnd; i++) {
-        Quadruple* quad = &IR[i];
+        Quadruple* quad = &ctx->IR[i];
         
         // Check result for temporaries
         if (strlen(quad->result) > 0 && isTemporary(quad->result)) {
@@ -457,17 +561,40 @@ void assignVariableOffsets(ActivationRecord* record, const char* funcName,
         }
     }
     
+    // Double temporaries: a temporary may copy one defined further down
+    // (t = u at the end of a loop body), so repeat until nothing changes
+    std::set<std::string> doubleTemps;
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (int i = funcStart + 1; i < funcEnd; i++) {
+            const Quadruple* quad = &ctx->IR[i];
+            if (isTemporary(quad->result) && !doubleTemps.count(quad->result) &&
+                definesDoubleTemporary(funcName, quad, doubleTemps)) {
+                doubleTemps.insert(quad->result);
+                changed = true;
+            }
+        }
+    }
+    
     // Assign offsets to temporaries
     for (int t = 0; t < tempCount; t++) {
         if (record->varCount < MAX_VARIABLES) {
+            bool isDouble = doubleTemps.count(temps[t]) > 0;
+            if (isDouble) {
+                offset -= 4;
+            }
             strcpy(record->variables[record->varCount].varName, temps[t]);
             record->variables[record->varCount].offset = offset;
-            record->variables[record->varCount].size = 4;
+            record->variables[record->varCount].size = isDouble ? 8 : 4;
+            record->variables[record->varCount].isDouble = isDouble;
             record->varCount++;
             offset -= 4;
         }
     }
     record->maxTemps = tempCount;
+    
+    // 4. Save slots of the callee-saved $s registers, $s0 first
+    record->savedRegsOffset = offset;
 }
 
 /**
@@ -500,13 +627,13 @@ int getArrayElementInfo(const char* arrayName, bool* isCharArray) {
     *isCharArray = false;  // Default to non-char array
     
     // Search symbol table for the array
-    for (int i = 0; i < symCount; i++) {
-        if (strcmp(symtab[i].name, arrayName) == 0) {
+    for (int i = 0; i < ctx->symCount; i++) {
+        if (strcmp(ctx->symtab[i].name, arrayName) == 0) {
             // CRITICAL FIX: For arrays, distinguish between:
             // - char arr[] : array of chars, element size = 1 byte
             // - char* arr[] : array of char pointers, element size = 4 bytes
             // Check if it's an ARRAY of pointers (ptr_level > 0 && is_array)
-            if (symtab[i].is_array && symtab[i].ptr_level > 0) {
+            if (ctx->symtab[i].is_array && ctx->symtab[i].ptr_level > 0) {
                 // Array of pointers: char* arr[], int* arr[], etc.
                 // Each element is a pointer (4 bytes in MIPS32)
                 *isCharArray = false;
@@ -514,16 +641,21 @@ int getArrayElementInfo(const char* arrayName, bool* isCharArray) {
             }
             
             // Check if it's a pure char array (not char*)
-            if (strstr(symtab[i].type, "char") != NULL && symtab[i].ptr_level == 0) {
+            if (strstr(ctx->symtab[i].type, "char") != NULL && ctx->symtab[i].ptr_level == 0) {
                 *isCharArray = true;
                 return 1;  // char elements are 1 byte
             }
             
+            // double arr[] and double* step over 8-byte elements
+            if (hasDoubleElements(&ctx->symtab[i])) {
+                return 8;
+            }
+            
             // Check for pointer types (int*, char*, etc.) that are NOT arrays
-            if (strstr(symtab[i].type, "*") != NULL || symtab[i].ptr_level > 0) {
+            if (strstr(ctx->symtab[i].type, "*") != NULL || ctx->symtab[i].ptr_level > 0) {
                 // In MIPS32, all pointers are 4 bytes (32-bit addresses)
                 // For pointer arithmetic (ptr + 1), we need the size of the pointed-to type
-                if (strstr(symtab[i].type, "char") != NULL && symtab[i].ptr_level == 1) {
+                if (strstr(ctx->symtab[i].type, "char") != NULL && ctx->symtab[i].ptr_level == 1) {
                     return 1;  // char* pointer arithmetic: ptr+1 adds 1 byte
                 }
                 return 4;  // int*, float*, other* pointer arithmetic: ptr+1 adds 4 bytes
@@ -543,10 +675,10 @@ int getArrayElementInfo(const char* arrayName, bool* isCharArray) {
  */
 bool isPointerVariable(const char* varName) {
     // Search symbol table (without scope restrictions, like getArrayElementInfo)
-    for (int i = 0; i < symCount; i++) {
-        if (strcmp(symtab[i].name, varName) == 0) {
+    for (int i = 0; i < ctx->symCount; i++) {
+        if (strcmp(ctx->symtab[i].name, varName) == 0) {
             // It's a pointer if ptr_level > 0 AND not an array
-            return (symtab[i].ptr_level > 0 && !symtab[i].is_array);
+            return (ctx->symtab[i].ptr_level > 0 && !ctx->symtab[i].is_array);
         }
     }
     return false;
@@ -560,29 +692,40 @@ bool isPointerVariable(const char* varName) {
  * Scan IR and build activation records for all functions
  */
 void computeActivationRecords() {
-    activationRecordCount = 0;
+    ctx->activationRecordCount = 0;
     
     // Find all functions in IR
     int i = 0;
-    while (i < irCount) {
-        if (isFunctionBegin(&IR[i])) {
-            const char* funcName = IR[i].arg1;
+    while (i < ctx->irCount) {
+        if (isFunctionBegin(&ctx->IR[i])) {
+            const char* funcName = ctx->IR[i].arg1;
             int funcStart = i;
             int funcEnd = findFunctionEnd(funcStart);
             
-            if (activationRecordCount < MAX_FUNCTIONS) {
-                ActivationRecord* record = &activationRecords[activationRecordCount];
+            if (ctx->activationRecordCount < MAX_FUNCTIONS) {
+                ActivationRecord* record = &ctx->activationRecords[ctx->activationRecordCount];
                 
                 // Set function name
                 strcpy(record->funcName, funcName);
                 
-                // Calculate frame size
-                record->frameSize = calculateFrameSize(funcName, funcStart, funcEnd);
+                // Calculate frame size, with room to save the callee-saved
+                // registers: as in the o32 convention every function
+                // preserves all of $s0-$s7, saving the ones it is handed
+                record->savedRegsSize = NUM_SAVED_REGS * 4;
+                record->frameSize = calculateFrameSize(funcName, funcStart, funcEnd) +
+                                    (record->savedRegsSize + 7) / 8 * 8;
                 
                 // Assign variable offsets
                 assignVariableOffsets(record, funcName, funcStart, funcEnd);
                 
-                activationRecordCount++;
+                // calculateFrameSize counts a word per variable; doubles
+                // and arrays may need more, down to the last $s slot
+                int used = record->savedRegsSize - record->savedRegsOffset;
+                if (record->frameSize < (used + 7) / 8 * 8) {
+                    record->frameSize = (used + 7) / 8 * 8;
+                }
+                
+                ctx->activationRecordCount++;
             }
             
             i = funcEnd + 1;
@@ -604,8 +747,8 @@ void printActivationRecords() {
     printf("ACTIVATION RECORDS (Stack Frame Layout)\n");
     printf("========================================\n\n");
     
-    for (int f = 0; f < activationRecordCount; f++) {
-        ActivationRecord* record = &activationRecords[f];
+    for (int f = 0; f < ctx->activationRecordCount; f++) {
+        ActivationRecord* record = &ctx->activationRecords[f];
         
         printf("Function: %s\n", record->funcName);
         printf("  Frame Size: %d bytes\n", record->frameSize);
@@ -633,7 +776,7 @@ void printActivationRecords() {
     }
     
     printf("========================================\n");
-    printf("Total Functions: %d\n", activationRecordCount);
+    printf("Total Functions: %d\n", ctx->activationRecordCount);
     printf("========================================\n\n");
 }
 
@@ -641,9 +784,9 @@ void printActivationRecords() {
  * Get activation record for a specific function
  */
 ActivationRecord* getActivationRecord(const char* funcName) {
-    for (int i = 0; i < activationRecordCount; i++) {
-        if (strcmp(activationRecords[i].funcName, funcName) == 0) {
-            return &activationRecords[i];
+    for (int i = 0; i < ctx->activationRecordCount; i++) {
+        if (strcmp(ctx->activationRecords[i].funcName, funcName) == 0) {
+            return &ctx->activationRecords[i];
         }
     }
     return NULL;
@@ -662,20 +805,27 @@ void initMIPSCodeGen(MIPSCodeGenerator* codegen) {
     }
     
     // Initialize all fields
-    codegen->IR = IR;
-    codegen->irCount = irCount;
-    codegen->blocks = blocks;
-    codegen->blockCount = blockCount;
+    codegen->IR = ctx->IR;
+    codegen->irCount = ctx->irCount;
+    codegen->blocks = ctx->blocks;
+    codegen->blockCount = ctx->blockCount;
     codegen->currentBlock = 0;
     codegen->inFunction = false;
+    codegen->currentIndex = 0;
+    codegen->tempLiveness = NULL;
+    codegen->tempLivenessCount = 0;
     codegen->currentFuncName[0] = '\0';
     codegen->currentFunction = NULL;
+    codegen->activationRecords = ctx->activationRecords;
     codegen->funcCount = 0;
+    codegen->outputFile = NULL;
+    codegen->outputBuffer = NULL;
     
     // Initialize register descriptors (all registers free initially)
     for (int i = 0; i < 32; i++) {
         codegen->regDescriptors[i].varCount = 0;
         codegen->regDescriptors[i].isDirty = false;
+        codegen->regDescriptors[i].allocated = false;
         for (int j = 0; j < 10; j++) {
 
             codegen->regDescriptors[i].varNames[j][0] = '\0';
@@ -688,14 +838,25 @@ void initMIPSCodeGen(MIPSCodeGenerator* codegen) {
     // Initialize function call state (Phase 3)
     codegen->currentParamCount = 0;
     codegen->stringCount = 0;
+    codegen->printfSegmentCount = 0;
+    codegen->sharedIORoutines = false;
     codegen->floatConstCount = 0;
+    codegen->doubleConstCount = 0;
+    codegen->doubleCompareCount = 0;
     codegen->varTypeCount = 0;
     for (int i = 0; i < 10; i++) {
         codegen->paramRegisterMap[i] = -1;
+        codegen->printfDoubles[i][0] = '\0';
     }
+    codegen->preservedRegCount = 0;
+    codegen->saveInsertPoint = 0;
+    codegen->restoreInsertPoints = NULL;
+    codegen->restoreInsertCount = 0;
+    codegen->restoreInsertCapacity = 0;
     for (int i = 0; i < 100; i++) {
         codegen->stringLiterals[i][0] = '\0';
         codegen->floatConstants[i][0] = '\0';
+        codegen->doubleConstants[i][0] = '\0';
     }
     for (int i = 0; i < MAX_VARIABLES; i++) {
         codegen->varTypes[i].varName[0] = '\0';
@@ -717,7 +878,9 @@ void testActivationRecords() {
     printf("╚════════════════════════════════════════════════════════════╝\n");
     
     // Compute activation records for all functions
+    beginPhase(PHASE_ACTIVATION_RECORDS);
     computeActivationRecords();
+    endPhase(PHASE_ACTIVATION_RECORDS);
     
     // Print the results
     printActivationRecords();
@@ -739,8 +902,12 @@ void initDescriptors(MIPSCodeGenerator* codegen) {
     for (int i = 0; i < 32; i++) {
         codegen->regDescriptors[i].varCount = 0;
         codegen->regDescriptors[i].isDirty = false;
+        codegen->regDescriptors[i].allocated = false;
+        codegen->fpRegDescriptors[i].varCount = 0;
+        codegen->fpRegDescriptors[i].isDirty = false;
         for (int j = 0; j < 10; j++) {
             codegen->regDescriptors[i].varNames[j][0] = '\0';
+            codegen->fpRegDescriptors[i].varNames[j][0] = '\0';
         }
     }
     
@@ -856,6 +1023,267 @@ int findAddressDescriptor(MIPSCodeGenerator* codegen, const char* varName) {
     return -1;
 }
 
+/**
+ * Whether quad->result is the variable the instruction assigns (stores,
+ * branches, PARAM and RETURN keep an operand or a label there)
+ */
+static bool writesResultOperand(const Quadruple* quad) {
+    const char* op = quad->op;
+    return !(strcmp(op, "LABEL") == 0 || (op[0] == 'L' && isdigit(op[1])) ||
+             strncmp(op, "IF_", 3) == 0 ||
+             strcmp(op, "GOTO") == 0 || strcmp(op, "goto") == 0 ||
+             strcmp(op, "PARAM") == 0 || strcmp(op, "param") == 0 ||
+             strcmp(op, "RETURN") == 0 || strcmp(op, "return") == 0 ||
+             strcmp(op, "ASSIGN_ARRAY") == 0 || strcmp(op, "ASSIGN_DEREF") == 0 ||
+             strcmp(op, "STORE_OFFSET") == 0 || strcmp(op, "STORE") == 0);
+}
+
+/**
+ * Collect the numbers of the temporaries t<n> mentioned in an operand,
+ * including inside forms like "[t3]" or "*t3". Returns how many were found
+ */
+static int findTemporaries(const char* operand, int* numbers, int maxNumbers) {
+    int found = 0;
+    for (int i = 0; operand[i] != '\0'; i++) {
+        if (operand[i] != 't' || !isdigit((unsigned char)operand[i + 1]) ||
+            (i > 0 && (isalnum((unsigned char)operand[i - 1]) || operand[i - 1] == '_'))) {
+            continue;
+        }
+        int j = i + 1;
+        int number = 0;
+        while (isdigit((unsigned char)operand[j]) && number < 1000000) {
+            number = number * 10 + (operand[j] - '0');
+            j++;
+        }
+        if (!isalnum((unsigned char)operand[j]) && operand[j] != '_' && found < maxNumbers) {
+            numbers[found++] = number;
+        }
+        i = j - 1;
+    }
+    return found;
+}
+
+/**
+ * Number of a temporary named exactly t<n> (-1 for anything else)
+ */
+static int temporaryNumber(const char* varName) {
+    if (!isTemporary(varName)) {
+        return -1;
+    }
+    int number = 0;
+    for (const char* c = varName + 1; *c; c++) {
+        if (!isdigit((unsigned char)*c) || number >= 1000000) {
+            return -1;
+        }
+        number = number * 10 + (*c - '0');
+    }
+    return number;
+}
+
+/**
+ * Record where each temporary of a function is defined and used. Returns a
+ * malloc'd table indexed by temporary number (NULL if out of memory)
+ */
+static TempLiveness* buildTempLiveness(const Quadruple* IR, int funcStart, int funcEnd, int* tempCount) {
+    int numbers[16];
+    int count = 0;
+    for (int i = funcStart; i <= funcEnd; i++) {
+        const Quadruple* quad = &IR[i];
+        const char* operands[3] = { quad->arg1, quad->arg2, quad->result };
+        for (int o = 0; o < 3; o++) {
+            int found = findTemporaries(operands[o], numbers, 16);
+            for (int k = 0; k < found; k++) {
+                if (numbers[k] >= count) count = numbers[k] + 1;
+            }
+        }
+    }
+    
+    TempLiveness* table = (TempLiveness*)malloc(sizeof(TempLiveness) * (count > 0 ? count : 1));
+    int* labelsBefore = (int*)malloc(sizeof(int) * (funcEnd - funcStart + 1));
+    if (!table || !labelsBefore) {
+        free(table);
+        free(labelsBefore);
+        *tempCount = 0;
+        return NULL;
+    }
+    *tempCount = count;
+    for (int n = 0; n < count; n++) {
+        table[n].defIndex = -1;
+        table[n].firstUse = -1;
+        table[n].lastUse = -1;
+        table[n].crossesLabel = false;
+    }
+    
+    int labels = 0;
+    for (int i = funcStart; i <= funcEnd; i++) {
+        const Quadruple* quad = &IR[i];
+        if (strcmp(quad->op, "LABEL") == 0 || (quad->op[0] == 'L' && isdigit(quad->op[1]))) {
+            labels++;
+        }
+        labelsBefore[i - funcStart] = labels;
+        
+        int defined = writesResultOperand(quad) ? temporaryNumber(quad->result) : -1;
+        bool readsItself = false;
+        const char* operands[3] = { quad->arg1, quad->arg2, quad->result };
+        for (int o = 0; o < 3; o++) {
+            int found = findTemporaries(operands[o], numbers, 16);
+            for (int k = 0; k < found; k++) {
+                TempLiveness* info = &table[numbers[k]];
+                if (info->firstUse < 0) info->firstUse = i;
+                info->lastUse = i;
+                if (o < 2 && numbers[k] == defined) readsItself = true;
+            }
+        }
+        
+        if (defined >= 0) {
+            // A definition reading its own old value makes the temporary loop-carried
+            table[defined].defIndex = (table[defined].defIndex == -1 && !readsItself) ? i : -2;
+        }
+        
+        // translateCall reads printf/scanf arguments again from memory; other
+        // calls take them from the argument registers PARAM loaded
+        if ((strcmp(quad->op, "CALL") == 0 || strcmp(quad->op, "call") == 0) &&
+            (strcmp(quad->arg1, "printf") == 0 || strcmp(quad->arg1, "scanf") == 0)) {
+            for (int p = i - 1; p >= funcStart; p--) {
+                const Quadruple* param = &IR[p];
+                if (strcmp(param->op, "CALL") == 0 || strcmp(param->op, "call") == 0) {
+                    break;
+                }
+                if (strcmp(param->op, "PARAM") == 0 || strcmp(param->op, "param") == 0) {
+                    int found = findTemporaries(param->arg1, numbers, 16);
+                    for (int k = 0; k < found; k++) {
+                        table[numbers[k]].lastUse = i;
+                    }
+                }
+            }
+        }
+    }
+    
+    for (int n = 0; n < count; n++) {
+        if (table[n].defIndex >= 0 && table[n].lastUse >= 0) {
+            table[n].crossesLabel = labelsBefore[table[n].lastUse - funcStart] !=
+                                    labelsBefore[table[n].defIndex - funcStart];
+        }
+    }
+    free(labelsBefore);
+    return table;
+}
+
+static void computeTempLiveness(MIPSCodeGenerator* codegen, int funcStart, int funcEnd) {
+    codegen->tempLiveness = buildTempLiveness(codegen->IR, funcStart, funcEnd, &codegen->tempLivenessCount);
+}
+
+/**
+ * Whether a temporary's value is computed before the call at callIndex and
+ * read after it, with no label in between (only then is its register
+ * content known to be the value at the later uses)
+ */
+static bool livesAcrossCall(const TempLiveness* info, int callIndex) {
+    return info->defIndex >= 0 && info->firstUse == info->defIndex && !info->crossesLabel &&
+           info->defIndex < callIndex && info->lastUse > callIndex;
+}
+
+static bool isCallInstruction(const Quadruple* quad) {
+    return (strcmp(quad->op, "CALL") == 0 || strcmp(quad->op, "call") == 0 ||
+            strcmp(quad->op, "INDIRECT_CALL") == 0) && strcmp(quad->arg1, "scanf") != 0;
+}
+
+static const char* labelName(const Quadruple* quad) {
+    if (strcmp(quad->op, "LABEL") == 0) {
+        return quad->arg1;
+    }
+    return (quad->op[0] == 'L' && isdigit(quad->op[1])) ? quad->op : NULL;
+}
+
+static const char* jumpTarget(const Quadruple* quad) {
+    if (strcmp(quad->op, "GOTO") == 0 || strcmp(quad->op, "goto") == 0) {
+        return quad->result[0] != '\0' ? quad->result : quad->arg1;
+    }
+    return strncmp(quad->op, "IF_", 3) == 0 ? quad->arg2 : NULL;
+}
+
+/**
+ * Number of callee-saved $s registers a function keeps temporaries in
+ * across its calls: the most temporaries live across any one call (scanf
+ * forgets every register, so it does not count), at most NUM_SAVED_REGS.
+ *
+ * Saving and restoring an $s register costs a store and a load per call
+ * of the function, about what keeping one value in memory across one call
+ * costs, so the registers are only used when the values are estimated to
+ * cross more calls than there are registers to save (a call between a
+ * label and a backward jump to it counts ten times). Otherwise, as in
+ * fib(n-1) + fib(n-2), they stay in memory and the function saves nothing
+ */
+static int countPreservedRegisters(const Quadruple* IR, int funcStart, int funcEnd) {
+    int count = 0;
+    int length = funcEnd - funcStart + 2;
+    TempLiveness* table = buildTempLiveness(IR, funcStart, funcEnd, &count);
+    int* liveAt = (int*)calloc(length, sizeof(int));
+    int* loopAt = (int*)calloc(length, sizeof(int));
+    if (!table || !liveAt || !loopAt) {
+        free(table);
+        free(liveAt);
+        free(loopAt);
+        return 0;
+    }
+    
+    // Temporary n is live across every instruction strictly inside (def, lastUse)
+    for (int n = 0; n < count; n++) {
+        if (livesAcrossCall(&table[n], table[n].defIndex + 1)) {
+            liveAt[table[n].defIndex + 1 - funcStart]++;
+            liveAt[table[n].lastUse - funcStart]--;
+        }
+    }
+    for (int j = funcStart; j <= funcEnd; j++) {
+        const char* target = jumpTarget(&IR[j]);
+        for (int a = funcStart; target != NULL && a < j; a++) {
+            const char* label = labelName(&IR[a]);
+            if (label != NULL && strcmp(label, target) == 0) {
+                loopAt[a - funcStart]++;
+                loopAt[j - funcStart]--;
+                break;
+            }
+        }
+    }
+    
+    int needed = 0;
+    int crossings = 0;
+    int live = 0;
+    int loops = 0;
+    for (int i = funcStart; i <= funcEnd; i++) {
+        live += liveAt[i - funcStart];
+        loops += loopAt[i - funcStart];
+        if (isCallInstruction(&IR[i])) {
+            crossings += live * (loops > 0 ? 10 : 1);
+            if (live > needed) needed = live;
+        }
+    }
+    free(table);
+    free(liveAt);
+    free(loopAt);
+    if (needed > NUM_SAVED_REGS) {
+        needed = NUM_SAVED_REGS;
+    }
+    return crossings > needed ? needed : 0;
+}
+
+/**
+ * A temporary is dead after irIndex when its only definition comes before
+ * every use, all uses are at or before irIndex, and no label between the
+ * definition and the last use lets a jump reach a use again. Stores made
+ * while translating instruction i ask about i - 1, as i itself may read
+ * the value from memory (printf arguments are)
+ */
+static bool isDeadTemporary(MIPSCodeGenerator* codegen, const char* varName, int irIndex) {
+    int n = temporaryNumber(varName);
+    if (n < 0 || n >= codegen->tempLivenessCount || lookupSymbol(varName) != NULL) {
+        return false;
+    }
+    const TempLiveness* info = &codegen->tempLiveness[n];
+    return info->defIndex >= 0 && info->firstUse == info->defIndex &&
+           !info->crossesLabel && info->lastUse <= irIndex;
+}
+
 // ============================================================================
 // Helper Functions
 // ============================================================================
@@ -864,8 +1292,59 @@ int findAddressDescriptor(MIPSCodeGenerator* codegen, const char* varName) {
  * Emit a MIPS instruction to output file
  */
 void emitMIPS(MIPSCodeGenerator* codegen, const char* instruction) {
-    if (codegen->outputFile) {
+    if (codegen->outputBuffer) {
+        MIPSOutputBuffer* buf = codegen->outputBuffer;
+        size_t len = strlen(instruction);
+        if (buf->length + len + 2 > buf->capacity) {
+            size_t newCapacity = buf->capacity ? buf->capacity * 2 : 4096;
+            while (newCapacity < buf->length + len + 2) {
+                newCapacity *= 2;
+            }
+            char* data = (char*)realloc(buf->data, newCapacity);
+            if (!data) {
+                fprintf(stderr, "Error: Cannot grow MIPS output buffer\n");
+                return;
+            }
+            buf->data = data;
+            buf->capacity = newCapacity;
+        }
+        memcpy(buf->data + buf->length, instruction, len);
+        buf->length += len;
+        buf->data[buf->length++] = '\n';
+        buf->data[buf->length] = '\0';
+    } else if (codegen->outputFile) {
         fprintf(codegen->outputFile, "%s\n", instruction);
+        ctx->mipsLineCount++;
+    }
+}
+
+/**
+ * Append pre-rendered assembly text (already newline-terminated)
+ */
+static void emitMIPSText(MIPSCodeGenerator* codegen, const char* text, size_t length) {
+    if (codegen->outputBuffer) {
+        MIPSOutputBuffer* buf = codegen->outputBuffer;
+        if (buf->length + length + 1 > buf->capacity) {
+            size_t newCapacity = buf->capacity ? buf->capacity * 2 : 4096;
+            while (newCapacity < buf->length + length + 1) {
+                newCapacity *= 2;
+            }
+            char* data = (char*)realloc(buf->data, newCapacity);
+            if (!data) {
+                fprintf(stderr, "Error: Cannot grow MIPS output buffer\n");
+                return;
+            }
+            buf->data = data;
+            buf->capacity = newCapacity;
+        }
+        memcpy(buf->data + buf->length, text, length);
+        buf->length += length;
+        buf->data[buf->length] = '\0';
+    } else if (codegen->outputFile) {
+        fwrite(text, 1, length, codegen->outputFile);
+        for (const char* p = text; (p = (const char*)memchr(p, '\n', text + length - p)) != NULL; p++) {
+            ctx->mipsLineCount++;
+        }
     }
 }
 
@@ -873,7 +1352,7 @@ void emitMIPS(MIPSCodeGenerator* codegen, const char* instruction) {
  * Get register name string (e.g., "$t0")
  */
 const char* getRegisterName(int regNum) {
-    static char regName[8];
+    static thread_local char regName[8];
     
     switch (regNum) {
         case REG_ZERO: return "$zero";
@@ -915,19 +1394,17 @@ const char* getRegisterName(int regNum) {
  */
 bool isGlobalVariable(MIPSCodeGenerator* codegen, const char* varName) {
     // Check symbol table for global variables
-    for (int i = 0; i < symCount; i++) {
-        if (strcmp(symtab[i].name, varName) == 0) {
-            if (symtab[i].scope_level == 0 && !symtab[i].is_function) {
+    for (int i = 0; i < ctx->symCount; i++) {
+        if (strcmp(ctx->symtab[i].name, varName) == 0) {
+            if (ctx->symtab[i].scope_level == 0 && !ctx->symtab[i].is_function) {
                 return true;
             }
         }
     }
     
     // Check staticVars array for static local variables (e.g., "func.var")
-    extern StaticVarInfo staticVars[];
-    extern int staticVarCount;
-    for (int i = 0; i < staticVarCount; i++) {
-        if (strcmp(staticVars[i].name, varName) == 0) {
+    for (int i = 0; i < ctx->staticVarCount; i++) {
+        if (strcmp(ctx->staticVars[i].name, varName) == 0) {
             return true;
         }
     }
@@ -998,8 +1475,10 @@ void spillRegister(MIPSCodeGenerator* codegen, int regNum) {
         int addrIdx = findAddressDescriptor(codegen, varName);
         if (addrIdx < 0) continue;
         
-        // Only store if NOT already in memory or if dirty
-        if (!codegen->addrDescriptors[addrIdx].inMemory || regDesc->isDirty) {
+        // Only store if NOT already in memory or if dirty, and some later
+        // instruction may still read the value
+        if ((!codegen->addrDescriptors[addrIdx].inMemory || regDesc->isDirty) &&
+            !isDeadTemporary(codegen, varName, codegen->currentIndex - 1)) {
             storeVariable(codegen, varName, regNum);
             codegen->addrDescriptors[addrIdx].inMemory = true;
         }
@@ -1012,6 +1491,27 @@ void spillRegister(MIPSCodeGenerator* codegen, int regNum) {
     clearRegisterDescriptor(codegen, regNum);
 }
 
+/**
+ * Find or create the _float<N> label of a float constant in the data section
+ * Returns -1 when the constant table is full
+ */
+static int findFloatConstant(MIPSCodeGenerator* codegen, const char* constant) {
+    for (int i = 0; i < codegen->floatConstCount; i++) {
+        if (strcmp(codegen->floatConstants[i], constant) == 0) {
+            return i;
+        }
+    }
+    
+    if (codegen->floatConstCount < 100) {
+        // Add new float constant
+        int floatIndex = codegen->floatConstCount;
+        strcpy(codegen->floatConstants[floatIndex], constant);
+        codegen->floatConstCount++;
+        return floatIndex;
+    }
+    return -1;
+}
+
 /**
  * Load variable from memory into register
  */
@@ -1032,21 +1532,7 @@ void loadVariable(MIPSCodeGenerator* codegen, const char* varName, int regNum) {
         
         // Handle float constants - load from .data section
         if (isFloatConstant(varName)) {
-            // Find or create float constant in data section
-            int floatIndex = -1;
-            for (int i = 0; i < codegen->floatConstCount; i++) {
-                if (strcmp(codegen->floatConstants[i], varName) == 0) {
-                    floatIndex = i;
-                    break;
-                }
-            }
-            
-            if (floatIndex < 0 && codegen->floatConstCount < 100) {
-                // Add new float constant
-                floatIndex = codegen->floatConstCount;
-                strcpy(codegen->floatConstants[floatIndex], varName);
-                codegen->floatConstCount++;
-            }
+            int floatIndex = findFloatConstant(codegen, varName);
             
             if (floatIndex >= 0) {
                 // Load float bits from data section as integer for storage
@@ -1153,81 +1639,410 @@ void storeVariable(MIPSCodeGenerator* codegen, const char* varName, int regNum)
 }
 
 /**
- * getReg Algorithm (Lecture 35)
- * Find a register to hold a variable
- * Returns register number (REG_T0 to REG_T9)
+ * Whether a variable not in any register has a value in memory to load:
+ * 1. Variable has inMemory flag set (was previously stored), OR
+ * 2. Variable is a global/static variable (in .data section), OR
+ * 3. Variable is a local or parameter (saved to stack in prologue)
+ *
+ * CRITICAL FIX: Do NOT load temporaries that have never been stored (inMemory = false)
+ * Temporaries only exist in registers until explicitly spilled
  */
-int getReg(MIPSCodeGenerator* codegen, const char* varName, int irIndex) {
-    char instr[256];
-    
-    // Skip if varName is empty or a constant
-    if (varName == NULL || strlen(varName) == 0) {
-        return REG_T0;  // Default register
-    }
-    
-    // CRITICAL FIX: Check if this variable is an ARRAY
-    // In C, when an array name is used in an expression, it decays to a pointer to its first element
-    // So we need to load the ADDRESS, not a value from memory
-    bool isArray = false;
-    
-    // First check symbol table for is_array flag (most reliable)
-    for (int i = 0; i < symCount; i++) {
-        if (strcmp(symtab[i].name, varName) == 0) {
-            // Check if it's in current function scope (or global if no current function)
-            bool inScope = false;
-            if (codegen->currentFunction == NULL) {
-                // Global scope
-                inScope = (strcmp(symtab[i].function_scope, "") == 0 || 
-                          strcmp(symtab[i].function_scope, "global") == 0);
-            } else {
-                // Local scope
-                inScope = (strcmp(symtab[i].function_scope, codegen->currentFunction->funcName) == 0);
-            }
-            
-            if (inScope && symtab[i].is_array && symtab[i].ptr_level == 0) {
-                isArray = true;
-                break;
+static bool hasMemoryValue(MIPSCodeGenerator* codegen, const char* varName, int addrIdx) {
+    if (addrIdx >= 0 && codegen->addrDescriptors[addrIdx].inMemory) {
+        return true;
+    } else if (isGlobalVariable(codegen, varName)) {
+        return true;
+    } else if (addrIdx < 0 && codegen->currentFunction != NULL) {
+        // No address descriptor - check if this is a declared local variable or parameter
+        // If it has a stack location, we should load from memory (might have been written by scanf/etc)
+        for (int v = 0; v < codegen->currentFunction->varCount; v++) {
+            if (strcmp(codegen->currentFunction->variables[v].varName, varName) == 0) {
+                // Found in activation record - it's a real variable with storage, load it
+                return true;
             }
         }
-    }
-    
-    // If it's an array, we need to compute its ADDRESS, not load a value
-    if (isArray) {
-        // Find an empty register or reuse if already computed
-        for (int r = REG_T0; r <= REG_T9; r++) {
-            // Check if we already have this array's address in a register
-            for (int v = 0; v < codegen->regDescriptors[r].varCount; v++) {
-                if (strcmp(codegen->regDescriptors[r].varNames[v], varName) == 0) {
-                    return r;  // Already have the address!
-                }
+    } else if (codegen->currentFunction != NULL) {
+        // Check if this is a parameter - parameters are saved in prologue
+        char params[16][128];
+        int paramCount = 0;
+        getParameterNames(codegen->currentFunction->funcName, params, &paramCount);
+        
+        for (int p = 0; p < paramCount; p++) {
+            if (strcmp(params[p], varName) == 0) {
+                return true;
             }
         }
-        
-        // Find empty register or spill one
-        int targetReg = REG_T0;
-        for (int r = REG_T0; r <= REG_T9; r++) {
-            if (codegen->regDescriptors[r].varCount == 0) {
-                targetReg = r;
-                break;
+    }
+    return false;
+}
+
+/**
+ * Whether name holds a double in the function of `record`: one of its
+ * variables or temporaries with an 8-byte double slot, or a global double
+ */
+static bool isDoubleIn(const ActivationRecord* record, const char* name) {
+    if (name[0] == '\0' || isConstantValue(name)) {
+        return false;
+    }
+    if (record != NULL) {
+        for (int v = 0; v < record->varCount; v++) {
+            if (strcmp(record->variables[v].varName, name) == 0) {
+                return record->variables[v].isDouble;
             }
         }
-        
-        if (codegen->regDescriptors[targetReg].varCount > 0) {
-            // Must spill
-            spillRegister(codegen, targetReg);
+    }
+    const Symbol* sym = findFunctionSymbol("", name);
+    return sym != NULL && sym->scope_level == 0 && isDoubleSymbol(sym);
+}
+
+static bool isDoubleValue(MIPSCodeGenerator* codegen, const char* name) {
+    return isDoubleIn(codegen->currentFunction, name);
+}
+
+/**
+ * FP registers handed out by getFloatReg. Only even registers are used, so
+ * the odd partner of each stays free for a double-precision pair; $f0/$f2
+ * are scratch for conversions and syscall results and $f12/$f14 carry
+ * float arguments to syscalls and the runtime library.
+ */
+static const int allocatableFloatRegs[NUM_FLOAT_REGS] = {
+    4, 6, 8, 10, 16, 18, 20, 22, 24, 26, 28, 30
+};
+
+/**
+ * Find the FP register holding varName (-1 if none)
+ */
+static int findFloatRegister(MIPSCodeGenerator* codegen, const char* varName) {
+    for (int i = 0; i < NUM_FLOAT_REGS; i++) {
+        RegisterDescriptor* desc = &codegen->fpRegDescriptors[allocatableFloatRegs[i]];
+        if (desc->varCount > 0 && strcmp(desc->varNames[0], varName) == 0) {
+            return allocatableFloatRegs[i];
         }
-        
-        // Compute array base address: addiu reg, $fp, offset
-        char location[128];
-        getMemoryLocation(codegen, varName, location);
-        
-        // Parse offset from location string like "-24($fp)"
-        int offset = 0;
-        if (strstr(location, "($fp)") != NULL) {
-            sscanf(location, "%d($fp)", &offset);
-            sprintf(instr, "    addiu %s, $fp, %d    # Load address of array %s", 
-                    getRegisterName(targetReg), offset, varName);
-            emitMIPS(codegen, instr);
+    }
+    return -1;
+}
+
+/**
+ * Float results may live only in an FP register; copy one into integer
+ * register regNum with mfc1 instead of loading it from memory
+ */
+static bool copyFromFloatRegister(MIPSCodeGenerator* codegen, const char* varName, int regNum) {
+    int freg = findFloatRegister(codegen, varName);
+    if (freg < 0 || isDoubleValue(codegen, varName)) {
+        return false;
+    }
+    
+    char instr[256];
+    sprintf(instr, "    mfc1 %s, $f%d    # %s from FP register", getRegisterName(regNum), freg, varName);
+    emitMIPS(codegen, instr);
+    return true;
+}
+
+/**
+ * Store a newly computed result. Temporaries are written back lazily: they
+ * stay dirty in the register until a spill, block boundary or call needs
+ * them in memory. Other variables are stored right away, as pointers and
+ * called functions may read them. Call after updateDescriptors.
+ */
+static void storeResult(MIPSCodeGenerator* codegen, const char* varName, int regNum) {
+    int addrIdx = findOrCreateAddrDesc(codegen, varName);
+    if (isTemporary(varName) && lookupSymbol(varName) == NULL) {
+        codegen->regDescriptors[regNum].isDirty = true;
+        if (addrIdx >= 0) {
+            codegen->addrDescriptors[addrIdx].inMemory = false;
+        }
+        return;
+    }
+    
+    storeVariable(codegen, varName, regNum);
+    if (addrIdx >= 0) {
+        codegen->addrDescriptors[addrIdx].inMemory = true;
+    }
+    
+    // Clean again unless another value in the register is still pending
+    RegisterDescriptor* regDesc = &codegen->regDescriptors[regNum];
+    bool pending = false;
+    for (int v = 0; v < regDesc->varCount; v++) {
+        int idx = findAddressDescriptor(codegen, regDesc->varNames[v]);
+        if (idx >= 0 && !codegen->addrDescriptors[idx].inMemory && !isConstantValue(regDesc->varNames[v])) {
+            pending = true;
+        }
+    }
+    regDesc->isDirty = pending;
+}
+
+/**
+ * Registers getReg hands out: $t0-$t7 ($t8 and $t9 are scratch registers),
+ * then $s0-$s7. An $s register must be saved by the function that uses it,
+ * which needs a buffer to insert the saves into once the body is generated
+ */
+static bool isAllocatableRegister(MIPSCodeGenerator* codegen, int regNum) {
+    if (regNum >= REG_T0 && regNum <= REG_T7) {
+        return true;
+    }
+    if (regNum < REG_S0 || regNum > REG_S7) {
+        return false;
+    }
+    return codegen->outputBuffer != NULL;
+}
+
+/**
+ * Whether a register keeps its value through a call: a callee-saved $s
+ * register holding only temporaries, which no callee can reach
+ */
+static bool survivesCall(MIPSCodeGenerator* codegen, int regNum) {
+    RegisterDescriptor* regDesc = &codegen->regDescriptors[regNum];
+    if (regNum < REG_S0 || regNum > REG_S7 || regDesc->varCount == 0) {
+        return false;
+    }
+    for (int v = 0; v < regDesc->varCount; v++) {
+        if (!isTemporary(regDesc->varNames[v]) || lookupSymbol(regDesc->varNames[v]) != NULL) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Whether a register holds a value that must reach memory before control
+ * leaves the block
+ */
+static bool needsSpill(MIPSCodeGenerator* codegen, int regNum) {
+    RegisterDescriptor* regDesc = &codegen->regDescriptors[regNum];
+    if (regDesc->varCount == 0) {
+        return false;
+    }
+    if (regDesc->isDirty) {
+        return true;
+    }
+    for (int v = 0; v < regDesc->varCount; v++) {
+        int addrIdx = findAddressDescriptor(codegen, regDesc->varNames[v]);
+        if (addrIdx >= 0 && !codegen->addrDescriptors[addrIdx].inMemory &&
+            !isConstantValue(regDesc->varNames[v])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Store the live values that exist only in registers and keep them there
+ * (before calls and stores through pointers, after which the registers
+ * are forgotten). Before a call, registers that survive it are left alone
+ */
+static void writeBackRegisters(MIPSCodeGenerator* codegen, bool acrossCall) {
+    for (int r = REG_T0; r <= REG_T9; r++) {
+        RegisterDescriptor* regDesc = &codegen->regDescriptors[r];
+        if (!needsSpill(codegen, r) || (acrossCall && survivesCall(codegen, r))) {
+            continue;
+        }
+        for (int v = 0; v < regDesc->varCount; v++) {
+            const char* varName = regDesc->varNames[v];
+            int addrIdx = findAddressDescriptor(codegen, varName);
+            if (addrIdx < 0 || isConstantValue(varName)) {
+                continue;
+            }
+            if ((!codegen->addrDescriptors[addrIdx].inMemory || regDesc->isDirty) &&
+                !isDeadTemporary(codegen, varName, codegen->currentIndex - 1)) {
+                storeVariable(codegen, varName, r);
+                codegen->addrDescriptors[addrIdx].inMemory = true;
+            }
+        }
+        regDesc->isDirty = false;
+    }
+}
+
+/**
+ * Store one pending value before code reads it through its stack slot
+ * (a temporary used as an array base is addressed, not loaded)
+ */
+static void writeBackVariable(MIPSCodeGenerator* codegen, const char* varName) {
+    int addrIdx = findAddressDescriptor(codegen, varName);
+    if (addrIdx < 0 || codegen->addrDescriptors[addrIdx].inMemory) {
+        return;
+    }
+    for (int r = REG_T0; r <= REG_T9; r++) {
+        for (int v = 0; v < codegen->regDescriptors[r].varCount; v++) {
+            if (strcmp(codegen->regDescriptors[r].varNames[v], varName) == 0) {
+                storeVariable(codegen, varName, r);
+                codegen->addrDescriptors[addrIdx].inMemory = true;
+                return;
+            }
+        }
+    }
+}
+
+/**
+ * Move the temporaries that are still needed after the call at callIndex
+ * from $t registers into free callee-saved $s registers, where the call
+ * leaves them. Without a free $s register they are written back as before
+ */
+static void preserveAcrossCall(MIPSCodeGenerator* codegen, int callIndex) {
+    char instr[256];
+    if (codegen->preservedRegCount == 0 || codegen->outputBuffer == NULL) {
+        return;
+    }
+    
+    for (int r = REG_T0; r <= REG_T7; r++) {
+        RegisterDescriptor* regDesc = &codegen->regDescriptors[r];
+        bool needed = false;
+        bool onlyTemporaries = regDesc->varCount > 0;
+        for (int v = 0; v < regDesc->varCount; v++) {
+            int n = temporaryNumber(regDesc->varNames[v]);
+            if (n < 0 || lookupSymbol(regDesc->varNames[v]) != NULL) {
+                onlyTemporaries = false;
+            } else if (n < codegen->tempLivenessCount && livesAcrossCall(&codegen->tempLiveness[n], callIndex)) {
+                needed = true;
+            }
+        }
+        if (!needed || !onlyTemporaries) {
+            continue;
+        }
+        
+        // An $s register is free when empty or left with temporaries nobody reads again
+        int target = -1;
+        for (int s = REG_S0; s < REG_S0 + codegen->preservedRegCount && target < 0; s++) {
+            RegisterDescriptor* savedDesc = &codegen->regDescriptors[s];
+            bool available = true;
+            for (int v = 0; v < savedDesc->varCount; v++) {
+                if (!isDeadTemporary(codegen, savedDesc->varNames[v], callIndex - 1)) {
+                    available = false;
+                }
+            }
+            if (available) {
+                target = s;
+            }
+        }
+        if (target < 0) {
+            return;
+        }
+        
+        sprintf(instr, "    move %s, %s    # Keep %s across the call",
+                getRegisterName(target), getRegisterName(r), regDesc->varNames[0]);
+        emitMIPS(codegen, instr);
+        clearRegisterDescriptor(codegen, target);
+        codegen->regDescriptors[target] = *regDesc;
+        codegen->regDescriptors[target].allocated = true;
+        for (int v = 0; v < regDesc->varCount; v++) {
+            int addrIdx = findAddressDescriptor(codegen, regDesc->varNames[v]);
+            if (addrIdx >= 0) {
+                codegen->addrDescriptors[addrIdx].inRegister = target;
+            }
+        }
+        clearRegisterDescriptor(codegen, r);
+    }
+}
+
+/**
+ * After a call: forget what the caller-saved $t and $a registers held,
+ * except resultReg (the return value) and the registers that survive
+ */
+static void forgetCallerSavedRegisters(MIPSCodeGenerator* codegen, int resultReg) {
+    for (int r = REG_T0; r <= REG_T9; r++) {
+        if (r != resultReg && !survivesCall(codegen, r)) {
+            clearRegisterDescriptor(codegen, r);
+        }
+    }
+    for (int r = REG_A0; r <= REG_A3; r++) {
+        clearRegisterDescriptor(codegen, r);
+    }
+}
+
+/**
+ * Whether a register holds an operand of the instruction being translated,
+ * which must not be evicted to make room for another of its operands
+ */
+static bool holdsOperand(MIPSCodeGenerator* codegen, int regNum, int irIndex) {
+    if (irIndex < 0 || irIndex >= codegen->irCount) {
+        return false;
+    }
+    const Quadruple* quad = &codegen->IR[irIndex];
+    RegisterDescriptor* regDesc = &codegen->regDescriptors[regNum];
+    for (int v = 0; v < regDesc->varCount; v++) {
+        if (strcmp(regDesc->varNames[v], quad->arg1) == 0 ||
+            strcmp(regDesc->varNames[v], quad->arg2) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * getReg Algorithm (Lecture 35)
+ * Find a register to hold a variable
+ * Returns register number (REG_T0 to REG_T9)
+ */
+static int selectRegister(MIPSCodeGenerator* codegen, const char* varName, int irIndex) {
+    char instr[256];
+    
+    // Skip if varName is empty or a constant
+    if (varName == NULL || strlen(varName) == 0) {
+        return REG_T0;  // Default register
+    }
+    
+    // CRITICAL FIX: Check if this variable is an ARRAY
+    // In C, when an array name is used in an expression, it decays to a pointer to its first element
+    // So we need to load the ADDRESS, not a value from memory
+    bool isArray = false;
+    
+    // First check symbol table for is_array flag (most reliable)
+    for (int i = 0; i < ctx->symCount; i++) {
+        if (strcmp(ctx->symtab[i].name, varName) == 0) {
+            // Check if it's in current function scope (or global if no current function)
+            bool inScope = false;
+            if (codegen->currentFunction == NULL) {
+                // Global scope
+                inScope = (strcmp(ctx->symtab[i].function_scope, "") == 0 || 
+                          strcmp(ctx->symtab[i].function_scope, "global") == 0);
+            } else {
+                // Local scope
+                inScope = (strcmp(ctx->symtab[i].function_scope, codegen->currentFunction->funcName) == 0);
+            }
+            
+            if (inScope && ctx->symtab[i].is_array && ctx->symtab[i].ptr_level == 0) {
+                isArray = true;
+                break;
+            }
+        }
+    }
+    
+    // If it's an array, we need to compute its ADDRESS, not load a value
+    if (isArray) {
+        // Find an empty register or reuse if already computed
+        for (int r = REG_T0; r <= REG_T9; r++) {
+            // Check if we already have this array's address in a register
+            for (int v = 0; v < codegen->regDescriptors[r].varCount; v++) {
+                if (strcmp(codegen->regDescriptors[r].varNames[v], varName) == 0) {
+                    return r;  // Already have the address!
+                }
+            }
+        }
+        
+        // Find empty register or spill one
+        int targetReg = REG_T0;
+        for (int r = REG_T0; r <= REG_T9; r++) {
+            if (codegen->regDescriptors[r].varCount == 0 && isAllocatableRegister(codegen, r)) {
+                targetReg = r;
+                break;
+            }
+        }
+        
+        if (codegen->regDescriptors[targetReg].varCount > 0) {
+            // Must spill
+            spillRegister(codegen, targetReg);
+        }
+        
+        // Compute array base address: addiu reg, $fp, offset
+        char location[128];
+        getMemoryLocation(codegen, varName, location);
+        
+        // Parse offset from location string like "-24($fp)"
+        int offset = 0;
+        if (strstr(location, "($fp)") != NULL) {
+            sscanf(location, "%d($fp)", &offset);
+            sprintf(instr, "    addiu %s, $fp, %d    # Load address of array %s", 
+                    getRegisterName(targetReg), offset, varName);
+            emitMIPS(codegen, instr);
         } else {
             // Global array - use la
             sprintf(instr, "    la %s, %s    # Load address of global array %s", 
@@ -1248,7 +2063,7 @@ int getReg(MIPSCodeGenerator* codegen, const char* varName, int irIndex) {
     if (isConstantValue(varName)) {
         // For constants, find an empty register and load the constant
         for (int r = REG_T0; r <= REG_T9; r++) {
-            if (codegen->regDescriptors[r].varCount == 0) {
+            if (codegen->regDescriptors[r].varCount == 0 && isAllocatableRegister(codegen, r)) {
                 loadVariable(codegen, varName, r);
                 // CRITICAL FIX: Must update descriptors to prevent register reallocation during same instruction
                 // Constants need temporary tracking within an instruction to avoid clobbering
@@ -1267,7 +2082,8 @@ int getReg(MIPSCodeGenerator* codegen, const char* varName, int irIndex) {
         // Try to find a better victim using next-use information
         int maxNextUse = -1;
         for (int r = REG_T0; r <= REG_T9; r++) {
-            if (codegen->regDescriptors[r].varCount > 0) {
+            if (codegen->regDescriptors[r].varCount > 0 && isAllocatableRegister(codegen, r) &&
+                !holdsOperand(codegen, r, irIndex)) {
                 const char* victimVar = codegen->regDescriptors[r].varNames[0];
                 
                 // Check if variable is dead (no next use)
@@ -1325,49 +2141,16 @@ int getReg(MIPSCodeGenerator* codegen, const char* varName, int irIndex) {
     
     // CASE 2: Find an empty temporary register
     for (int r = REG_T0; r <= REG_T9; r++) {
-        if (codegen->regDescriptors[r].varCount == 0) {
+        if (codegen->regDescriptors[r].varCount == 0 && isAllocatableRegister(codegen, r)) {
             // Empty register found!
-            // Load from memory if:
-            // 1. Variable has inMemory flag set (was previously stored), OR  
-            // 2. Variable is a global/static variable (in .data section), OR
-            // 3. Variable is a parameter (saved to stack in prologue)
-            //
-            // CRITICAL FIX: Do NOT load temporaries that have never been stored (inMemory = false)
-            // Temporaries only exist in registers until explicitly spilled
-            bool shouldLoad = false;
-            
-            if (addrIdx >= 0 && codegen->addrDescriptors[addrIdx].inMemory) {
-                shouldLoad = true;
-            } else if (isGlobalVariable(codegen, varName)) {
-                shouldLoad = true;
-            } else if (addrIdx < 0 && codegen->currentFunction != NULL) {
-                // No address descriptor - check if this is a declared local variable or parameter
-                // If it has a stack location, we should load from memory (might have been written by scanf/etc)
-                for (int v = 0; v < codegen->currentFunction->varCount; v++) {
-                    if (strcmp(codegen->currentFunction->variables[v].varName, varName) == 0) {
-                        // Found in activation record - it's a real variable with storage, load it
-                        shouldLoad = true;
-                        break;
-                    }
-                }
-            } else if (codegen->currentFunction != NULL) {
-                // Check if this is a parameter - parameters are saved in prologue
-                char params[16][128];
-                int paramCount = 0;
-                getParameterNames(codegen->currentFunction->funcName, params, &paramCount);
-                
-                for (int p = 0; p < paramCount; p++) {
-                    if (strcmp(params[p], varName) == 0) {
-                        shouldLoad = true;
-                        break;
-                    }
-                }
-            }
-            
-            if (shouldLoad) {
+            bool loaded = false;
+            if (!copyFromFloatRegister(codegen, varName, r) && hasMemoryValue(codegen, varName, addrIdx)) {
                 loadVariable(codegen, varName, r);
+                loaded = true;
             }
             updateDescriptors(codegen, r, varName);
+            // A value just loaded matches memory
+            codegen->regDescriptors[r].isDirty = !loaded;
             return r;
         }
     }
@@ -1379,7 +2162,8 @@ int getReg(MIPSCodeGenerator* codegen, const char* varName, int irIndex) {
     // Try to find a better victim using next-use information
     int maxNextUse = -1;
     for (int r = REG_T0; r <= REG_T9; r++) {
-        if (codegen->regDescriptors[r].varCount > 0) {
+        if (codegen->regDescriptors[r].varCount > 0 && isAllocatableRegister(codegen, r) &&
+            !holdsOperand(codegen, r, irIndex)) {
             const char* victimVar = codegen->regDescriptors[r].varNames[0];
             
             // Check if variable is dead (no next use)
@@ -1405,25 +2189,273 @@ int getReg(MIPSCodeGenerator* codegen, const char* varName, int irIndex) {
     spillRegister(codegen, victimReg);
     
     // FIX: Only load from memory if variable has been initialized
-    if (addrIdx >= 0 && codegen->addrDescriptors[addrIdx].inMemory) {
+    bool loaded = false;
+    if (copyFromFloatRegister(codegen, varName, victimReg)) {
+        // Float temporary kept in an FP register
+    } else if (hasMemoryValue(codegen, varName, addrIdx)) {
         loadVariable(codegen, varName, victimReg);
+        loaded = true;
     }
     updateDescriptors(codegen, victimReg, varName);
+    codegen->regDescriptors[victimReg].isDirty = !loaded;
     
     return victimReg;
 }
 
+/**
+ * Register for a variable (see selectRegister); records the registers the
+ * function is handed so the prologue saves exactly the $s ones among them
+ */
+int getReg(MIPSCodeGenerator* codegen, const char* varName, int irIndex) {
+    int reg = selectRegister(codegen, varName, irIndex);
+    codegen->regDescriptors[reg].allocated = true;
+    return reg;
+}
+
 // ============================================================================
-// Task 2.3 & 2.4: Instruction Translation
+// Floating-Point Register Allocation
 // ============================================================================
 
 /**
- * Translate arithmetic operation (ADD, SUB, MUL, DIV, MOD)
+ * Store an FP register to the memory location of the variable it holds
  */
-void translateArithmetic(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
+static void storeFloatRegister(MIPSCodeGenerator* codegen, int freg) {
     char instr[256];
-    int regResult;  // Declare here, assign in each branch
+    char location[128];
+    RegisterDescriptor* desc = &codegen->fpRegDescriptors[freg];
+    const char* varName = desc->varNames[0];
+    
+    getMemoryLocation(codegen, varName, location);
+    if (isDoubleValue(codegen, varName)) {
+        sprintf(instr, "    s.d $f%d, %s    # Store double %s", freg, location, varName);
+    } else {
+        sprintf(instr, "    swc1 $f%d, %s    # Store float %s", freg, location, varName);
+    }
+    emitMIPS(codegen, instr);
     
+    int addrIdx = findOrCreateAddrDesc(codegen, varName);
+    if (addrIdx >= 0) {
+        codegen->addrDescriptors[addrIdx].inMemory = true;
+    }
+    desc->isDirty = false;
+}
+
+/**
+ * Whether a dirty FP register still needs storing: its value may already
+ * have reached memory through an integer register copy (mfc1, then a spill)
+ */
+static bool needsFloatStore(MIPSCodeGenerator* codegen, int freg) {
+    RegisterDescriptor* desc = &codegen->fpRegDescriptors[freg];
+    if (desc->varCount == 0 || !desc->isDirty || isConstantValue(desc->varNames[0])) {
+        return false;
+    }
+    int addrIdx = findAddressDescriptor(codegen, desc->varNames[0]);
+    return addrIdx < 0 || !codegen->addrDescriptors[addrIdx].inMemory;
+}
+
+static void clearFloatRegister(MIPSCodeGenerator* codegen, int freg) {
+    codegen->fpRegDescriptors[freg].varCount = 0;
+    codegen->fpRegDescriptors[freg].isDirty = false;
+    codegen->fpRegDescriptors[freg].varNames[0][0] = '\0';
+}
+
+/**
+ * Spill an FP register to memory (constants are never stored back)
+ */
+static void spillFloatRegister(MIPSCodeGenerator* codegen, int freg) {
+    if (needsFloatStore(codegen, freg)) {
+        storeFloatRegister(codegen, freg);
+    }
+    clearFloatRegister(codegen, freg);
+}
+
+void writeBackFloatRegisters(MIPSCodeGenerator* codegen) {
+    for (int i = 0; i < NUM_FLOAT_REGS; i++) {
+        int freg = allocatableFloatRegs[i];
+        if (needsFloatStore(codegen, freg)) {
+            storeFloatRegister(codegen, freg);
+        } else {
+            codegen->fpRegDescriptors[freg].isDirty = false;
+        }
+    }
+}
+
+void clearFloatRegisters(MIPSCodeGenerator* codegen) {
+    for (int i = 0; i < NUM_FLOAT_REGS; i++) {
+        clearFloatRegister(codegen, allocatableFloatRegs[i]);
+    }
+}
+
+/**
+ * Find a free FP register, spilling a dead value or the one with the
+ * furthest next use when all are taken (same policy as getReg)
+ */
+static int allocateFloatRegister(MIPSCodeGenerator* codegen, int irIndex, int avoid1, int avoid2) {
+    for (int i = 0; i < NUM_FLOAT_REGS; i++) {
+        int freg = allocatableFloatRegs[i];
+        if (freg != avoid1 && freg != avoid2 && codegen->fpRegDescriptors[freg].varCount == 0) {
+            return freg;
+        }
+    }
+    
+    int victimReg = -1;
+    int maxNextUse = -1;
+    for (int i = 0; i < NUM_FLOAT_REGS; i++) {
+        int freg = allocatableFloatRegs[i];
+        if (freg == avoid1 || freg == avoid2) {
+            continue;
+        }
+        
+        bool isLive = false;
+        int nextUseIdx = -1;
+        getNextUseInfo(irIndex, codegen->fpRegDescriptors[freg].varNames[0], &isLive, &nextUseIdx);
+        
+        if (!isLive || nextUseIdx < 0) {
+            victimReg = freg;
+            break;
+        }
+        if (nextUseIdx > maxNextUse) {
+            maxNextUse = nextUseIdx;
+            victimReg = freg;
+        }
+    }
+    
+    spillFloatRegister(codegen, victimReg);
+    return victimReg;
+}
+
+int getFloatReg(MIPSCodeGenerator* codegen, const char* varName, int irIndex, int avoid1, int avoid2) {
+    char instr[256];
+    
+    // Already in an FP register?
+    int freg = findFloatRegister(codegen, varName);
+    if (freg >= 0) {
+        return freg;
+    }
+    
+    freg = allocateFloatRegister(codegen, irIndex, avoid1, avoid2);
+    
+    int intReg = -1;
+    for (int r = REG_T0; r <= REG_T9 && intReg < 0; r++) {
+        for (int v = 0; v < codegen->regDescriptors[r].varCount; v++) {
+            if (strcmp(codegen->regDescriptors[r].varNames[v], varName) == 0) {
+                intReg = r;
+                break;
+            }
+        }
+    }
+    
+    Symbol* sym = lookupSymbol(varName);
+    bool loadsAsWord = !isConstantValue(varName) &&
+                       !(sym && (strcmp(sym->type, "char") == 0 || sym->is_array));
+    int floatIndex = isFloatConstant(varName) ? findFloatConstant(codegen, varName) : -1;
+    
+    if (floatIndex >= 0) {
+        sprintf(instr, "    lwc1 $f%d, _float%d    # Load float %s", freg, floatIndex, varName);
+    } else if (intReg >= 0) {
+        sprintf(instr, "    mtc1 %s, $f%d    # Move %s to FP register", getRegisterName(intReg), freg, varName);
+    } else if (loadsAsWord && hasMemoryValue(codegen, varName, findAddressDescriptor(codegen, varName))) {
+        char location[128];
+        getMemoryLocation(codegen, varName, location);
+        sprintf(instr, "    lwc1 $f%d, %s    # Load float %s", freg, location, varName);
+    } else {
+        // Integer constants, chars and arrays go through an integer register
+        int reg = getReg(codegen, varName, irIndex);
+        sprintf(instr, "    mtc1 %s, $f%d    # Move %s to FP register", getRegisterName(reg), freg, varName);
+    }
+    emitMIPS(codegen, instr);
+    
+    strcpy(codegen->fpRegDescriptors[freg].varNames[0], varName);
+    codegen->fpRegDescriptors[freg].varCount = 1;
+    codegen->fpRegDescriptors[freg].isDirty = false;
+    return freg;
+}
+
+/**
+ * FP register that receives a float result: the one already holding the
+ * variable, or a free one other than the operands' registers
+ */
+static int getFloatResultReg(MIPSCodeGenerator* codegen, const char* varName, int irIndex, int avoid1, int avoid2) {
+    int freg = findFloatRegister(codegen, varName);
+    if (freg >= 0) {
+        return freg;
+    }
+    return allocateFloatRegister(codegen, irIndex, avoid1, avoid2);
+}
+
+/**
+ * Record that freg now holds the float value of varName. Temporaries stay
+ * in the FP register until a label, jump or call writes them back; other
+ * variables are stored right away, as pointers may read them.
+ */
+static void setFloatResult(MIPSCodeGenerator* codegen, const char* varName, int freg) {
+    RegisterDescriptor* desc = &codegen->fpRegDescriptors[freg];
+    strcpy(desc->varNames[0], varName);
+    desc->varCount = 1;
+    desc->isDirty = true;
+    
+    // Copies of the old value in integer registers are stale now
+    for (int r = REG_T0; r <= REG_T9; r++) {
+        RegisterDescriptor* regDesc = &codegen->regDescriptors[r];
+        for (int v = 0; v < regDesc->varCount; v++) {
+            if (strcmp(regDesc->varNames[v], varName) == 0) {
+                if (regDesc->varCount == 1) {
+                    clearRegisterDescriptor(codegen, r);
+                } else {
+                    regDesc->varCount--;
+                    strcpy(regDesc->varNames[v], regDesc->varNames[regDesc->varCount]);
+                    regDesc->varNames[regDesc->varCount][0] = '\0';
+                }
+                break;
+            }
+        }
+    }
+    
+    int addrIdx = findOrCreateAddrDesc(codegen, varName);
+    if (addrIdx >= 0) {
+        codegen->addrDescriptors[addrIdx].inRegister = -1;
+        codegen->addrDescriptors[addrIdx].inMemory = false;
+    }
+    if (!isTemporary(varName)) {
+        storeFloatRegister(codegen, freg);
+    }
+    
+    registerVariableType(codegen, varName, isDoubleValue(codegen, varName) ? "double" : "float");
+}
+
+/**
+ * An instruction other than a float operation assigned varName: drop the
+ * stale copy from the FP registers
+ */
+static void forgetFloatCopy(MIPSCodeGenerator* codegen, const char* varName) {
+    int freg = findFloatRegister(codegen, varName);
+    if (freg >= 0) {
+        clearFloatRegister(codegen, freg);
+    }
+}
+
+/**
+ * A store through a pointer may have changed any variable: drop the
+ * cached ones (they are never dirty; only temporaries are)
+ */
+static void forgetFloatVariables(MIPSCodeGenerator* codegen) {
+    for (int i = 0; i < NUM_FLOAT_REGS; i++) {
+        int freg = allocatableFloatRegs[i];
+        const char* varName = codegen->fpRegDescriptors[freg].varNames[0];
+        if (codegen->fpRegDescriptors[freg].varCount > 0 && !isTemporary(varName) && !isConstantValue(varName)) {
+            clearFloatRegister(codegen, freg);
+        }
+    }
+}
+
+// ============================================================================
+// Task 2.3 & 2.4: Instruction Translation
+// ============================================================================
+
+/**
+ * Whether an arithmetic quad runs on the FPU (float/double +, -, *, /)
+ */
+static bool isFloatArithmetic(MIPSCodeGenerator* codegen, const Quadruple* quad) {
     // FLOAT ARITHMETIC DETECTION: Check if operation involves floats via type annotation or constant detection
     bool isFloatOp = false;
     if (quad->resultType[0] != '\0') {
@@ -1435,61 +2467,47 @@ void translateArithmetic(MIPSCodeGenerator* codegen, Quadruple* quad, int irInde
                     strcmp(getVariableType(codegen, quad->arg1), "float") == 0 ||
                     strcmp(getVariableType(codegen, quad->arg2), "float") == 0;
     }
+    if (!isFloatOp || strlen(quad->arg2) == 0) {
+        return false;
+    }
     
-    if (isFloatOp && strlen(quad->arg2) > 0) {
-        // Handle float arithmetic using floating-point coprocessor
-        // Load arg1 into float register
-        int freg1 = 0;  // Use $f0-$f3 for temporaries
-        int regArg1Temp = getReg(codegen, quad->arg1, irIndex);
-        sprintf(instr, "    mtc1 %s, $f%d    # Move arg1 to float reg", 
-                getRegisterName(regArg1Temp), freg1);
-        emitMIPS(codegen, instr);
-        
-        // Load arg2 into float register
-        int freg2 = 2;
-        int regArg2Temp = getReg(codegen, quad->arg2, irIndex);
-        sprintf(instr, "    mtc1 %s, $f%d    # Move arg2 to float reg", 
-                getRegisterName(regArg2Temp), freg2);
-        emitMIPS(codegen, instr);
+    // Other operations (MOD) fall back to integer instructions
+    return strcmp(quad->op, "ADD") == 0 || strcmp(quad->op, "+") == 0 ||
+           strcmp(quad->op, "SUB") == 0 || strcmp(quad->op, "-") == 0 ||
+           strcmp(quad->op, "MUL") == 0 || strcmp(quad->op, "*") == 0 ||
+           strcmp(quad->op, "DIV") == 0 || strcmp(quad->op, "/") == 0;
+}
+
+/**
+ * Translate arithmetic operation (ADD, SUB, MUL, DIV, MOD)
+ */
+void translateArithmetic(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
+    char instr[256];
+    int regResult;  // Declare here, assign in each branch
+    
+    if (isFloatArithmetic(codegen, quad)) {
+        // Operands and result stay in FP registers; no round trip through $t registers
+        int freg1 = getFloatReg(codegen, quad->arg1, irIndex, -1, -1);
+        int freg2 = getFloatReg(codegen, quad->arg2, irIndex, freg1, -1);
+        int fregResult = getFloatResultReg(codegen, quad->result, irIndex, freg1, freg2);
         
-        // Perform floating-point operation
-        int fregResult = 4;
+        const char* fop;
         if (strcmp(quad->op, "ADD") == 0 || strcmp(quad->op, "+") == 0) {
-            sprintf(instr, "    add.s $f%d, $f%d, $f%d", fregResult, freg1, freg2);
+            fop = "add.s";
         } else if (strcmp(quad->op, "SUB") == 0 || strcmp(quad->op, "-") == 0) {
-            sprintf(instr, "    sub.s $f%d, $f%d, $f%d", fregResult, freg1, freg2);
+            fop = "sub.s";
         } else if (strcmp(quad->op, "MUL") == 0 || strcmp(quad->op, "*") == 0) {
-            sprintf(instr, "    mul.s $f%d, $f%d, $f%d", fregResult, freg1, freg2);
-        } else if (strcmp(quad->op, "DIV") == 0 || strcmp(quad->op, "/") == 0) {
-            sprintf(instr, "    div.s $f%d, $f%d, $f%d", fregResult, freg1, freg2);
+            fop = "mul.s";
         } else {
-            // Fallback to integer operations
-            isFloatOp = false;
-            goto integer_arithmetic;
+            fop = "div.s";
         }
+        sprintf(instr, "    %s $f%d, $f%d, $f%d", fop, fregResult, freg1, freg2);
         emitMIPS(codegen, instr);
         
-        // Move result back to integer register for storage
-        regResult = getReg(codegen, quad->result, irIndex);
-        sprintf(instr, "    mfc1 %s, $f%d    # Move float result to int reg", 
-                getRegisterName(regResult), fregResult);
-        emitMIPS(codegen, instr);
-        
-        // Update descriptors and store
-        updateDescriptors(codegen, regResult, quad->result);
-        codegen->regDescriptors[regResult].isDirty = true;
-        storeVariable(codegen, quad->result, regResult);
-        int addrIdx = findOrCreateAddrDesc(codegen, quad->result);
-        if (addrIdx >= 0) {
-            codegen->addrDescriptors[addrIdx].inMemory = true;
-        }
-        
-        // Register result as float type
-        registerVariableType(codegen, quad->result, "float");
+        setFloatResult(codegen, quad->result, fregResult);
         return;
     }
     
-integer_arithmetic:
     // CRITICAL FIX: Detect pointer arithmetic FIRST before loading arg1
     // When doing ptr+1 or arr+3, we need to get the ADDRESS, not the VALUE
     bool isPointerArithmetic = false;
@@ -1511,11 +2529,11 @@ integer_arithmetic:
         
         // Also check if it's an array by searching symbol table without scope restrictions
         bool arg1IsArr = false;
-        for (int i = 0; i < symCount; i++) {
-            if (strcmp(symtab[i].name, quad->arg1) == 0) {
+        for (int i = 0; i < ctx->symCount; i++) {
+            if (strcmp(ctx->symtab[i].name, quad->arg1) == 0) {
                 // It's an array ONLY if is_array is true AND ptr_level is 0
                 // For pointer parameters (int* arr), ptr_level should be 1, so NOT an array
-                if (symtab[i].is_array && symtab[i].ptr_level == 0) {
+                if (ctx->symtab[i].is_array && ctx->symtab[i].ptr_level == 0) {
                     arg1IsArr = true;
                     arg1IsArray = true;  // Remember if it's an array
                 }
@@ -1539,7 +2557,7 @@ integer_arithmetic:
         int offset = getVariableOffset(codegen, quad->arg1);
         regArg1 = REG_T0;  // Use a temporary register
         for (int r = REG_T0; r <= REG_T9; r++) {
-            if (codegen->regDescriptors[r].varCount == 0) {
+            if (codegen->regDescriptors[r].varCount == 0 && isAllocatableRegister(codegen, r)) {
                 regArg1 = r;
                 break;
             }
@@ -1590,14 +2608,15 @@ integer_arithmetic:
             
             // CRITICAL FIX: If loading arg2 clobbered arg1's register, reload arg1
             // This can happen when arg2 is a constant and getReg chooses to spill arg1's register
-            if (regArg2 == regArg1) {
+            if (regArg2 == regArg1 && strcmp(quad->arg1, quad->arg2) != 0) {
                 // They're in the same register - arg1 was clobbered!
                 // Reload arg1 into a different register
                 if (isConstantValue(quad->arg2)) {
                     // arg2 is a constant that clobbered arg1
                     // Move the constant to a different register
                     for (int r = REG_T0; r <= REG_T9; r++) {
-                        if (r != regArg1 && codegen->regDescriptors[r].varCount == 0) {
+                        if (r != regArg1 && codegen->regDescriptors[r].varCount == 0 &&
+                            isAllocatableRegister(codegen, r)) {
                             // Found an empty register different from arg1
                             sprintf(instr, "    move %s, %s", 
                                    getRegisterName(r), getRegisterName(regArg2));
@@ -1716,13 +2735,9 @@ integer_arithmetic:
     updateDescriptors(codegen, regResult, quad->result);
     codegen->regDescriptors[regResult].isDirty = true;
     
-    // CRITICAL FIX: Store result to memory immediately for reloadability
-    // This ensures the value is available when needed by future instructions (e.g., printf parameters)
-    storeVariable(codegen, quad->result, regResult);
-    int addrIdx = findOrCreateAddrDesc(codegen, quad->result);
-    if (addrIdx >= 0) {
-        codegen->addrDescriptors[addrIdx].inMemory = true;
-    }
+    // Store result; a temporary stays dirty in the register and is written
+    // back if it is spilled or still live at a block boundary or call
+    storeResult(codegen, quad->result, regResult);
 }
 
 /**
@@ -1800,17 +2815,14 @@ void translateAssignment(MIPSCodeGenerator* codegen, Quadruple* quad, int irInde
             // Update descriptors and store
             updateDescriptors(codegen, resultReg, quad->result);
             codegen->regDescriptors[resultReg].isDirty = false;
-            storeVariable(codegen, quad->result, resultReg);
-            int addrIdx = findOrCreateAddrDesc(codegen, quad->result);
-            if (addrIdx >= 0) {
-                codegen->addrDescriptors[addrIdx].inMemory = true;
-            }
+            storeResult(codegen, quad->result, resultReg);
             return;
         }
         
         // Array access (not pointer)
         // Get array base offset
         char arrayLocation[128];
+        writeBackVariable(codegen, arrayName);
         getMemoryLocation(codegen, arrayName, arrayLocation);
         int baseOffset = 0;
         if (strstr(arrayLocation, "($fp)") != NULL) {
@@ -1869,12 +2881,8 @@ void translateAssignment(MIPSCodeGenerator* codegen, Quadruple* quad, int irInde
         updateDescriptors(codegen, resultReg, quad->result);
         codegen->regDescriptors[resultReg].isDirty = false;
         
-        // Store to memory immediately for reloadability
-        storeVariable(codegen, quad->result, resultReg);
-        int addrIdx = findOrCreateAddrDesc(codegen, quad->result);
-        if (addrIdx >= 0) {
-            codegen->addrDescriptors[addrIdx].inMemory = true;
-        }
+        // Store result
+        storeResult(codegen, quad->result, resultReg);
         return;
     }
     
@@ -1906,12 +2914,8 @@ void translateAssignment(MIPSCodeGenerator* codegen, Quadruple* quad, int irInde
             updateDescriptors(codegen, resultReg, resultVar);
             codegen->regDescriptors[resultReg].isDirty = true;
             
-            // Store to memory for reloadability
-            storeVariable(codegen, resultVar, resultReg);
-            int addrIdx2 = findOrCreateAddrDesc(codegen, resultVar);
-            if (addrIdx2 >= 0) {
-                codegen->addrDescriptors[addrIdx2].inMemory = true;
-            }
+            // Store result
+            storeResult(codegen, resultVar, resultReg);
         } else {
             // Global variable - load address
             int resultReg = getReg(codegen, resultVar, irIndex);
@@ -1923,12 +2927,8 @@ void translateAssignment(MIPSCodeGenerator* codegen, Quadruple* quad, int irInde
             updateDescriptors(codegen, resultReg, resultVar);
             codegen->regDescriptors[resultReg].isDirty = true;
             
-            // Store to memory for reloadability
-            storeVariable(codegen, resultVar, resultReg);
-            int addrIdx2 = findOrCreateAddrDesc(codegen, resultVar);
-            if (addrIdx2 >= 0) {
-                codegen->addrDescriptors[addrIdx2].inMemory = true;
-            }
+            // Store result
+            storeResult(codegen, resultVar, resultReg);
         }
         return;
     }
@@ -1969,19 +2969,10 @@ void translateAssignment(MIPSCodeGenerator* codegen, Quadruple* quad, int irInde
                         getRegisterName(regDest), offset, quad->result, quad->arg1);
                 emitMIPS(codegen, instr);
                 
-                // Store to destination
-                storeVariable(codegen, quad->result, regDest);
-                
-                // Update descriptors
+                // Update descriptors and store to destination
                 updateDescriptors(codegen, regDest, quad->result);
                 codegen->regDescriptors[regDest].isDirty = false;
-                
-                // Store to memory for reloadability
-                storeVariable(codegen, quad->result, regDest);
-                int addrIdx3 = findOrCreateAddrDesc(codegen, quad->result);
-                if (addrIdx3 >= 0) {
-                    codegen->addrDescriptors[addrIdx3].inMemory = true;
-                }
+                storeResult(codegen, quad->result, regDest);
                 return;
             }
         }
@@ -2023,18 +3014,10 @@ void translateAssignment(MIPSCodeGenerator* codegen, Quadruple* quad, int irInde
             regSrc = getReg(codegen, quad->arg1, irIndex);
         }
         
-        // Store to result variable's memory location
-        storeVariable(codegen, quad->result, regSrc);
-        
-        // Update address descriptor - result is now in memory and in register
-        int addrIdx = findOrCreateAddrDesc(codegen, quad->result);
-        if (addrIdx >= 0) {
-            codegen->addrDescriptors[addrIdx].inMemory = true;
-            codegen->addrDescriptors[addrIdx].inRegister = regSrc;
-        }
-        
-        // Update register descriptor
+        // Update register descriptor - result is now in the register,
+        // then store it to its memory location
         updateDescriptors(codegen, regSrc, quad->result);
+        storeResult(codegen, quad->result, regSrc);
         return;
     }
     
@@ -2055,14 +3038,9 @@ void translateAssignment(MIPSCodeGenerator* codegen, Quadruple* quad, int irInde
                 getRegisterName(regDest), funcLabel, quad->result, quad->arg1);
         emitMIPS(codegen, instr);
         
-        // Store and update descriptors
-        storeVariable(codegen, quad->result, regDest);
-        int addrIdx = findOrCreateAddrDesc(codegen, quad->result);
-        if (addrIdx >= 0) {
-            codegen->addrDescriptors[addrIdx].inMemory = true;
-            codegen->addrDescriptors[addrIdx].inRegister = regDest;
-        }
+        // Update descriptors and store
         updateDescriptors(codegen, regDest, quad->result);
+        storeResult(codegen, quad->result, regDest);
         return;
     }
     
@@ -2081,20 +3059,14 @@ void translateAssignment(MIPSCodeGenerator* codegen, Quadruple* quad, int irInde
         emitMIPS(codegen, instr);
     }
     
-    // CRITICAL FIX: If result is a global/static variable, store to memory immediately
-    // This ensures the value persists across function calls
-    // ALSO store ALL variables to memory for correctness (temporaries need to be reloadable)
-    storeVariable(codegen, quad->result, regDest);
-    
-    // Update address descriptor to reflect it's in memory
-    int addrIdx = findOrCreateAddrDesc(codegen, quad->result);
-    if (addrIdx >= 0) {
-        codegen->addrDescriptors[addrIdx].inMemory = true;
-    }
-    
     // Update descriptors
     updateDescriptors(codegen, regDest, quad->result);
-    codegen->regDescriptors[regDest].isDirty = false;  // Not dirty since we just stored it
+    codegen->regDescriptors[regDest].isDirty = false;
+    
+    // CRITICAL FIX: If result is a global/static variable, store to memory immediately
+    // This ensures the value persists across function calls
+    // (temporaries are written back when spilled or live across a block boundary)
+    storeResult(codegen, quad->result, regDest);
     
     // Register variable type if available in quad
     if (quad->resultType[0] != '\0') {
@@ -2184,6 +3156,7 @@ void translateLabel(MIPSCodeGenerator* codegen, Quadruple* quad, bool skipSpill)
                     spillRegister(codegen, r);
                 }
             }
+            writeBackFloatRegisters(codegen);
         }
         
         // CRITICAL: Also invalidate ALL address descriptors after label
@@ -2198,6 +3171,7 @@ void translateLabel(MIPSCodeGenerator* codegen, Quadruple* quad, bool skipSpill)
         for (int r = REG_T0; r <= REG_T9; r++) {
             clearRegisterDescriptor(codegen, r);
         }
+        clearFloatRegisters(codegen);
         
         sanitizeLabelName(labelName, sanitized);
         sprintf(label, "%s:", sanitized);
@@ -2217,10 +3191,11 @@ void translateGoto(MIPSCodeGenerator* codegen, Quadruple* quad) {
     // Clean registers are already saved and don't need re-spilling
     // This prevents exceeding frame size with unnecessary spills
     for (int r = REG_T0; r <= REG_T9; r++) {
-        if (codegen->regDescriptors[r].varCount > 0 && codegen->regDescriptors[r].isDirty) {
+        if (needsSpill(codegen, r)) {
             spillRegister(codegen, r);
         }
     }
+    writeBackFloatRegisters(codegen);
     
     // CRITICAL: Also invalidate ALL address descriptors before goto
     // The target label may be reached from multiple paths, so register contents can't be trusted
@@ -2251,6 +3226,80 @@ void translateGoto(MIPSCodeGenerator* codegen, Quadruple* quad) {
     }
 }
 
+/**
+ * Branch instruction for the relational op `op`, taken when the
+ * comparison holds (or, with takenWhenTrue false, when it fails);
+ * NULL when op is not relational
+ */
+static const char* relationalBranch(const char* op, bool takenWhenTrue) {
+    static const struct {
+        const char* op;
+        const char* symbol;
+        const char* whenTrue;
+        const char* whenFalse;
+    } branches[] = {
+        { "LT", "<",  "blt", "bge" }, { "GT", ">",  "bgt", "ble" },
+        { "LE", "<=", "ble", "bgt" }, { "GE", ">=", "bge", "blt" },
+        { "EQ", "==", "beq", "bne" }, { "NE", "!=", "bne", "beq" },
+    };
+    for (size_t i = 0; i < sizeof(branches) / sizeof(branches[0]); i++) {
+        if (strcmp(op, branches[i].op) == 0 || strcmp(op, branches[i].symbol) == 0) {
+            return takenWhenTrue ? branches[i].whenTrue : branches[i].whenFalse;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Whether the relational quad at irIndex only feeds the IF_TRUE_GOTO /
+ * IF_FALSE_GOTO right after it. The two are then translated together as
+ * one compare-and-branch and the 0/1 result is never materialized
+ */
+static bool fusesWithNextBranch(MIPSCodeGenerator* codegen, int irIndex) {
+    if (irIndex < 0 || irIndex + 1 >= codegen->irCount) {
+        return false;
+    }
+    const Quadruple* quad = &codegen->IR[irIndex];
+    const Quadruple* next = &codegen->IR[irIndex + 1];
+    return relationalBranch(quad->op, true) != NULL &&
+           (strcmp(next->op, "IF_TRUE_GOTO") == 0 || strcmp(next->op, "IF_FALSE_GOTO") == 0) &&
+           strcmp(next->arg1, quad->result) == 0 &&
+           isDeadTemporary(codegen, quad->result, irIndex + 1);
+}
+
+/**
+ * Compare-and-branch for a relational quad fused with the conditional
+ * branch after it. An integer constant on the right stays an immediate
+ * operand (blt $t0, 10, L1) instead of being loaded first
+ */
+static void translateFusedBranch(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
+    char instr[256];
+    char sanitized[128];
+    const Quadruple* branch = &codegen->IR[irIndex + 1];
+    
+    int regArg1 = getReg(codegen, quad->arg1, irIndex);
+    char rhs[64];
+    char* end = NULL;
+    long value = strtol(quad->arg2, &end, 10);
+    if (quad->arg2[0] != '\0' && *end == '\0') {
+        sprintf(rhs, "%ld", value);
+    } else {
+        int regArg2 = getReg(codegen, quad->arg2, irIndex);
+        strcpy(rhs, getRegisterName(regArg2));
+    }
+    
+    // Same as translateConditionalBranch: dirty registers reach memory
+    // before control can leave the block
+    writeBackRegisters(codegen, false);
+    writeBackFloatRegisters(codegen);
+    
+    sanitizeLabelName(branch->arg2, sanitized);
+    sprintf(instr, "    %s %s, %s, %s",
+           relationalBranch(quad->op, strcmp(branch->op, "IF_TRUE_GOTO") == 0),
+           getRegisterName(regArg1), rhs, sanitized);
+    emitMIPS(codegen, instr);
+}
+
 /**
  * Translate conditional branch
  * CRITICAL: Must spill all registers before branching because control flow changes
@@ -2262,14 +3311,13 @@ void translateConditionalBranch(MIPSCodeGenerator* codegen, Quadruple* quad, int
     // Get register for condition variable
     int regCond = getReg(codegen, quad->arg1, irIndex);
     
-    // CRITICAL FIX: Spill only DIRTY registers before branching
+    // CRITICAL FIX: Store only DIRTY registers before branching
     // Clean registers are already saved and don't need re-spilling
     // This prevents exceeding frame size with unnecessary spills
-    for (int r = REG_T0; r <= REG_T9; r++) {
-        if (codegen->regDescriptors[r].varCount > 0 && codegen->regDescriptors[r].isDirty && r != regCond) {
-            spillRegister(codegen, r);
-        }
-    }
+    // The registers keep their values on the fall-through path
+    // (regCond too: the branch below still reads the register itself)
+    writeBackRegisters(codegen, false);
+    writeBackFloatRegisters(codegen);
     
     // The target label is in arg2 for conditional branches
     const char* targetLabel = quad->arg2;
@@ -2291,66 +3339,468 @@ void translateConditionalBranch(MIPSCodeGenerator* codegen, Quadruple* quad, int
         // For now, treat same as integer (proper float handling would use FPU)
         sprintf(instr, "    bnez %s, %s", getRegisterName(regCond), sanitized);
     }
-    else if (strcmp(quad->op, "IF_FALSE_GOTO_FLOAT") == 0) {
-        // Branch if float condition is false (zero)
-        sprintf(instr, "    beqz %s, %s", getRegisterName(regCond), sanitized);
+    else if (strcmp(quad->op, "IF_FALSE_GOTO_FLOAT") == 0) {
+        // Branch if float condition is false (zero)
+        sprintf(instr, "    beqz %s, %s", getRegisterName(regCond), sanitized);
+    }
+    else {
+        // Fallback - shouldn't happen but handle gracefully
+        fprintf(stderr, "Warning: Unknown conditional branch op: %s\n", quad->op);
+        sprintf(instr, "    beqz %s, %s", getRegisterName(regCond), sanitized);
+    }
+    
+    emitMIPS(codegen, instr);
+}
+
+/**
+ * Translate relational operation (LT, GT, EQ, etc.)
+ */
+void translateRelational(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
+    char instr[256];
+    
+    if (fusesWithNextBranch(codegen, irIndex)) {
+        translateFusedBranch(codegen, quad, irIndex);
+        return;
+    }
+    
+    int regArg1 = getReg(codegen, quad->arg1, irIndex);
+    int regArg2 = getReg(codegen, quad->arg2, irIndex);
+    int regResult = getReg(codegen, quad->result, irIndex);
+    
+    if (strcmp(quad->op, "LT") == 0 || strcmp(quad->op, "<") == 0) {
+        sprintf(instr, "    slt %s, %s, %s", 
+               getRegisterName(regResult),
+               getRegisterName(regArg1),
+               getRegisterName(regArg2));
+    } else if (strcmp(quad->op, "GT") == 0 || strcmp(quad->op, ">") == 0) {
+        sprintf(instr, "    sgt %s, %s, %s", 
+               getRegisterName(regResult),
+               getRegisterName(regArg1),
+               getRegisterName(regArg2));
+    } else if (strcmp(quad->op, "LE") == 0 || strcmp(quad->op, "<=") == 0) {
+        sprintf(instr, "    sle %s, %s, %s", 
+               getRegisterName(regResult),
+               getRegisterName(regArg1),
+               getRegisterName(regArg2));
+    } else if (strcmp(quad->op, "GE") == 0 || strcmp(quad->op, ">=") == 0) {
+        sprintf(instr, "    sge %s, %s, %s", 
+               getRegisterName(regResult),
+               getRegisterName(regArg1),
+               getRegisterName(regArg2));
+    } else if (strcmp(quad->op, "EQ") == 0 || strcmp(quad->op, "==") == 0) {
+        sprintf(instr, "    seq %s, %s, %s", 
+               getRegisterName(regResult),
+               getRegisterName(regArg1),
+               getRegisterName(regArg2));
+    } else if (strcmp(quad->op, "NE") == 0 || strcmp(quad->op, "!=") == 0) {
+        sprintf(instr, "    sne %s, %s, %s", 
+               getRegisterName(regResult),
+               getRegisterName(regArg1),
+               getRegisterName(regArg2));
+    } else {
+        return;  // Unknown relational op
+    }
+    
+    emitMIPS(codegen, instr);
+    updateDescriptors(codegen, regResult, quad->result);
+    storeResult(codegen, quad->result, regResult);
+}
+
+// ----------------------------------------------------------------------------
+// Double Precision
+// ----------------------------------------------------------------------------
+
+/**
+ * Index of the _double<N> label of a float constant converted to double,
+ * or -1 when generateDataSection did not pool it
+ */
+static int findDoubleConstant(MIPSCodeGenerator* codegen, const char* constant) {
+    for (int i = 0; i < codegen->doubleConstCount; i++) {
+        if (strcmp(codegen->doubleConstants[i], constant) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Whether name holds a single-precision float
+ */
+static bool isFloatValue(MIPSCodeGenerator* codegen, const char* name) {
+    if (isFloatConstant(name)) {
+        return true;
+    }
+    if (isConstantValue(name) || isDoubleValue(codegen, name)) {
+        return false;
+    }
+    const Symbol* sym = findFunctionSymbol(codegen->currentFunction ? codegen->currentFunction->funcName : "", name);
+    if (sym != NULL && !sym->is_array && sym->ptr_level == 0 && strstr(sym->type, "float") != NULL &&
+        strchr(sym->type, '*') == NULL) {
+        return true;
+    }
+    return findFloatRegister(codegen, name) >= 0 || strcmp(getVariableType(codegen, name), "float") == 0;
+}
+
+/**
+ * Load the float name and widen it in place. The float copy is written
+ * back and given up, so the pair holds no variable afterwards.
+ */
+static int widenFloatReg(MIPSCodeGenerator* codegen, const char* name, int irIndex, int avoid1, int avoid2) {
+    char instr[256];
+    int freg = getFloatReg(codegen, name, irIndex, avoid1, avoid2);
+    spillFloatRegister(codegen, freg);
+    sprintf(instr, "    cvt.d.s $f%d, $f%d    # %s to double", freg, freg, name);
+    emitMIPS(codegen, instr);
+    return freg;
+}
+
+/**
+ * Even FP register of the pair holding name as a double. Doubles are
+ * loaded (l.d) and tracked like floats in getFloatReg. Constants, ints
+ * and floats are converted in a pair no variable is recorded in, which
+ * only lasts for the current instruction: pass it to later allocations
+ * as avoid1/avoid2.
+ */
+static int getDoubleReg(MIPSCodeGenerator* codegen, const char* name, int irIndex, int avoid1, int avoid2) {
+    char instr[256];
+    bool isDouble = isDoubleValue(codegen, name);
+    int freg = findFloatRegister(codegen, name);
+    if (freg >= 0 && isDouble) {
+        return freg;
+    }
+    
+    int doubleIndex = isFloatConstant(name) ? findDoubleConstant(codegen, name) : -1;
+    if (doubleIndex >= 0) {
+        freg = allocateFloatRegister(codegen, irIndex, avoid1, avoid2);
+        sprintf(instr, "    l.d $f%d, _double%d    # Load double %s", freg, doubleIndex, name);
+        emitMIPS(codegen, instr);
+        return freg;
+    }
+    if (isDouble) {
+        char location[128];
+        freg = allocateFloatRegister(codegen, irIndex, avoid1, avoid2);
+        getMemoryLocation(codegen, name, location);
+        sprintf(instr, "    l.d $f%d, %s    # Load double %s", freg, location, name);
+        emitMIPS(codegen, instr);
+        
+        strcpy(codegen->fpRegDescriptors[freg].varNames[0], name);
+        codegen->fpRegDescriptors[freg].varCount = 1;
+        codegen->fpRegDescriptors[freg].isDirty = false;
+        return freg;
+    }
+    
+    if (isFloatValue(codegen, name)) {
+        return widenFloatReg(codegen, name, irIndex, avoid1, avoid2);
+    }
+    
+    int reg = getReg(codegen, name, irIndex);
+    freg = allocateFloatRegister(codegen, irIndex, avoid1, avoid2);
+    sprintf(instr, "    mtc1 %s, $f%d    # Move %s to FP register", getRegisterName(reg), freg, name);
+    emitMIPS(codegen, instr);
+    sprintf(instr, "    cvt.d.w $f%d, $f%d    # %s to double", freg, freg, name);
+    emitMIPS(codegen, instr);
+    return freg;
+}
+
+/**
+ * Type a double value is converted to when it is assigned to name:
+ * 'd' (double), 'f' (float) or 'i' (int and everything else)
+ */
+static char doubleResultKind(MIPSCodeGenerator* codegen, const char* name) {
+    if (isDoubleValue(codegen, name)) {
+        return 'd';
+    }
+    return isFloatValue(codegen, name) ? 'f' : 'i';
+}
+
+/**
+ * Assign the double in the pair at freg to name, converting it for a
+ * float or int result. A double result takes over freg unless another
+ * variable is recorded there.
+ */
+static void setDoubleResult(MIPSCodeGenerator* codegen, const char* name, int irIndex, int freg, char kind) {
+    char instr[256];
+    RegisterDescriptor* desc = &codegen->fpRegDescriptors[freg];
+    
+    if (kind == 'd') {
+        int dest = freg;
+        if (desc->varCount > 0 && strcmp(desc->varNames[0], name) != 0) {
+            dest = getFloatResultReg(codegen, name, irIndex, freg, -1);
+            sprintf(instr, "    mov.d $f%d, $f%d", dest, freg);
+            emitMIPS(codegen, instr);
+        } else {
+            int old = findFloatRegister(codegen, name);
+            if (old >= 0 && old != freg) {
+                clearFloatRegister(codegen, old);
+            }
+        }
+        setFloatResult(codegen, name, dest);
+    } else if (kind == 'f') {
+        int dest = getFloatResultReg(codegen, name, irIndex, freg, -1);
+        sprintf(instr, "    cvt.s.d $f%d, $f%d    # Convert double to float", dest, freg);
+        emitMIPS(codegen, instr);
+        setFloatResult(codegen, name, dest);
+    } else {
+        sprintf(instr, "    trunc.w.d $f0, $f%d    # Convert double to int (truncate)", freg);
+        emitMIPS(codegen, instr);
+        int reg = getReg(codegen, name, irIndex);
+        sprintf(instr, "    mfc1 %s, $f0", getRegisterName(reg));
+        emitMIPS(codegen, instr);
+        
+        updateDescriptors(codegen, reg, name);
+        codegen->regDescriptors[reg].isDirty = false;
+        storeResult(codegen, name, reg);
+        registerVariableType(codegen, name, "int");
+    }
+}
+
+/**
+ * Put the address of element `index` of a double array, or of the
+ * pointer to double arrayName, in $t8
+ */
+static void doubleElementAddress(MIPSCodeGenerator* codegen, const char* arrayName, const char* index, int irIndex) {
+    char instr[256];
+    const Symbol* sym = findFunctionSymbol(codegen->currentFunction->funcName, arrayName);
+    
+    if (sym != NULL && !sym->is_array) {
+        int ptrReg = getReg(codegen, arrayName, irIndex);
+        sprintf(instr, "    move $t8, %s", getRegisterName(ptrReg));
+    } else {
+        char location[128];
+        int baseOffset = 0;
+        getMemoryLocation(codegen, arrayName, location);
+        if (sscanf(location, "%d($fp)", &baseOffset) == 1) {
+            sprintf(instr, "    addiu $t8, $fp, %d    # &%s", baseOffset, arrayName);
+        } else {
+            sprintf(instr, "    la $t8, %s", location);
+        }
+    }
+    emitMIPS(codegen, instr);
+    
+    if (isConstantValue(index)) {
+        if (atoi(index) != 0) {
+            sprintf(instr, "    addiu $t8, $t8, %d", atoi(index) * 8);
+            emitMIPS(codegen, instr);
+        }
+        return;
+    }
+    int indexReg = getReg(codegen, index, irIndex);
+    sprintf(instr, "    sll $t9, %s, 3", getRegisterName(indexReg));
+    emitMIPS(codegen, instr);
+    emitMIPS(codegen, "    addu $t8, $t8, $t9");
+}
+
+static bool isArithmeticOp(const char* op) {
+    return strcmp(op, "ADD") == 0 || strcmp(op, "+") == 0 || strcmp(op, "SUB") == 0 || strcmp(op, "-") == 0 ||
+           strcmp(op, "MUL") == 0 || strcmp(op, "*") == 0 || strcmp(op, "DIV") == 0 || strcmp(op, "/") == 0;
+}
+
+/**
+ * Whether a quad reads or writes a double, so translateDouble handles it
+ * with .d instructions on FP register pairs
+ */
+static bool isDoubleOperation(MIPSCodeGenerator* codegen, const Quadruple* quad) {
+    const char* op = quad->op;
+    if (codegen->currentFunction == NULL) {
+        return false;
+    }
+    const char* funcName = codegen->currentFunction->funcName;
+    
+    if (strstr(op, "CAST") != NULL || strcmp(op, "FLOAT_TO_DOUBLE") == 0 || strcmp(op, "DOUBLE_TO_FLOAT") == 0) {
+        return strstr(op, "double") != NULL || strstr(op, "DOUBLE") != NULL || isDoubleValue(codegen, quad->arg1);
+    }
+    if (isArithmeticOp(op) && quad->arg2[0] != '\0') {
+        return isDoubleValue(codegen, quad->result) || isDoubleValue(codegen, quad->arg1) ||
+               isDoubleValue(codegen, quad->arg2);
+    }
+    if (strcmp(op, "NEG") == 0 || strcmp(op, "ASSIGN") == 0 || strcmp(op, "=") == 0) {
+        return isDoubleValue(codegen, quad->result) || isDoubleValue(codegen, quad->arg1);
+    }
+    if (relationalBranch(op, true) != NULL) {
+        return isDoubleValue(codegen, quad->arg1) || isDoubleValue(codegen, quad->arg2);
+    }
+    if (strcmp(op, "ARRAY_ACCESS") == 0 || strcmp(op, "DEREF") == 0) {
+        return hasDoubleElements(findFunctionSymbol(funcName, quad->arg1));
+    }
+    if (strcmp(op, "ASSIGN_ARRAY") == 0) {
+        return hasDoubleElements(findFunctionSymbol(funcName, quad->arg2));
     }
-    else {
-        // Fallback - shouldn't happen but handle gracefully
-        fprintf(stderr, "Warning: Unknown conditional branch op: %s\n", quad->op);
-        sprintf(instr, "    beqz %s, %s", getRegisterName(regCond), sanitized);
+    if (strcmp(op, "ASSIGN_DEREF") == 0) {
+        const Symbol* pointer = findFunctionSymbol(funcName, quad->arg2);
+        return pointer != NULL ? hasDoubleElements(pointer) : isDoubleValue(codegen, quad->arg1);
+    }
+    return false;
+}
+
+/**
+ * Compare two doubles into the FP condition flag and branch on it (fused
+ * with the IF_TRUE_GOTO / IF_FALSE_GOTO after it) or materialize it as 0/1.
+ * c.lt.d and c.le.d with swapped operands give > and >=; != branches on
+ * the c.eq.d flag being clear.
+ */
+static void translateDoubleCompare(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
+    char instr[256];
+    char label[160];
+    const char* op = quad->op;
+    
+    int freg1 = getDoubleReg(codegen, quad->arg1, irIndex, -1, -1);
+    int freg2 = getDoubleReg(codegen, quad->arg2, irIndex, freg1, -1);
+    
+    const char* cmp;
+    bool swapped = false;
+    bool negated = false;
+    if (strcmp(op, "LT") == 0 || strcmp(op, "<") == 0) {
+        cmp = "c.lt.d";
+    } else if (strcmp(op, "GT") == 0 || strcmp(op, ">") == 0) {
+        cmp = "c.lt.d";
+        swapped = true;
+    } else if (strcmp(op, "LE") == 0 || strcmp(op, "<=") == 0) {
+        cmp = "c.le.d";
+    } else if (strcmp(op, "GE") == 0 || strcmp(op, ">=") == 0) {
+        cmp = "c.le.d";
+        swapped = true;
+    } else {
+        cmp = "c.eq.d";
+        negated = strcmp(op, "NE") == 0 || strcmp(op, "!=") == 0;
+    }
+    sprintf(instr, "    %s $f%d, $f%d", cmp, swapped ? freg2 : freg1, swapped ? freg1 : freg2);
+    emitMIPS(codegen, instr);
+    
+    if (fusesWithNextBranch(codegen, irIndex)) {
+        const Quadruple* branch = &codegen->IR[irIndex + 1];
+        char sanitized[128];
+        bool takenWhenTrue = strcmp(branch->op, "IF_TRUE_GOTO") == 0;
+        
+        writeBackRegisters(codegen, false);
+        writeBackFloatRegisters(codegen);
+        
+        sanitizeLabelName(branch->arg2, sanitized);
+        sprintf(instr, "    %s %s", takenWhenTrue != negated ? "bc1t" : "bc1f", sanitized);
+        emitMIPS(codegen, instr);
+        return;
     }
     
+    int regResult = getReg(codegen, quad->result, irIndex);
+    sprintf(label, "_%s_dcmp%d", codegen->currentFunction->funcName, codegen->doubleCompareCount++);
+    sprintf(instr, "    li %s, 0", getRegisterName(regResult));
+    emitMIPS(codegen, instr);
+    sprintf(instr, "    %s %s", negated ? "bc1t" : "bc1f", label);
     emitMIPS(codegen, instr);
+    sprintf(instr, "    li %s, 1", getRegisterName(regResult));
+    emitMIPS(codegen, instr);
+    sprintf(instr, "%s:", label);
+    emitMIPS(codegen, instr);
+    
+    updateDescriptors(codegen, regResult, quad->result);
+    storeResult(codegen, quad->result, regResult);
 }
 
 /**
- * Translate relational operation (LT, GT, EQ, etc.)
+ * Translate a quad isDoubleOperation accepted: arithmetic, negation and
+ * copies on FP register pairs, conversions to and from double,
+ * comparisons, and 8-byte loads and stores through arrays and pointers
  */
-void translateRelational(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
+static void translateDouble(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
     char instr[256];
+    const char* op = quad->op;
     
-    int regArg1 = getReg(codegen, quad->arg1, irIndex);
-    int regArg2 = getReg(codegen, quad->arg2, irIndex);
-    int regResult = getReg(codegen, quad->result, irIndex);
+    if (relationalBranch(op, true) != NULL) {
+        translateDoubleCompare(codegen, quad, irIndex);
+        return;
+    }
     
-    if (strcmp(quad->op, "LT") == 0 || strcmp(quad->op, "<") == 0) {
-        sprintf(instr, "    slt %s, %s, %s", 
-               getRegisterName(regResult),
-               getRegisterName(regArg1),
-               getRegisterName(regArg2));
-    } else if (strcmp(quad->op, "GT") == 0 || strcmp(quad->op, ">") == 0) {
-        sprintf(instr, "    sgt %s, %s, %s", 
-               getRegisterName(regResult),
-               getRegisterName(regArg1),
-               getRegisterName(regArg2));
-    } else if (strcmp(quad->op, "LE") == 0 || strcmp(quad->op, "<=") == 0) {
-        sprintf(instr, "    sle %s, %s, %s", 
-               getRegisterName(regResult),
-               getRegisterName(regArg1),
-               getRegisterName(regArg2));
-    } else if (strcmp(quad->op, "GE") == 0 || strcmp(quad->op, ">=") == 0) {
-        sprintf(instr, "    sge %s, %s, %s", 
-               getRegisterName(regResult),
-               getRegisterName(regArg1),
-               getRegisterName(regArg2));
-    } else if (strcmp(quad->op, "EQ") == 0 || strcmp(quad->op, "==") == 0) {
-        sprintf(instr, "    seq %s, %s, %s", 
-               getRegisterName(regResult),
-               getRegisterName(regArg1),
-               getRegisterName(regArg2));
-    } else if (strcmp(quad->op, "NE") == 0 || strcmp(quad->op, "!=") == 0) {
-        sprintf(instr, "    sne %s, %s, %s", 
-               getRegisterName(regResult),
-               getRegisterName(regArg1),
-               getRegisterName(regArg2));
-    } else {
-        return;  // Unknown relational op
+    if (isArithmeticOp(op)) {
+        int freg1 = getDoubleReg(codegen, quad->arg1, irIndex, -1, -1);
+        int freg2 = getDoubleReg(codegen, quad->arg2, irIndex, freg1, -1);
+        char kind = doubleResultKind(codegen, quad->result);
+        int dest = kind == 'd' ? getFloatResultReg(codegen, quad->result, irIndex, freg1, freg2) : 2;
+        
+        const char* fop;
+        if (strcmp(op, "ADD") == 0 || strcmp(op, "+") == 0) {
+            fop = "add.d";
+        } else if (strcmp(op, "SUB") == 0 || strcmp(op, "-") == 0) {
+            fop = "sub.d";
+        } else if (strcmp(op, "MUL") == 0 || strcmp(op, "*") == 0) {
+            fop = "mul.d";
+        } else {
+            fop = "div.d";
+        }
+        sprintf(instr, "    %s $f%d, $f%d, $f%d", fop, dest, freg1, freg2);
+        emitMIPS(codegen, instr);
+        setDoubleResult(codegen, quad->result, irIndex, dest, kind);
+        return;
     }
     
-    emitMIPS(codegen, instr);
-    updateDescriptors(codegen, regResult, quad->result);
-    codegen->regDescriptors[regResult].isDirty = true;
+    if (strcmp(op, "NEG") == 0) {
+        int freg = getDoubleReg(codegen, quad->arg1, irIndex, -1, -1);
+        char kind = doubleResultKind(codegen, quad->result);
+        int dest = kind == 'd' ? getFloatResultReg(codegen, quad->result, irIndex, freg, -1) : 2;
+        sprintf(instr, "    neg.d $f%d, $f%d", dest, freg);
+        emitMIPS(codegen, instr);
+        setDoubleResult(codegen, quad->result, irIndex, dest, kind);
+        return;
+    }
+    
+    if (strcmp(op, "ARRAY_ACCESS") == 0 || strcmp(op, "DEREF") == 0) {
+        bool isArray = strcmp(op, "ARRAY_ACCESS") == 0;
+        char kind = doubleResultKind(codegen, quad->result);
+        int dest = kind == 'd' ? getFloatResultReg(codegen, quad->result, irIndex, -1, -1) : 2;
+        if (isArray) {
+            doubleElementAddress(codegen, quad->arg1, quad->arg2, irIndex);
+            sprintf(instr, "    l.d $f%d, 0($t8)    # %s = %s[%s]", dest, quad->result, quad->arg1, quad->arg2);
+        } else {
+            int ptrReg = getReg(codegen, quad->arg1, irIndex);
+            sprintf(instr, "    l.d $f%d, 0(%s)    # %s = *%s", dest, getRegisterName(ptrReg), quad->result, quad->arg1);
+        }
+        emitMIPS(codegen, instr);
+        setDoubleResult(codegen, quad->result, irIndex, dest, kind);
+        return;
+    }
+    
+    if (strcmp(op, "ASSIGN_ARRAY") == 0) {
+        // ASSIGN_ARRAY index, array, value
+        int freg = getDoubleReg(codegen, quad->result, irIndex, -1, -1);
+        doubleElementAddress(codegen, quad->arg2, quad->arg1, irIndex);
+        sprintf(instr, "    s.d $f%d, 0($t8)    # %s[%s] = %s", freg, quad->arg2, quad->arg1, quad->result);
+        emitMIPS(codegen, instr);
+        return;
+    }
+    
+    if (strcmp(op, "ASSIGN_DEREF") == 0) {
+        // ASSIGN_DEREF value, pointer; the store may change any variable
+        int freg = getDoubleReg(codegen, quad->arg1, irIndex, -1, -1);
+        int ptrReg = getReg(codegen, quad->arg2, irIndex);
+        sprintf(instr, "    s.d $f%d, 0(%s)    # *%s = %s", freg, getRegisterName(ptrReg), quad->arg2, quad->arg1);
+        emitMIPS(codegen, instr);
+        for (int r = REG_T0; r <= REG_T9; r++) {
+            clearRegisterDescriptor(codegen, r);
+        }
+        for (int i = 0; i < codegen->addrDescCount; i++) {
+            codegen->addrDescriptors[i].inRegister = -1;
+        }
+        return;
+    }
+    
+    // Copies and casts: the source is widened by getDoubleReg, the cast
+    // names the result type (a plain copy takes the result's own)
+    char kind = doubleResultKind(codegen, quad->result);
+    if (strstr(op, "_to_double") != NULL || strcmp(op, "FLOAT_TO_DOUBLE") == 0) {
+        kind = 'd';
+    } else if (strstr(op, "_to_float") != NULL || strcmp(op, "DOUBLE_TO_FLOAT") == 0) {
+        kind = 'f';
+    } else if (strstr(op, "CAST") != NULL) {
+        kind = 'i';
+    }
+    // A float cast may read a temporary copied from a float variable,
+    // which holds the float's bits without being typed as one
+    bool floatSource = strstr(op, "float_to_double") != NULL || strcmp(op, "FLOAT_TO_DOUBLE") == 0;
+    int freg;
+    if (floatSource && !isConstantValue(quad->arg1) && !isDoubleValue(codegen, quad->arg1)) {
+        freg = widenFloatReg(codegen, quad->arg1, irIndex, -1, -1);
+    } else {
+        freg = getDoubleReg(codegen, quad->arg1, irIndex, -1, -1);
+    }
+    setDoubleResult(codegen, quad->result, irIndex, freg, kind);
 }
 
 /**
@@ -2394,7 +3844,7 @@ void translateLogical(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex)
         emitMIPS(codegen, instr);
         updateDescriptors(codegen, regResult, quad->result);
     }
-    codegen->regDescriptors[getReg(codegen, quad->result, irIndex)].isDirty = true;
+    storeResult(codegen, quad->result, getReg(codegen, quad->result, irIndex));
 }
 
 /**
@@ -2472,7 +3922,7 @@ void translateBitwise(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex)
         emitMIPS(codegen, instr);
         updateDescriptors(codegen, regResult, quad->result);
     }
-    codegen->regDescriptors[getReg(codegen, quad->result, irIndex)].isDirty = true;
+    storeResult(codegen, quad->result, getReg(codegen, quad->result, irIndex));
 }
 
 // ============================================================================
@@ -2487,6 +3937,51 @@ void translateBitwise(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex)
  * Translate PARAM instruction
  * First 4 params go to $a0-$a3, rest are pushed to stack
  */
+/**
+ * Declared type of the callee parameter the PARAM at irIndex passes, or
+ * NULL when the callee is unknown (function pointers)
+ */
+static const char* calleeParameterType(MIPSCodeGenerator* codegen, int irIndex) {
+    int later = 0;
+    for (int i = irIndex + 1; i < codegen->irCount && i < irIndex + 20 && !isFunctionEnd(&codegen->IR[i]); i++) {
+        const Quadruple* quad = &codegen->IR[i];
+        if (strcmp(quad->op, "PARAM") == 0 || strcmp(quad->op, "param") == 0) {
+            later++;
+        } else if (strcmp(quad->op, "CALL") == 0 || strcmp(quad->op, "call") == 0) {
+            int position = atoi(quad->arg2) - 1 - later;
+            for (int s = 0; s < ctx->symCount; s++) {
+                const Symbol* func = &ctx->symtab[s];
+                if (func->is_function && strcmp(func->name, quad->arg1) == 0) {
+                    return position >= 0 && position < func->param_count && position < 16
+                           ? func->param_types[position] : NULL;
+                }
+            }
+            return NULL;
+        } else if (isCallInstruction(quad)) {
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Pass the word in FP register freg as argument slot `slot`: in $a0-$a3,
+ * then pushed like the other stack arguments
+ */
+static void passFloatWord(MIPSCodeGenerator* codegen, int slot, int freg) {
+    char instr[256];
+    if (slot < 4) {
+        sprintf(instr, "    mfc1 $a%d, $f%d", slot, freg);
+        emitMIPS(codegen, instr);
+        codegen->paramRegisterMap[slot] = REG_A0 + slot;
+        return;
+    }
+    sprintf(instr, "    mfc1 $t9, $f%d", freg);
+    emitMIPS(codegen, instr);
+    emitMIPS(codegen, "    sw $t9, 0($sp)");
+    emitMIPS(codegen, "    addiu $sp, $sp, -4");
+}
+
 void translateParam(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
     char instr[256];
     
@@ -2496,7 +3991,7 @@ void translateParam(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
     // Check if next instruction is a CALL to printf/scanf
     // If so, skip stack operations entirely - printf/scanf handler manages its own stack
     bool isIOCall = false;
-    for (int i = irIndex + 1; i < codegen->irCount && i < irIndex + 20; i++) {
+    for (int i = irIndex + 1; i < codegen->irCount && i < irIndex + 20 && !isFunctionEnd(&codegen->IR[i]); i++) {
         if (strcmp(codegen->IR[i].op, "CALL") == 0 || strcmp(codegen->IR[i].op, "call") == 0) {
             const char* funcName = codegen->IR[i].arg1;
             if (strcmp(funcName, "printf") == 0 || strcmp(funcName, "scanf") == 0) {
@@ -2516,21 +4011,25 @@ void translateParam(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
         char paramVars[10][128];  // Up to 10 parameters
         int paramVarCount = 0;
         
-        for (int i = irIndex; i < codegen->irCount && i < irIndex + 20; i++) {
+        for (int i = irIndex; i < codegen->irCount && i < irIndex + 20 && !isFunctionEnd(&codegen->IR[i]); i++) {
             if (strcmp(codegen->IR[i].op, "PARAM") == 0 || strcmp(codegen->IR[i].op, "param") == 0) {
                 if (paramVarCount < 10) {
                     strncpy(paramVars[paramVarCount], codegen->IR[i].arg1, 127);
                     paramVars[paramVarCount][127] = '\0';
                     paramVarCount++;
                 }
-            } else if (strcmp(codegen->IR[i].op, "CALL") == 0 || strcmp(codegen->IR[i].op, "call") == 0) {
+            } else if (isCallInstruction(&codegen->IR[i])) {
+                // Temporaries needed after the call move to $s registers instead
+                preserveAcrossCall(codegen, i);
                 break;  // Stop at CALL
+            } else if (strcmp(codegen->IR[i].op, "CALL") == 0 || strcmp(codegen->IR[i].op, "call") == 0) {
+                break;
             }
         }
         
         // Spill all dirty caller-saved registers EXCEPT those holding parameter values
         for (int r = REG_T0; r <= REG_T9; r++) {
-            if (codegen->regDescriptors[r].varCount > 0 && codegen->regDescriptors[r].isDirty) {
+            if (needsSpill(codegen, r) && !survivesCall(codegen, r)) {
                 // Check if this register holds any parameter variable
                 bool holdsParam = false;
                 for (int v = 0; v < codegen->regDescriptors[r].varCount; v++) {
@@ -2555,6 +4054,41 @@ void translateParam(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
     // Increment parameter counter
     int paramIndex = codegen->currentParamCount++;
     
+    // printf prints double arguments straight from their memory location
+    // (the call writes them back first), so they take no register
+    if (isIOCall) {
+        if (paramIndex == 0) {
+            for (int i = 0; i < 10; i++) {
+                codegen->printfDoubles[i][0] = '\0';
+            }
+        }
+        if (isDoubleValue(codegen, paramValue)) {
+            if (paramIndex < 10) {
+                strcpy(codegen->printfDoubles[paramIndex], paramValue);
+            }
+            return;
+        }
+    }
+    
+    // A double takes two argument slots, its low word first; a double
+    // passed for a float or int parameter is converted first
+    const char* paramType = isIOCall ? NULL : calleeParameterType(codegen, irIndex);
+    bool passesDouble = paramType != NULL ? isDoubleType(paramType) : isDoubleValue(codegen, paramValue);
+    if (!isIOCall && (passesDouble || isDoubleValue(codegen, paramValue))) {
+        int freg = getDoubleReg(codegen, paramValue, irIndex, -1, -1);
+        if (passesDouble) {
+            codegen->currentParamCount++;
+            passFloatWord(codegen, paramIndex, freg);
+            passFloatWord(codegen, paramIndex + 1, freg + 1);
+        } else {
+            bool toFloat = strstr(paramType, "float") != NULL && strchr(paramType, '*') == NULL;
+            sprintf(instr, "    %s $f0, $f%d", toFloat ? "cvt.s.d" : "trunc.w.d", freg);
+            emitMIPS(codegen, instr);
+            passFloatWord(codegen, paramIndex, 0);
+        }
+        return;
+    }
+    
     if (paramIndex < 4) {
         // First 4 parameters go to $a0-$a3
         int argReg = REG_A0 + paramIndex;
@@ -2586,10 +4120,29 @@ void translateParam(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
         } else {
             // Variable - for I/O calls, load directly from memory to avoid register allocation issues
             if (isIOCall) {
-                char location[128];
-                getMemoryLocation(codegen, paramValue, location);
-                sprintf(instr, "    lw %s, %s    # Load %s for I/O call", 
-                       getRegisterName(argReg), location, paramValue);
+                // ...unless the value has not been written back yet
+                int heldIn = -1;
+                int addrIdx = findAddressDescriptor(codegen, paramValue);
+                if (addrIdx >= 0 && !codegen->addrDescriptors[addrIdx].inMemory) {
+                    for (int r = REG_T0; r <= REG_T9 && heldIn < 0; r++) {
+                        for (int v = 0; v < codegen->regDescriptors[r].varCount; v++) {
+                            if (strcmp(codegen->regDescriptors[r].varNames[v], paramValue) == 0) {
+                                heldIn = r;
+                                break;
+                            }
+                        }
+                    }
+                }
+
+                if (heldIn >= 0) {
+                    sprintf(instr, "    move %s, %s    # %s for I/O call",
+                           getRegisterName(argReg), getRegisterName(heldIn), paramValue);
+                } else {
+                    char location[128];
+                    getMemoryLocation(codegen, paramValue, location);
+                    sprintf(instr, "    lw %s, %s    # Load %s for I/O call",
+                           getRegisterName(argReg), location, paramValue);
+                }
                 emitMIPS(codegen, instr);
             } else {
                 // Get register for variable
@@ -2625,6 +4178,310 @@ void translateParam(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
     // If isIOCall and paramIndex >= 4, we skip pushing to stack - printf/scanf will handle it
 }
 
+/**
+ * One piece of a printf format string: the literal text printed before a
+ * conversion specifier, then the specifier (spec is '\0' for the text
+ * after the last one)
+ */
+typedef struct PrintfPiece {
+    char text[256];
+    int textLen;
+    char spec;
+    int precision;      // -1 when the specifier has none
+    char length;        // 'l' or 'h' length modifier, '\0' for none
+} PrintfPiece;
+
+/**
+ * Find the format string of the printf call at irIndex: the nearest
+ * preceding PARAM of the same function that is a string literal
+ */
+static bool findPrintfFormat(MIPSCodeGenerator* codegen, int irIndex, char* formatStr, size_t size) {
+    for (int i = irIndex - 1; i >= 0 && i >= irIndex - 20 && !isFunctionBegin(&codegen->IR[i]); i--) {
+        if ((strcmp(codegen->IR[i].op, "PARAM") == 0 || strcmp(codegen->IR[i].op, "param") == 0) &&
+            codegen->IR[i].arg1[0] == '"') {
+            strncpy(formatStr, codegen->IR[i].arg1, size - 1);
+            formatStr[size - 1] = '\0';
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Split a quoted printf format literal at compile time. Escape sequences
+ * and %% are decoded into the literal text; characters the console cannot
+ * print (anything but newline, tab and printable ASCII) are dropped.
+ * `pieces` grows to hold every piece of the format.
+ */
+static void parsePrintfFormat(const char* formatStr, std::vector<PrintfPiece>& pieces) {
+    pieces.clear();
+    pieces.push_back(PrintfPiece());
+    PrintfPiece* piece = &pieces.back();
+    piece->textLen = 0;
+    piece->spec = '\0';
+    piece->precision = -1;
+    piece->length = '\0';
+    
+    // Skip the opening quote
+    for (int i = 1; formatStr[i] != '\0' && formatStr[i] != '"'; i++) {
+        if (formatStr[i] == '%' && formatStr[i+1] != '%' && formatStr[i+1] != '\0' && formatStr[i+1] != '"') {
+            // Conversion specifier, with an optional precision like .2
+            // and length modifier (%ld, %lf)
+            i++;
+            int precision = -1;
+            if (formatStr[i] == '.') {
+                i++;
+                precision = 0;
+                while (formatStr[i] >= '0' && formatStr[i] <= '9') {
+                    precision = precision * 10 + (formatStr[i] - '0');
+                    i++;
+                }
+            }
+            char length = '\0';
+            while (formatStr[i] == 'l' || formatStr[i] == 'h') {
+                length = formatStr[i];
+                i++;
+            }
+            piece->text[piece->textLen] = '\0';
+            piece->spec = formatStr[i];
+            piece->precision = precision;
+            piece->length = length;
+            pieces.push_back(PrintfPiece());
+            piece = &pieces.back();
+            piece->textLen = 0;
+            piece->spec = '\0';
+            piece->precision = -1;
+            piece->length = '\0';
+            if (formatStr[i] == '\0') break;
+            continue;
+        }
+        
+        char ch = formatStr[i];
+        if (ch == '%' && formatStr[i+1] == '%') {
+            i++;  // Escaped percent sign
+        } else if (ch == '\\' && formatStr[i+1] != '\0' && formatStr[i+1] != '"') {
+            i++;
+            switch (formatStr[i]) {
+                case 'n': ch = '\n'; break;
+                case 't': ch = '\t'; break;
+                case 'r': ch = '\r'; break;
+                default:  ch = formatStr[i]; break;
+            }
+        }
+        if ((ch == '\n' || ch == '\t' || (ch >= 32 && ch <= 126)) && piece->textLen < (int)sizeof(piece->text) - 1) {
+            piece->text[piece->textLen++] = ch;
+        }
+    }
+    piece->text[piece->textLen] = '\0';
+}
+
+/**
+ * Index of a literal segment in the _fmt pool, or -1
+ */
+static int findPrintfSegment(const MIPSCodeGenerator* codegen, const char* text) {
+    for (int i = 0; i < codegen->printfSegmentCount; i++) {
+        if (strcmp(codegen->printfSegments[i], text) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Print a printf literal segment: pooled segments with one print_string
+ * syscall, single characters (or segments that did not fit in the pool)
+ * with print_char
+ */
+static void emitPrintfText(MIPSCodeGenerator* codegen, const char* text, int length) {
+    char instr[256];
+    int segment = length > 1 ? findPrintfSegment(codegen, text) : -1;
+    if (segment >= 0) {
+        sprintf(instr, "    la $a0, _fmt%d", segment);
+        emitMIPS(codegen, instr);
+        emitMIPS(codegen, "    li $v0, 4    # syscall 4: print_string");
+        emitMIPS(codegen, "    syscall");
+        return;
+    }
+    for (int j = 0; j < length; j++) {
+        char ch = text[j];
+        if (ch == '\n') {
+            sprintf(instr, "    li $a0, 10    # newline");
+        } else if (ch == '\t') {
+            sprintf(instr, "    li $a0, 9     # tab");
+        } else {
+            sprintf(instr, "    li $a0, %d    # '%c'", (int)ch, ch);
+        }
+        emitMIPS(codegen, instr);
+        emitMIPS(codegen, "    li $v0, 11    # syscall 11: print_char");
+        emitMIPS(codegen, "    syscall");
+    }
+}
+
+// In IO_RUNTIME_AUTO mode, calls whose inline expansion would take at
+// least this many instructions use the shared routine instead, provided
+// the instructions saved over the program outweigh the routines' size
+#define SHARED_IO_MIN_INLINE_SIZE 8
+#define SHARED_IO_ROUTINES_SIZE 120
+
+/**
+ * Whether the quad at irIndex lies inside a loop: some later jump in the
+ * same function goes back to a label at or before it
+ */
+static bool isInsideLoop(MIPSCodeGenerator* codegen, int irIndex) {
+    int begin = irIndex;
+    while (begin > 0 && !isFunctionBegin(&codegen->IR[begin])) {
+        begin--;
+    }
+    for (int j = irIndex + 1; j < codegen->irCount && !isFunctionEnd(&codegen->IR[j]); j++) {
+        const Quadruple* quad = &codegen->IR[j];
+        const char* target = NULL;
+        if (strcmp(quad->op, "GOTO") == 0 || strcmp(quad->op, "goto") == 0) {
+            target = strlen(quad->result) > 0 ? quad->result : quad->arg1;
+        } else if (strncmp(quad->op, "IF_TRUE_GOTO", 12) == 0 || strncmp(quad->op, "IF_FALSE_GOTO", 13) == 0) {
+            target = quad->arg2;
+        }
+        if (!target || target[0] == '\0') {
+            continue;
+        }
+        for (int l = begin; l <= irIndex; l++) {
+            if (strcmp(codegen->IR[l].op, "LABEL") == 0 && strcmp(codegen->IR[l].arg1, target) == 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Number of instructions translateCall emits for the printf/scanf call at
+ * irIndex when it is expanded inline
+ */
+static int inlineIOCallSize(MIPSCodeGenerator* codegen, int irIndex, bool isPrintf, int paramCount) {
+    if (!isPrintf) {
+        // Address move, read syscall (2) and store per item, then the count
+        return 4 * (paramCount - 1) + 1;
+    }
+    char formatStr[512];
+    if (!findPrintfFormat(codegen, irIndex, formatStr, sizeof(formatStr))) {
+        return 2;
+    }
+    int size = paramCount > 1 ? paramCount + 1 : 0;     // Saving and restoring $a1-$a3
+    std::vector<PrintfPiece> pieces;
+    parsePrintfFormat(formatStr, pieces);
+    for (size_t p = 0; p < pieces.size(); p++) {
+        if (pieces[p].textLen > 0) {
+            size += 3;      // Pooled segment or a single print_char
+        }
+        if (pieces[p].spec != '\0') {
+            size += pieces[p].spec == 'f' ? 4 : 3;
+        }
+    }
+    return size;
+}
+
+/**
+ * Whether the printf/scanf call at irIndex passes a double argument or
+ * reads one (%lf)
+ */
+static bool passesDoubles(MIPSCodeGenerator* codegen, int irIndex) {
+    const Quadruple* call = &codegen->IR[irIndex];
+    if (strcmp(call->arg1, "scanf") == 0) {
+        char formatStr[512];
+        std::vector<PrintfPiece> pieces;
+        if (!findPrintfFormat(codegen, irIndex, formatStr, sizeof(formatStr))) {
+            return false;
+        }
+        parsePrintfFormat(formatStr, pieces);
+        for (size_t p = 0; p < pieces.size(); p++) {
+            if (pieces[p].length == 'l' && pieces[p].spec == 'f') {
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    int begin = irIndex;
+    while (begin > 0 && !isFunctionBegin(&codegen->IR[begin])) {
+        begin--;
+    }
+    const ActivationRecord* record = getActivationRecord(codegen->IR[begin].arg1);
+    int params = atoi(call->arg2);
+    for (int i = irIndex - 1; i > begin && params > 0; i--) {
+        const Quadruple* quad = &codegen->IR[i];
+        if (strcmp(quad->op, "PARAM") == 0 || strcmp(quad->op, "param") == 0) {
+            if (isDoubleIn(record, quad->arg1)) {
+                return true;
+            }
+            params--;
+        }
+    }
+    return false;
+}
+
+/**
+ * Whether the printf/scanf call at irIndex may call the shared routine,
+ * regardless of whether the program includes them. They take the format
+ * in $a0 and up to three arguments in $a1-$a3, so calls with more
+ * arguments are always expanded inline.
+ */
+static bool isSharedIOCandidate(MIPSCodeGenerator* codegen, int irIndex) {
+    if (ctx->ioRuntimeMode == IO_RUNTIME_INLINE) {
+        return false;
+    }
+    const Quadruple* quad = &codegen->IR[irIndex];
+    if ((strcmp(quad->op, "CALL") != 0 && strcmp(quad->op, "call") != 0) ||
+        (strcmp(quad->arg1, "printf") != 0 && strcmp(quad->arg1, "scanf") != 0)) {
+        return false;
+    }
+    if (!isdigit((unsigned char)quad->arg2[0])) {
+        return false;
+    }
+    int paramCount = atoi(quad->arg2);
+    if (paramCount < 1 || paramCount > 4) {
+        return false;
+    }
+    // The routines pass every argument in one word
+    if (passesDoubles(codegen, irIndex)) {
+        return false;
+    }
+    if (ctx->ioRuntimeMode == IO_RUNTIME_SHARED) {
+        return true;
+    }
+    // Outside loops the call runs rarely, so code size decides
+    if (isInsideLoop(codegen, irIndex)) {
+        return false;
+    }
+    bool isPrintf = strcmp(quad->arg1, "printf") == 0;
+    return inlineIOCallSize(codegen, irIndex, isPrintf, paramCount) >= SHARED_IO_MIN_INLINE_SIZE;
+}
+
+/**
+ * Decide whether the program includes the shared printf/scanf routines;
+ * called once, before the data section is laid out
+ */
+static void planSharedIO(MIPSCodeGenerator* codegen) {
+    codegen->sharedIORoutines = false;
+    int saved = 0;
+    for (int i = 0; i < codegen->irCount; i++) {
+        if (isSharedIOCandidate(codegen, i)) {
+            bool isPrintf = strcmp(codegen->IR[i].arg1, "printf") == 0;
+            saved += inlineIOCallSize(codegen, i, isPrintf, atoi(codegen->IR[i].arg2)) - 1;
+        }
+    }
+    if (ctx->ioRuntimeMode == IO_RUNTIME_SHARED) {
+        codegen->sharedIORoutines = saved > 0;
+    } else if (ctx->ioRuntimeMode == IO_RUNTIME_AUTO) {
+        codegen->sharedIORoutines = saved > SHARED_IO_ROUTINES_SIZE;
+    }
+}
+
+/**
+ * Whether the printf/scanf call at irIndex calls the shared routine
+ */
+static bool useSharedIOCall(MIPSCodeGenerator* codegen, int irIndex) {
+    return codegen->sharedIORoutines && isSharedIOCandidate(codegen, irIndex);
+}
+
 /**
  * Translate CALL instruction
  * Format: result = call func_name, param_count
@@ -2640,35 +4497,21 @@ void translateCall(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
     
     // Check if this is a standard library I/O function
     if (strcmp(funcName, "printf") == 0) {
-        // FULL PRINTF IMPLEMENTATION WITH FORMAT STRING PARSING
-        // Parse the format string and generate syscalls for each segment
-        
-        // Get the format string from the first parameter  
-        // Look backward in IR for the PARAM instruction with string literal
+        // The format string is split at compile time: literal text is
+        // printed from the _fmt pool in .data, each specifier with the
+        // syscall (or runtime helper) for its argument
         char formatStr[512] = "";
-        bool foundFormat = false;
-        
-        // Search backward from current instruction for the first PARAM with a string literal
-        for (int i = irIndex - 1; i >= 0 && i >= irIndex - 20; i--) {
-            if ((strcmp(codegen->IR[i].op, "PARAM") == 0 || strcmp(codegen->IR[i].op, "param") == 0) &&
-                codegen->IR[i].arg1[0] == '"') {
-                // Found string literal parameter
-                strncpy(formatStr, codegen->IR[i].arg1, sizeof(formatStr) - 1);
-                foundFormat = true;
-                break;
-            }
-        }
+        bool foundFormat = findPrintfFormat(codegen, irIndex, formatStr, sizeof(formatStr));
         
-        if (!foundFormat || formatStr[0] != '"') {
+        if (useSharedIOCall(codegen, irIndex)) {
+            // Format in $a0, arguments in $a1-$a3, walked at runtime
+            emitMIPS(codegen, "    jal _printf");
+        } else if (!foundFormat || formatStr[0] != '"') {
             // Fallback to simple printf if no format string found
             sprintf(instr, "    li $v0, 4    # syscall 4: print_string");
             emitMIPS(codegen, instr);
             emitMIPS(codegen, "    syscall");
         } else {
-            // Parse format string and generate a runtime string parser
-            // Strategy: Load format string address, iterate through it character by character,
-            // print characters until we hit %, then print the corresponding argument
-            
             // Save argument registers to stack (we'll need $a0 for syscalls)
             if (paramCount > 1) {
                 sprintf(instr, "    addiu $sp, $sp, -16");
@@ -2685,165 +4528,83 @@ void translateCall(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
                 }
             }
             
-            // Simpler approach: Parse format string at COMPILE time and generate inline code
+            std::vector<PrintfPiece> pieces;
+            parsePrintfFormat(formatStr, pieces);
             int argIndex = 1;  // Start with first argument after format string
-            char segment[256];
-            int segLen = 0;
             
-            // Parse the format string (skip opening quote)
-            for (int i = 1; formatStr[i] != '\0' && formatStr[i] != '"'; i++) {
-                if (formatStr[i] == '%' && formatStr[i+1] != '%' && formatStr[i+1] != '\0' && formatStr[i+1] != '"') {
-                    // Found format specifier - print accumulated segment first
-                    if (segLen > 0) {
-                        segment[segLen] = '\0';
-                        // Print each character of the segment
-                        for (int j = 0; j < segLen; j++) {
-                            char ch = segment[j];
-                            if (ch == '\n') {
-                                // Print newline
-                                sprintf(instr, "    li $a0, 10    # newline");
-                                emitMIPS(codegen, instr);
-                                sprintf(instr, "    li $v0, 11    # syscall 11: print_char");
-                                emitMIPS(codegen, instr);
-                                emitMIPS(codegen, "    syscall");
-                            } else if (ch == '\t') {
-                                sprintf(instr, "    li $a0, 9     # tab");
-                                emitMIPS(codegen, instr);
-                                sprintf(instr, "    li $v0, 11");
-                                emitMIPS(codegen, instr);
-                                emitMIPS(codegen, "    syscall");
-                            } else if (ch >= 32 && ch <= 126) {
-                                // Printable ASCII
-                                sprintf(instr, "    li $a0, %d    # '%c'", (int)ch, ch);
-                                emitMIPS(codegen, instr);
-                                sprintf(instr, "    li $v0, 11    # syscall 11: print_char");
-                                emitMIPS(codegen, instr);
-                                emitMIPS(codegen, "    syscall");
-                            }
-                        }
-                        segLen = 0;
-                    }
-                    
-                    // Handle the format specifier
-                    i++;  // Move past '%'
-                    char spec = formatStr[i];
-                    
-                    // Parse precision specifiers like .1, .2
-                    int precision = -1;  // -1 means default (6 for floats)
-                    if (spec == '.') {
-                        i++;
-                        precision = 0;
-                        while (formatStr[i] >= '0' && formatStr[i] <= '9') {
-                            precision = precision * 10 + (formatStr[i] - '0');
-                            i++;
-                        }
-                        spec = formatStr[i];
-                    }
-                    
-                    // Load the argument into $a0
-                    if (argIndex == 1) {
-                        sprintf(instr, "    lw $a0, 0($sp)    # Load arg %d", argIndex);
-                    } else if (argIndex == 2) {
-                        sprintf(instr, "    lw $a0, 4($sp)    # Load arg %d", argIndex);
-                    } else if (argIndex == 3) {
-                        sprintf(instr, "    lw $a0, 8($sp)    # Load arg %d", argIndex);
-                    } else {
-                        // Load from original stack position
-                        sprintf(instr, "    lw $a0, %d($sp)    # Load arg %d", 16 + (argIndex - 4) * 4, argIndex);
-                    }
+            for (size_t p = 0; p < pieces.size(); p++) {
+                const PrintfPiece* piece = &pieces[p];
+                if (piece->textLen > 0) {
+                    emitPrintfText(codegen, piece->text, piece->textLen);
+                }
+                if (piece->spec == '\0') {
+                    continue;
+                }
+                char spec = piece->spec;
+                
+                // Doubles are printed from memory, in the $f12 pair
+                if (argIndex < 10 && codegen->printfDoubles[argIndex][0] != '\0') {
+                    char location[128];
+                    int prec = (piece->precision == -1) ? 6 : piece->precision;
+                    getMemoryLocation(codegen, codegen->printfDoubles[argIndex], location);
+                    sprintf(instr, "    l.d $f12, %s    # Load arg %d", location, argIndex);
                     emitMIPS(codegen, instr);
-                    
-                    // Emit appropriate syscall based on format specifier
-                    if (spec == 'd' || spec == 'i') {
-                        sprintf(instr, "    li $v0, 1    # syscall 1: print_int");
-                        emitMIPS(codegen, instr);
-                        emitMIPS(codegen, "    syscall");
-                    } else if (spec == 'f') {
-                        // Float formatting with precision control (default 6 decimal places for %f)
-                        int prec = (precision == -1) ? 6 : precision;
-                        
-                        // Move value to float register
-                        sprintf(instr, "    mtc1 $a0, $f12    # Move to float register");
-                        emitMIPS(codegen, instr);
-                        
-                        // Call helper to print float with specified precision
-                        sprintf(instr, "    li $t7, %d    # Precision", prec);
-                        emitMIPS(codegen, instr);
-                        emitMIPS(codegen, "    jal _print_float_precision");
-                    } else if (spec == 'c') {
-                        sprintf(instr, "    li $v0, 11   # syscall 11: print_char");
-                        emitMIPS(codegen, instr);
-                        emitMIPS(codegen, "    syscall");
-                    } else if (spec == 's') {
-                        sprintf(instr, "    li $v0, 4    # syscall 4: print_string");
-                        emitMIPS(codegen, instr);
-                        emitMIPS(codegen, "    syscall");
-                    } else if (spec == 'p' || spec == 'x') {
-                        sprintf(instr, "    li $v0, 1    # syscall 1: print_int (pointer as int)");
-                        emitMIPS(codegen, instr);
-                        emitMIPS(codegen, "    syscall");
-                    } else {
-                        sprintf(instr, "    li $v0, 1    # syscall 1: print_int (default)");
-                        emitMIPS(codegen, instr);
-                        emitMIPS(codegen, "    syscall");
-                    }
-                    
+                    sprintf(instr, "    li $t7, %d    # Precision", prec);
+                    emitMIPS(codegen, instr);
+                    emitMIPS(codegen, "    jal _print_double_precision");
                     argIndex++;
-                } else if (formatStr[i] == '%' && formatStr[i+1] == '%') {
-                    // Escaped percent sign
-                    segment[segLen++] = '%';
-                    i++;  // Skip next '%'
+                    continue;
+                }
+                
+                // Load the argument into $a0
+                if (argIndex == 1) {
+                    sprintf(instr, "    lw $a0, 0($sp)    # Load arg %d", argIndex);
+                } else if (argIndex == 2) {
+                    sprintf(instr, "    lw $a0, 4($sp)    # Load arg %d", argIndex);
+                } else if (argIndex == 3) {
+                    sprintf(instr, "    lw $a0, 8($sp)    # Load arg %d", argIndex);
                 } else {
-                    // Regular character
-                    char ch = formatStr[i];
+                    // Load from original stack position
+                    sprintf(instr, "    lw $a0, %d($sp)    # Load arg %d", 16 + (argIndex - 4) * 4, argIndex);
+                }
+                emitMIPS(codegen, instr);
+                
+                // Emit appropriate syscall based on format specifier
+                if (spec == 'd' || spec == 'i') {
+                    sprintf(instr, "    li $v0, 1    # syscall 1: print_int");
+                    emitMIPS(codegen, instr);
+                    emitMIPS(codegen, "    syscall");
+                } else if (spec == 'f') {
+                    // Float formatting with precision control (default 6 decimal places for %f)
+                    int prec = (piece->precision == -1) ? 6 : piece->precision;
                     
-                    // Handle escape sequences
-                    if (ch == '\\' && formatStr[i+1] != '\0' && formatStr[i+1] != '"') {
-                        i++;
-                        if (formatStr[i] == 'n') {
-                            ch = '\n';
-                        } else if (formatStr[i] == 't') {
-                            ch = '\t';
-                        } else if (formatStr[i] == 'r') {
-                            ch = '\r';
-                        } else if (formatStr[i] == '\\') {
-                            ch = '\\';
-                        } else if (formatStr[i] == '"') {
-                            ch = '"';
-                        } else {
-                            ch = formatStr[i];
-                        }
-                    }
+                    // Move value to float register
+                    sprintf(instr, "    mtc1 $a0, $f12    # Move to float register");
+                    emitMIPS(codegen, instr);
                     
-                    segment[segLen++] = ch;
-                }
-            }
-            
-            // Print any remaining segment
-            if (segLen > 0) {
-                segment[segLen] = '\0';
-                for (int j = 0; j < segLen; j++) {
-                    char ch = segment[j];
-                    if (ch == '\n') {
-                        sprintf(instr, "    li $a0, 10    # newline");
-                        emitMIPS(codegen, instr);
-                        sprintf(instr, "    li $v0, 11    # syscall 11: print_char");
-                        emitMIPS(codegen, instr);
-                        emitMIPS(codegen, "    syscall");
-                    } else if (ch == '\t') {
-                        sprintf(instr, "    li $a0, 9     # tab");
-                        emitMIPS(codegen, instr);
-                        sprintf(instr, "    li $v0, 11");
-                        emitMIPS(codegen, instr);
-                        emitMIPS(codegen, "    syscall");
-                    } else if (ch >= 32 && ch <= 126) {
-                        sprintf(instr, "    li $a0, %d    # '%c'", (int)ch, ch);
-                        emitMIPS(codegen, instr);
-                        sprintf(instr, "    li $v0, 11    # syscall 11: print_char");
-                        emitMIPS(codegen, instr);
-                        emitMIPS(codegen, "    syscall");
-                    }
+                    // Call helper to print float with specified precision
+                    sprintf(instr, "    li $t7, %d    # Precision", prec);
+                    emitMIPS(codegen, instr);
+                    emitMIPS(codegen, "    jal _print_float_precision");
+                } else if (spec == 'c') {
+                    sprintf(instr, "    li $v0, 11   # syscall 11: print_char");
+                    emitMIPS(codegen, instr);
+                    emitMIPS(codegen, "    syscall");
+                } else if (spec == 's') {
+                    sprintf(instr, "    li $v0, 4    # syscall 4: print_string");
+                    emitMIPS(codegen, instr);
+                    emitMIPS(codegen, "    syscall");
+                } else if (spec == 'p' || spec == 'x') {
+                    sprintf(instr, "    li $v0, 1    # syscall 1: print_int (pointer as int)");
+                    emitMIPS(codegen, instr);
+                    emitMIPS(codegen, "    syscall");
+                } else {
+                    sprintf(instr, "    li $v0, 1    # syscall 1: print_int (default)");
+                    emitMIPS(codegen, instr);
+                    emitMIPS(codegen, "    syscall");
                 }
+                
+                argIndex++;
             }
             
             // Restore stack (restore the 16 bytes we allocated for saving a1-a3)
@@ -2872,7 +4633,8 @@ void translateCall(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
         bool foundFormat = false;
         int paramsFound = 0;
         
-        for (int i = irIndex - 1; i >= 0 && i >= irIndex - 30 && paramsFound < numParams; i--) {
+        for (int i = irIndex - 1; i >= 0 && i >= irIndex - 30 && paramsFound < numParams &&
+                                  !isFunctionBegin(&codegen->IR[i]); i--) {
             if (strcmp(codegen->IR[i].op, "PARAM") == 0 || strcmp(codegen->IR[i].op, "param") == 0) {
                 paramsFound++;
                 if (paramsFound == numParams && codegen->IR[i].arg1[0] == '"') {
@@ -2884,7 +4646,10 @@ void translateCall(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
             }
         }
         
-        if (!foundFormat || formatStr[0] != '"') {
+        if (useSharedIOCall(codegen, irIndex)) {
+            // Format in $a0, addresses in $a1-$a3; returns the item count
+            emitMIPS(codegen, "    jal _scanf");
+        } else if (!foundFormat || formatStr[0] != '"') {
             // Fallback to simple int scanf
             sprintf(instr, "    li $v0, 5    # syscall 5: read_int");
             emitMIPS(codegen, instr);
@@ -2911,6 +4676,12 @@ void translateCall(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
                         i++;
                         spec = formatStr[i];
                     }
+                    bool isLong = false;
+                    while (spec == 'l' || spec == 'h') {
+                        isLong = spec == 'l';
+                        i++;
+                        spec = formatStr[i];
+                    }
                     
                     // Load the address of variable from argument
                     // Arguments are in $a1, $a2, $a3, or stack
@@ -2936,6 +4707,13 @@ void translateCall(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
                         emitMIPS(codegen, "    syscall");
                         sprintf(instr, "    sw $v0, 0($t8)   # Store int to address");
                         emitMIPS(codegen, instr);
+                    } else if (spec == 'f' && isLong) {
+                        // Read double (SPIM syscall 7)
+                        sprintf(instr, "    li $v0, 7    # syscall 7: read_double");
+                        emitMIPS(codegen, instr);
+                        emitMIPS(codegen, "    syscall");
+                        sprintf(instr, "    s.d $f0, 0($t8)  # Store double to address");
+                        emitMIPS(codegen, instr);
                     } else if (spec == 'f') {
                         // Read float (SPIM syscall 6)
                         sprintf(instr, "    li $v0, 6    # syscall 6: read_float");
@@ -2987,7 +4765,7 @@ void translateCall(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
             updateDescriptors(codegen, resultReg, quad->result);
             codegen->regDescriptors[resultReg].isDirty = false;
             
-            // Store to memory
+            // Store to memory: every register is forgotten below
             storeVariable(codegen, quad->result, resultReg);
             int addrIdx = findOrCreateAddrDesc(codegen, quad->result);
             if (addrIdx >= 0) {
@@ -3036,22 +4814,24 @@ void translateCall(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
         
         // If call has a result, move return value from $v0 to destination
         int resultReg = -1;  // Track which register holds the return value
-        if (strlen(quad->result) > 0 && strcmp(quad->result, "") != 0) {
+        if (isDoubleValue(codegen, quad->result)) {
+            // Doubles come back in the $f0 pair
+            int freg = getFloatResultReg(codegen, quad->result, irIndex, -1, -1);
+            sprintf(instr, "    mov.d $f%d, $f0", freg);
+            emitMIPS(codegen, instr);
+            setFloatResult(codegen, quad->result, freg);
+        } else if (strlen(quad->result) > 0 && strcmp(quad->result, "") != 0) {
             resultReg = getReg(codegen, quad->result, irIndex);
             sprintf(instr, "    move %s, $v0", getRegisterName(resultReg));
             emitMIPS(codegen, instr);
             
             // Update descriptors
             updateDescriptors(codegen, resultReg, quad->result);
-            codegen->regDescriptors[resultReg].isDirty = false;  // Return value already stored
+            codegen->regDescriptors[resultReg].isDirty = false;
             
-            // CRITICAL FIX: Store return value to memory so it can be loaded later
-            // Without this, subsequent loads (e.g., for printf arguments) get garbage
-            storeVariable(codegen, quad->result, resultReg);
-            int addrIdx = findOrCreateAddrDesc(codegen, quad->result);
-            if (addrIdx >= 0) {
-                codegen->addrDescriptors[addrIdx].inMemory = true;
-            }
+            // CRITICAL FIX: Store return value so it can be loaded later; a temporary
+            // stays dirty in the register, which is spilled before the next call
+            storeResult(codegen, quad->result, resultReg);
         }
     }
     
@@ -3060,7 +4840,7 @@ void translateCall(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
     // operations will reload variables from memory instead of trusting stale register values
     // EXCEPTIONS:
     // 1. Don't clear the register that holds the return value
-    // 2. Don't clear registers holding temporaries (tN) - they only exist in registers!
+    // 2. Don't clear $s registers holding temporaries - the callee preserves them
     int resultReg = -1;
     if (strlen(quad->result) > 0 && strcmp(quad->result, "") != 0) {
         // Find which register holds the result (check address descriptor)
@@ -3072,26 +4852,94 @@ void translateCall(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
         }
     }
     
-    for (int r = REG_T0; r <= REG_T9; r++) {
-        if (r == resultReg) {
-            // Don't clear - holds the return value
-            continue;
+    // Recursive calls clobber all caller-saved registers: in fib(n-1) + fib(n-2)
+    // the first result is kept in an $s register (or memory) over the second call
+    forgetCallerSavedRegisters(codegen, resultReg);
+    
+    // Reset parameter counter for next call
+    codegen->currentParamCount = 0;
+}
+
+/**
+ * Remember where an epilogue restores the callee-saved registers ($fp
+ * still points into the frame there)
+ */
+static void markRestorePoint(MIPSCodeGenerator* codegen) {
+    if (codegen->outputBuffer == NULL) {
+        return;
+    }
+    if (codegen->restoreInsertCount == codegen->restoreInsertCapacity) {
+        int capacity = codegen->restoreInsertCapacity ? codegen->restoreInsertCapacity * 2 : 16;
+        size_t* points = (size_t*)realloc(codegen->restoreInsertPoints, sizeof(size_t) * capacity);
+        if (!points) {
+            fprintf(stderr, "Error: Cannot grow the epilogue list\n");
+            return;
         }
-        
-        // CRITICAL FIX: Clear ALL caller-saved registers after function calls
-        // This includes temporaries! Even though temporaries only exist in registers,
-        // they MUST be reloaded from memory after a function call because:
-        // 1. The return value was already stored to memory (line 3051)
-        // 2. Recursive calls clobber all caller-saved registers
-        // 3. Example: fib(n-1) + fib(n-2) - first result must be in memory before second call
-        clearRegisterDescriptor(codegen, r);
+        codegen->restoreInsertPoints = points;
+        codegen->restoreInsertCapacity = capacity;
     }
-    for (int r = REG_A0; r <= REG_A3; r++) {
-        clearRegisterDescriptor(codegen, r);
+    codegen->restoreInsertPoints[codegen->restoreInsertCount++] = codegen->outputBuffer->length;
+}
+
+/**
+ * Insert the saves and restores of the callee-saved registers the function
+ * was handed at the points marked by the prologue and the epilogues
+ */
+static void insertSavedRegisters(MIPSCodeGenerator* codegen) {
+    MIPSOutputBuffer* buf = codegen->outputBuffer;
+    const ActivationRecord* record = codegen->currentFunction;
+    if (buf == NULL || record == NULL) {
+        return;
     }
     
-    // Reset parameter counter for next call
-    codegen->currentParamCount = 0;
+    bool used[NUM_SAVED_REGS] = { false };
+    int usedCount = 0;
+    for (int s = 0; s < NUM_SAVED_REGS; s++) {
+        if (codegen->regDescriptors[REG_S0 + s].allocated) {
+            used[s] = true;
+            usedCount++;
+        }
+    }
+    if (usedCount == 0) {
+        return;
+    }
+    
+    char saves[NUM_SAVED_REGS * 32] = "";
+    char restores[NUM_SAVED_REGS * 32] = "";
+    for (int s = 0; s < NUM_SAVED_REGS; s++) {
+        if (used[s]) {
+            int offset = record->savedRegsOffset - 4 * s;
+            sprintf(saves + strlen(saves), "    sw $s%d, %d($fp)\n", s, offset);
+            sprintf(restores + strlen(restores), "    lw $s%d, %d($fp)\n", s, offset);
+        }
+    }
+    size_t savesLength = strlen(saves);
+    size_t restoresLength = strlen(restores);
+    
+    size_t capacity = buf->length + savesLength + restoresLength * codegen->restoreInsertCount + 1;
+    char* data = (char*)malloc(capacity);
+    if (!data) {
+        fprintf(stderr, "Error: Cannot allocate MIPS output buffer\n");
+        return;
+    }
+    size_t length = 0;
+    size_t copied = 0;
+    for (int p = -1; p < codegen->restoreInsertCount; p++) {
+        size_t point = (p < 0) ? codegen->saveInsertPoint : codegen->restoreInsertPoints[p];
+        memcpy(data + length, buf->data + copied, point - copied);
+        length += point - copied;
+        copied = point;
+        memcpy(data + length, p < 0 ? saves : restores, p < 0 ? savesLength : restoresLength);
+        length += p < 0 ? savesLength : restoresLength;
+    }
+    memcpy(data + length, buf->data + copied, buf->length - copied);
+    length += buf->length - copied;
+    data[length] = '\0';
+    
+    free(buf->data);
+    buf->data = data;
+    buf->length = length;
+    buf->capacity = capacity;
 }
 
 /**
@@ -3104,8 +4952,21 @@ void translateReturn(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
     // If returning a value, move it to $v0
     if (strlen(quad->arg1) > 0 && strcmp(quad->arg1, "") != 0) {
         const char* retValue = quad->arg1;
+        const char* funcName = codegen->currentFunction ? codegen->currentFunction->funcName : "";
         
-        if (isConstantValue(retValue)) {
+        if (returnsDouble(funcName)) {
+            // Doubles are returned in the $f0 pair
+            int freg = getDoubleReg(codegen, retValue, irIndex, -1, -1);
+            sprintf(instr, "    mov.d $f0, $f%d", freg);
+            emitMIPS(codegen, instr);
+        } else if (isDoubleValue(codegen, retValue)) {
+            int freg = getDoubleReg(codegen, retValue, irIndex, -1, -1);
+            const Symbol* func = findFunctionSymbol("", funcName);
+            bool toFloat = func != NULL && strstr(func->return_type, "float") != NULL;
+            sprintf(instr, "    %s $f0, $f%d", toFloat ? "cvt.s.d" : "trunc.w.d", freg);
+            emitMIPS(codegen, instr);
+            emitMIPS(codegen, "    mfc1 $v0, $f0");
+        } else if (isConstantValue(retValue)) {
             // Return constant - use loadVariable which handles floats
             loadVariable(codegen, retValue, REG_V0);
         } else {
@@ -3134,6 +4995,7 @@ void translateReturn(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
             emitMIPS(codegen, "    syscall");
         }
         
+        markRestorePoint(codegen);
         sprintf(instr, "    lw $ra, %d($sp)", frameSize - 4);
         emitMIPS(codegen, instr);
         sprintf(instr, "    lw $fp, %d($sp)", frameSize - 8);
@@ -3177,14 +5039,14 @@ void translateArrayAccess(MIPSCodeGenerator* codegen, Quadruple* quad, int irInd
                 
                 // Now find the symbol table entry with matching name AND scope
                 // Use the offset to disambiguate between parameter and local
-                for (int i = 0; i < symCount; i++) {
-                    if (strcmp(symtab[i].name, arrayName) == 0) {
+                for (int i = 0; i < ctx->symCount; i++) {
+                    if (strcmp(ctx->symtab[i].name, arrayName) == 0) {
                         // Check if this symbol is in the current function's scope
                         // Parameters have positive/small negative offsets, locals have larger negative
                         // The activation record stores the correct offset for THIS variable
                         // So we use the is_array flag from the first matching symbol in THIS function
-                        if (strcmp(symtab[i].function_scope, codegen->currentFunction->funcName) == 0) {
-                            isPointerAccess = (symtab[i].ptr_level > 0 && !symtab[i].is_array);
+                        if (strcmp(ctx->symtab[i].function_scope, codegen->currentFunction->funcName) == 0) {
+                            isPointerAccess = (ctx->symtab[i].ptr_level > 0 && !ctx->symtab[i].is_array);
                             break;
                         }
                     }
@@ -3246,18 +5108,15 @@ void translateArrayAccess(MIPSCodeGenerator* codegen, Quadruple* quad, int irInd
         updateDescriptors(codegen, resultReg, resultVar);
         codegen->regDescriptors[resultReg].isDirty = false;
         
-        // Store to memory for reloadability
-        storeVariable(codegen, resultVar, resultReg);
-        int addrIdx = findOrCreateAddrDesc(codegen, resultVar);
-        if (addrIdx >= 0) {
-            codegen->addrDescriptors[addrIdx].inMemory = true;
-        }
+        // Store result
+        storeResult(codegen, resultVar, resultReg);
         return;
     }
     
     // Regular array access: arr[i] where arr is an array
     // Get base address of array (from $fp offset)
     char arrayLocation[128];
+    writeBackVariable(codegen, arrayName);
     getMemoryLocation(codegen, arrayName, arrayLocation);
     
     // Parse offset value (e.g., "-12" from "-12($fp)")
@@ -3282,15 +5141,9 @@ void translateArrayAccess(MIPSCodeGenerator* codegen, Quadruple* quad, int irInd
         
         updateDescriptors(codegen, resultReg, resultVar);
         
-        // CRITICAL FIX: Store result to memory immediately after loading from array
-        // This ensures that if the register is spilled later, the memory location has the correct value
-        // Without this, if t43 = intArr[3] loads into $t1, but later $t1 is reused and t43 is reloaded,
-        // it would reload from t43's stack slot which was never written to
-        storeVariable(codegen, resultVar, resultReg);
-        int addrIdx = findAddressDescriptor(codegen, resultVar);
-        if (addrIdx >= 0) {
-            codegen->addrDescriptors[addrIdx].inMemory = true;
-        }
+        // Store result; a temporary stays dirty in the register, so if $t1 holding
+        // t43 = intArr[3] is reused later, the spill writes t43's stack slot first
+        storeResult(codegen, resultVar, resultReg);
     } else {
         // Variable index - calculate at runtime
         int indexReg = getReg(codegen, indexVar, irIndex);
@@ -3332,13 +5185,8 @@ void translateArrayAccess(MIPSCodeGenerator* codegen, Quadruple* quad, int irInd
         
         updateDescriptors(codegen, resultReg, resultVar);
         
-        // CRITICAL FIX: Store result to memory immediately after loading from array
-        // This ensures that if the register is spilled later, the memory location has the correct value
-        storeVariable(codegen, resultVar, resultReg);
-        int addrIdx = findAddressDescriptor(codegen, resultVar);
-        if (addrIdx >= 0) {
-            codegen->addrDescriptors[addrIdx].inMemory = true;
-        }
+        // Store result
+        storeResult(codegen, resultVar, resultReg);
     }
 }
 
@@ -3415,6 +5263,7 @@ void translateAssignArray(MIPSCodeGenerator* codegen, Quadruple* quad, int irInd
     // Regular array access: arr[i] where arr is an array
     // Get base address of array (from $fp offset)
     char arrayLocation[128];
+    writeBackVariable(codegen, arrayName);
     getMemoryLocation(codegen, arrayName, arrayLocation);
     
     // Parse offset value
@@ -3532,12 +5381,8 @@ void translateAddr(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
         updateDescriptors(codegen, resultReg, resultVar);
         codegen->regDescriptors[resultReg].isDirty = false;
         
-        // Store to memory for reloadability
-        storeVariable(codegen, resultVar, resultReg);
-        int addrIdx = findOrCreateAddrDesc(codegen, resultVar);
-        if (addrIdx >= 0) {
-            codegen->addrDescriptors[addrIdx].inMemory = true;
-        }
+        // Store result
+        storeResult(codegen, resultVar, resultReg);
     } else {
         // Global variable - load address
         int resultReg = getReg(codegen, resultVar, irIndex);
@@ -3547,12 +5392,8 @@ void translateAddr(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
         updateDescriptors(codegen, resultReg, resultVar);
         codegen->regDescriptors[resultReg].isDirty = false;
         
-        // Store to memory for reloadability
-        storeVariable(codegen, resultVar, resultReg);
-        int addrIdx = findOrCreateAddrDesc(codegen, resultVar);
-        if (addrIdx >= 0) {
-            codegen->addrDescriptors[addrIdx].inMemory = true;
-        }
+        // Store result
+        storeResult(codegen, resultVar, resultReg);
     }
 }
 
@@ -3571,11 +5412,11 @@ void translateArrayAddr(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex
     // Check if this is a pointer dereference (ptr[i]) or array access (arr[i])
     // CRITICAL FIX: Use scope-independent lookup, not lookupSymbol()
     bool isPointerAccess = false;
-    for (int i = 0; i < symCount; i++) {
-        if (strcmp(symtab[i].name, arrayName) == 0) {
+    for (int i = 0; i < ctx->symCount; i++) {
+        if (strcmp(ctx->symtab[i].name, arrayName) == 0) {
             // It's pointer access if it has pointer level > 0 and is NOT a local array
             // (A parameter like int* arr has ptr_level=1)
-            isPointerAccess = (symtab[i].ptr_level > 0 && !symtab[i].is_array);
+            isPointerAccess = (ctx->symtab[i].ptr_level > 0 && !ctx->symtab[i].is_array);
             break;
         }
     }
@@ -3617,10 +5458,11 @@ void translateArrayAddr(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex
         emitMIPS(codegen, instr);
         
         updateDescriptors(codegen, resultReg, resultVar);
-        codegen->regDescriptors[resultReg].isDirty = true;
+        storeResult(codegen, resultVar, resultReg);
     } else {
         // arr[i] - compute address from $fp offset
         char arrayLocation[128];
+        writeBackVariable(codegen, arrayName);
         getMemoryLocation(codegen, arrayName, arrayLocation);
         
         int baseOffset = 0;
@@ -3640,7 +5482,7 @@ void translateArrayAddr(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex
             emitMIPS(codegen, instr);
             
             updateDescriptors(codegen, resultReg, resultVar);
-            codegen->regDescriptors[resultReg].isDirty = true;
+            storeResult(codegen, resultVar, resultReg);
         } else {
             // Variable index - must compute at runtime
             int indexReg = getReg(codegen, indexVar, irIndex);
@@ -3667,7 +5509,7 @@ void translateArrayAddr(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex
             emitMIPS(codegen, instr);
             
             updateDescriptors(codegen, resultReg, resultVar);
-            codegen->regDescriptors[resultReg].isDirty = true;
+            storeResult(codegen, resultVar, resultReg);
         }
     }
 }
@@ -3695,12 +5537,8 @@ void translateDeref(MIPSCodeGenerator* codegen, Quadruple* quad, int irIndex) {
     updateDescriptors(codegen, resultReg, resultVar);
     codegen->regDescriptors[resultReg].isDirty = true;
     
-    // Store result to memory for reloadability
-    storeVariable(codegen, resultVar, resultReg);
-    int addrIdx = findOrCreateAddrDesc(codegen, resultVar);
-    if (addrIdx >= 0) {
-        codegen->addrDescriptors[addrIdx].inMemory = true;
-    }
+    // Store result
+    storeResult(codegen, resultVar, resultReg);
 }
 
 /**
@@ -3787,12 +5625,8 @@ void translateLoadOffset(MIPSCodeGenerator* codegen, Quadruple* quad, int irInde
     updateDescriptors(codegen, resultReg, resultVar);
     codegen->regDescriptors[resultReg].isDirty = false;
     
-    // Store result to memory for reloadability
-    storeVariable(codegen, resultVar, resultReg);
-    int addrIdx = findOrCreateAddrDesc(codegen, resultVar);
-    if (addrIdx >= 0) {
-        codegen->addrDescriptors[addrIdx].inMemory = true;
-    }
+    // Store result
+    storeResult(codegen, resultVar, resultReg);
 }
 
 /**
@@ -3888,8 +5722,6 @@ void generateSyscall(MIPSCodeGenerator* codegen, int syscall_num, int reg) {
  * Generate .data section (static allocation - Lecture 32)
  */
 void generateDataSection(MIPSCodeGenerator* codegen) {
-    extern StaticVarInfo staticVars[];
-    extern int staticVarCount;
     
     emitMIPS(codegen, ".data");
     emitMIPS(codegen, "");
@@ -3898,20 +5730,23 @@ void generateDataSection(MIPSCodeGenerator* codegen) {
     // We'll use staticVars as the source of truth for initial values
     
     // First, emit all variables from staticVars array (these have correct init values)
-    for (int i = 0; i < staticVarCount; i++) {
+    for (int i = 0; i < ctx->staticVarCount; i++) {
         char directive[256];
-        sprintf(directive, "%s: .word %s", staticVars[i].name, staticVars[i].init_value);
+        const Symbol* sym = findFunctionSymbol("", ctx->staticVars[i].name);
+        bool isDouble = sym != NULL && sym->scope_level == 0 && isDoubleSymbol(sym);
+        sprintf(directive, "%s: %s %s", ctx->staticVars[i].name, isDouble ? ".double" : ".word",
+                ctx->staticVars[i].init_value);
         emitMIPS(codegen, directive);
     }
     
     // Second, check for global variables in symbol table that might not be in staticVars
     // (e.g., uninitialized globals or arrays)
-    for (int i = 0; i < symCount; i++) {
-        if (symtab[i].scope_level == 0 && !symtab[i].is_function) {
+    for (int i = 0; i < ctx->symCount; i++) {
+        if (ctx->symtab[i].scope_level == 0 && !ctx->symtab[i].is_function) {
             // Check if already added from staticVars
             bool alreadyAdded = false;
-            for (int j = 0; j < staticVarCount; j++) {
-                if (strcmp(staticVars[j].name, symtab[i].name) == 0) {
+            for (int j = 0; j < ctx->staticVarCount; j++) {
+                if (strcmp(ctx->staticVars[j].name, ctx->symtab[i].name) == 0) {
                     alreadyAdded = true;
                     break;
                 }
@@ -3919,13 +5754,15 @@ void generateDataSection(MIPSCodeGenerator* codegen) {
             
             if (!alreadyAdded) {
                 char directive[256];
-                if (symtab[i].is_array) {
+                if (ctx->symtab[i].is_array) {
                     // Array allocation
-                    int totalSize = symtab[i].size;
-                    sprintf(directive, "%s: .space %d    # Array", symtab[i].name, totalSize);
+                    int totalSize = ctx->symtab[i].size;
+                    sprintf(directive, "%s: .space %d    # Array", ctx->symtab[i].name, totalSize);
+                } else if (isDoubleSymbol(&ctx->symtab[i])) {
+                    sprintf(directive, "%s: .double 0", ctx->symtab[i].name);
                 } else {
                     // Simple variable with no initializer
-                    sprintf(directive, "%s: .word 0", symtab[i].name);
+                    sprintf(directive, "%s: .word 0", ctx->symtab[i].name);
                 }
                 emitMIPS(codegen, directive);
             }
@@ -3967,6 +5804,33 @@ void generateDataSection(MIPSCodeGenerator* codegen) {
         emitMIPS(codegen, directive);
     }
     
+    // Float literals converted to double keep their full precision
+    codegen->doubleConstCount = 0;
+    for (int i = 0; i < codegen->irCount; i++) {
+        const Quadruple* quad = &codegen->IR[i];
+        if (strstr(quad->op, "_to_double") == NULL && strcmp(quad->op, "FLOAT_TO_DOUBLE") != 0 &&
+            strcmp(quad->resultType, "double") != 0) {
+            continue;
+        }
+        const char* args[] = {quad->arg1, quad->arg2};
+        for (int a = 0; a < 2; a++) {
+            if (isFloatConstant(args[a]) && findDoubleConstant(codegen, args[a]) < 0 && codegen->doubleConstCount < 100) {
+                strcpy(codegen->doubleConstants[codegen->doubleConstCount++], args[a]);
+            }
+        }
+    }
+    for (int i = 0; i < codegen->doubleConstCount; i++) {
+        char directive[256];
+        char cleanValue[64];
+        strcpy(cleanValue, codegen->doubleConstants[i]);
+        int len = strlen(cleanValue);
+        if (len > 0 && (cleanValue[len-1] == 'f' || cleanValue[len-1] == 'F')) {
+            cleanValue[len-1] = '\0';
+        }
+        sprintf(directive, "_double%d: .double %s", i, cleanValue);
+        emitMIPS(codegen, directive);
+    }
+    
     // 3. String literals (scan IR for PARAM and ASSIGN instructions with strings)
     codegen->stringCount = 0;
     for (int i = 0; i < codegen->irCount; i++) {
@@ -4018,6 +5882,48 @@ void generateDataSection(MIPSCodeGenerator* codegen) {
         }
     }
     
+    // 4. printf literal segments, shared by every inline call that prints
+    // them (calls to the shared _printf use the format string itself)
+    planSharedIO(codegen);
+    codegen->printfSegmentCount = 0;
+    for (int i = 0; i < codegen->irCount; i++) {
+        if ((strcmp(codegen->IR[i].op, "CALL") != 0 && strcmp(codegen->IR[i].op, "call") != 0) ||
+            strcmp(codegen->IR[i].arg1, "printf") != 0 || useSharedIOCall(codegen, i)) {
+            continue;
+        }
+        char formatStr[512];
+        if (!findPrintfFormat(codegen, i, formatStr, sizeof(formatStr))) {
+            continue;
+        }
+        std::vector<PrintfPiece> pieces;
+        parsePrintfFormat(formatStr, pieces);
+        for (size_t p = 0; p < pieces.size(); p++) {
+            // Single characters are cheaper as print_char
+            if (pieces[p].textLen < 2 || findPrintfSegment(codegen, pieces[p].text) >= 0 ||
+                codegen->printfSegmentCount >= MAX_PRINTF_SEGMENTS) {
+                continue;
+            }
+            strcpy(codegen->printfSegments[codegen->printfSegmentCount], pieces[p].text);
+            
+            char directive[600];
+            int len = sprintf(directive, "_fmt%d: .asciiz \"", codegen->printfSegmentCount);
+            for (const char* c = pieces[p].text; *c; c++) {
+                if (*c == '\n') {
+                    len += sprintf(directive + len, "\\n");
+                } else if (*c == '\t') {
+                    len += sprintf(directive + len, "\\t");
+                } else if (*c == '"' || *c == '\\') {
+                    len += sprintf(directive + len, "\\%c", *c);
+                } else {
+                    directive[len++] = *c;
+                }
+            }
+            sprintf(directive + len, "\"");
+            emitMIPS(codegen, directive);
+            codegen->printfSegmentCount++;
+        }
+    }
+    
     // Add newline string for printf
     char newline[128];
     sprintf(newline, "_newline: .asciiz \"\\n\"");
@@ -4030,6 +5936,51 @@ void generateDataSection(MIPSCodeGenerator* codegen) {
 // Task 2.6: Function Prologue/Epilogue
 // ============================================================================
 
+/**
+ * Whether parameter p of funcName can stay in a register instead of being
+ * stored to its stack slot on entry: one of the first four, of integer or
+ * pointer type, with its address never taken in the body. Like any other
+ * dirty variable it is stored when a call or block boundary needs it
+ */
+static bool keepsParameterInRegister(const char* funcName, int p) {
+    if (p >= 4) {
+        return false;
+    }
+    
+    const Symbol* func = NULL;
+    for (int i = 0; i < ctx->symCount && func == NULL; i++) {
+        if (strcmp(ctx->symtab[i].name, funcName) == 0 && ctx->symtab[i].is_function) {
+            func = &ctx->symtab[i];
+        }
+    }
+    if (func == NULL || p >= func->param_count) {
+        return false;
+    }
+    const char* type = func->param_types[p];
+    const char* name = func->param_names[p];
+    if (strchr(type, '[') != NULL || strstr(type, "struct") != NULL || strstr(type, "union") != NULL ||
+        ((strstr(type, "float") != NULL || strstr(type, "double") != NULL) && strchr(type, '*') == NULL)) {
+        return false;
+    }
+    
+    int funcStart = findFunctionInIR(funcName);
+    if (funcStart < 0) {
+        return false;
+    }
+    int funcEnd = findFunctionEnd(funcStart);
+    for (int i = funcStart + 1; i < funcEnd; i++) {
+        const Quadruple* quad = &ctx->IR[i];
+        if ((strcmp(quad->op, "ADDR") == 0 || strcmp(quad->op, "&") == 0) && strcmp(quad->arg1, name) == 0) {
+            return false;
+        }
+        if ((quad->arg1[0] == '&' && strcmp(quad->arg1 + 1, name) == 0) ||
+            (quad->arg2[0] == '&' && strcmp(quad->arg2 + 1, name) == 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 /**
  * Generate function prologue (stack frame setup)
  */
@@ -4060,22 +6011,47 @@ void generatePrologue(MIPSCodeGenerator* codegen, const char* funcName) {
     sprintf(instr, "    addiu $fp, $sp, %d", record->frameSize - 4);
     emitMIPS(codegen, instr);
     
+    // The callee-saved registers the body uses are saved here
+    if (codegen->outputBuffer) {
+        codegen->saveInsertPoint = codegen->outputBuffer->length;
+    }
+    
     // CRITICAL FIX: Save parameters from $a0-$a3 to their stack locations
     // This ensures parameters can be restored after function calls (especially recursive)
+    // Parameters kept in registers are saved only when they have to be
     char params[16][128];
     int paramCount = 0;
     getParameterNames(funcName, params, &paramCount);
     
-    for (int p = 0; p < paramCount && p < 4; p++) {
+    // A double arrives in two argument slots
+    int slot = 0;
+    for (int p = 0; p < paramCount && slot < 4; p++) {
+        if (keepsParameterInRegister(funcName, p)) {
+            int reg = REG_T0 + p;
+            sprintf(instr, "    move %s, $a%d    # Parameter %s", getRegisterName(reg), slot++, params[p]);
+            emitMIPS(codegen, instr);
+            updateDescriptors(codegen, reg, params[p]);
+            int addrIdx = findAddressDescriptor(codegen, params[p]);
+            if (addrIdx >= 0) {
+                codegen->addrDescriptors[addrIdx].inMemory = false;
+            }
+            continue;
+        }
+        
         // Find parameter's stack offset
+        int words = 1;
         for (int v = 0; v < record->varCount; v++) {
             if (strcmp(record->variables[v].varName, params[p]) == 0) {
-                sprintf(instr, "    sw $a%d, %d($fp)    # Save parameter %s", 
-                       p, record->variables[v].offset, params[p]);
-                emitMIPS(codegen, instr);
+                words = record->variables[v].isDouble ? 2 : 1;
+                for (int w = 0; w < words && slot + w < 4; w++) {
+                    sprintf(instr, "    sw $a%d, %d($fp)    # Save parameter %s", 
+                           slot + w, record->variables[v].offset + 4 * w, params[p]);
+                    emitMIPS(codegen, instr);
+                }
                 break;
             }
         }
+        slot += words;
     }
     
     emitMIPS(codegen, "");
@@ -4093,6 +6069,9 @@ void generateEpilogue(MIPSCodeGenerator* codegen, const char* funcName) {
     emitMIPS(codegen, "");
     emitMIPS(codegen, "    # Function epilogue");
     
+    // Callee-saved registers are restored here
+    markRestorePoint(codegen);
+    
     // Restore $ra
     sprintf(instr, "    lw $ra, %d($sp)", record->frameSize - 4);
     emitMIPS(codegen, instr);
@@ -4136,8 +6115,39 @@ void translateInstruction(MIPSCodeGenerator* codegen, int irIndex) {
         return;
     }
     
+    // Calls clobber the caller-saved $t and $f registers (the runtime library
+    // uses them too) and a store through a pointer makes every register
+    // suspect: live values only held in registers go to memory first, or
+    // to $s registers when a later instruction still needs them
+    bool isCall = (strcmp(quad->op, "CALL") == 0 || strcmp(quad->op, "call") == 0 ||
+                   strcmp(quad->op, "INDIRECT_CALL") == 0);
+    if (isCallInstruction(quad)) {
+        preserveAcrossCall(codegen, irIndex);
+    }
+    if (isCall || strcmp(quad->op, "ASSIGN_DEREF") == 0) {
+        writeBackRegisters(codegen, isCallInstruction(quad));
+    }
+    if (isCall) {
+        writeBackFloatRegisters(codegen);
+        clearFloatRegisters(codegen);
+    }
+    
+    // Float and double operations leave their result in an FP register;
+    // after any other instruction writing quad->result, a copy there is stale
+    bool doubleOperation = isDoubleOperation(codegen, quad);
+    bool definesFloatResult = doubleOperation || strstr(quad->op, "int_to_float") != NULL ||
+                              strcmp(quad->op, "INT_TO_FLOAT") == 0 ||
+                              isFloatArithmetic(codegen, quad);
+    bool storesThroughPointer = (strcmp(quad->op, "ASSIGN_ARRAY") == 0 || strcmp(quad->op, "ASSIGN_DEREF") == 0 ||
+                                 strcmp(quad->op, "STORE_OFFSET") == 0 || strcmp(quad->op, "STORE") == 0);
+    bool writesResult = !definesFloatResult && !isCall && writesResultOperand(quad);
+    
+    // Anything reading or writing a double, on FP register pairs
+    if (doubleOperation) {
+        translateDouble(codegen, quad, irIndex);
+    }
     // Arithmetic operations
-    if (strcmp(quad->op, "ADD") == 0 || strcmp(quad->op, "SUB") == 0 ||
+    else if (strcmp(quad->op, "ADD") == 0 || strcmp(quad->op, "SUB") == 0 ||
         strcmp(quad->op, "MUL") == 0 || strcmp(quad->op, "DIV") == 0 ||
         strcmp(quad->op, "MOD") == 0 ||
         strcmp(quad->op, "+") == 0 || strcmp(quad->op, "-") == 0 ||
@@ -4178,7 +6188,10 @@ void translateInstruction(MIPSCodeGenerator* codegen, int irIndex) {
              strcmp(quad->op, "IF_FALSE_GOTO") == 0 ||
              strcmp(quad->op, "IF_TRUE_GOTO_FLOAT") == 0 ||
              strcmp(quad->op, "IF_FALSE_GOTO_FLOAT") == 0) {
-        translateConditionalBranch(codegen, quad, irIndex);
+        // Already emitted with the comparison before it
+        if (!fusesWithNextBranch(codegen, irIndex - 1)) {
+            translateConditionalBranch(codegen, quad, irIndex);
+        }
     }
     // Unconditional jump
     else if (strcmp(quad->op, "GOTO") == 0 || strcmp(quad->op, "goto") == 0) {
@@ -4211,20 +6224,19 @@ void translateInstruction(MIPSCodeGenerator* codegen, int irIndex) {
         emitMIPS(codegen, instr);
 
         // If the indirect call has a result (quad->result non-empty), move $v0 into result
+        int resultReg = -1;
         if (quad->result && quad->result[0] != '\0') {
-            int resultReg = getReg(codegen, quad->result, irIndex);
+            resultReg = getReg(codegen, quad->result, irIndex);
             sprintf(instr, "    move %s, $v0    # move return value", getRegisterName(resultReg));
             emitMIPS(codegen, instr);
 
-            // Store and update descriptors
-            storeVariable(codegen, quad->result, resultReg);
+            // Update descriptors and store
             updateDescriptors(codegen, resultReg, quad->result);
             codegen->regDescriptors[resultReg].isDirty = false;
-            int addrIdx = findOrCreateAddrDesc(codegen, quad->result);
-            if (addrIdx >= 0) {
-                codegen->addrDescriptors[addrIdx].inMemory = true;
-            }
+            storeResult(codegen, quad->result, resultReg);
         }
+        forgetCallerSavedRegisters(codegen, resultReg);
+        codegen->currentParamCount = 0;
     }
     // RETURN (Phase 3 - improved version)
     else if (strcmp(quad->op, "RETURN") == 0 || strcmp(quad->op, "return") == 0) {
@@ -4277,14 +6289,9 @@ void translateInstruction(MIPSCodeGenerator* codegen, int irIndex) {
                 quad->result, ptrVar);
         emitMIPS(codegen, instr);
         
-        // Store and update descriptors
-        storeVariable(codegen, quad->result, regResult);
+        // Update descriptors and store
         updateDescriptors(codegen, regResult, quad->result);
-        int addrIdx = findOrCreateAddrDesc(codegen, quad->result);
-        if (addrIdx >= 0) {
-            codegen->addrDescriptors[addrIdx].inMemory = true;
-            codegen->addrDescriptors[addrIdx].inRegister = regResult;
-        }
+        storeResult(codegen, quad->result, regResult);
     }
     // DEREF - dereference operator (Phase 3)
     else if (strcmp(quad->op, "DEREF") == 0 || strcmp(quad->op, "*") == 0) {
@@ -4340,36 +6347,22 @@ void translateInstruction(MIPSCodeGenerator* codegen, int irIndex) {
             // Load integer value
             int regSrc = getReg(codegen, quad->arg1, irIndex);
             
-            // Convert: move to FPU, convert, move back
-            sprintf(instr, "    mtc1 %s, $f0    # Move int to FPU", getRegisterName(regSrc));
-            emitMIPS(codegen, instr);
-            sprintf(instr, "    cvt.s.w $f0, $f0    # Convert int to float");
+            // Convert in the FP register that keeps the result
+            int fregDest = getFloatResultReg(codegen, quad->result, irIndex, -1, -1);
+            sprintf(instr, "    mtc1 %s, $f%d    # Move int to FPU", getRegisterName(regSrc), fregDest);
             emitMIPS(codegen, instr);
-            
-            // Get result register
-            int regDest = getReg(codegen, quad->result, irIndex);
-            sprintf(instr, "    mfc1 %s, $f0    # Move float result back", getRegisterName(regDest));
+            sprintf(instr, "    cvt.s.w $f%d, $f%d    # Convert int to float", fregDest, fregDest);
             emitMIPS(codegen, instr);
             
-            // Store and update
-            storeVariable(codegen, quad->result, regDest);
-            updateDescriptors(codegen, regDest, quad->result);
-            codegen->regDescriptors[regDest].isDirty = false;
-            int addrIdx = findOrCreateAddrDesc(codegen, quad->result);
-            if (addrIdx >= 0) {
-                codegen->addrDescriptors[addrIdx].inMemory = true;
-            }
-            registerVariableType(codegen, quad->result, "float");
+            setFloatResult(codegen, quad->result, fregDest);
         }
         // Handle float to int conversion
         else if (strstr(quad->op, "float_to_int") != NULL || strcmp(quad->op, "FLOAT_TO_INT") == 0) {
             // Load float value
-            int regSrc = getReg(codegen, quad->arg1, irIndex);
+            int fregSrc = getFloatReg(codegen, quad->arg1, irIndex, -1, -1);
             
-            // Convert: move to FPU, convert with truncation, move back
-            sprintf(instr, "    mtc1 %s, $f0    # Move float to FPU", getRegisterName(regSrc));
-            emitMIPS(codegen, instr);
-            sprintf(instr, "    cvt.w.s $f0, $f0    # Convert float to int (truncate)");
+            // Convert with truncation, move back
+            sprintf(instr, "    cvt.w.s $f0, $f%d    # Convert float to int (truncate)", fregSrc);
             emitMIPS(codegen, instr);
             
             // Get result register
@@ -4377,14 +6370,10 @@ void translateInstruction(MIPSCodeGenerator* codegen, int irIndex) {
             sprintf(instr, "    mfc1 %s, $f0    # Move int result back", getRegisterName(regDest));
             emitMIPS(codegen, instr);
             
-            // Store and update
-            storeVariable(codegen, quad->result, regDest);
+            // Update and store
             updateDescriptors(codegen, regDest, quad->result);
             codegen->regDescriptors[regDest].isDirty = false;
-            int addrIdx2 = findOrCreateAddrDesc(codegen, quad->result);
-            if (addrIdx2 >= 0) {
-                codegen->addrDescriptors[addrIdx2].inMemory = true;
-            }
+            storeResult(codegen, quad->result, regDest);
             registerVariableType(codegen, quad->result, "int");
         }
         // Handle int to bool conversion
@@ -4397,19 +6386,80 @@ void translateInstruction(MIPSCodeGenerator* codegen, int irIndex) {
                    getRegisterName(regDest), getRegisterName(regSrc));
             emitMIPS(codegen, instr);
             
-            storeVariable(codegen, quad->result, regDest);
             updateDescriptors(codegen, regDest, quad->result);
             codegen->regDescriptors[regDest].isDirty = false;
-            int addrIdx3 = findOrCreateAddrDesc(codegen, quad->result);
-            if (addrIdx3 >= 0) {
-                codegen->addrDescriptors[addrIdx3].inMemory = true;
-            }
+            storeResult(codegen, quad->result, regDest);
         }
         // For other casts (char/int, float/double, etc.), just do a simple move
         else {
             translateAssignment(codegen, quad, irIndex);
         }
     }
+    
+    if (storesThroughPointer) {
+        forgetFloatVariables(codegen);
+    } else if (writesResult && quad->result[0] != '\0') {
+        forgetFloatCopy(codegen, quad->result);
+    }
+}
+
+/**
+ * Set the number of worker threads used to translate functions
+ */
+void setCodegenThreadCount(int threads) {
+    ctx->codegenThreads = (threads < 1) ? 1 : threads;
+}
+
+/**
+ * Prepare a per-function code generation context.
+ * IR, basic blocks, next-use info and activation records are shared read-only;
+ * descriptors, call state and the output buffer belong to the function alone.
+ * Constant/type tables are copied so lookups see what the data section saw.
+ */
+void initFunctionContext(MIPSCodeGenerator* funcCtx, const MIPSCodeGenerator* shared, MIPSOutputBuffer* buffer) {
+    funcCtx->IR = shared->IR;
+    funcCtx->irCount = shared->irCount;
+    funcCtx->blocks = shared->blocks;
+    funcCtx->blockCount = shared->blockCount;
+    funcCtx->nextUseInfo = shared->nextUseInfo;
+    funcCtx->activationRecords = shared->activationRecords;
+    funcCtx->funcCount = shared->funcCount;
+    funcCtx->currentFunction = NULL;
+    
+    funcCtx->outputFile = NULL;
+    funcCtx->outputBuffer = buffer;
+    funcCtx->currentBlock = 0;
+    funcCtx->inFunction = false;
+    funcCtx->currentIndex = 0;
+    funcCtx->tempLiveness = NULL;
+    funcCtx->tempLivenessCount = 0;
+    funcCtx->currentFuncName[0] = '\0';
+    
+    initDescriptors(funcCtx);
+    
+    funcCtx->currentParamCount = 0;
+    for (int i = 0; i < 10; i++) {
+        funcCtx->paramRegisterMap[i] = -1;
+        funcCtx->printfDoubles[i][0] = '\0';
+    }
+    funcCtx->preservedRegCount = 0;
+    funcCtx->saveInsertPoint = 0;
+    funcCtx->restoreInsertPoints = NULL;
+    funcCtx->restoreInsertCount = 0;
+    funcCtx->restoreInsertCapacity = 0;
+    
+    funcCtx->stringCount = shared->stringCount;
+    memcpy(funcCtx->stringLiterals, shared->stringLiterals, sizeof(funcCtx->stringLiterals[0]) * shared->stringCount);
+    funcCtx->sharedIORoutines = shared->sharedIORoutines;
+    funcCtx->printfSegmentCount = shared->printfSegmentCount;
+    memcpy(funcCtx->printfSegments, shared->printfSegments, sizeof(funcCtx->printfSegments[0]) * shared->printfSegmentCount);
+    funcCtx->floatConstCount = shared->floatConstCount;
+    memcpy(funcCtx->floatConstants, shared->floatConstants, sizeof(funcCtx->floatConstants[0]) * shared->floatConstCount);
+    funcCtx->doubleConstCount = shared->doubleConstCount;
+    memcpy(funcCtx->doubleConstants, shared->doubleConstants, sizeof(funcCtx->doubleConstants[0]) * shared->doubleConstCount);
+    funcCtx->doubleCompareCount = 0;
+    funcCtx->varTypeCount = shared->varTypeCount;
+    memcpy(funcCtx->varTypes, shared->varTypes, sizeof(funcCtx->varTypes[0]) * shared->varTypeCount);
 }
 
 /**
@@ -4437,11 +6487,15 @@ void generateFunction(MIPSCodeGenerator* codegen, int funcStart, int funcEnd) {
     }
     emitMIPS(codegen, label);
     
+    // Initialize descriptors for this function (the prologue may bind parameters)
+    initDescriptors(codegen);
+    
     // Prologue
     generatePrologue(codegen, funcName);
     
-    // Initialize descriptors for this function
-    initDescriptors(codegen);
+    computeTempLiveness(codegen, funcStart, funcEnd);
+    codegen->preservedRegCount = countPreservedRegisters(codegen->IR, funcStart, funcEnd);
+    codegen->restoreInsertCount = 0;
     
     // Track if previous instruction was a return (to avoid generating unreachable code)
     bool prevWasReturn = false;
@@ -4449,6 +6503,7 @@ void generateFunction(MIPSCodeGenerator* codegen, int funcStart, int funcEnd) {
     // Translate each instruction
     for (int i = funcStart + 1; i < funcEnd; i++) {
         Quadruple* quad = &codegen->IR[i];
+        codegen->currentIndex = i;
         
         // Check if this is a label following a return
         bool isLabel = (strcmp(quad->op, "LABEL") == 0 || 
@@ -4469,38 +6524,547 @@ void generateFunction(MIPSCodeGenerator* codegen, int funcStart, int funcEnd) {
     // NOTE: Epilogue is generated by RETURN instruction, not here
     // generateEpilogue(codegen, funcName);
     emitMIPS(codegen, "");
+    insertSavedRegisters(codegen);
+    
+    free(codegen->tempLiveness);
+    codegen->tempLiveness = NULL;
+    codegen->tempLivenessCount = 0;
+    free(codegen->restoreInsertPoints);
+    codegen->restoreInsertPoints = NULL;
+    codegen->restoreInsertCapacity = 0;
+}
+
+void setIORuntimeMode(IORuntimeMode mode) {
+    ctx->ioRuntimeMode = mode;
+}
+
+void setMIPSTarget(MIPSTarget target) {
+    ctx->mipsTarget = target;
+}
+
+void setInstructionScheduling(const MIPSPipelineModel* model) {
+    ctx->scheduleInstructions = model != NULL;
+    if (model) ctx->pipelineModel = *model;
+}
+
+static bool hashCompilerBinary(void);
+
+void setCodegenCacheDir(const char* dir) {
+    ctx->codegenCacheDir[0] = '\0';
+    if (!dir || dir[0] == '\0') {
+        return;
+    }
+    if (strlen(dir) >= sizeof(ctx->codegenCacheDir)) {
+        fprintf(stderr, "Warning: Cache directory path too long; caching disabled\n");
+    } else if (mkdir(dir, 0777) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Warning: Cannot create cache directory %s; caching disabled\n", dir);
+    } else if (!hashCompilerBinary()) {
+        fprintf(stderr, "Warning: Cannot read the compiler binary to identify its build; caching disabled\n");
+    } else {
+        strcpy(ctx->codegenCacheDir, dir);
+    }
+}
+
+// ============================================================================
+// Per-function assembly cache
+// ============================================================================
+
+// Two independent 64-bit hashes; the cache key is their concatenation
+struct CodegenHasher {
+    uint64_t fnv;
+    uint64_t mix;
+
+    CodegenHasher() : fnv(14695981039346656037ULL), mix(0x9E3779B97F4A7C15ULL) {}
+
+    void add(const void* data, size_t length) {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (size_t i = 0; i < length; i++) {
+            fnv = (fnv ^ bytes[i]) * 1099511628211ULL;
+            mix = (mix ^ bytes[i]) * 0xFF51AFD7ED558CCDULL;
+            mix ^= mix >> 29;
+        }
+    }
+    void addString(const char* text) { add(text, strlen(text) + 1); }
+    void addInt(int value) { add(&value, sizeof(value)); }
+};
+
+// Hash of the running compiler binary: a rebuild of any of its objects
+// (codegen, lowering, runtime routines, ...) starts a fresh cache.
+// Computed once per process, on the first unit that enables the cache
+static uint64_t compilerBuildHash[2] = { 0, 0 };
+static bool compilerBuildHashed = false;
+static std::once_flag compilerBuildHashOnce;
+
+static void readCompilerBinary(void) {
+    FILE* file = fopen("/proc/self/exe", "rb");
+    if (!file) return;
+    CodegenHasher h;
+    char chunk[65536];
+    size_t length;
+    while ((length = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        h.add(chunk, length);
+    }
+    compilerBuildHashed = !ferror(file);
+    fclose(file);
+    compilerBuildHash[0] = h.fnv;
+    compilerBuildHash[1] = h.mix;
+}
+
+static bool hashCompilerBinary(void) {
+    std::call_once(compilerBuildHashOnce, readCompilerBinary);
+    return compilerBuildHashed;
+}
+
+/**
+ * Names in a function's assembly that are numbered across the whole unit:
+ * IR temporaries (tN) and labels (LN), and the .data labels of the string
+ * literals (_strN), printf segments (_fmtN) and float constants (_floatN)
+ * it uses. Keys and cache entries use placeholders instead (@t0, @L0, @s0,
+ * @p0, @f0), numbered in order of first use inside the function, so edits
+ * elsewhere in the unit leave them unchanged
+ */
+struct CacheRelocations {
+    std::map<std::string, std::string> toPlaceholder;
+    std::map<std::string, std::string> fromPlaceholder;
+    std::map<char, int> counts;
+};
+
+static const std::string& relocate(CacheRelocations& relocs, const std::string& name, char kind) {
+    std::map<std::string, std::string>::iterator it = relocs.toPlaceholder.find(name);
+    if (it != relocs.toPlaceholder.end()) {
+        return it->second;
+    }
+    char placeholder[32];
+    snprintf(placeholder, sizeof(placeholder), "@%c%d", kind, relocs.counts[kind]++);
+    relocs.fromPlaceholder[placeholder] = name;
+    return relocs.toPlaceholder[name] = placeholder;
+}
+
+static bool isIdentifierChar(char c) {
+    return isalnum((unsigned char)c) || c == '_' || c == '@';
+}
+
+// Name made of `prefix` and digits only, like the tN and LN of the IR
+static bool isNumberedName(const std::string& name, char prefix) {
+    if (name.size() < 2 || name[0] != prefix) return false;
+    for (size_t i = 1; i < name.size(); i++) {
+        if (!isdigit((unsigned char)name[i])) return false;
+    }
+    return true;
+}
+
+/**
+ * Copy `text` replacing every identifier that has an entry in `names`;
+ * identifiers right after '$' are registers and are kept. Returns false
+ * if a placeholder (an identifier starting with '@') has no entry
+ */
+static bool rewriteNames(const char* text, size_t length, const std::map<std::string, std::string>& names,
+                         std::string& out) {
+    out.clear();
+    out.reserve(length);
+    size_t i = 0;
+    while (i < length) {
+        if (!isIdentifierChar(text[i]) || isdigit((unsigned char)text[i])) {
+            out += text[i++];
+            continue;
+        }
+        size_t start = i;
+        while (i < length && isIdentifierChar(text[i])) i++;
+        std::string token(text + start, i - start);
+        std::map<std::string, std::string>::const_iterator it = names.find(token);
+        if (start > 0 && text[start - 1] == '$') {
+            out += token;
+        } else if (it != names.end()) {
+            out += it->second;
+        } else if (token[0] == '@') {
+            return false;
+        } else {
+            out += token;
+        }
+    }
+    return true;
+}
+
+/**
+ * Add one IR operand to the key: temporaries and labels become their
+ * placeholders, the pooled .data entries it refers to get one (whether a
+ * pool holds the entry is hashed too, since the code differs when it does
+ * not), and the other identifiers are collected in `referenced`
+ */
+static void hashOperand(CodegenHasher& h, const MIPSCodeGenerator* codegen, const char* operand,
+                        CacheRelocations& relocs, std::set<std::string>& referenced) {
+    if (operand[0] == '"') {
+        h.addString(operand);
+        int literal = -1;
+        for (int j = 0; j < codegen->stringCount && literal < 0; j++) {
+            if (strcmp(codegen->stringLiterals[j], operand) == 0) literal = j;
+        }
+        h.addInt(literal >= 0);
+        if (literal >= 0) {
+            relocate(relocs, "_str" + std::to_string(literal), 's');
+        }
+        // Literals that are printf formats print their text from the _fmt pool
+        std::vector<PrintfPiece> pieces;
+        parsePrintfFormat(operand, pieces);
+        for (size_t p = 0; p < pieces.size(); p++) {
+            if (pieces[p].textLen < 2) continue;
+            int segment = findPrintfSegment(codegen, pieces[p].text);
+            h.addInt(segment >= 0);
+            if (segment >= 0) {
+                relocate(relocs, "_fmt" + std::to_string(segment), 'p');
+            }
+        }
+        return;
+    }
+    
+    for (int j = 0; j < codegen->floatConstCount; j++) {
+        if (strcmp(codegen->floatConstants[j], operand) == 0) {
+            h.addInt(1);
+            relocate(relocs, "_float" + std::to_string(j), 'f');
+            break;
+        }
+    }
+    for (int j = 0; j < codegen->doubleConstCount; j++) {
+        if (strcmp(codegen->doubleConstants[j], operand) == 0) {
+            h.addInt(2);
+            relocate(relocs, "_double" + std::to_string(j), 'd');
+            break;
+        }
+    }
+    
+    std::string canonical;
+    for (size_t i = 0; operand[i] != '\0';) {
+        if (!isIdentifierChar(operand[i]) || isdigit((unsigned char)operand[i])) {
+            canonical += operand[i++];
+            continue;
+        }
+        size_t start = i;
+        while (operand[i] != '\0' && isIdentifierChar(operand[i])) i++;
+        std::string token(operand + start, i - start);
+        referenced.insert(token);
+        if (isNumberedName(token, 't')) {
+            canonical += relocate(relocs, token, 't');
+        } else if (isNumberedName(token, 'L')) {
+            canonical += relocate(relocs, token, 'L');
+        } else {
+            canonical += token;
+        }
+    }
+    h.addString(canonical.c_str());
+}
+
+static void hashSymbol(CodegenHasher& h, const Symbol* sym) {
+    h.addString(sym->name);
+    h.addString(sym->type);
+    h.addString(sym->kind);
+    h.addInt(sym->scope_level);
+    // Lookups from the global scope only test the block of global entries
+    h.addInt(sym->scope_level == 0 ? sym->block_id : 0);
+    h.addInt(sym->size);
+    h.addInt(sym->is_array);
+    h.addInt(sym->num_dims);
+    for (int d = 0; d < sym->num_dims && d < 10; d++) h.addInt(sym->array_dims[d]);
+    h.addInt(sym->ptr_level);
+    h.addInt(sym->is_function);
+    h.addString(sym->return_type);
+    h.addInt(sym->param_count);
+    for (int p = 0; p < sym->param_count && p < 16; p++) {
+        h.addString(sym->param_types[p]);
+        h.addString(sym->param_names[p]);
+    }
+    h.addString(sym->function_scope);
+    h.addInt(sym->is_external);
+    h.addInt(sym->is_static);
+    h.addInt(sym->is_const);
+    h.addInt(sym->is_const_ptr);
+    h.addInt(sym->points_to_const);
+    h.addInt(sym->is_reference);
+}
+
+/**
+ * Cache key of a function: everything its translation reads, in
+ * function-relative form. Translation only looks at the function's own
+ * quadruples, and codegen finds symbols by name (first match, or the
+ * function's own scope), so the symbols that count are those of the
+ * function's scope and every entry with a name the function mentions.
+ * Fills `relocs` with the function's placeholders.
+ */
+static std::string functionCacheKey(const MIPSCodeGenerator* codegen, int funcStart, int funcEnd,
+                                    CacheRelocations& relocs) {
+    CodegenHasher h;
+    h.addString("mips-function-cache-v2");
+    h.add(compilerBuildHash, sizeof(compilerBuildHash));
+    h.addInt(ctx->ioRuntimeMode);
+    h.addInt(codegen->sharedIORoutines);
+    
+    const char* funcName = codegen->IR[funcStart].arg1;
+    std::set<std::string> referenced;
+    h.addInt(funcEnd - funcStart);
+    for (int i = funcStart; i <= funcEnd; i++) {
+        const Quadruple* quad = &codegen->IR[i];
+        h.addString(quad->op);
+        hashOperand(h, codegen, quad->arg1, relocs, referenced);
+        hashOperand(h, codegen, quad->arg2, relocs, referenced);
+        hashOperand(h, codegen, quad->result, relocs, referenced);
+        h.addString(quad->resultType);
+    }
+    
+    for (int i = 0; i < ctx->symCount; i++) {
+        const Symbol* sym = &ctx->symtab[i];
+        if (strcmp(sym->function_scope, funcName) == 0 || referenced.count(sym->name)) {
+            hashSymbol(h, sym);
+        }
+    }
+    for (int i = 0; i < ctx->staticVarCount; i++) {
+        if (referenced.count(ctx->staticVars[i].name)) {
+            h.addString(ctx->staticVars[i].name);
+            h.addString(ctx->staticVars[i].init_value);
+            h.addInt(ctx->staticVars[i].is_initialized);
+        }
+    }
+    for (int i = 0; i < codegen->varTypeCount; i++) {
+        if (referenced.count(codegen->varTypes[i].varName)) {
+            std::map<std::string, std::string>::iterator it = relocs.toPlaceholder.find(codegen->varTypes[i].varName);
+            h.addString(it != relocs.toPlaceholder.end() ? it->second.c_str() : codegen->varTypes[i].varName);
+            h.addString(codegen->varTypes[i].varType);
+        }
+    }
+    
+    const ActivationRecord* record = getActivationRecord(funcName);
+    if (record) {
+        h.addInt(record->frameSize);
+        h.addInt(record->numLocals);
+        h.addInt(record->numParams);
+        h.addInt(record->maxTemps);
+        h.addInt(record->savedRegsSize);
+        h.addInt(record->savedRegsOffset);
+        h.addInt(record->varCount);
+        for (int v = 0; v < record->varCount; v++) {
+            std::map<std::string, std::string>::iterator it = relocs.toPlaceholder.find(record->variables[v].varName);
+            h.addString(it != relocs.toPlaceholder.end() ? it->second.c_str() : record->variables[v].varName);
+            h.addInt(record->variables[v].offset);
+            h.addInt(record->variables[v].size);
+            h.addInt(record->variables[v].isDouble);
+        }
+    }
+
+    char name[40];
+    snprintf(name, sizeof(name), "%016llx%016llx.s", (unsigned long long)h.fnv, (unsigned long long)h.mix);
+    return std::string(ctx->codegenCacheDir) + "/" + name;
+}
+
+/**
+ * Read a cached function, putting the unit's current names back in
+ * place of its placeholders
+ */
+static bool readCachedFunction(const std::string& path, const CacheRelocations& relocs, MIPSOutputBuffer* buffer) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+    struct stat st;
+    std::string text;
+    bool ok = fstat(fileno(file), &st) == 0 && st.st_size > 0;
+    if (ok) {
+        text.resize((size_t)st.st_size);
+        ok = fread(&text[0], 1, text.size(), file) == text.size();
+    }
+    fclose(file);
+    
+    std::string relocated;
+    if (!ok || !rewriteNames(text.data(), text.size(), relocs.fromPlaceholder, relocated)) {
+        return false;
+    }
+    buffer->data = (char*)malloc(relocated.size() + 1);
+    if (!buffer->data) return false;
+    memcpy(buffer->data, relocated.data(), relocated.size());
+    buffer->length = relocated.size();
+    buffer->capacity = buffer->length + 1;
+    buffer->data[buffer->length] = '\0';
+    return true;
+}
+
+// Written with placeholders, through a temporary name so concurrent
+// compilations never see a partial entry
+static void writeCachedFunction(const std::string& path, const CacheRelocations& relocs,
+                                const MIPSOutputBuffer* buffer) {
+    if (!buffer->data || buffer->length == 0) return;
+    std::string text;
+    rewriteNames(buffer->data, buffer->length, relocs.toPlaceholder, text);
+    char suffix[64];
+    snprintf(suffix, sizeof(suffix), ".tmp%ld.%p", (long)getpid(), (const void*)buffer);
+    std::string temp = path + suffix;
+    FILE* file = fopen(temp.c_str(), "wb");
+    if (!file) return;
+    bool ok = fwrite(text.data(), 1, text.size(), file) == text.size();
+    if (fclose(file) != 0 || !ok || rename(temp.c_str(), path.c_str()) != 0) {
+        unlink(temp.c_str());
+    }
 }
 
+static const MIPSOutputBuffer* getSharedIORoutinesAsm(void);
+
 /**
  * Generate .text section
  */
 void generateTextSection(MIPSCodeGenerator* codegen) {
     emitMIPS(codegen, ".text");
     emitMIPS(codegen, ".globl main");
+    if (ctx->mipsTarget == MIPS_TARGET_REAL) {
+        emitMIPS(codegen, ".set noreorder");
+        emitMIPS(codegen, ".set noat");
+    }
     emitMIPS(codegen, "");
     
-    // Process each function in IR
+    // Collect function boundaries in source order
+    std::vector<int> funcStarts;
+    std::vector<int> funcEnds;
     int i = 0;
     while (i < codegen->irCount) {
         if (isFunctionBegin(&codegen->IR[i])) {
-            const char* funcName = codegen->IR[i].arg1;
-            
             // Find function end
             int funcEnd = i + 1;
             while (funcEnd < codegen->irCount && !isFunctionEnd(&codegen->IR[funcEnd])) {
                 funcEnd++;
             }
-            
-            // Generate function
-            generateFunction(codegen, i, funcEnd);
-            
+            funcStarts.push_back(i);
+            funcEnds.push_back(funcEnd);
             i = funcEnd + 1;
         } else {
             i++;
         }
     }
     
-    // Generate C standard library function implementations
+    // Each function is translated in its own context into its own buffer,
+    // so the result does not depend on how many workers ran
+    int numFuncs = (int)funcStarts.size();
+    std::vector<MIPSOutputBuffer> outputs(numFuncs);
+    for (int f = 0; f < numFuncs; f++) {
+        outputs[f].data = NULL;
+        outputs[f].length = 0;
+        outputs[f].capacity = 0;
+    }
+    
+    // Functions whose inputs hash to a cached entry are not translated again
+    std::vector<std::string> cacheKeys;
+    std::vector<CacheRelocations> cacheRelocs;
+    std::vector<int> pending;
+    if (ctx->codegenCacheDir[0] != '\0') {
+        cacheRelocs.resize(numFuncs);
+        for (int f = 0; f < numFuncs; f++) {
+            cacheKeys.push_back(functionCacheKey(codegen, funcStarts[f], funcEnds[f], cacheRelocs[f]));
+            if (!readCachedFunction(cacheKeys[f], cacheRelocs[f], &outputs[f])) {
+                pending.push_back(f);
+            }
+        }
+        printf("Function cache: %d of %d functions reused\n", numFuncs - (int)pending.size(), numFuncs);
+    } else {
+        for (int f = 0; f < numFuncs; f++) {
+            pending.push_back(f);
+        }
+    }
+    int numPending = (int)pending.size();
+    
+    // Workers run against the compilation context of the calling thread
+    CompilerContext* owner = ctx;
+    std::atomic<int> nextFunc(0);
+    auto worker = [&]() {
+        setCompilerContext(owner);
+        MIPSCodeGenerator* funcCtx = (MIPSCodeGenerator*)malloc(sizeof(MIPSCodeGenerator));
+        if (!funcCtx) {
+            fprintf(stderr, "Error: Cannot allocate memory for function code generator\n");
+            return;
+        }
+        int p;
+        while ((p = nextFunc.fetch_add(1)) < numPending) {
+            int f = pending[p];
+            initFunctionContext(funcCtx, codegen, &outputs[f]);
+            generateFunction(funcCtx, funcStarts[f], funcEnds[f]);
+        }
+        free(funcCtx);
+    };
+    
+    int numThreads = ctx->codegenThreads < numPending ? ctx->codegenThreads : numPending;
+    if (numThreads <= 1) {
+        worker();
+    } else {
+        std::vector<std::thread> pool;
+        for (int t = 0; t < numThreads; t++) {
+            pool.push_back(std::thread([&]() {
+                worker();
+                addWorkerThreadCpuTime();
+            }));
+        }
+        for (size_t t = 0; t < pool.size(); t++) {
+            pool[t].join();
+        }
+    }
+    
+    if (!cacheKeys.empty()) {
+        for (int p = 0; p < numPending; p++) {
+            writeCachedFunction(cacheKeys[pending[p]], cacheRelocs[pending[p]], &outputs[pending[p]]);
+        }
+    }
+    
+    // For real MIPS or scheduling the whole .text is collected and
+    // rewritten in one piece, so cached and fresh functions get the same
+    // treatment
+    MIPSTextOptions rewrite;
+    rewrite.realMIPS = ctx->mipsTarget == MIPS_TARGET_REAL;
+    rewrite.schedule = ctx->scheduleInstructions != 0;
+    rewrite.pipeline = ctx->pipelineModel;
+    MIPSOutputBuffer text = { NULL, 0, 0 };
+    MIPSOutputBuffer* fileOutput = codegen->outputBuffer;
+    if (rewrite.realMIPS || rewrite.schedule) {
+        codegen->outputBuffer = &text;
+    }
+    
+    // Concatenate function bodies in source order
+    for (int f = 0; f < numFuncs; f++) {
+        if (outputs[f].data) {
+            emitMIPSText(codegen, outputs[f].data, outputs[f].length);
+            free(outputs[f].data);
+        }
+    }
+    
+    // The runtime library does not depend on the program, so it is
+    // rendered once per process and copied into every output
+    const MIPSOutputBuffer* runtime = getRuntimeLibraryAsm();
+    if (runtime->data) {
+        emitMIPSText(codegen, runtime->data, runtime->length);
+    }
+    
+    if (codegen->sharedIORoutines) {
+        const MIPSOutputBuffer* routines = getSharedIORoutinesAsm();
+        if (routines->data) {
+            emitMIPSText(codegen, routines->data, routines->length);
+        }
+    }
+    
+    if (rewrite.realMIPS || rewrite.schedule) {
+        codegen->outputBuffer = fileOutput;
+        MIPSTextStats stats;
+        size_t length = 0;
+        char* rewritten = text.data ? rewriteMIPSText(text.data, text.length, &rewrite, &length, &stats) : NULL;
+        if (rewritten) {
+            emitMIPSText(codegen, rewritten, length);
+            if (rewrite.schedule) {
+                printf("Scheduling: %d blocks reordered, model stalls %lld -> %lld\n",
+                       stats.scheduledBlocks, stats.stallsBefore, stats.stallsAfter);
+            }
+            if (rewrite.realMIPS) {
+                printf("Delay slots: %d of %d filled\n", stats.filledSlots, stats.delaySlots);
+            }
+            free(rewritten);
+        } else if (text.data) {
+            fprintf(stderr, "Error: Cannot allocate memory for rewriting the text section\n");
+        }
+        free(text.data);
+    }
+}
+
+/**
+ * Emit the C standard library function implementations
+ */
+static void emitRuntimeLibrary(MIPSCodeGenerator* codegen) {
     emitMIPS(codegen, "");
     emitMIPS(codegen, "# ============================================");
     emitMIPS(codegen, "# C Standard Library Function Implementations");
@@ -4551,16 +7115,63 @@ void generateTextSection(MIPSCodeGenerator* codegen) {
     emitMIPS(codegen, "    jr $ra");
     emitMIPS(codegen, "");
     
-    // atof - ASCII to Float (simplified - returns integer part)
+    // atof - ASCII to Double (digits with an optional fraction, no exponent)
     // Input: $a0 = string address
-    // Output: $v0 = integer value (float truncated to int)
+    // Output: $f0/$f1 = double value
     emitMIPS(codegen, "_atof:");
-    emitMIPS(codegen, "    # Simplified atof - just calls atoi for integer part");
-    emitMIPS(codegen, "    addiu $sp, $sp, -4");
-    emitMIPS(codegen, "    sw $ra, 0($sp)");
-    emitMIPS(codegen, "    jal _atoi          # reuse atoi implementation");
-    emitMIPS(codegen, "    lw $ra, 0($sp)");
-    emitMIPS(codegen, "    addiu $sp, $sp, 4");
+    emitMIPS(codegen, "    li $t1, 0          # negative = false");
+    emitMIPS(codegen, "    move $t0, $a0      # ptr = str");
+    emitMIPS(codegen, "_atof_skip_space:");
+    emitMIPS(codegen, "    lb $t2, 0($t0)     # load char");
+    emitMIPS(codegen, "    beq $t2, 32, _atof_next_char   # if space, skip");
+    emitMIPS(codegen, "    beq $t2, 9, _atof_next_char    # if tab, skip");
+    emitMIPS(codegen, "    j _atof_check_sign");
+    emitMIPS(codegen, "_atof_next_char:");
+    emitMIPS(codegen, "    addi $t0, $t0, 1");
+    emitMIPS(codegen, "    j _atof_skip_space");
+    emitMIPS(codegen, "_atof_check_sign:");
+    emitMIPS(codegen, "    bne $t2, 45, _atof_check_plus  # if not '-', check '+'");
+    emitMIPS(codegen, "    li $t1, 1          # negative = true");
+    emitMIPS(codegen, "    addi $t0, $t0, 1   # skip '-'");
+    emitMIPS(codegen, "    j _atof_start");
+    emitMIPS(codegen, "_atof_check_plus:");
+    emitMIPS(codegen, "    bne $t2, 43, _atof_start  # if not '+', start conversion");
+    emitMIPS(codegen, "    addi $t0, $t0, 1   # skip '+'");
+    emitMIPS(codegen, "_atof_start:");
+    emitMIPS(codegen, "    mtc1 $zero, $f0");
+    emitMIPS(codegen, "    cvt.d.w $f0, $f0   # result = 0.0");
+    emitMIPS(codegen, "    li $t2, 1");
+    emitMIPS(codegen, "    mtc1 $t2, $f2");
+    emitMIPS(codegen, "    cvt.d.w $f2, $f2   # scale = 1.0");
+    emitMIPS(codegen, "    li $t2, 10");
+    emitMIPS(codegen, "    mtc1 $t2, $f4");
+    emitMIPS(codegen, "    cvt.d.w $f4, $f4   # 10.0");
+    emitMIPS(codegen, "    li $t3, 0          # no '.' yet");
+    emitMIPS(codegen, "");
+    emitMIPS(codegen, "    # All digits go into result; scale counts those after the '.'");
+    emitMIPS(codegen, "_atof_loop:");
+    emitMIPS(codegen, "    lb $t2, 0($t0)     # load char");
+    emitMIPS(codegen, "    addi $t0, $t0, 1   # ptr++");
+    emitMIPS(codegen, "    bne $t2, 46, _atof_digit  # if not '.', digit");
+    emitMIPS(codegen, "    bnez $t3, _atof_done      # second '.'");
+    emitMIPS(codegen, "    li $t3, 1");
+    emitMIPS(codegen, "    j _atof_loop");
+    emitMIPS(codegen, "_atof_digit:");
+    emitMIPS(codegen, "    blt $t2, 48, _atof_done   # if < '0', done");
+    emitMIPS(codegen, "    bgt $t2, 57, _atof_done   # if > '9', done");
+    emitMIPS(codegen, "    addi $t2, $t2, -48 # convert ASCII to digit");
+    emitMIPS(codegen, "    mtc1 $t2, $f6");
+    emitMIPS(codegen, "    cvt.d.w $f6, $f6");
+    emitMIPS(codegen, "    mul.d $f0, $f0, $f4  # result *= 10");
+    emitMIPS(codegen, "    add.d $f0, $f0, $f6  # result += digit");
+    emitMIPS(codegen, "    beqz $t3, _atof_loop");
+    emitMIPS(codegen, "    mul.d $f2, $f2, $f4  # scale *= 10");
+    emitMIPS(codegen, "    j _atof_loop");
+    emitMIPS(codegen, "_atof_done:");
+    emitMIPS(codegen, "    div.d $f0, $f0, $f2  # result /= scale");
+    emitMIPS(codegen, "    beqz $t1, _atof_return");
+    emitMIPS(codegen, "    neg.d $f0, $f0     # apply sign");
+    emitMIPS(codegen, "_atof_return:");
     emitMIPS(codegen, "    jr $ra");
     emitMIPS(codegen, "");
     
@@ -4676,6 +7287,298 @@ void generateTextSection(MIPSCodeGenerator* codegen) {
     emitMIPS(codegen, "    addiu $sp, $sp, 12");
     emitMIPS(codegen, "    jr $ra");
     emitMIPS(codegen, "");
+    
+    // _print_double_precision - Print double with specific decimal precision
+    // Input: $f12/$f13 = double value, $t7 = precision (number of decimal places)
+    // Output: none (prints to stdout)
+    // The fraction is rounded to nearest; a carry goes into the integer part
+    emitMIPS(codegen, "_print_double_precision:");
+    emitMIPS(codegen, "    addiu $sp, $sp, -12");
+    emitMIPS(codegen, "    sw $ra, 0($sp)");
+    emitMIPS(codegen, "    sw $s0, 4($sp)");
+    emitMIPS(codegen, "    sw $s1, 8($sp)");
+    emitMIPS(codegen, "");
+    emitMIPS(codegen, "    move $s1, $t7      # Save precision");
+    emitMIPS(codegen, "");
+    emitMIPS(codegen, "    # Check if negative");
+    emitMIPS(codegen, "    mtc1 $zero, $f4");
+    emitMIPS(codegen, "    cvt.d.w $f4, $f4");
+    emitMIPS(codegen, "    c.lt.d $f12, $f4");
+    emitMIPS(codegen, "    bc1f _pdp_positive");
+    emitMIPS(codegen, "    nop");
+    emitMIPS(codegen, "    # Print minus sign");
+    emitMIPS(codegen, "    li $a0, 45         # '-'");
+    emitMIPS(codegen, "    li $v0, 11");
+    emitMIPS(codegen, "    syscall");
+    emitMIPS(codegen, "    # Make positive");
+    emitMIPS(codegen, "    neg.d $f12, $f12");
+    emitMIPS(codegen, "");
+    emitMIPS(codegen, "_pdp_positive:");
+    emitMIPS(codegen, "    # Split into integer and fractional part");
+    emitMIPS(codegen, "    trunc.w.d $f4, $f12  # Convert to int (truncate)");
+    emitMIPS(codegen, "    mfc1 $s0, $f4      # Integer part");
+    emitMIPS(codegen, "    cvt.d.w $f4, $f4   # Convert int back to double");
+    emitMIPS(codegen, "    sub.d $f12, $f12, $f4  # frac = original - integer");
+    emitMIPS(codegen, "");
+    emitMIPS(codegen, "    # Calculate 10^precision");
+    emitMIPS(codegen, "    li $t0, 1          # multiplier = 1");
+    emitMIPS(codegen, "    li $t1, 0          # counter = 0");
+    emitMIPS(codegen, "_pdp_mult_loop:");
+    emitMIPS(codegen, "    bge $t1, $s1, _pdp_mult_done");
+    emitMIPS(codegen, "    mul $t0, $t0, 10");
+    emitMIPS(codegen, "    addi $t1, $t1, 1");
+    emitMIPS(codegen, "    j _pdp_mult_loop");
+    emitMIPS(codegen, "_pdp_mult_done:");
+    emitMIPS(codegen, "");
+    emitMIPS(codegen, "    # digits = (trunc(2 * frac * 10^precision) + 1) / 2");
+    emitMIPS(codegen, "    mtc1 $t0, $f4");
+    emitMIPS(codegen, "    cvt.d.w $f4, $f4");
+    emitMIPS(codegen, "    mul.d $f12, $f12, $f4");
+    emitMIPS(codegen, "    add.d $f12, $f12, $f12");
+    emitMIPS(codegen, "    trunc.w.d $f12, $f12");
+    emitMIPS(codegen, "    mfc1 $t1, $f12");
+    emitMIPS(codegen, "    addi $t1, $t1, 1");
+    emitMIPS(codegen, "    sra $t1, $t1, 1    # fractional digits");
+    emitMIPS(codegen, "    blt $t1, $t0, _pdp_print_int");
+    emitMIPS(codegen, "    sub $t1, $t1, $t0  # Rounded up to the next integer");
+    emitMIPS(codegen, "    addi $s0, $s0, 1");
+    emitMIPS(codegen, "_pdp_print_int:");
+    emitMIPS(codegen, "    move $a0, $s0");
+    emitMIPS(codegen, "    li $v0, 1          # Print integer");
+    emitMIPS(codegen, "    syscall");
+    emitMIPS(codegen, "    move $s0, $t1");
+    emitMIPS(codegen, "    beqz $s1, _pdp_print_done  # No decimal point for precision 0");
+    emitMIPS(codegen, "");
+    emitMIPS(codegen, "    # Print decimal point");
+    emitMIPS(codegen, "    li $a0, 46         # '.'");
+    emitMIPS(codegen, "    li $v0, 11");
+    emitMIPS(codegen, "    syscall");
+    emitMIPS(codegen, "");
+    emitMIPS(codegen, "    # Print fractional part with leading zeros");
+    emitMIPS(codegen, "    div $t0, $t0, 10   # divisor = 10^(precision-1)");
+    emitMIPS(codegen, "_pdp_lead_zero_loop:");
+    emitMIPS(codegen, "    beqz $t0, _pdp_print_done  # if divisor == 0, done");
+    emitMIPS(codegen, "    bge $s0, $t0, _pdp_print_digits  # if value >= divisor, print");
+    emitMIPS(codegen, "    # Print leading zero");
+    emitMIPS(codegen, "    li $a0, 48         # '0'");
+    emitMIPS(codegen, "    li $v0, 11");
+    emitMIPS(codegen, "    syscall");
+    emitMIPS(codegen, "    div $t0, $t0, 10");
+    emitMIPS(codegen, "    j _pdp_lead_zero_loop");
+    emitMIPS(codegen, "");
+    emitMIPS(codegen, "_pdp_print_digits:");
+    emitMIPS(codegen, "    # Print remaining digits");
+    emitMIPS(codegen, "    move $a0, $s0");
+    emitMIPS(codegen, "    li $v0, 1");
+    emitMIPS(codegen, "    syscall");
+    emitMIPS(codegen, "");
+    emitMIPS(codegen, "_pdp_print_done:");
+    emitMIPS(codegen, "    lw $ra, 0($sp)");
+    emitMIPS(codegen, "    lw $s0, 4($sp)");
+    emitMIPS(codegen, "    lw $s1, 8($sp)");
+    emitMIPS(codegen, "    addiu $sp, $sp, 12");
+    emitMIPS(codegen, "    jr $ra");
+    emitMIPS(codegen, "");
+}
+
+const MIPSOutputBuffer* getRuntimeLibraryAsm(void) {
+    static MIPSOutputBuffer runtime = {NULL, 0, 0};
+    static std::once_flag rendered;
+    std::call_once(rendered, []() {
+        MIPSCodeGenerator* scratch = (MIPSCodeGenerator*)calloc(1, sizeof(MIPSCodeGenerator));
+        if (!scratch) {
+            fprintf(stderr, "Error: Cannot allocate memory for runtime library\n");
+            return;
+        }
+        scratch->outputBuffer = &runtime;
+        emitRuntimeLibrary(scratch);
+        free(scratch);
+    });
+    return &runtime;
+}
+
+/**
+ * Emit the shared printf/scanf routines used by calls that are not
+ * expanded inline (IORuntimeMode)
+ */
+static void emitSharedIORoutines(MIPSCodeGenerator* codegen) {
+    // _printf - Format string walked at runtime
+    // Input: $a0 = format string, $a1-$a3 = arguments (floats as raw bits)
+    // Output: none (prints to stdout)
+    // Literal runs are printed with one print_string syscall by
+    // terminating them in place and restoring the byte afterwards
+    emitMIPS(codegen, "_printf:");
+    emitMIPS(codegen, "    addiu $sp, $sp, -32");
+    emitMIPS(codegen, "    sw $ra, 0($sp)");
+    emitMIPS(codegen, "    sw $s0, 4($sp)");
+    emitMIPS(codegen, "    sw $s1, 8($sp)");
+    emitMIPS(codegen, "    sw $s2, 12($sp)");
+    emitMIPS(codegen, "    sw $a1, 16($sp)    # Arguments in order");
+    emitMIPS(codegen, "    sw $a2, 20($sp)");
+    emitMIPS(codegen, "    sw $a3, 24($sp)");
+    emitMIPS(codegen, "    move $s0, $a0      # Format pointer");
+    emitMIPS(codegen, "    addiu $s1, $sp, 16 # Next argument");
+    emitMIPS(codegen, "_printf_loop:");
+    emitMIPS(codegen, "    move $t2, $s0      # Start of literal run");
+    emitMIPS(codegen, "    li $t3, 37         # '%'");
+    emitMIPS(codegen, "_printf_scan:");
+    emitMIPS(codegen, "    lb $t1, 0($s0)");
+    emitMIPS(codegen, "    addiu $s0, $s0, 1");
+    emitMIPS(codegen, "    beqz $t1, _printf_flush");
+    emitMIPS(codegen, "    bne $t1, $t3, _printf_scan");
+    emitMIPS(codegen, "_printf_flush:");
+    emitMIPS(codegen, "    addiu $s0, $s0, -1 # Back to the '%' or terminator");
+    emitMIPS(codegen, "    beq $t2, $s0, _printf_format  # Empty run");
+    emitMIPS(codegen, "    sb $zero, 0($s0)   # Terminate the run");
+    emitMIPS(codegen, "    move $a0, $t2");
+    emitMIPS(codegen, "    li $v0, 4          # print_string");
+    emitMIPS(codegen, "    syscall");
+    emitMIPS(codegen, "    sb $t1, 0($s0)     # Restore the format string");
+    emitMIPS(codegen, "_printf_format:");
+    emitMIPS(codegen, "    beqz $t1, _printf_done");
+    emitMIPS(codegen, "    addiu $s0, $s0, 1  # Past '%'");
+    emitMIPS(codegen, "    lb $t1, 0($s0)");
+    emitMIPS(codegen, "    li $a0, 37");
+    emitMIPS(codegen, "    beqz $t1, _printf_char       # Trailing '%'");
+    emitMIPS(codegen, "    addiu $s0, $s0, 1");
+    emitMIPS(codegen, "    beq $t1, 37, _printf_char    # '%%'");
+    emitMIPS(codegen, "    li $s2, 6          # Default precision");
+    emitMIPS(codegen, "    bne $t1, 46, _printf_spec    # No '.'");
+    emitMIPS(codegen, "    li $s2, 0");
+    emitMIPS(codegen, "_printf_precision:");
+    emitMIPS(codegen, "    lb $t1, 0($s0)");
+    emitMIPS(codegen, "    blt $t1, 48, _printf_spec_next");
+    emitMIPS(codegen, "    bgt $t1, 57, _printf_spec_next");
+    emitMIPS(codegen, "    addiu $s0, $s0, 1");
+    emitMIPS(codegen, "    addi $t1, $t1, -48");
+    emitMIPS(codegen, "    mul $s2, $s2, 10");
+    emitMIPS(codegen, "    add $s2, $s2, $t1");
+    emitMIPS(codegen, "    j _printf_precision");
+    emitMIPS(codegen, "_printf_spec_next:");
+    emitMIPS(codegen, "    addiu $s0, $s0, 1");
+    emitMIPS(codegen, "_printf_spec:");
+    emitMIPS(codegen, "    beq $t1, 108, _printf_length # 'l'");
+    emitMIPS(codegen, "    beq $t1, 104, _printf_length # 'h'");
+    emitMIPS(codegen, "    beqz $t1, _printf_done");
+    emitMIPS(codegen, "    lw $a0, 0($s1)     # Next argument");
+    emitMIPS(codegen, "    addiu $s1, $s1, 4");
+    emitMIPS(codegen, "    beq $t1, 102, _printf_float  # 'f'");
+    emitMIPS(codegen, "    beq $t1, 99, _printf_char    # 'c'");
+    emitMIPS(codegen, "    beq $t1, 115, _printf_string # 's'");
+    emitMIPS(codegen, "    li $v0, 1          # d, i, p, x and others: print_int");
+    emitMIPS(codegen, "    syscall");
+    emitMIPS(codegen, "    j _printf_loop");
+    emitMIPS(codegen, "_printf_length:");
+    emitMIPS(codegen, "    lb $t1, 0($s0)     # Length modifiers are skipped");
+    emitMIPS(codegen, "    addiu $s0, $s0, 1");
+    emitMIPS(codegen, "    j _printf_spec");
+    emitMIPS(codegen, "_printf_float:");
+    emitMIPS(codegen, "    mtc1 $a0, $f12");
+    emitMIPS(codegen, "    move $t7, $s2      # Precision");
+    emitMIPS(codegen, "    jal _print_float_precision");
+    emitMIPS(codegen, "    j _printf_loop");
+    emitMIPS(codegen, "_printf_string:");
+    emitMIPS(codegen, "    li $v0, 4");
+    emitMIPS(codegen, "    syscall");
+    emitMIPS(codegen, "    j _printf_loop");
+    emitMIPS(codegen, "_printf_char:");
+    emitMIPS(codegen, "    li $v0, 11");
+    emitMIPS(codegen, "    syscall");
+    emitMIPS(codegen, "    j _printf_loop");
+    emitMIPS(codegen, "_printf_done:");
+    emitMIPS(codegen, "    lw $ra, 0($sp)");
+    emitMIPS(codegen, "    lw $s0, 4($sp)");
+    emitMIPS(codegen, "    lw $s1, 8($sp)");
+    emitMIPS(codegen, "    lw $s2, 12($sp)");
+    emitMIPS(codegen, "    addiu $sp, $sp, 32");
+    emitMIPS(codegen, "    jr $ra");
+    emitMIPS(codegen, "");
+    
+    // _scanf - Format string walked at runtime
+    // Input: $a0 = format string, $a1-$a3 = destination addresses
+    // Output: $v0 = number of items read
+    emitMIPS(codegen, "_scanf:");
+    emitMIPS(codegen, "    addiu $sp, $sp, -32");
+    emitMIPS(codegen, "    sw $s0, 4($sp)");
+    emitMIPS(codegen, "    sw $s1, 8($sp)");
+    emitMIPS(codegen, "    sw $s2, 12($sp)");
+    emitMIPS(codegen, "    sw $a1, 16($sp)    # Addresses in order");
+    emitMIPS(codegen, "    sw $a2, 20($sp)");
+    emitMIPS(codegen, "    sw $a3, 24($sp)");
+    emitMIPS(codegen, "    move $s0, $a0      # Format pointer");
+    emitMIPS(codegen, "    addiu $s1, $sp, 16 # Next address");
+    emitMIPS(codegen, "    li $s2, 0          # Items read");
+    emitMIPS(codegen, "_scanf_loop:");
+    emitMIPS(codegen, "    lb $t1, 0($s0)");
+    emitMIPS(codegen, "    beqz $t1, _scanf_done");
+    emitMIPS(codegen, "    addiu $s0, $s0, 1");
+    emitMIPS(codegen, "    bne $t1, 37, _scanf_loop     # Literal text is skipped");
+    emitMIPS(codegen, "    lb $t1, 0($s0)");
+    emitMIPS(codegen, "    beqz $t1, _scanf_done");
+    emitMIPS(codegen, "    addiu $s0, $s0, 1");
+    emitMIPS(codegen, "    beq $t1, 37, _scanf_loop     # '%%'");
+    emitMIPS(codegen, "_scanf_width:");
+    emitMIPS(codegen, "    beq $t1, 32, _scanf_skip     # Spaces, widths and lengths");
+    emitMIPS(codegen, "    beq $t1, 108, _scanf_skip    # 'l'");
+    emitMIPS(codegen, "    beq $t1, 104, _scanf_skip    # 'h'");
+    emitMIPS(codegen, "    blt $t1, 48, _scanf_spec");
+    emitMIPS(codegen, "    bgt $t1, 57, _scanf_spec");
+    emitMIPS(codegen, "_scanf_skip:");
+    emitMIPS(codegen, "    lb $t1, 0($s0)");
+    emitMIPS(codegen, "    addiu $s0, $s0, 1");
+    emitMIPS(codegen, "    j _scanf_width");
+    emitMIPS(codegen, "_scanf_spec:");
+    emitMIPS(codegen, "    beqz $t1, _scanf_done");
+    emitMIPS(codegen, "    lw $t8, 0($s1)     # Destination address");
+    emitMIPS(codegen, "    addiu $s1, $s1, 4");
+    emitMIPS(codegen, "    addiu $s2, $s2, 1");
+    emitMIPS(codegen, "    beq $t1, 102, _scanf_float   # 'f'");
+    emitMIPS(codegen, "    beq $t1, 99, _scanf_char     # 'c'");
+    emitMIPS(codegen, "    beq $t1, 115, _scanf_string  # 's'");
+    emitMIPS(codegen, "    li $v0, 5          # d, i and others: read_int");
+    emitMIPS(codegen, "    syscall");
+    emitMIPS(codegen, "    sw $v0, 0($t8)");
+    emitMIPS(codegen, "    j _scanf_loop");
+    emitMIPS(codegen, "_scanf_float:");
+    emitMIPS(codegen, "    li $v0, 6          # read_float");
+    emitMIPS(codegen, "    syscall");
+    emitMIPS(codegen, "    swc1 $f0, 0($t8)");
+    emitMIPS(codegen, "    j _scanf_loop");
+    emitMIPS(codegen, "_scanf_char:");
+    emitMIPS(codegen, "    li $v0, 12         # read_char");
+    emitMIPS(codegen, "    syscall");
+    emitMIPS(codegen, "    sb $v0, 0($t8)");
+    emitMIPS(codegen, "    j _scanf_loop");
+    emitMIPS(codegen, "_scanf_string:");
+    emitMIPS(codegen, "    move $a0, $t8      # Buffer address");
+    emitMIPS(codegen, "    li $a1, 100        # Max length");
+    emitMIPS(codegen, "    li $v0, 8          # read_string");
+    emitMIPS(codegen, "    syscall");
+    emitMIPS(codegen, "    j _scanf_loop");
+    emitMIPS(codegen, "_scanf_done:");
+    emitMIPS(codegen, "    move $v0, $s2");
+    emitMIPS(codegen, "    lw $s0, 4($sp)");
+    emitMIPS(codegen, "    lw $s1, 8($sp)");
+    emitMIPS(codegen, "    lw $s2, 12($sp)");
+    emitMIPS(codegen, "    addiu $sp, $sp, 32");
+    emitMIPS(codegen, "    jr $ra");
+    emitMIPS(codegen, "");
+}
+
+static const MIPSOutputBuffer* getSharedIORoutinesAsm(void) {
+    static MIPSOutputBuffer routines = {NULL, 0, 0};
+    static std::once_flag rendered;
+    std::call_once(rendered, []() {
+        MIPSCodeGenerator* scratch = (MIPSCodeGenerator*)calloc(1, sizeof(MIPSCodeGenerator));
+        if (!scratch) {
+            fprintf(stderr, "Error: Cannot allocate memory for runtime library\n");
+            return;
+        }
+        scratch->outputBuffer = &routines;
+        emitSharedIORoutines(scratch);
+        free(scratch);
+    });
+    return &routines;
 }
 
 /**
@@ -4701,15 +7604,29 @@ void generateMIPSCode(MIPSCodeGenerator* codegen, const char* outputFilename) {
     codegen->outputFile = NULL;
 }
 
+// Per-thread code generator allocation, released when the thread exits
+struct CodeGeneratorSlot {
+    MIPSCodeGenerator* codegen;
+    CodeGeneratorSlot() : codegen(NULL) {}
+    ~CodeGeneratorSlot() { free(codegen); }
+};
+
 /**
  * Main entry point for testing Phase 2
  */
 void testMIPSCodeGeneration(const char* outputFilename) {
     // First, run basic block analysis (needed for next-use info)
+    beginPhase(PHASE_ANALYZE_IR);
     analyzeIR();
+    endPhase(PHASE_ANALYZE_IR);
     
-    // Initialize code generator - use malloc to avoid stack overflow
-    MIPSCodeGenerator* codegen = (MIPSCodeGenerator*)malloc(sizeof(MIPSCodeGenerator));
+    // Initialize code generator - kept on the heap (too large for the stack)
+    // and reused by later compilations on the same thread
+    static thread_local CodeGeneratorSlot slot;
+    if (!slot.codegen) {
+        slot.codegen = (MIPSCodeGenerator*)malloc(sizeof(MIPSCodeGenerator));
+    }
+    MIPSCodeGenerator* codegen = slot.codegen;
     if (!codegen) {
         fprintf(stderr, "Error: Cannot allocate memory for code generator\n");
         return;
@@ -4717,23 +7634,23 @@ void testMIPSCodeGeneration(const char* outputFilename) {
     initMIPSCodeGen(codegen);
     
     // Compute activation records (from Phase 1)
+    beginPhase(PHASE_ACTIVATION_RECORDS);
     computeActivationRecords();
+    endPhase(PHASE_ACTIVATION_RECORDS);
     
     // DEBUG: Print activation records
     printActivationRecords();
     
-    // Copy activation records to codegen
-    for (int i = 0; i < activationRecordCount; i++) {
-        codegen->activationRecords[i] = activationRecords[i];
-    }
-    codegen->funcCount = activationRecordCount;
+    // Share activation records with codegen (read-only from here on)
+    codegen->activationRecords = ctx->activationRecords;
+    codegen->funcCount = ctx->activationRecordCount;
     
     // Generate MIPS code
+    beginPhase(PHASE_GENERATE_MIPS);
+    ctx->mipsLineCount = 0;
     generateMIPSCode(codegen, outputFilename);
+    endPhase(PHASE_GENERATE_MIPS);
     
     printf("MIPS assembly generated: %s\n", outputFilename);
-    
-    // Free memory
-    free(codegen);
 }
 
@@ -22,6 +22,7 @@ extern "C" {
 #include <stdio.h>
 #include "ir_context.h"
 #include "basic_block.h"
+#include "mips_lowering.h"
 
 // MIPS Register definitions
 #define REG_ZERO 0   // $zero - constant 0
@@ -54,8 +55,11 @@ extern "C" {
 #define REG_RA   31  // $ra - return address
 
 #define NUM_TEMP_REGS 10  // $t0-$t9
+#define NUM_SAVED_REGS 8  // $s0-$s7
+#define NUM_FLOAT_REGS 12 // Even registers $f4-$f10, $f16-$f30 (see getFloatReg)
 #define MAX_VARIABLES 1000
 #define MAX_FUNCTIONS 100
+#define MAX_PRINTF_SEGMENTS 200  // Distinct printf literal segments in .data
 
 /**
  * Register Descriptor (Lecture 35)
@@ -65,6 +69,7 @@ typedef struct RegisterDescriptor {
     char varNames[10][128];  // Variables currently in this register
     int varCount;            // Number of variables
     bool isDirty;            // Has the register been modified?
+    bool allocated;          // Handed out in the current function ($s registers are then saved by it)
 } RegisterDescriptor;
 
 /**
@@ -80,6 +85,17 @@ typedef struct AddressDescriptor {
     bool isGlobal;           // Is this a global variable?
 } AddressDescriptor;
 
+/**
+ * Where a temporary of the function being translated is defined and used,
+ * so a spill can skip storing a value no later instruction reads
+ */
+typedef struct TempLiveness {
+    int defIndex;            // IR index of the only definition (-1 none, -2 several)
+    int firstUse;            // First IR index mentioning the temporary
+    int lastUse;             // Last IR index mentioning it
+    bool crossesLabel;       // A label lies between the definition and the last use
+} TempLiveness;
+
 /**
  * Function Activation Record Information (Lectures 32-33)
  * Stack frame layout and variable offsets
@@ -91,16 +107,29 @@ typedef struct ActivationRecord {
     int numParams;           // Number of parameters
     int maxTemps;            // Maximum temporaries needed
     int savedRegsSize;       // Space for saved $s registers
+    int savedRegsOffset;     // Offset of the $s0 slot from $fp ($s1 at -4 from it, ...)
     
     // Variable offsets from $fp
     struct {
         char varName[128];
         int offset;          // Offset from $fp (negative for locals)
         int size;            // Size in bytes
+        bool isDouble;       // Held in an even/odd FP register pair
     } variables[MAX_VARIABLES];
     int varCount;
 } ActivationRecord;
 
+/**
+ * Growable text buffer holding the assembly of a single function.
+ * Functions are translated into their own buffers so they can be generated
+ * independently and then written out in source order.
+ */
+typedef struct MIPSOutputBuffer {
+    char* data;
+    size_t length;
+    size_t capacity;
+} MIPSOutputBuffer;
+
 /**
  * MIPS Code Generator Context
  * Main structure holding all code generation state
@@ -117,31 +146,55 @@ typedef struct MIPSCodeGenerator {
     
     // Register allocation (Lecture 35)
     RegisterDescriptor regDescriptors[32];  // All MIPS registers
+    RegisterDescriptor fpRegDescriptors[32];  // Coprocessor 1 registers $f0-$f31
     AddressDescriptor addrDescriptors[MAX_VARIABLES];
     int addrDescCount;
     
-    // Runtime environment (Lectures 32-33)
-    ActivationRecord activationRecords[MAX_FUNCTIONS];
+    // Runtime environment (Lectures 32-33) - shared, read-only during codegen
+    ActivationRecord* activationRecords;
     int funcCount;
     ActivationRecord* currentFunction;
     
     // Code generation state
     FILE* outputFile;
+    MIPSOutputBuffer* outputBuffer;  // When set, emitMIPS appends here instead of outputFile
     int currentBlock;
     bool inFunction;
     char currentFuncName[128];
+    int currentIndex;                // IR index being translated
+    TempLiveness* tempLiveness;      // Indexed by temporary number (current function only)
+    int tempLivenessCount;
     
     // Function call state (Phase 3)
     int currentParamCount;      // Track params for current CALL
     int paramRegisterMap[10];   // Map param index to register number
+    char printfDoubles[10][128];  // Double arguments of the pending printf by index ("" for others)
+    int doubleCompareCount;     // Labels of double comparisons materialized as 0/1
+    
+    // Callee-saved $s registers: the saves after the prologue and the
+    // restores before each return are inserted into outputBuffer once the
+    // body is generated, for the registers marked allocated
+    int preservedRegCount;           // $s registers worth keeping temporaries in across calls
+    size_t saveInsertPoint;
+    size_t* restoreInsertPoints;
+    int restoreInsertCount;
+    int restoreInsertCapacity;
     
     // String literal mapping (Phase 3)
     char stringLiterals[100][256];  // Store string literals
     int stringCount;                 // Count of string literals
     
+    // printf literal text between conversion specifiers, pooled in .data
+    // as _fmt<N> and printed with one print_string syscall each
+    char printfSegments[MAX_PRINTF_SEGMENTS][256];
+    int printfSegmentCount;
+    bool sharedIORoutines;          // Some printf/scanf calls use _printf/_scanf
+    
     // Float constant mapping
     char floatConstants[100][64];    // Store float constants
     int floatConstCount;             // Count of float constants
+    char doubleConstants[100][64];   // Constants converted to double, pooled as _double<N>
+    int doubleConstCount;
     
     // Variable type tracking
     struct {
@@ -160,6 +213,61 @@ typedef struct MIPSCodeGenerator {
  */
 void initMIPSCodeGen(MIPSCodeGenerator* codegen);
 
+/**
+ * Prepare a per-function context: copies the program-wide tables from the
+ * shared generator and gives the function fresh descriptors and its own buffer
+ */
+void initFunctionContext(MIPSCodeGenerator* funcCtx, const MIPSCodeGenerator* shared, MIPSOutputBuffer* buffer);
+
+/**
+ * Code generation settings. Each applies to the current thread's context
+ * only, until the context is reset.
+ */
+
+/**
+ * Set the number of worker threads used to translate functions (1 = serial)
+ */
+void setCodegenThreadCount(int threads);
+
+/**
+ * Reuse the assembly of functions whose code generation inputs are
+ * unchanged, caching it in `dir` across runs (NULL disables the cache)
+ */
+void setCodegenCacheDir(const char* dir);
+
+/**
+ * How printf/scanf calls are translated
+ */
+typedef enum {
+    IO_RUNTIME_INLINE,      // Expand every call's format string in place (default)
+    IO_RUNTIME_AUTO,        // Call the shared routines where that is smaller, except in loops
+    IO_RUNTIME_SHARED       // Call the shared _printf/_scanf routines wherever possible
+} IORuntimeMode;
+
+void setIORuntimeMode(IORuntimeMode mode);
+
+/**
+ * Which machine the .text section is written for
+ */
+typedef enum {
+    MIPS_TARGET_SPIM,       // Pseudo-instructions, no delay slots (default)
+    MIPS_TARGET_REAL        // Machine instructions only, branch delay slots filled
+} MIPSTarget;
+
+void setMIPSTarget(MIPSTarget target);
+
+/**
+ * List-schedule the instructions of every basic block for the latencies
+ * of `model`; NULL keeps them in IR order (the default)
+ */
+void setInstructionScheduling(const MIPSPipelineModel* model);
+
+/**
+ * Assembly of the C standard library routines appended to every program.
+ * Rendered on first use and shared (read-only) by all compilations.
+ */
+const MIPSOutputBuffer* getRuntimeLibraryAsm(void);
+
 /**
  * Main entry point: Generate MIPS assembly from IR
  */
@@ -263,6 +371,24 @@ int getReg(MIPSCodeGenerator* codegen, const char* varName, int irIndex);
  */
 void spillRegister(MIPSCodeGenerator* codegen, int regNum);
 
+/**
+ * getReg for floating-point values: find an FP register holding varName,
+ * loading it with lwc1 (or mtc1 from the integer register it is in).
+ * avoid1/avoid2 are FP registers the current instruction still needs (-1 = none).
+ * Returns the FP register number ($f<N>)
+ */
+int getFloatReg(MIPSCodeGenerator* codegen, const char* varName, int irIndex, int avoid1, int avoid2);
+
+/**
+ * Store every dirty FP register to memory; the registers keep their values
+ */
+void writeBackFloatRegisters(MIPSCodeGenerator* codegen);
+
+/**
+ * Forget what the FP registers hold (after labels and calls)
+ */
+void clearFloatRegisters(MIPSCodeGenerator* codegen);
+
 /**
  * Load variable into register
  */
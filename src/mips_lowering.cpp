@@ -0,0 +1,1108 @@
+#include "mips_lowering.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// How far back from a branch the delay slot filler looks for a candidate
+#define SLOT_SEARCH_WINDOW 8
+
+// Resources other than registers an instruction can read or write
+#define RES_HILO 1u
+#define RES_FCC  2u
+#define RES_MEM  4u
+
+// Registers are numbered 0-31 (integer) and 32-63 (FPU) in the masks
+#define FP_REG(n) ((n) + 32)
+#define REG_AT    1
+#define REG_RA    31
+
+// Operand layouts of the machine instructions the lowering emits
+enum Shape {
+    S_NONE,      //
+    S_RRR,       // rd, rs, rt
+    S_RRI,       // rt, rs, imm
+    S_RI,        // rt, imm              (lui)
+    S_HILO,      // rs, rt  |  $zero, rs, rt
+    S_MFHILO,    // rd
+    S_MTHILO,    // rs
+    S_BR2,       // rs, rt, label
+    S_BR1,       // rs, label
+    S_BC,        // label                (bc1t / bc1f)
+    S_J,         // label
+    S_JAL,       // label
+    S_JR,        // rs
+    S_JALR,      // rs  |  rd, rs
+    S_LOAD,      // rt, off(base)
+    S_STORE,     // rt, off(base)
+    S_FLOAD,     // ft, off(base)
+    S_FSTORE,    // ft, off(base)
+    S_FFF,       // fd, fs, ft
+    S_FF,        // fd, fs
+    S_FCMP,      // fs, ft
+    S_MTC1,      // rt, fs
+    S_MFC1,      // rt, fs
+    S_SYSCALL
+};
+
+struct MachineOp {
+    const char* name;
+    Shape shape;
+    unsigned pairs;              // Bit i: FP operand i names an even/odd double pair
+};
+
+static const MachineOp machineOps[] = {
+    { "nop", S_NONE },        { "syscall", S_SYSCALL },
+    { "add", S_RRR },         { "addu", S_RRR },       { "sub", S_RRR },        { "subu", S_RRR },
+    { "and", S_RRR },         { "or", S_RRR },         { "xor", S_RRR },        { "nor", S_RRR },
+    { "slt", S_RRR },         { "sltu", S_RRR },       { "sllv", S_RRR },       { "srlv", S_RRR },
+    { "srav", S_RRR },        { "mul", S_RRR },
+    { "addi", S_RRI },        { "addiu", S_RRI },      { "andi", S_RRI },       { "ori", S_RRI },
+    { "xori", S_RRI },        { "slti", S_RRI },       { "sltiu", S_RRI },      { "sll", S_RRI },
+    { "srl", S_RRI },         { "sra", S_RRI },
+    { "lui", S_RI },
+    { "mult", S_HILO },       { "multu", S_HILO },     { "div", S_HILO },       { "divu", S_HILO },
+    { "mfhi", S_MFHILO },     { "mflo", S_MFHILO },    { "mthi", S_MTHILO },    { "mtlo", S_MTHILO },
+    { "beq", S_BR2 },         { "bne", S_BR2 },
+    { "bgez", S_BR1 },        { "bgtz", S_BR1 },       { "blez", S_BR1 },       { "bltz", S_BR1 },
+    { "bc1t", S_BC },         { "bc1f", S_BC },
+    { "j", S_J },             { "jal", S_JAL },        { "jr", S_JR },          { "jalr", S_JALR },
+    { "lw", S_LOAD },         { "lh", S_LOAD },        { "lhu", S_LOAD },       { "lb", S_LOAD },
+    { "lbu", S_LOAD },        { "sw", S_STORE },       { "sh", S_STORE },       { "sb", S_STORE },
+    { "lwc1", S_FLOAD },      { "swc1", S_FSTORE },
+    { "add.s", S_FFF },       { "sub.s", S_FFF },      { "mul.s", S_FFF },      { "div.s", S_FFF },
+    { "neg.s", S_FF },        { "abs.s", S_FF },       { "mov.s", S_FF },       { "sqrt.s", S_FF },
+    { "cvt.s.w", S_FF },      { "cvt.w.s", S_FF },     { "trunc.w.s", S_FF },
+    { "c.eq.s", S_FCMP },     { "c.lt.s", S_FCMP },    { "c.le.s", S_FCMP },
+    { "mtc1", S_MTC1 },       { "mfc1", S_MFC1 },
+    { "add.d", S_FFF, 7 },    { "sub.d", S_FFF, 7 },   { "mul.d", S_FFF, 7 },   { "div.d", S_FFF, 7 },
+    { "neg.d", S_FF, 3 },     { "abs.d", S_FF, 3 },    { "mov.d", S_FF, 3 },    { "sqrt.d", S_FF, 3 },
+    { "cvt.d.s", S_FF, 1 },   { "cvt.d.w", S_FF, 1 },  { "cvt.s.d", S_FF, 2 },  { "cvt.w.d", S_FF, 2 },
+    { "trunc.w.d", S_FF, 2 },
+    { "c.eq.d", S_FCMP, 3 },  { "c.lt.d", S_FCMP, 3 }, { "c.le.d", S_FCMP, 3 },
+};
+
+// One instruction after lowering
+struct Insn {
+    string op;
+    vector<string> operands;
+};
+
+// What a load or store accesses, to tell accesses that cannot overlap apart
+enum MemoryKind {
+    MEM_UNKNOWN,                 // Through a pointer: may alias anything
+    MEM_FRAME,                   // offset($fp) or offset($sp)
+    MEM_STATIC                   // label+offset
+};
+
+struct MemoryRef {
+    MemoryKind kind;
+    int base;                    // MEM_FRAME: $fp or $sp
+    string label;                // MEM_STATIC
+    int64_t offset;
+    int size;
+};
+
+// One output line with what the scheduler and the delay slot filler need
+// to know about it
+struct AsmLine {
+    string text;
+    bool instruction;            // Otherwise a label, directive, comment or blank line
+    bool boundary;               // Label or directive: a candidate never moves across it
+    bool transfer;               // Branch or jump (has a delay slot)
+    bool movable;                // May be moved into a delay slot
+    bool barrier;                // Nothing moves past it (syscall, unknown instruction)
+    bool inSlot;                 // Occupies a delay slot
+    uint64_t useRegs, defRegs;
+    unsigned useRes, defRes;
+    int extraLatency;            // Cycles after the next one before the result can be read
+    MemoryRef memory;            // Loads and stores
+};
+
+/* ========== Operands ========== */
+
+static string trim(const string& s) {
+    size_t first = s.find_first_not_of(" \t\r\n");
+    if (first == string::npos) return "";
+    size_t last = s.find_last_not_of(" \t\r\n");
+    return s.substr(first, last - first + 1);
+}
+
+// Offset of a '#' comment that is not inside a string or character literal
+static size_t commentStart(const string& line) {
+    char quote = 0;
+    for (size_t i = 0; i < line.size(); i++) {
+        char c = line[i];
+        if (quote) {
+            if (c == '\\') i++;
+            else if (c == quote) quote = 0;
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+        } else if (c == '#') {
+            return i;
+        }
+    }
+    return string::npos;
+}
+
+static vector<string> splitOperands(const string& s) {
+    vector<string> operands;
+    string current;
+    char quote = 0;
+    for (size_t i = 0; i < s.size(); i++) {
+        char c = s[i];
+        if (quote) {
+            current += c;
+            if (c == '\\' && i + 1 < s.size()) current += s[++i];
+            else if (c == quote) quote = 0;
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+            current += c;
+        } else if (c == ',') {
+            operands.push_back(trim(current));
+            current.clear();
+        } else {
+            current += c;
+        }
+    }
+    if (!trim(current).empty() || !operands.empty()) operands.push_back(trim(current));
+    return operands;
+}
+
+static const char* const regNames[32] = {
+    "zero", "at", "v0", "v1", "a0", "a1", "a2", "a3",
+    "t0", "t1", "t2", "t3", "t4", "t5", "t6", "t7",
+    "s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7",
+    "t8", "t9", "k0", "k1", "gp", "sp", "fp", "ra"
+};
+
+// Integer register number, or -1
+static int registerNumber(const string& token) {
+    if (token.size() < 2 || token[0] != '$') return -1;
+    const char* name = token.c_str() + 1;
+    if (isdigit((unsigned char)name[0])) {
+        int n = atoi(name);
+        return n >= 0 && n <= 31 ? n : -1;
+    }
+    for (int r = 0; r < 32; r++) {
+        if (strcmp(name, regNames[r]) == 0) return r;
+    }
+    return strcmp(name, "s8") == 0 ? 30 : -1;
+}
+
+// FPU register number, or -1
+static int fpRegisterNumber(const string& token) {
+    if (token.size() < 3 || token[0] != '$' || token[1] != 'f' || !isdigit((unsigned char)token[2])) return -1;
+    int n = atoi(token.c_str() + 2);
+    return n >= 0 && n <= 31 ? n : -1;
+}
+
+static bool isRegister(const string& token) {
+    return registerNumber(token) >= 0;
+}
+
+static bool parseImmediate(const string& token, int64_t& value) {
+    if (token.size() >= 3 && token[0] == '\'') {
+        size_t i = 1;
+        char c = token[i++];
+        if (c == '\\' && i < token.size()) {
+            char e = token[i++];
+            c = e == 'n' ? '\n' : e == 't' ? '\t' : e == 'r' ? '\r' : e == '0' ? '\0' : e;
+        }
+        value = (unsigned char)c;
+        return i < token.size() && token[i] == '\'';
+    }
+    if (token.empty()) return false;
+    char* end;
+    value = strtoll(token.c_str(), &end, 0);
+    return *end == '\0';
+}
+
+static bool fitsSigned16(int64_t value) {
+    return value >= -32768 && value <= 32767;
+}
+
+static bool fitsUnsigned16(int64_t value) {
+    return value >= 0 && value <= 65535;
+}
+
+static string number(int64_t value) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%lld", (long long)value);
+    return buffer;
+}
+
+/**
+ * Split "off(base)" into its parts; base is "" for a bare label or number
+ */
+static bool splitAddress(const string& address, string& offset, string& base) {
+    // The base register follows the closing parenthesis of %lo(...)
+    size_t paren = address.find('(', address[0] == '%' ? address.find(')') : 0);
+    if (paren == string::npos) {
+        offset = trim(address);
+        base = "";
+        return !offset.empty();
+    }
+    size_t close = address.find(')', paren);
+    if (close == string::npos) return false;
+    offset = trim(address.substr(0, paren));
+    base = trim(address.substr(paren + 1, close - paren - 1));
+    return isRegister(base);
+}
+
+/* ========== Pseudo-instruction expansion ========== */
+
+static void add(vector<Insn>& out, const char* op, const string& a) {
+    Insn insn;
+    insn.op = op;
+    insn.operands.push_back(a);
+    out.push_back(insn);
+}
+
+static void add(vector<Insn>& out, const char* op, const string& a, const string& b) {
+    add(out, op, a);
+    out.back().operands.push_back(b);
+}
+
+static void add(vector<Insn>& out, const char* op, const string& a, const string& b, const string& c) {
+    add(out, op, a, b);
+    out.back().operands.push_back(c);
+}
+
+static void loadImmediate(vector<Insn>& out, const string& rd, int64_t value) {
+    int32_t v = (int32_t)value;
+    if (fitsSigned16(v)) {
+        add(out, "addiu", rd, "$zero", number(v));
+    } else if (fitsUnsigned16(v)) {
+        add(out, "ori", rd, "$zero", number(v));
+    } else {
+        add(out, "lui", rd, number(((uint32_t)v >> 16) & 0xffff));
+        if (v & 0xffff) add(out, "ori", rd, rd, number(v & 0xffff));
+    }
+}
+
+/**
+ * A register holding operand `x`: x itself, $zero, or $at loaded with the
+ * immediate
+ */
+static string registerOperand(vector<Insn>& out, const string& x, bool& ok) {
+    if (isRegister(x)) return x;
+    int64_t value;
+    if (!parseImmediate(x, value)) {
+        ok = false;
+        return x;
+    }
+    if ((int32_t)value == 0) return "$zero";
+    loadImmediate(out, "$at", value);
+    return "$at";
+}
+
+/**
+ * Rewrite a memory operand into off(base) with a 16-bit offset, loading
+ * the high half of a label address into $at first
+ */
+static string memoryOperand(vector<Insn>& out, const string& address, bool& ok) {
+    string offset, base;
+    if (!splitAddress(address, offset, base)) {
+        ok = false;
+        return address;
+    }
+    int64_t value = 0;
+    bool numeric = offset.empty() || parseImmediate(offset, value);
+    if (numeric && fitsSigned16(value)) {
+        return number(value) + "(" + (base.empty() ? "$zero" : base) + ")";
+    }
+    add(out, "lui", "$at", "%hi(" + offset + ")");
+    if (!base.empty()) add(out, "addu", "$at", "$at", base);
+    return "%lo(" + offset + ")($at)";
+}
+
+struct AluOp {
+    const char* name;
+    const char* registerForm;
+    const char* immediateForm;   // NULL when there is none
+    bool zeroExtended;           // andi/ori/xori take 0..65535
+    bool negated;                // sub rd, rs, imm = addi rd, rs, -imm
+};
+
+static const AluOp aluOps[] = {
+    { "add", "add", "addi", false, false },       { "addi", "add", "addi", false, false },
+    { "addu", "addu", "addiu", false, false },    { "addiu", "addu", "addiu", false, false },
+    { "sub", "sub", "addi", false, true },        { "subu", "subu", "addiu", false, true },
+    { "and", "and", "andi", true, false },        { "andi", "and", "andi", true, false },
+    { "or", "or", "ori", true, false },           { "ori", "or", "ori", true, false },
+    { "xor", "xor", "xori", true, false },        { "xori", "xor", "xori", true, false },
+    { "nor", "nor", NULL, false, false },
+    { "slt", "slt", "slti", false, false },       { "slti", "slt", "slti", false, false },
+    { "sltu", "sltu", "sltiu", false, false },    { "sltiu", "sltu", "sltiu", false, false },
+};
+
+static const char* const shiftOps[][2] = {
+    { "sll", "sllv" }, { "srl", "srlv" }, { "sra", "srav" }
+};
+
+static bool expandAlu(const AluOp& alu, const string& rd, const string& rs, const string& x, vector<Insn>& out) {
+    if (isRegister(x)) {
+        add(out, alu.registerForm, rd, rs, x);
+        return true;
+    }
+    int64_t value;
+    if (!parseImmediate(x, value)) return false;
+    int64_t imm = alu.negated ? -value : value;
+    if (alu.immediateForm && (alu.zeroExtended ? fitsUnsigned16(imm) : fitsSigned16(imm))) {
+        add(out, alu.immediateForm, rd, rs, number(imm));
+    } else {
+        loadImmediate(out, "$at", value);
+        add(out, alu.registerForm, rd, rs, "$at");
+    }
+    return true;
+}
+
+/**
+ * Branch on rs <op> x with op one of lt, ge, gt, le (signed or not)
+ */
+static bool expandRelationalBranch(const string& op, const string& rs, const string& x, const string& label, vector<Insn>& out) {
+    bool isUnsigned = op.size() == 4;
+    string relation = op.substr(1, 2);
+    const char* slt = isUnsigned ? "sltu" : "slt";
+    const char* slti = isUnsigned ? "sltiu" : "slti";
+    int64_t value = 0;
+    bool immediate = !isRegister(x);
+    if (immediate && !parseImmediate(x, value)) return false;
+
+    // Signed comparisons with zero have their own instructions
+    if (!isUnsigned && (x == "$zero" || (immediate && (int32_t)value == 0))) {
+        add(out, relation == "lt" ? "bltz" : relation == "ge" ? "bgez" : relation == "gt" ? "bgtz" : "blez", rs, label);
+        return true;
+    }
+    // $at = rs < x  (lt, ge)  or  $at = x < rs  (gt, le); rs <= imm is rs < imm + 1
+    bool takenWhenSet = relation == "lt" || relation == "gt";
+    bool swapped = relation == "gt" || relation == "le";
+    if (immediate && !swapped && fitsSigned16(value)) {
+        add(out, slti, "$at", rs, number(value));
+    } else if (immediate && swapped && fitsSigned16(value + 1) && (!isUnsigned || (uint32_t)value != 0xffffffffu)) {
+        add(out, slti, "$at", rs, number(value + 1));
+        takenWhenSet = !takenWhenSet;
+    } else {
+        bool ok = true;
+        string rt = registerOperand(out, x, ok);
+        if (swapped) add(out, slt, "$at", rt, rs);
+        else add(out, slt, "$at", rs, rt);
+    }
+    add(out, takenWhenSet ? "bne" : "beq", "$at", "$zero", label);
+    return true;
+}
+
+/**
+ * rd = rs <op> x with op one of seq, sne, sgt, sge, sle (signed or not)
+ */
+static bool expandSet(const string& op, const string& rd, const string& rs, const string& x, vector<Insn>& out) {
+    int64_t value = 0;
+    bool immediate = !isRegister(x);
+    if (immediate && !parseImmediate(x, value)) return false;
+    bool ok = true;
+
+    if (op == "seq" || op == "sne") {
+        string difference = rs;
+        if (immediate && fitsUnsigned16(value) && value != 0) {
+            add(out, "xori", rd, rs, number(value));
+            difference = rd;
+        } else if (x != "$zero" && !(immediate && value == 0)) {
+            add(out, "xor", rd, rs, registerOperand(out, x, ok));
+            difference = rd;
+        }
+        if (op == "seq") add(out, "sltiu", rd, difference, "1");
+        else add(out, "sltu", rd, "$zero", difference);
+        return ok;
+    }
+
+    bool isUnsigned = op.size() == 4;
+    const char* slt = isUnsigned ? "sltu" : "slt";
+    const char* slti = isUnsigned ? "sltiu" : "slti";
+    string relation = op.substr(1, 2);
+    if (relation == "gt") {
+        add(out, slt, rd, registerOperand(out, x, ok), rs);
+    } else if (relation == "ge") {
+        if (immediate && fitsSigned16(value)) add(out, slti, rd, rs, number(value));
+        else add(out, slt, rd, rs, registerOperand(out, x, ok));
+        add(out, "xori", rd, rd, "1");
+    } else if (relation == "le") {
+        if (immediate && fitsSigned16(value + 1) && (!isUnsigned || (uint32_t)value != 0xffffffffu)) {
+            add(out, slti, rd, rs, number(value + 1));
+        } else {
+            add(out, slt, rd, registerOperand(out, x, ok), rs);
+            add(out, "xori", rd, rd, "1");
+        }
+    } else {
+        return false;
+    }
+    return ok;
+}
+
+/**
+ * Lower one SPIM instruction into machine instructions. Returns false when
+ * the instruction is not understood.
+ */
+static bool expand(const string& op, vector<string> ops, vector<Insn>& out) {
+    size_t n = ops.size();
+    bool ok = true;
+
+    for (size_t a = 0; a < sizeof(aluOps) / sizeof(aluOps[0]); a++) {
+        if (op != aluOps[a].name) continue;
+        if (n == 2) ops.insert(ops.begin() + 1, ops[0]);    // op rd, x = op rd, rd, x
+        return ops.size() == 3 && expandAlu(aluOps[a], ops[0], ops[1], ops[2], out);
+    }
+    for (size_t s = 0; s < sizeof(shiftOps) / sizeof(shiftOps[0]); s++) {
+        if (op != shiftOps[s][0] && op != shiftOps[s][1]) continue;
+        if (n != 3) return false;
+        add(out, isRegister(ops[2]) ? shiftOps[s][1] : shiftOps[s][0], ops[0], ops[1], ops[2]);
+        return true;
+    }
+
+    if (op == "move" && n == 2) {
+        add(out, "addu", ops[0], ops[1], "$zero");
+    } else if ((op == "neg" || op == "negu") && n == 2) {
+        add(out, op == "neg" ? "sub" : "subu", ops[0], "$zero", ops[1]);
+    } else if (op == "not" && n == 2) {
+        add(out, "nor", ops[0], ops[1], "$zero");
+    } else if (op == "abs" && n == 2) {
+        add(out, "sra", "$at", ops[1], "31");
+        add(out, "xor", ops[0], ops[1], "$at");
+        add(out, "subu", ops[0], ops[0], "$at");
+    } else if (op == "li" && n == 2) {
+        int64_t value;
+        if (!parseImmediate(ops[1], value)) return false;
+        loadImmediate(out, ops[0], value);
+    } else if (op == "la" && n == 2) {
+        string offset, base;
+        int64_t value = 0;
+        if (!splitAddress(ops[1], offset, base)) return false;
+        if (!base.empty() && (offset.empty() || parseImmediate(offset, value)) && fitsSigned16(value)) {
+            add(out, "addiu", ops[0], base, number(value));
+        } else {
+            string high = base.empty() ? ops[0] : "$at";
+            add(out, "lui", high, "%hi(" + offset + ")");
+            add(out, "addiu", high, high, "%lo(" + offset + ")");
+            if (!base.empty()) add(out, "addu", ops[0], high, base);
+        }
+    } else if (op == "mul" && n == 3) {
+        add(out, "mul", ops[0], ops[1], registerOperand(out, ops[2], ok));
+    } else if ((op == "div" || op == "divu" || op == "mult" || op == "multu") && n == 3 && ops[0] == "$zero") {
+        add(out, op.c_str(), ops[0], ops[1], ops[2]);
+    } else if ((op == "div" || op == "divu" || op == "rem" || op == "remu") && (n == 2 || n == 3)) {
+        const char* divide = op == "div" || op == "rem" ? "div" : "divu";
+        if (n == 2) {
+            add(out, divide, "$zero", ops[0], registerOperand(out, ops[1], ok));
+        } else {
+            string dividend = ops[1];
+            string divisor = registerOperand(out, ops[2], ok);
+            add(out, divide, "$zero", dividend, divisor);
+            add(out, op[0] == 'd' ? "mflo" : "mfhi", ops[0]);
+        }
+    } else if ((op == "seq" || op == "sne" || op == "sgt" || op == "sgtu" || op == "sge" ||
+                op == "sgeu" || op == "sle" || op == "sleu") && n == 3) {
+        return expandSet(op, ops[0], ops[1], ops[2], out);
+    } else if (op == "b" && n == 1) {
+        add(out, "beq", "$zero", "$zero", ops[0]);
+    } else if ((op == "beqz" || op == "bnez") && n == 2) {
+        add(out, op == "beqz" ? "beq" : "bne", ops[0], "$zero", ops[1]);
+    } else if ((op == "beq" || op == "bne") && n == 3) {
+        string rt = registerOperand(out, ops[1], ok);
+        add(out, op.c_str(), ops[0], rt, ops[2]);
+    } else if ((op == "blt" || op == "bge" || op == "bgt" || op == "ble" || op == "bltu" ||
+                op == "bgeu" || op == "bgtu" || op == "bleu") && n == 3) {
+        return expandRelationalBranch(op, ops[0], ops[1], ops[2], out);
+    } else if ((op == "lw" || op == "lh" || op == "lhu" || op == "lb" || op == "lbu" || op == "sw" ||
+                op == "sh" || op == "sb" || op == "lwc1" || op == "swc1" || op == "l.s" || op == "s.s") && n == 2) {
+        const char* name = op == "l.s" ? "lwc1" : op == "s.s" ? "swc1" : op.c_str();
+        string address = memoryOperand(out, ops[1], ok);
+        add(out, name, ops[0], address);
+    } else if ((op == "l.d" || op == "s.d") && n == 2) {
+        // Two word accesses, low word first, so the pair only needs word alignment
+        string offset, base;
+        int64_t value = 0;
+        if (!splitAddress(ops[1], offset, base)) return false;
+        int reg = fpRegisterNumber(ops[0]);
+        if (reg < 0 || reg % 2 != 0) return false;
+        string high = offset.empty() || parseImmediate(offset, value) ? number(value + 4) : offset + "+4";
+        if (!base.empty()) high += "(" + base + ")";
+        const char* name = op == "l.d" ? "lwc1" : "swc1";
+        string address = memoryOperand(out, ops[1], ok);
+        add(out, name, ops[0], address);
+        address = memoryOperand(out, high, ok);
+        add(out, name, "$f" + number(reg + 1), address);
+    } else if (op == "li.s" && n == 2) {
+        char* end;
+        float value = strtof(ops[1].c_str(), &end);
+        if (*end != '\0') return false;
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        if (bits == 0) {
+            add(out, "mtc1", "$zero", ops[0]);
+        } else {
+            loadImmediate(out, "$at", (int32_t)bits);
+            add(out, "mtc1", "$at", ops[0]);
+        }
+    } else {
+        // Already a machine instruction
+        for (size_t m = 0; m < sizeof(machineOps) / sizeof(machineOps[0]); m++) {
+            if (op == machineOps[m].name) {
+                Insn insn;
+                insn.op = op;
+                insn.operands = ops;
+                out.push_back(insn);
+                return true;
+            }
+        }
+        return false;
+    }
+    return ok;
+}
+
+/* ========== Dependences ========== */
+
+static uint64_t regBit(const string& token) {
+    int r = registerNumber(token);
+    return r > 0 ? 1ull << r : 0;
+}
+
+static uint64_t fpRegBit(const string& token) {
+    int r = fpRegisterNumber(token);
+    return r >= 0 ? 1ull << FP_REG(r) : 0;
+}
+
+// An FP operand, or both registers of a double pair
+static uint64_t fpOperandBits(const string& token, unsigned pairs, int operand) {
+    uint64_t bits = fpRegBit(token);
+    return (pairs >> operand) & 1 ? bits | bits << 1 : bits;
+}
+
+static uint64_t baseBit(const string& address) {
+    string offset, base;
+    return splitAddress(address, offset, base) ? regBit(base) : 0;
+}
+
+/**
+ * Fill in what a machine instruction reads and writes. Instructions whose
+ * operands do not match their shape are left immovable.
+ */
+static void analyze(const Insn& insn, const MIPSPipelineModel& model, AsmLine& line) {
+    const vector<string>& o = insn.operands;
+    size_t n = o.size();
+    Shape shape = S_SYSCALL;
+    unsigned pairs = 0;
+    for (size_t m = 0; m < sizeof(machineOps) / sizeof(machineOps[0]); m++) {
+        if (insn.op == machineOps[m].name) {
+            shape = machineOps[m].shape;
+            pairs = machineOps[m].pairs;
+            break;
+        }
+    }
+    line.movable = true;
+    switch (shape) {
+        case S_NONE:                     // Nothing to gain from moving a nop
+            line.movable = false;
+            return;
+        case S_SYSCALL:
+            break;
+        case S_RRR:
+            if (n != 3) break;
+            line.defRegs = regBit(o[0]);
+            line.useRegs = regBit(o[1]) | regBit(o[2]);
+            if (insn.op == "mul") line.defRes = RES_HILO;
+            return;
+        case S_RRI:
+            if (n != 3) break;
+            line.defRegs = regBit(o[0]);
+            line.useRegs = regBit(o[1]);
+            return;
+        case S_RI:
+            if (n != 2) break;
+            line.defRegs = regBit(o[0]);
+            return;
+        case S_HILO:
+            for (size_t i = 0; i < n; i++) line.useRegs |= regBit(o[i]);
+            line.defRes = RES_HILO;
+            line.extraLatency = insn.op.compare(0, 3, "div") == 0 ? model.divideLatency : model.multiplyLatency;
+            return;
+        case S_MFHILO:
+            if (n != 1) break;
+            line.defRegs = regBit(o[0]);
+            line.useRes = RES_HILO;
+            return;
+        case S_MTHILO:
+            if (n != 1) break;
+            line.useRegs = regBit(o[0]);
+            line.defRes = RES_HILO;
+            return;
+        case S_BR2:
+            line.transfer = true;
+            if (n == 3) line.useRegs = regBit(o[0]) | regBit(o[1]);
+            return;
+        case S_BR1:
+            line.transfer = true;
+            if (n == 2) line.useRegs = regBit(o[0]);
+            return;
+        case S_BC:
+            line.transfer = true;
+            line.useRes = RES_FCC;
+            return;
+        case S_J:
+            line.transfer = true;
+            return;
+        case S_JAL:
+            line.transfer = true;
+            line.defRegs = 1ull << REG_RA;
+            return;
+        case S_JR:
+            line.transfer = true;
+            if (n == 1) line.useRegs = regBit(o[0]);
+            return;
+        case S_JALR:
+            line.transfer = true;
+            line.defRegs = n == 2 ? regBit(o[0]) : 1ull << REG_RA;
+            line.useRegs = regBit(o[n - 1]);
+            return;
+        case S_LOAD:
+        case S_FLOAD:
+            if (n != 2) break;
+            line.defRegs = shape == S_LOAD ? regBit(o[0]) : fpRegBit(o[0]);
+            line.useRegs = baseBit(o[1]);
+            line.useRes = RES_MEM;
+            line.extraLatency = model.loadLatency;
+            return;
+        case S_STORE:
+        case S_FSTORE:
+            if (n != 2) break;
+            line.useRegs = (shape == S_STORE ? regBit(o[0]) : fpRegBit(o[0])) | baseBit(o[1]);
+            line.defRes = RES_MEM;
+            return;
+        case S_FFF:
+            if (n != 3) break;
+            line.defRegs = fpOperandBits(o[0], pairs, 0);
+            line.useRegs = fpOperandBits(o[1], pairs, 1) | fpOperandBits(o[2], pairs, 2);
+            return;
+        case S_FF:
+            if (n != 2) break;
+            line.defRegs = fpOperandBits(o[0], pairs, 0);
+            line.useRegs = fpOperandBits(o[1], pairs, 1);
+            return;
+        case S_FCMP:
+            if (n != 2) break;
+            line.useRegs = fpOperandBits(o[0], pairs, 0) | fpOperandBits(o[1], pairs, 1);
+            line.defRes = RES_FCC;
+            return;
+        case S_MTC1:
+            if (n != 2) break;
+            line.useRegs = regBit(o[0]);
+            line.defRegs = fpRegBit(o[1]);
+            return;
+        case S_MFC1:
+            if (n != 2) break;
+            line.defRegs = regBit(o[0]);
+            line.useRegs = fpRegBit(o[1]);
+            return;
+    }
+    line.movable = false;
+    line.barrier = true;
+}
+
+
+static MemoryRef memoryRef(const string& op, const string& address) {
+    MemoryRef ref = MemoryRef();
+    ref.kind = MEM_UNKNOWN;
+    ref.size = op[1] == 'b' ? 1 : op[1] == 'h' ? 2 : 4;
+    if (op == "l.d" || op == "s.d" || op == "ldc1" || op == "sdc1") ref.size = 8;  // Both words of a pair
+    string offset, base;
+    if (!splitAddress(address, offset, base)) return ref;
+    int64_t value = 0;
+    bool numeric = offset.empty() || parseImmediate(offset, value);
+    int reg = base.empty() ? 0 : registerNumber(base);
+    if (numeric && (reg == 29 || reg == 30)) {
+        ref.kind = MEM_FRAME;
+        ref.base = reg;
+        ref.offset = value;
+    } else if (!numeric && base.empty()) {
+        // label, label+n, label-n
+        size_t sign = offset.find_first_of("+-", 1);
+        if (sign != string::npos && !parseImmediate(trim(offset.substr(sign + (offset[sign] == '+' ? 1 : 0))), value)) {
+            return ref;
+        }
+        ref.kind = MEM_STATIC;
+        ref.label = trim(offset.substr(0, sign));
+        ref.offset = sign == string::npos ? 0 : value;
+    }
+    return ref;
+}
+
+static bool mayAlias(const MemoryRef& a, const MemoryRef& b) {
+    if (a.kind == MEM_UNKNOWN || b.kind == MEM_UNKNOWN) return true;
+    if (a.kind != b.kind) return false;                  // Stack and static data
+    if (a.kind == MEM_FRAME && a.base != b.base) return true;
+    if (a.kind == MEM_STATIC && a.label != b.label) return false;
+    return a.offset < b.offset + b.size && b.offset < a.offset + a.size;
+}
+
+// `later` may not move above `earlier`, or the other way round
+static bool dependent(const AsmLine& earlier, const AsmLine& later) {
+    if ((earlier.defRegs & (later.useRegs | later.defRegs)) || (earlier.useRegs & later.defRegs)) return true;
+    unsigned resources = (earlier.defRes & (later.useRes | later.defRes)) | (earlier.useRes & later.defRes);
+    if (resources & ~RES_MEM) return true;
+    // Two accesses through the same base register are ordered by that
+    // register's dependences whenever it changes in between
+    return (resources & RES_MEM) && mayAlias(earlier.memory, later.memory);
+}
+
+// Cycles from issuing `producer` until `consumer` can issue without a stall
+static int issueDistance(const AsmLine& producer, const AsmLine& consumer) {
+    bool waits = (producer.defRegs & consumer.useRegs) ||
+                 (producer.defRes & (consumer.useRes | consumer.defRes) & RES_HILO);
+    return waits ? 1 + producer.extraLatency : 1;
+}
+
+/* ========== Delay slots ========== */
+
+/**
+ * Move the closest instruction before the branch at lines.back() that is
+ * independent of everything between it and the branch, and of the branch
+ * itself, into the branch's delay slot; append a nop when there is none
+ */
+static void fillDelaySlot(vector<AsmLine>& lines, MIPSTextStats& stats) {
+    size_t branch = lines.size() - 1;
+    AsmLine& transfer = lines[branch];
+    stats.delaySlots++;
+
+    int seen = 0;
+    for (size_t i = branch; i-- > 0 && seen < SLOT_SEARCH_WINDOW; ) {
+        const AsmLine& candidate = lines[i];
+        if (candidate.boundary) break;
+        if (!candidate.instruction) continue;
+        if (candidate.transfer || candidate.inSlot || candidate.barrier) break;
+        seen++;
+        if (!candidate.movable) continue;
+        bool blocked = dependent(candidate, transfer);
+        for (size_t j = i + 1; j < branch && !blocked; j++) {
+            blocked = lines[j].instruction && dependent(candidate, lines[j]);
+        }
+        if (blocked) continue;
+
+        AsmLine slot = candidate;
+        slot.inSlot = true;
+        lines.erase(lines.begin() + i);
+        lines.push_back(slot);
+        stats.filledSlots++;
+        return;
+    }
+
+    AsmLine nop = AsmLine();
+    nop.text = "    nop";
+    nop.instruction = true;
+    nop.inSlot = true;
+    lines.push_back(nop);
+}
+
+static void fillDelaySlots(vector<AsmLine>& lines, MIPSTextStats& stats) {
+    vector<AsmLine> filled;
+    filled.reserve(lines.size() + lines.size() / 4);
+    for (size_t i = 0; i < lines.size(); i++) {
+        filled.push_back(lines[i]);
+        if (lines[i].transfer) fillDelaySlot(filled, stats);
+    }
+    lines.swap(filled);
+}
+
+/* ========== Scheduling ========== */
+
+// Longer straight-line runs are scheduled in pieces of this many instructions
+#define MAX_SCHEDULE_BLOCK 128
+
+struct ScheduleEdge {
+    int to;
+    int distance;
+};
+
+// Stall cycles of issuing the instructions in `order` one per cycle
+static long long countStalls(const vector<int>& order, const vector<vector<ScheduleEdge> >& successors) {
+    vector<long long> earliest(order.size(), 0);
+    long long cycle = 0, stalls = 0;
+    for (size_t k = 0; k < order.size(); k++) {
+        int node = order[k];
+        long long issue = earliest[node] > cycle ? earliest[node] : cycle;
+        stalls += issue - cycle;
+        cycle = issue + 1;
+        for (size_t e = 0; e < successors[node].size(); e++) {
+            const ScheduleEdge& edge = successors[node][e];
+            if (issue + edge.distance > earliest[edge.to]) earliest[edge.to] = issue + edge.distance;
+        }
+    }
+    return stalls;
+}
+
+/**
+ * List-schedule the instructions of lines[begin, end). Comments and blank
+ * lines travel with the instruction after them; a branch or jump at the
+ * end stays last. Each cycle the ready instruction with the longest
+ * latency-weighted path to the end of the block issues, preferring source
+ * order on ties; the original order is kept unless the new one stalls less
+ * under the pipeline model.
+ */
+static void scheduleBlock(vector<AsmLine>& lines, size_t begin, size_t end, vector<AsmLine>& out, MIPSTextStats& stats) {
+    vector<size_t> nodes;                // Line index of each instruction
+    for (size_t i = begin; i < end; i++) {
+        if (lines[i].instruction) nodes.push_back(i);
+    }
+    int n = (int)nodes.size();
+    size_t trailing = n ? nodes[n - 1] + 1 : begin;
+    vector<int> order(n);
+    for (int i = 0; i < n; i++) order[i] = i;
+
+    if (n > 2) {
+        bool fixedLast = lines[nodes[n - 1]].transfer;
+        vector<vector<ScheduleEdge> > successors(n);
+        vector<int> predecessors(n, 0);
+        for (int i = 0; i < n; i++) {
+            for (int j = i + 1; j < n; j++) {
+                const AsmLine& a = lines[nodes[i]];
+                const AsmLine& b = lines[nodes[j]];
+                if (dependent(a, b) || (fixedLast && j == n - 1)) {
+                    ScheduleEdge edge = { j, issueDistance(a, b) };
+                    successors[i].push_back(edge);
+                    predecessors[j]++;
+                }
+            }
+        }
+        vector<int> height(n, 0);
+        for (int i = n - 1; i >= 0; i--) {
+            height[i] = 1 + lines[nodes[i]].extraLatency;
+            for (size_t e = 0; e < successors[i].size(); e++) {
+                int h = successors[i][e].distance + height[successors[i][e].to];
+                if (h > height[i]) height[i] = h;
+            }
+        }
+
+        vector<int> scheduled;
+        vector<long long> earliest(n, 0);
+        vector<bool> done(n, false);
+        long long cycle = 0;
+        while ((int)scheduled.size() < n) {
+            int best = -1;
+            for (int i = 0; i < n; i++) {
+                if (done[i] || predecessors[i] > 0) continue;
+                if (best < 0) {
+                    best = i;
+                    continue;
+                }
+                bool ready = earliest[i] <= cycle, bestReady = earliest[best] <= cycle;
+                if (ready != bestReady) {
+                    if (ready) best = i;
+                } else if (!ready && earliest[i] != earliest[best]) {
+                    if (earliest[i] < earliest[best]) best = i;
+                } else if (height[i] > height[best]) {
+                    best = i;
+                }
+            }
+            long long issue = earliest[best] > cycle ? earliest[best] : cycle;
+            cycle = issue + 1;
+            done[best] = true;
+            scheduled.push_back(best);
+            for (size_t e = 0; e < successors[best].size(); e++) {
+                const ScheduleEdge& edge = successors[best][e];
+                if (issue + edge.distance > earliest[edge.to]) earliest[edge.to] = issue + edge.distance;
+                predecessors[edge.to]--;
+            }
+        }
+
+        long long before = countStalls(order, successors);
+        long long after = countStalls(scheduled, successors);
+        stats.stallsBefore += before;
+        if (after < before) {
+            order = scheduled;
+            stats.scheduledBlocks++;
+        }
+        stats.stallsAfter += after < before ? after : before;
+    }
+
+    for (int k = 0; k < n; k++) {
+        size_t node = nodes[order[k]];
+        size_t first = order[k] == 0 ? begin : nodes[order[k] - 1] + 1;
+        for (size_t i = first; i <= node; i++) out.push_back(lines[i]);
+    }
+    for (size_t i = trailing; i < end; i++) out.push_back(lines[i]);
+}
+
+/**
+ * Schedule every straight-line run between labels, directives, branches,
+ * jumps and syscalls
+ */
+static void scheduleBlocks(vector<AsmLine>& lines, MIPSTextStats& stats) {
+    vector<AsmLine> out;
+    out.reserve(lines.size());
+    size_t begin = 0;
+    int count = 0;
+    for (size_t i = 0; i < lines.size(); i++) {
+        const AsmLine& line = lines[i];
+        if (line.boundary || line.barrier) {
+            scheduleBlock(lines, begin, i, out, stats);
+            out.push_back(line);
+            begin = i + 1;
+            count = 0;
+        } else if (line.transfer || (line.instruction && ++count == MAX_SCHEDULE_BLOCK)) {
+            scheduleBlock(lines, begin, i + 1, out, stats);
+            begin = i + 1;
+            count = 0;
+        }
+    }
+    scheduleBlock(lines, begin, lines.size(), out, stats);
+    lines.swap(out);
+}
+
+/* ========== Driver ========== */
+
+static string render(const string& indent, const Insn& insn) {
+    string text = indent + insn.op;
+    for (size_t i = 0; i < insn.operands.size(); i++) {
+        text += i ? ", " : " ";
+        text += insn.operands[i];
+    }
+    return text;
+}
+
+/**
+ * mul and three-operand div/rem on registers as mult/div and mflo/mfhi,
+ * so the scheduler can put independent instructions in between
+ */
+static bool splitHiLo(const string& op, const vector<string>& ops, vector<Insn>& out) {
+    if (ops.size() != 3 || ops[0] == "$zero" || !isRegister(ops[0]) || !isRegister(ops[1]) || !isRegister(ops[2])) {
+        return false;
+    }
+    if (op == "mul") {
+        add(out, "mult", ops[1], ops[2]);
+        add(out, "mflo", ops[0]);
+    } else if (op == "div" || op == "divu" || op == "rem" || op == "remu") {
+        add(out, op == "div" || op == "rem" ? "div" : "divu", ops[1], ops[2]);
+        add(out, op[0] == 'd' ? "mflo" : "mfhi", ops[0]);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static void lowerLine(const string& raw, const MIPSTextOptions& options, vector<AsmLine>& lines) {
+    AsmLine line = AsmLine();
+    size_t comment = commentStart(raw);
+    string code = trim(comment == string::npos ? raw : raw.substr(0, comment));
+    line.text = raw;
+    if (code.empty()) {
+        lines.push_back(line);
+        return;
+    }
+    if (code[0] == '.' || code[code.size() - 1] == ':') {
+        line.boundary = true;
+        lines.push_back(line);
+        return;
+    }
+
+    size_t space = code.find_first_of(" \t");
+    string op = code.substr(0, space);
+    vector<string> ops = splitOperands(space == string::npos ? "" : trim(code.substr(space + 1)));
+    string indent = raw.substr(0, raw.find_first_not_of(" \t"));
+    string trailer;
+    if (comment != string::npos) {
+        size_t codeEnd = raw.find_last_not_of(" \t", comment - 1);
+        trailer = raw.substr(codeEnd == string::npos ? comment : codeEnd + 1);
+        while (!trailer.empty() && (trailer[trailer.size() - 1] == '\r' || trailer[trailer.size() - 1] == '\n')) {
+            trailer.erase(trailer.size() - 1);
+        }
+    }
+    MemoryRef memory = ops.size() == 2 ? memoryRef(op, ops[1]) : MemoryRef();
+
+    vector<Insn> pieces;
+    bool split = options.schedule && splitHiLo(op, ops, pieces);
+    if (!split) {
+        Insn insn;
+        insn.op = op;
+        insn.operands = ops;
+        pieces.push_back(insn);
+    }
+    for (size_t p = 0; p < pieces.size(); p++) {
+        vector<Insn> expansion;
+        line = AsmLine();
+        line.instruction = true;
+        line.text = split ? render(indent, pieces[p]) + (p == 0 ? trailer : "") : raw;
+        if (!expand(pieces[p].op, pieces[p].operands, expansion)) {
+            // Copied unchanged; it stays where it is and nothing moves past it
+            line.barrier = true;
+            lines.push_back(line);
+            continue;
+        }
+
+        if (options.realMIPS) {
+            bool unchanged = !split && expansion.size() == 1 && expansion[0].op == op && expansion[0].operands == ops;
+            for (size_t e = 0; e < expansion.size(); e++) {
+                AsmLine lowered = AsmLine();
+                lowered.instruction = true;
+                lowered.text = unchanged ? raw : render(indent, expansion[e]) + (e == 0 && p == 0 ? trailer : "");
+                analyze(expansion[e], options.pipeline, lowered);
+                if (lowered.useRes & RES_MEM || lowered.defRes & RES_MEM) lowered.memory = memory;
+                lines.push_back(lowered);
+            }
+            continue;
+        }
+
+        // SPIM expands the pseudo-instruction itself: it reads and writes
+        // what its expansion does, except for the assembler temporary
+        line.movable = true;
+        for (size_t e = 0; e < expansion.size(); e++) {
+            AsmLine part = AsmLine();
+            analyze(expansion[e], options.pipeline, part);
+            line.useRegs |= part.useRegs;
+            line.defRegs |= part.defRegs;
+            line.useRes |= part.useRes;
+            line.defRes |= part.defRes;
+            line.transfer = line.transfer || part.transfer;
+            line.barrier = line.barrier || part.barrier;
+            line.movable = line.movable && part.movable;
+            if (part.extraLatency > line.extraLatency) line.extraLatency = part.extraLatency;
+        }
+        line.useRegs &= ~(1ull << REG_AT);
+        line.defRegs &= ~(1ull << REG_AT);
+        if (line.useRes & RES_MEM || line.defRes & RES_MEM) line.memory = memory;
+        lines.push_back(line);
+    }
+}
+
+char* rewriteMIPSText(const char* text, size_t length, const MIPSTextOptions* options, size_t* outLength, MIPSTextStats* stats) {
+    MIPSTextStats counts = MIPSTextStats();
+    vector<AsmLine> lines;
+    size_t start = 0;
+    while (start < length) {
+        const char* newline = (const char*)memchr(text + start, '\n', length - start);
+        size_t end = newline ? (size_t)(newline - text) : length;
+        lowerLine(string(text + start, end - start), *options, lines);
+        start = end + 1;
+    }
+    if (options->schedule) scheduleBlocks(lines, counts);
+    if (options->realMIPS) fillDelaySlots(lines, counts);
+
+    size_t size = 0;
+    for (size_t i = 0; i < lines.size(); i++) {
+        size += lines[i].text.size() + 1;
+    }
+    char* result = (char*)malloc(size + 1);
+    if (!result) return NULL;
+    char* p = result;
+    for (size_t i = 0; i < lines.size(); i++) {
+        memcpy(p, lines[i].text.data(), lines[i].text.size());
+        p += lines[i].text.size();
+        *p++ = '\n';
+    }
+    *p = '\0';
+    if (outLength) *outLength = size;
+    if (stats) *stats = counts;
+    return result;
+}
@@ -0,0 +1,65 @@
+/**
+ * Real-MIPS Lowering and Block Scheduling
+ * Post-passes over the .text produced by the code generator.
+ *
+ * Lowering rewrites the SPIM-style text for hardware that executes branch
+ * delay slots: pseudo-instructions (li, la, move, blt/bge/..., seq/sge/...,
+ * three-operand div/rem, immediates out of range) become the machine
+ * instructions they stand for, using $at as the assembler temporary, and
+ * the slot after every branch and jump is filled with an earlier
+ * independent instruction of the same block, or nop. The result is meant
+ * to be assembled with ".set noreorder" / ".set noat".
+ *
+ * Scheduling reorders the instructions of each straight-line block, on a
+ * dependence graph of registers, HI/LO, the FP condition flag and memory,
+ * so loads and multiply/divide results are not read right after they are
+ * produced. mul and three-operand div/rem are split into mult/div and
+ * mflo/mfhi for this.
+ */
+
+#ifndef MIPS_LOWERING_H
+#define MIPS_LOWERING_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Latencies the scheduler plans for. The defaults of the built-in
+ * simulator are 1, 11 and 34.
+ */
+typedef struct MIPSPipelineModel {
+    int loadLatency;                 // Stall cycles when the next instruction uses a loaded value
+    int multiplyLatency;             // Cycles after mult/multu before mfhi/mflo can read HI/LO
+    int divideLatency;               // Likewise for div/divu
+} MIPSPipelineModel;
+
+typedef struct MIPSTextOptions {
+    int realMIPS;                    // Expand pseudo-instructions and fill delay slots
+    int schedule;                    // Reorder each block for `pipeline`
+    MIPSPipelineModel pipeline;
+} MIPSTextOptions;
+
+typedef struct MIPSTextStats {
+    int delaySlots;                  // Branches and jumps
+    int filledSlots;                 // Delay slots holding a useful instruction
+    int scheduledBlocks;             // Blocks whose instructions were reordered
+    long long stallsBefore;          // Model stall cycles, one pass through every block
+    long long stallsAfter;
+} MIPSTextStats;
+
+/**
+ * Rewrite `length` bytes of assembly text. Returns a malloc'd,
+ * NUL-terminated buffer (its length in *outLength), or NULL when out of
+ * memory. Lines the passes do not understand are copied unchanged and
+ * nothing moves across them. `stats` may be NULL.
+ */
+char* rewriteMIPSText(const char* text, size_t length, const MIPSTextOptions* options, size_t* outLength, MIPSTextStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MIPS_LOWERING_H
@@ -0,0 +1,1419 @@
+#include "mips_simulator.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+
+using namespace std;
+
+// SPIM memory layout
+#define TEXT_BASE   0x00400000u
+#define DATA_BASE   0x10000000u      // Start of the data segment ($gp area)
+#define STATIC_BASE 0x10010000u      // Where .data is laid out
+#define DATA_LIMIT  0x20000000u      // sbrk never grows the data segment past this
+#define STACK_TOP   0x80000000u
+#define STACK_SIZE  (8u << 20)
+#define INITIAL_SP  0x7fffeffcu
+
+// Extra cycles on top of the one every machine instruction takes
+#define MUL_LATENCY      11
+#define DIV_LATENCY      34
+#define FP_ADD_LATENCY   1
+#define FP_MUL_LATENCY   3
+#define FP_DIV_LATENCY   11
+#define LOAD_USE_STALL   1
+#define TAKEN_PENALTY    1
+
+enum SimOp {
+    OP_NOP, OP_SYSCALL,
+    // Integer arithmetic and logic: rd = rs op (rt | imm)
+    OP_ADD, OP_SUB, OP_AND, OP_OR, OP_XOR, OP_NOR, OP_SLT, OP_SLTU,
+    OP_SLL, OP_SRL, OP_SRA, OP_MUL, OP_DIV, OP_DIVU, OP_REM, OP_REMU,
+    OP_SEQ, OP_SNE, OP_SLE, OP_SLEU, OP_SGT, OP_SGTU, OP_SGE, OP_SGEU,
+    OP_ABS, OP_LI, OP_LUI,
+    // HI/LO
+    OP_MULT, OP_MULTU, OP_DIV2, OP_DIVU2, OP_MFHI, OP_MFLO, OP_MTHI, OP_MTLO,
+    // Control flow: branches compare rs with (rt | imm)
+    OP_BEQ, OP_BNE, OP_BLT, OP_BLE, OP_BGT, OP_BGE, OP_BLTU, OP_BLEU, OP_BGTU, OP_BGEU,
+    OP_J, OP_JAL, OP_JR, OP_JALR,
+    // Memory: address = rs + imm
+    OP_LW, OP_LH, OP_LHU, OP_LB, OP_LBU, OP_SW, OP_SH, OP_SB, OP_LWC1, OP_SWC1,
+    OP_LDC1, OP_SDC1,
+    // FPU (single precision)
+    OP_ADD_S, OP_SUB_S, OP_MUL_S, OP_DIV_S, OP_NEG_S, OP_ABS_S, OP_MOV_S, OP_SQRT_S,
+    OP_CVT_S_W, OP_CVT_W_S, OP_C_EQ_S, OP_C_LT_S, OP_C_LE_S, OP_BC1T, OP_BC1F,
+    OP_MTC1, OP_MFC1, OP_LI_S,
+    // FPU (double precision, even/odd register pairs)
+    OP_ADD_D, OP_SUB_D, OP_MUL_D, OP_DIV_D, OP_NEG_D, OP_ABS_D, OP_MOV_D, OP_SQRT_D,
+    OP_CVT_D_S, OP_CVT_S_D, OP_CVT_D_W, OP_CVT_W_D, OP_C_EQ_D, OP_C_LT_D, OP_C_LE_D
+};
+
+// Operand layouts
+enum SimFormat {
+    F_NONE,      //
+    F_RRX,       // rd, rs, rt|imm       (rd, rt|imm when two operands: rd is also rs)
+    F_RR,        // rd, rs
+    F_RI,        // rd, imm
+    F_LA,        // rd, address
+    F_HILO,      // rs, rt
+    F_RD,        // rd
+    F_RS,        // rs
+    F_BR2,       // rs, rt|imm, label
+    F_BR1,       // rs, label            (compared with $zero)
+    F_LABEL,     // label
+    F_JALR,      // rs  |  rd, rs
+    F_MEM,       // rt, address
+    F_FMEM,      // ft, address
+    F_FFF,       // fd, fs, ft
+    F_FF,        // fd, fs
+    F_FCMP,      // fs, ft
+    F_RF,        // rt, fs               (mtc1 / mfc1)
+    F_FIMM       // fd, float
+};
+
+struct Mnemonic {
+    const char* name;
+    SimOp op;
+    SimFormat format;
+    int machineCount;            // SPIM expansion of the pseudo-instruction
+    int pairs;                   // Bit i: FP operand i names an even/odd double pair
+};
+
+static const Mnemonic mnemonics[] = {
+    { "nop", OP_NOP, F_NONE, 1 },        { "syscall", OP_SYSCALL, F_NONE, 1 },
+    { "add", OP_ADD, F_RRX, 1 },         { "addu", OP_ADD, F_RRX, 1 },
+    { "addi", OP_ADD, F_RRX, 1 },        { "addiu", OP_ADD, F_RRX, 1 },
+    { "sub", OP_SUB, F_RRX, 1 },         { "subu", OP_SUB, F_RRX, 1 },
+    { "and", OP_AND, F_RRX, 1 },         { "andi", OP_AND, F_RRX, 1 },
+    { "or", OP_OR, F_RRX, 1 },           { "ori", OP_OR, F_RRX, 1 },
+    { "xor", OP_XOR, F_RRX, 1 },         { "xori", OP_XOR, F_RRX, 1 },
+    { "nor", OP_NOR, F_RRX, 1 },
+    { "slt", OP_SLT, F_RRX, 1 },         { "slti", OP_SLT, F_RRX, 1 },
+    { "sltu", OP_SLTU, F_RRX, 1 },       { "sltiu", OP_SLTU, F_RRX, 1 },
+    { "sll", OP_SLL, F_RRX, 1 },         { "sllv", OP_SLL, F_RRX, 1 },
+    { "srl", OP_SRL, F_RRX, 1 },         { "srlv", OP_SRL, F_RRX, 1 },
+    { "sra", OP_SRA, F_RRX, 1 },         { "srav", OP_SRA, F_RRX, 1 },
+    { "mul", OP_MUL, F_RRX, 2 },
+    { "div", OP_DIV, F_RRX, 2 },         { "divu", OP_DIVU, F_RRX, 2 },
+    { "rem", OP_REM, F_RRX, 2 },         { "remu", OP_REMU, F_RRX, 2 },
+    { "seq", OP_SEQ, F_RRX, 3 },         { "sne", OP_SNE, F_RRX, 3 },
+    { "sle", OP_SLE, F_RRX, 3 },         { "sleu", OP_SLEU, F_RRX, 3 },
+    { "sgt", OP_SGT, F_RRX, 1 },         { "sgtu", OP_SGTU, F_RRX, 1 },
+    { "sge", OP_SGE, F_RRX, 3 },         { "sgeu", OP_SGEU, F_RRX, 3 },
+    { "move", OP_ADD, F_RR, 1 },         { "neg", OP_SUB, F_RR, 1 },
+    { "negu", OP_SUB, F_RR, 1 },         { "not", OP_NOR, F_RR, 1 },
+    { "abs", OP_ABS, F_RR, 3 },
+    { "li", OP_LI, F_RI, 1 },            { "lui", OP_LUI, F_RI, 1 },
+    { "la", OP_LI, F_LA, 2 },
+    { "mult", OP_MULT, F_HILO, 1 },      { "multu", OP_MULTU, F_HILO, 1 },
+    { "mfhi", OP_MFHI, F_RD, 1 },        { "mflo", OP_MFLO, F_RD, 1 },
+    { "mthi", OP_MTHI, F_RS, 1 },        { "mtlo", OP_MTLO, F_RS, 1 },
+    { "beq", OP_BEQ, F_BR2, 1 },         { "bne", OP_BNE, F_BR2, 1 },
+    { "blt", OP_BLT, F_BR2, 2 },         { "ble", OP_BLE, F_BR2, 2 },
+    { "bgt", OP_BGT, F_BR2, 2 },         { "bge", OP_BGE, F_BR2, 2 },
+    { "bltu", OP_BLTU, F_BR2, 2 },       { "bleu", OP_BLEU, F_BR2, 2 },
+    { "bgtu", OP_BGTU, F_BR2, 2 },       { "bgeu", OP_BGEU, F_BR2, 2 },
+    { "beqz", OP_BEQ, F_BR1, 1 },        { "bnez", OP_BNE, F_BR1, 1 },
+    { "bltz", OP_BLT, F_BR1, 1 },        { "blez", OP_BLE, F_BR1, 1 },
+    { "bgtz", OP_BGT, F_BR1, 1 },        { "bgez", OP_BGE, F_BR1, 1 },
+    { "b", OP_J, F_LABEL, 1 },           { "j", OP_J, F_LABEL, 1 },
+    { "jal", OP_JAL, F_LABEL, 1 },       { "jr", OP_JR, F_RS, 1 },
+    { "jalr", OP_JALR, F_JALR, 1 },
+    { "lw", OP_LW, F_MEM, 1 },           { "lh", OP_LH, F_MEM, 1 },
+    { "lhu", OP_LHU, F_MEM, 1 },         { "lb", OP_LB, F_MEM, 1 },
+    { "lbu", OP_LBU, F_MEM, 1 },         { "sw", OP_SW, F_MEM, 1 },
+    { "sh", OP_SH, F_MEM, 1 },           { "sb", OP_SB, F_MEM, 1 },
+    { "lwc1", OP_LWC1, F_FMEM, 1 },      { "l.s", OP_LWC1, F_FMEM, 1 },
+    { "swc1", OP_SWC1, F_FMEM, 1 },      { "s.s", OP_SWC1, F_FMEM, 1 },
+    { "add.s", OP_ADD_S, F_FFF, 1 },     { "sub.s", OP_SUB_S, F_FFF, 1 },
+    { "mul.s", OP_MUL_S, F_FFF, 1 },     { "div.s", OP_DIV_S, F_FFF, 1 },
+    { "neg.s", OP_NEG_S, F_FF, 1 },      { "abs.s", OP_ABS_S, F_FF, 1 },
+    { "mov.s", OP_MOV_S, F_FF, 1 },      { "sqrt.s", OP_SQRT_S, F_FF, 1 },
+    { "cvt.s.w", OP_CVT_S_W, F_FF, 1 },  { "cvt.w.s", OP_CVT_W_S, F_FF, 1 },
+    { "trunc.w.s", OP_CVT_W_S, F_FF, 1 },
+    { "c.eq.s", OP_C_EQ_S, F_FCMP, 1 },  { "c.lt.s", OP_C_LT_S, F_FCMP, 1 },
+    { "c.le.s", OP_C_LE_S, F_FCMP, 1 },
+    { "bc1t", OP_BC1T, F_LABEL, 1 },     { "bc1f", OP_BC1F, F_LABEL, 1 },
+    { "mtc1", OP_MTC1, F_RF, 1 },        { "mfc1", OP_MFC1, F_RF, 1 },
+    { "li.s", OP_LI_S, F_FIMM, 3 },
+    { "ldc1", OP_LDC1, F_FMEM, 1, 1 },   { "l.d", OP_LDC1, F_FMEM, 2, 1 },
+    { "sdc1", OP_SDC1, F_FMEM, 1, 1 },   { "s.d", OP_SDC1, F_FMEM, 2, 1 },
+    { "add.d", OP_ADD_D, F_FFF, 1, 7 },  { "sub.d", OP_SUB_D, F_FFF, 1, 7 },
+    { "mul.d", OP_MUL_D, F_FFF, 1, 7 },  { "div.d", OP_DIV_D, F_FFF, 1, 7 },
+    { "neg.d", OP_NEG_D, F_FF, 1, 3 },   { "abs.d", OP_ABS_D, F_FF, 1, 3 },
+    { "mov.d", OP_MOV_D, F_FF, 1, 3 },   { "sqrt.d", OP_SQRT_D, F_FF, 1, 3 },
+    { "cvt.d.s", OP_CVT_D_S, F_FF, 1, 1 }, { "cvt.s.d", OP_CVT_S_D, F_FF, 1, 2 },
+    { "cvt.d.w", OP_CVT_D_W, F_FF, 1, 1 }, { "cvt.w.d", OP_CVT_W_D, F_FF, 1, 2 },
+    { "trunc.w.d", OP_CVT_W_D, F_FF, 1, 2 },
+    { "c.eq.d", OP_C_EQ_D, F_FCMP, 1, 3 }, { "c.lt.d", OP_C_LT_D, F_FCMP, 1, 3 },
+    { "c.le.d", OP_C_LE_D, F_FCMP, 1, 3 },
+};
+
+// Registers are numbered 0-31 (integer) and 32-63 (FPU) in hazard masks
+#define FP_REG(n) ((n) + 32)
+
+struct SimInstruction {
+    SimOp op;
+    bool useImm;                 // Second source is `imm` rather than `rt`
+    uint8_t rd, rs, rt;
+    int32_t imm;
+    float fimm;
+    int target;                  // Instruction index of a branch/jump label
+    int machineCount;
+    int line;
+    int mnemonic;                // Index into mnemonics[]
+    uint64_t sources;            // Registers read, for the load-use stall
+    bool usesHiLo;               // Waits for an unfinished multiply or divide
+    int loadDest;                // Register written by a load, -1 otherwise
+};
+
+struct SourceLine {
+    string text;
+    int line;
+};
+
+struct Simulator {
+    const char* path;
+    SimulationOptions options;
+    FILE* in;
+    FILE* out;
+
+    vector<SimInstruction> text;
+    vector<SourceLine> textLines;
+    unordered_map<string, int> textLabels;
+    unordered_map<string, uint32_t> dataLabels;
+    vector<pair<uint32_t, pair<string, int> > > wordFixups;   // .word label
+
+    vector<uint8_t> data;        // DATA_BASE .. DATA_BASE + data.size()
+    uint32_t heapEnd;
+    vector<uint8_t> stack;       // STACK_TOP - STACK_SIZE .. STACK_TOP
+
+    uint32_t regs[32];
+    uint32_t fregs[32];
+    uint32_t hi, lo;
+    bool fcc;
+
+    vector<long long> executed;  // Per static instruction
+    SimulationStats stats;
+    bool delaySlots;             // ".set noreorder": branches and jumps take effect one instruction late
+};
+
+/* ========== Diagnostics ========== */
+
+static bool loadError(Simulator& sim, int line, const char* format, const string& detail) {
+    fprintf(stderr, "Simulator Error on line %d of %s: ", line, sim.path);
+    fprintf(stderr, format, detail.c_str());
+    fprintf(stderr, "\n");
+    return false;
+}
+
+/* ========== Lexical helpers ========== */
+
+static string trim(const string& s) {
+    size_t first = s.find_first_not_of(" \t\r\n");
+    if (first == string::npos) return "";
+    size_t last = s.find_last_not_of(" \t\r\n");
+    return s.substr(first, last - first + 1);
+}
+
+// Drop a '#' comment that is not inside a string or character literal
+static string stripComment(const string& line) {
+    char quote = 0;
+    for (size_t i = 0; i < line.size(); i++) {
+        char c = line[i];
+        if (quote) {
+            if (c == '\\') i++;
+            else if (c == quote) quote = 0;
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+        } else if (c == '#') {
+            return line.substr(0, i);
+        }
+    }
+    return line;
+}
+
+static vector<string> splitOperands(const string& s) {
+    vector<string> operands;
+    string current;
+    char quote = 0;
+    for (size_t i = 0; i < s.size(); i++) {
+        char c = s[i];
+        if (quote) {
+            current += c;
+            if (c == '\\' && i + 1 < s.size()) current += s[++i];
+            else if (c == quote) quote = 0;
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+            current += c;
+        } else if (c == ',') {
+            operands.push_back(trim(current));
+            current.clear();
+        } else {
+            current += c;
+        }
+    }
+    if (!trim(current).empty() || !operands.empty()) operands.push_back(trim(current));
+    return operands;
+}
+
+static bool isLabelChar(char c) {
+    return isalnum((unsigned char)c) || c == '_' || c == '.' || c == '$';
+}
+
+static int escapeValue(const string& s, size_t& i) {
+    char c = s[i++];
+    if (c != '\\' || i >= s.size()) return (unsigned char)c;
+    c = s[i++];
+    switch (c) {
+        case 'n': return '\n';
+        case 't': return '\t';
+        case 'r': return '\r';
+        case '0': return '\0';
+        case 'a': return '\a';
+        case 'b': return '\b';
+        case 'f': return '\f';
+        case 'v': return '\v';
+        default:  return (unsigned char)c;
+    }
+}
+
+static bool parseInteger(const string& token, int64_t& value) {
+    if (token.size() >= 3 && token[0] == '\'') {
+        size_t i = 1;
+        value = escapeValue(token, i);
+        return i < token.size() && token[i] == '\'';
+    }
+    if (token.empty()) return false;
+    char* end;
+    value = strtoll(token.c_str(), &end, 0);
+    return *end == '\0';
+}
+
+static const char* const regNames[32] = {
+    "zero", "at", "v0", "v1", "a0", "a1", "a2", "a3",
+    "t0", "t1", "t2", "t3", "t4", "t5", "t6", "t7",
+    "s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7",
+    "t8", "t9", "k0", "k1", "gp", "sp", "fp", "ra"
+};
+
+static bool parseRegister(const string& token, uint8_t& reg) {
+    if (token.size() < 2 || token[0] != '$') return false;
+    const char* name = token.c_str() + 1;
+    if (isdigit((unsigned char)name[0])) {
+        int n = atoi(name);
+        if (n < 0 || n > 31) return false;
+        reg = (uint8_t)n;
+        return true;
+    }
+    for (int r = 0; r < 32; r++) {
+        if (strcmp(name, regNames[r]) == 0) {
+            reg = (uint8_t)r;
+            return true;
+        }
+    }
+    if (strcmp(name, "s8") == 0) {
+        reg = 30;
+        return true;
+    }
+    return false;
+}
+
+static bool parseFPRegister(const string& token, uint8_t& reg) {
+    if (token.size() < 3 || token[0] != '$' || token[1] != 'f' || !isdigit((unsigned char)token[2])) return false;
+    int n = atoi(token.c_str() + 2);
+    if (n < 0 || n > 31) return false;
+    reg = (uint8_t)n;
+    return true;
+}
+
+/* ========== Memory ========== */
+
+static uint8_t* translate(Simulator& sim, uint32_t address, uint32_t size) {
+    if (address >= DATA_BASE && address - DATA_BASE + size <= sim.data.size()) {
+        return &sim.data[address - DATA_BASE];
+    }
+    if (address >= STACK_TOP - STACK_SIZE && address < STACK_TOP && STACK_TOP - address >= size) {
+        return &sim.stack[address - (STACK_TOP - STACK_SIZE)];
+    }
+    return NULL;
+}
+
+static uint32_t dataEnd(const Simulator& sim) {
+    return DATA_BASE + (uint32_t)sim.data.size();
+}
+
+static void appendData(Simulator& sim, const void* bytes, size_t size) {
+    const uint8_t* p = (const uint8_t*)bytes;
+    sim.data.insert(sim.data.end(), p, p + size);
+}
+
+static void alignData(Simulator& sim, uint32_t alignment) {
+    while (dataEnd(sim) % alignment != 0) sim.data.push_back(0);
+}
+
+/* ========== Loading ========== */
+
+static bool parseDataDirective(Simulator& sim, const string& directive, const string& rest, int line) {
+    if (directive == ".asciiz" || directive == ".ascii") {
+        string s = trim(rest);
+        if (s.size() < 2 || s[0] != '"' || s[s.size() - 1] != '"') {
+            return loadError(sim, line, "malformed string %s", s);
+        }
+        for (size_t i = 1; i < s.size() - 1; ) {
+            sim.data.push_back((uint8_t)escapeValue(s, i));
+        }
+        if (directive == ".asciiz") sim.data.push_back(0);
+    } else if (directive == ".word" || directive == ".half" || directive == ".byte") {
+        uint32_t size = directive == ".word" ? 4 : directive == ".half" ? 2 : 1;
+        alignData(sim, size);
+        vector<string> values = splitOperands(rest);
+        for (size_t v = 0; v < values.size(); v++) {
+            // "value:count" repeats a value
+            string item = values[v];
+            long long repeat = 1;
+            size_t colon = item.find(':');
+            if (colon != string::npos) {
+                repeat = atoll(item.c_str() + colon + 1);
+                item = trim(item.substr(0, colon));
+            }
+            int64_t value = 0;
+            if (!parseInteger(item, value)) {
+                if (size != 4 || item.empty() || !isLabelChar(item[0])) {
+                    return loadError(sim, line, "bad value %s", item);
+                }
+                sim.wordFixups.push_back(make_pair(dataEnd(sim), make_pair(item, line)));
+            }
+            for (long long r = 0; r < repeat; r++) {
+                uint32_t word = (uint32_t)value;
+                appendData(sim, &word, size);
+            }
+        }
+    } else if (directive == ".float") {
+        alignData(sim, 4);
+        vector<string> values = splitOperands(rest);
+        for (size_t v = 0; v < values.size(); v++) {
+            float value = strtof(values[v].c_str(), NULL);
+            appendData(sim, &value, sizeof(value));
+        }
+    } else if (directive == ".double") {
+        alignData(sim, 8);
+        vector<string> values = splitOperands(rest);
+        for (size_t v = 0; v < values.size(); v++) {
+            double value = strtod(values[v].c_str(), NULL);
+            appendData(sim, &value, sizeof(value));
+        }
+    } else if (directive == ".space") {
+        long long size = atoll(trim(rest).c_str());
+        if (size < 0 || dataEnd(sim) + size > DATA_LIMIT) {
+            return loadError(sim, line, "bad .space size %s", trim(rest));
+        }
+        sim.data.resize(sim.data.size() + (size_t)size, 0);
+    } else if (directive == ".align") {
+        alignData(sim, 1u << atoi(trim(rest).c_str()));
+    } else {
+        return loadError(sim, line, "unsupported directive %s", directive);
+    }
+    return true;
+}
+
+/**
+ * First pass: lay out .data, number the .text instructions, record labels
+ */
+static bool readSource(Simulator& sim, FILE* file) {
+    bool inText = true;
+    char buffer[4096];
+    string pending;
+    int line = 0;
+    while (fgets(buffer, sizeof(buffer), file)) {
+        line++;
+        string s = trim(stripComment(buffer));
+        // Peel off any labels
+        for (;;) {
+            size_t i = 0;
+            while (i < s.size() && isLabelChar(s[i])) i++;
+            if (i == 0 || i >= s.size() || s[i] != ':') break;
+            string label = s.substr(0, i);
+            if (sim.textLabels.count(label) || sim.dataLabels.count(label)) {
+                return loadError(sim, line, "duplicate label %s", label);
+            }
+            if (inText) {
+                sim.textLabels[label] = (int)sim.textLines.size();
+            } else {
+                sim.dataLabels[label] = dataEnd(sim);
+            }
+            s = trim(s.substr(i + 1));
+        }
+        if (s.empty()) continue;
+
+        size_t space = s.find_first_of(" \t");
+        string word = s.substr(0, space);
+        string rest = space == string::npos ? "" : s.substr(space + 1);
+        if (word == ".data") {
+            inText = false;
+        } else if (word == ".text") {
+            inText = true;
+        } else if (word == ".globl" || word == ".extern") {
+            // Single-file programs: nothing to export
+        } else if (word == ".set") {
+            // noreorder: the assembly fills its own delay slots; other options are ignored
+            string option = trim(rest);
+            if (option == "noreorder") sim.delaySlots = true;
+            else if (option == "reorder") sim.delaySlots = false;
+        } else if (!inText) {
+            // A label may precede the directive on the same line: the
+            // address must follow the directive's alignment
+            if (word == ".word" || word == ".float" || word == ".half" || word == ".double") {
+                uint32_t before = dataEnd(sim);
+                alignData(sim, word == ".half" ? 2 : word == ".double" ? 8 : 4);
+                for (unordered_map<string, uint32_t>::iterator it = sim.dataLabels.begin(); it != sim.dataLabels.end(); ++it) {
+                    if (it->second == before) it->second = dataEnd(sim);
+                }
+            }
+            if (!parseDataDirective(sim, word, rest, line)) return false;
+        } else if (word[0] == '.') {
+            return loadError(sim, line, "unsupported directive %s", word);
+        } else {
+            SourceLine source;
+            source.text = s;
+            source.line = line;
+            sim.textLines.push_back(source);
+        }
+    }
+    return true;
+}
+
+static bool resolveAddress(Simulator& sim, const string& token, uint8_t& base, int32_t& offset, int line);
+
+/**
+ * %hi(address) / %lo(address): the halves of an address as lui and a
+ * signed 16-bit offset or addiu combine them. Returns false when `token`
+ * is not a relocation; `ok` reports whether it resolved.
+ */
+static bool parseRelocation(Simulator& sim, const string& token, int32_t& value, bool& ok, int line) {
+    if (token.size() < 5 || token[0] != '%' || token[token.size() - 1] != ')') return false;
+    bool high = token.compare(0, 4, "%hi(") == 0;
+    if (!high && token.compare(0, 4, "%lo(") != 0) return false;
+    uint8_t base;
+    int32_t address;
+    ok = resolveAddress(sim, token.substr(4, token.size() - 5), base, address, line) && base == 0;
+    value = high ? (int32_t)(((uint32_t)address + 0x8000u) >> 16) : (int32_t)(int16_t)(address & 0xffff);
+    return true;
+}
+
+static bool resolveAddress(Simulator& sim, const string& token, uint8_t& base, int32_t& offset, int line) {
+    string s = token;
+    base = 0;
+    offset = 0;
+    // The base register follows the closing parenthesis of %lo(...)
+    size_t paren = s.find('(', s[0] == '%' ? s.find(')') : 0);
+    if (paren != string::npos) {
+        size_t close = s.find(')', paren);
+        if (close == string::npos || !parseRegister(trim(s.substr(paren + 1, close - paren - 1)), base)) {
+            return loadError(sim, line, "bad address %s", token);
+        }
+        s = trim(s.substr(0, paren));
+    }
+    if (s.empty()) return true;
+
+    int64_t value;
+    if (parseInteger(s, value)) {
+        offset = (int32_t)value;
+        return true;
+    }
+    bool ok;
+    if (parseRelocation(sim, s, offset, ok, line)) {
+        return ok || loadError(sim, line, "bad address %s", token);
+    }
+    // label, label+n, label-n
+    size_t sign = s.find_first_of("+-", 1);
+    string label = trim(s.substr(0, sign));
+    int64_t adjust = 0;
+    if (sign != string::npos && !parseInteger(trim(s.substr(sign + (s[sign] == '+' ? 1 : 0))), adjust)) {
+        return loadError(sim, line, "bad address %s", token);
+    }
+    if (sim.dataLabels.count(label)) {
+        offset = (int32_t)(sim.dataLabels[label] + adjust);
+    } else if (sim.textLabels.count(label)) {
+        offset = (int32_t)(TEXT_BASE + 4 * sim.textLabels[label] + adjust);
+    } else {
+        return loadError(sim, line, "undefined label %s", label);
+    }
+    return true;
+}
+
+static bool resolveTarget(Simulator& sim, const string& label, int& target, int line) {
+    unordered_map<string, int>::iterator it = sim.textLabels.find(label);
+    if (it == sim.textLabels.end()) {
+        return loadError(sim, line, "undefined label %s", label);
+    }
+    target = it->second;
+    return true;
+}
+
+static bool operandCount(Simulator& sim, const vector<string>& ops, size_t low, size_t high, const SourceLine& source) {
+    if (ops.size() < low || ops.size() > high) {
+        return loadError(sim, source.line, "wrong number of operands in '%s'", source.text);
+    }
+    return true;
+}
+
+/**
+ * Second pass: decode one instruction
+ */
+// Check that every double operand of `ins` names an even register and add
+// the odd half of each source pair to its dependencies
+static bool pairOperands(const Mnemonic& mn, SimInstruction& ins) {
+    uint8_t regs[3] = { ins.rd, ins.rs, ins.rt };
+    int first = 0;               // regs[] index of FP operand 0
+    int sourceFrom = 1;          // FP operands from this index on are read
+    if (mn.format == F_FCMP) {
+        first = 1;
+        sourceFrom = 0;
+    } else if (mn.format == F_FMEM) {
+        first = 2;
+        sourceFrom = ins.op == OP_SDC1 ? 0 : 1;
+    }
+    for (int operand = 0; first + operand < 3; operand++) {
+        if (!((mn.pairs >> operand) & 1)) continue;
+        uint8_t reg = regs[first + operand];
+        if (reg & 1) return false;
+        if (operand >= sourceFrom) ins.sources |= 1ull << FP_REG(reg + 1);
+    }
+    return true;
+}
+
+static bool decodeInstruction(Simulator& sim, const SourceLine& source, SimInstruction& ins) {
+    const string& s = source.text;
+    size_t space = s.find_first_of(" \t");
+    string name = s.substr(0, space);
+    vector<string> ops = splitOperands(space == string::npos ? "" : s.substr(space + 1));
+
+    int index = -1;
+    for (size_t m = 0; m < sizeof(mnemonics) / sizeof(mnemonics[0]); m++) {
+        if (name == mnemonics[m].name) {
+            index = (int)m;
+            break;
+        }
+    }
+    if (index < 0) {
+        return loadError(sim, source.line, "unsupported instruction %s", name);
+    }
+    const Mnemonic& mn = mnemonics[index];
+    memset(&ins, 0, sizeof(ins));
+    ins.op = mn.op;
+    ins.usesHiLo = (mn.op >= OP_MUL && mn.op <= OP_REMU) || (mn.op >= OP_MULT && mn.op <= OP_MFLO);
+    ins.mnemonic = index;
+    ins.machineCount = mn.machineCount;
+    ins.line = source.line;
+    ins.loadDest = -1;
+    ins.target = -1;
+
+    bool ok = true;
+    int64_t value;
+    switch (mn.format) {
+        case F_NONE:
+            ok = operandCount(sim, ops, 0, 0, source);
+            if (ok && ins.op == OP_SYSCALL) {
+                ins.sources = (1ull << 2) | (1ull << 4) | (1ull << 5) | (3ull << FP_REG(12));
+            }
+            break;
+
+        case F_RRX: {
+            if (!operandCount(sim, ops, 2, 3, source)) return false;
+            // Two operands: "op rd, x" means "op rd, rd, x", and the
+            // two-operand div/divu set HI/LO instead, as does the
+            // assembler's machine form "div $zero, rs, rt"
+            bool machineDivide = ops.size() == 3 && ops[0] == "$zero";
+            if ((ops.size() == 2 || machineDivide) && (ins.op == OP_DIV || ins.op == OP_DIVU)) {
+                ins.op = ins.op == OP_DIV ? OP_DIV2 : OP_DIVU2;
+                ins.machineCount = 1;
+                ok = parseRegister(ops[ops.size() - 2], ins.rs) && parseRegister(ops[ops.size() - 1], ins.rt);
+                ins.sources = (1ull << ins.rs) | (1ull << ins.rt);
+                break;
+            }
+            const string& second = ops.size() == 3 ? ops[1] : ops[0];
+            const string& third = ops[ops.size() - 1];
+            ok = parseRegister(ops[0], ins.rd) && parseRegister(second, ins.rs);
+            if (ok && !parseRegister(third, ins.rt)) {
+                ins.useImm = true;
+                if (!parseRelocation(sim, third, ins.imm, ok, source.line)) {
+                    ok = parseInteger(third, value);
+                    ins.imm = (int32_t)value;
+                    // Immediates outside 16 bits are loaded into $at first
+                    if (value < -32768 || value > 65535) ins.machineCount++;
+                }
+            }
+            ins.sources = (1ull << ins.rs) | (ins.useImm ? 0 : (1ull << ins.rt));
+            break;
+        }
+
+        case F_RR:
+            if (!operandCount(sim, ops, 2, 2, source)) return false;
+            ok = parseRegister(ops[0], ins.rd) && parseRegister(ops[1], ins.rt);
+            // move rd, rs = add rd, $zero, rs; neg = sub rd, $zero, rs; not = nor rd, rs, $zero
+            ins.rs = 0;
+            ins.sources = 1ull << ins.rt;
+            break;
+
+        case F_RI:
+            if (!operandCount(sim, ops, 2, 2, source)) return false;
+            ok = parseRegister(ops[0], ins.rd);
+            if (ok && !parseRelocation(sim, ops[1], ins.imm, ok, source.line)) {
+                ok = parseInteger(ops[1], value);
+                ins.imm = (int32_t)value;
+                if (ok && ins.op == OP_LI && (value < -32768 || value > 65535)) ins.machineCount = 2;
+            }
+            break;
+
+        case F_LA: {
+            if (!operandCount(sim, ops, 2, 2, source)) return false;
+            uint8_t base;
+            ok = parseRegister(ops[0], ins.rd) && resolveAddress(sim, ops[1], base, ins.imm, source.line);
+            if (ok && base != 0) {
+                // la rd, off(base) = addi rd, base, off
+                ins.op = OP_ADD;
+                ins.rs = base;
+                ins.useImm = true;
+                ins.machineCount = 1;
+                ins.sources = 1ull << base;
+            }
+            break;
+        }
+
+        case F_HILO:
+            if (!operandCount(sim, ops, 2, 2, source)) return false;
+            ok = parseRegister(ops[0], ins.rs) && parseRegister(ops[1], ins.rt);
+            ins.sources = (1ull << ins.rs) | (1ull << ins.rt);
+            break;
+
+        case F_RD:
+            if (!operandCount(sim, ops, 1, 1, source)) return false;
+            ok = parseRegister(ops[0], ins.rd);
+            break;
+
+        case F_RS:
+            if (!operandCount(sim, ops, 1, 1, source)) return false;
+            ok = parseRegister(ops[0], ins.rs);
+            ins.sources = 1ull << ins.rs;
+            break;
+
+        case F_BR2:
+            if (!operandCount(sim, ops, 3, 3, source)) return false;
+            ok = parseRegister(ops[0], ins.rs);
+            if (ok && !parseRegister(ops[1], ins.rt)) {
+                ok = parseInteger(ops[1], value);
+                ins.useImm = true;
+                ins.imm = (int32_t)value;
+                // beq/bne with an immediate load it into $at first
+                if (ins.op == OP_BEQ || ins.op == OP_BNE) ins.machineCount++;
+            }
+            ok = ok && resolveTarget(sim, ops[2], ins.target, source.line);
+            ins.sources = (1ull << ins.rs) | (ins.useImm ? 0 : (1ull << ins.rt));
+            break;
+
+        case F_BR1:
+            if (!operandCount(sim, ops, 2, 2, source)) return false;
+            ok = parseRegister(ops[0], ins.rs) && resolveTarget(sim, ops[1], ins.target, source.line);
+            ins.rt = 0;
+            ins.sources = 1ull << ins.rs;
+            break;
+
+        case F_LABEL:
+            if (!operandCount(sim, ops, 1, 1, source)) return false;
+            ok = resolveTarget(sim, ops[0], ins.target, source.line);
+            break;
+
+        case F_JALR:
+            if (!operandCount(sim, ops, 1, 2, source)) return false;
+            ins.rd = 31;
+            ok = ops.size() == 1 ? parseRegister(ops[0], ins.rs)
+                                 : parseRegister(ops[0], ins.rd) && parseRegister(ops[1], ins.rs);
+            ins.sources = 1ull << ins.rs;
+            break;
+
+        case F_MEM:
+        case F_FMEM: {
+            if (!operandCount(sim, ops, 2, 2, source)) return false;
+            bool fp = mn.format == F_FMEM;
+            ok = fp ? parseFPRegister(ops[0], ins.rt) : parseRegister(ops[0], ins.rt);
+            ok = ok && resolveAddress(sim, ops[1], ins.rs, ins.imm, source.line);
+            // A label address needs lui first
+            if (ok && ins.rs == 0 && (ins.imm < -32768 || ins.imm > 32767)) ins.machineCount++;
+            int value = fp ? FP_REG(ins.rt) : ins.rt;
+            bool store = ins.op == OP_SW || ins.op == OP_SH || ins.op == OP_SB || ins.op == OP_SWC1 || ins.op == OP_SDC1;
+            ins.sources = (1ull << ins.rs) | (store ? (1ull << value) : 0);
+            // A pair loads its high word last
+            if (!store) ins.loadDest = mn.pairs ? value + 1 : value;
+            break;
+        }
+
+        case F_FFF:
+            if (!operandCount(sim, ops, 3, 3, source)) return false;
+            ok = parseFPRegister(ops[0], ins.rd) && parseFPRegister(ops[1], ins.rs) && parseFPRegister(ops[2], ins.rt);
+            ins.sources = (1ull << FP_REG(ins.rs)) | (1ull << FP_REG(ins.rt));
+            break;
+
+        case F_FF:
+            if (!operandCount(sim, ops, 2, 2, source)) return false;
+            ok = parseFPRegister(ops[0], ins.rd) && parseFPRegister(ops[1], ins.rs);
+            ins.sources = 1ull << FP_REG(ins.rs);
+            break;
+
+        case F_FCMP:
+            if (!operandCount(sim, ops, 2, 2, source)) return false;
+            ok = parseFPRegister(ops[0], ins.rs) && parseFPRegister(ops[1], ins.rt);
+            ins.sources = (1ull << FP_REG(ins.rs)) | (1ull << FP_REG(ins.rt));
+            break;
+
+        case F_RF:
+            if (!operandCount(sim, ops, 2, 2, source)) return false;
+            ok = parseRegister(ops[0], ins.rt) && parseFPRegister(ops[1], ins.rs);
+            ins.sources = ins.op == OP_MTC1 ? (1ull << ins.rt) : (1ull << FP_REG(ins.rs));
+            break;
+
+        case F_FIMM: {
+            if (!operandCount(sim, ops, 2, 2, source)) return false;
+            char* end;
+            ins.fimm = strtof(ops[1].c_str(), &end);
+            ok = parseFPRegister(ops[0], ins.rd) && *end == '\0';
+            break;
+        }
+    }
+    if (!ok) {
+        return loadError(sim, source.line, "bad operand in '%s'", source.text);
+    }
+    if (mn.pairs && !pairOperands(mn, ins)) {
+        return loadError(sim, source.line, "odd register for a double in '%s'", source.text);
+    }
+    // $zero is never a real dependency
+    ins.sources &= ~1ull;
+    return true;
+}
+
+static bool loadProgram(Simulator& sim) {
+    FILE* file = fopen(sim.path, "r");
+    if (!file) {
+        fprintf(stderr, "Error: Cannot open file %s\n", sim.path);
+        return false;
+    }
+    sim.data.assign(STATIC_BASE - DATA_BASE, 0);
+    bool ok = readSource(sim, file);
+    fclose(file);
+    if (!ok) return false;
+
+    for (size_t f = 0; f < sim.wordFixups.size(); f++) {
+        const string& label = sim.wordFixups[f].second.first;
+        uint32_t value;
+        if (sim.dataLabels.count(label)) {
+            value = sim.dataLabels[label];
+        } else if (sim.textLabels.count(label)) {
+            value = TEXT_BASE + 4 * sim.textLabels[label];
+        } else {
+            return loadError(sim, sim.wordFixups[f].second.second, "undefined label %s", label);
+        }
+        memcpy(&sim.data[sim.wordFixups[f].first - DATA_BASE], &value, sizeof(value));
+    }
+
+    sim.text.resize(sim.textLines.size());
+    for (size_t i = 0; i < sim.textLines.size(); i++) {
+        if (!decodeInstruction(sim, sim.textLines[i], sim.text[i])) return false;
+    }
+    if (!sim.textLabels.count("main")) {
+        fprintf(stderr, "Simulator Error: %s has no main label\n", sim.path);
+        return false;
+    }
+    sim.heapEnd = dataEnd(sim);
+    return true;
+}
+
+/* ========== Execution ========== */
+
+static bool runtimeError(Simulator& sim, int pc, const char* format, uint32_t value) {
+    fflush(sim.out);
+    fprintf(stderr, "Simulator Error on line %d of %s: ", sim.text[pc].line, sim.path);
+    fprintf(stderr, format, value);
+    fprintf(stderr, "\n");
+    return false;
+}
+
+static float asFloat(uint32_t bits) {
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+static uint32_t asBits(float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+// A double lives in an even/odd pair: low word in the even register
+static double getDouble(const uint32_t* f, int reg) {
+    uint64_t bits = ((uint64_t)f[reg + 1] << 32) | f[reg];
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+static void setDouble(uint32_t* f, int reg, double d) {
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    f[reg] = (uint32_t)bits;
+    f[reg + 1] = (uint32_t)(bits >> 32);
+}
+
+// SPIM reads numbers a line at a time
+static bool readLine(Simulator& sim, char* buffer, size_t size) {
+    fflush(sim.out);
+    if (!fgets(buffer, (int)size, sim.in)) {
+        buffer[0] = '\0';
+        return false;
+    }
+    return true;
+}
+
+static bool doSyscall(Simulator& sim, int pc, bool& exited) {
+    uint32_t* r = sim.regs;
+    char line[1024];
+    switch (r[2]) {
+        case 1:
+            fprintf(sim.out, "%d", (int32_t)r[4]);
+            break;
+        case 2:
+            fprintf(sim.out, "%.8f", asFloat(sim.fregs[12]));
+            break;
+        case 3:
+            fprintf(sim.out, "%.8f", getDouble(sim.fregs, 12));
+            break;
+        case 4: {
+            uint32_t address = r[4];
+            for (;;) {
+                uint8_t* c = translate(sim, address++, 1);
+                if (!c) return runtimeError(sim, pc, "print_string: invalid address 0x%08x", r[4]);
+                if (*c == 0) break;
+                fputc(*c, sim.out);
+            }
+            break;
+        }
+        case 5:
+            readLine(sim, line, sizeof(line));
+            r[2] = (uint32_t)strtol(line, NULL, 10);
+            break;
+        case 6:
+            readLine(sim, line, sizeof(line));
+            sim.fregs[0] = asBits(strtof(line, NULL));
+            break;
+        case 7:
+            readLine(sim, line, sizeof(line));
+            setDouble(sim.fregs, 0, strtod(line, NULL));
+            break;
+        case 8: {
+            int32_t length = (int32_t)r[5];
+            if (length < 1) break;
+            uint8_t* buffer = translate(sim, r[4], (uint32_t)length);
+            if (!buffer) return runtimeError(sim, pc, "read_string: invalid buffer 0x%08x", r[4]);
+            fflush(sim.out);
+            if (!fgets((char*)buffer, length, sim.in)) buffer[0] = 0;
+            break;
+        }
+        case 9: {
+            uint32_t size = (r[4] + 3) & ~3u;
+            if (sim.heapEnd + size > DATA_LIMIT) return runtimeError(sim, pc, "sbrk: out of memory (%u bytes)", r[4]);
+            r[2] = sim.heapEnd;
+            sim.heapEnd += size;
+            if (sim.heapEnd - DATA_BASE > sim.data.size()) sim.data.resize(sim.heapEnd - DATA_BASE, 0);
+            break;
+        }
+        case 10:
+            sim.stats.exitCode = 0;
+            exited = true;
+            break;
+        case 11:
+            fputc((int)(r[4] & 0xff), sim.out);
+            break;
+        case 12: {
+            fflush(sim.out);
+            int c = fgetc(sim.in);
+            r[2] = c == EOF ? 0 : (uint32_t)c;
+            break;
+        }
+        case 17:
+            sim.stats.exitCode = (int32_t)r[4];
+            exited = true;
+            break;
+        default:
+            return runtimeError(sim, pc, "unsupported syscall %u", r[2]);
+    }
+    return true;
+}
+
+/**
+ * Copy argv[0] (the file name) and the program arguments to the top of the
+ * stack and pass argc/argv in $a0/$a1
+ */
+static bool pushArguments(Simulator& sim) {
+    vector<const char*> args(1, sim.path);
+    for (int i = 0; i < sim.options.argc; i++) args.push_back(sim.options.argv[i]);
+
+    uint32_t sp = INITIAL_SP;
+    vector<uint32_t> pointers;
+    for (size_t i = 0; i < args.size(); i++) {
+        uint32_t length = (uint32_t)strlen(args[i]) + 1;
+        if (length > STACK_SIZE / 2 || sp - length < STACK_TOP - STACK_SIZE / 2) {
+            fprintf(stderr, "Simulator Error: program arguments too long\n");
+            return false;
+        }
+        sp -= length;
+        memcpy(translate(sim, sp, length), args[i], length);
+        pointers.push_back(sp);
+    }
+    pointers.push_back(0);
+    sp = (sp - 4 * (uint32_t)pointers.size()) & ~7u;
+    memcpy(translate(sim, sp, 4 * (uint32_t)pointers.size()), &pointers[0], 4 * pointers.size());
+    sim.regs[4] = (uint32_t)args.size();
+    sim.regs[5] = sp;
+    sim.regs[29] = sp - 8;
+    return true;
+}
+
+static bool compare(SimOp op, uint32_t a, uint32_t b) {
+    switch (op) {
+        case OP_BEQ: case OP_SEQ:   return a == b;
+        case OP_BNE: case OP_SNE:   return a != b;
+        case OP_BLT:                return (int32_t)a < (int32_t)b;
+        case OP_BLE: case OP_SLE:   return (int32_t)a <= (int32_t)b;
+        case OP_BGT: case OP_SGT:   return (int32_t)a > (int32_t)b;
+        case OP_BGE: case OP_SGE:   return (int32_t)a >= (int32_t)b;
+        case OP_BLTU:               return a < b;
+        case OP_BLEU: case OP_SLEU: return a <= b;
+        case OP_BGTU: case OP_SGTU: return a > b;
+        case OP_BGEU: case OP_SGEU: return a >= b;
+        default:                    return false;
+    }
+}
+
+static bool run(Simulator& sim) {
+    uint32_t* r = sim.regs;
+    uint32_t* f = sim.fregs;
+    SimulationStats& st = sim.stats;
+    int count = (int)sim.text.size();
+    // Returning from main lands one past the last instruction
+    if (!pushArguments(sim)) return false;
+    r[30] = r[29];
+    r[28] = 0x10008000u;
+    r[31] = TEXT_BASE + 4 * (uint32_t)count;
+    int pc = sim.textLabels["main"];
+    int lastLoad = -1;
+    long long hiLoReady = 0;     // Cycle the last mult/div delivers HI/LO
+    // With delay slots a taken branch waits here for one instruction, and
+    // costs no extra cycle; jal/jalr return past the slot
+    int pendingTarget = -1;
+    int takenPenalty = sim.delaySlots ? 0 : TAKEN_PENALTY;
+    uint32_t linkOffset = sim.delaySlots ? 2 : 1;
+    long long limit = sim.options.maxInstructions;
+
+    while (pc >= 0 && pc < count) {
+        const SimInstruction& ins = sim.text[pc];
+        if (limit > 0 && st.instructions >= limit) {
+            return runtimeError(sim, pc, "instruction limit reached after %u instructions", (uint32_t)limit);
+        }
+        sim.executed[pc]++;
+        st.instructions++;
+        st.machineInstructions += ins.machineCount;
+        st.cycles += ins.machineCount;
+        if (lastLoad >= 0 && (ins.sources >> lastLoad) & 1) {
+            st.loadUseStalls++;
+            st.cycles += LOAD_USE_STALL;
+        }
+        lastLoad = ins.loadDest;
+        if (ins.usesHiLo && hiLoReady > st.cycles - ins.machineCount) {
+            long long wait = hiLoReady - (st.cycles - ins.machineCount);
+            st.hiLoStalls += wait;
+            st.cycles += wait;
+        }
+
+        uint32_t a = r[ins.rs];
+        uint32_t b = ins.useImm ? (uint32_t)ins.imm : r[ins.rt];
+        uint32_t result = 0;
+        bool writeRd = true;
+        int next = pc + 1;
+        bool transfer = false;
+
+        switch (ins.op) {
+            case OP_NOP: writeRd = false; break;
+            case OP_SYSCALL: {
+                writeRd = false;
+                st.syscalls++;
+                bool exited = false;
+                if (!doSyscall(sim, pc, exited)) return false;
+                if (exited) return true;
+                break;
+            }
+            case OP_ADD:  result = a + b; break;
+            case OP_SUB:  result = a - b; break;
+            case OP_AND:  result = a & (ins.useImm ? (b & 0xffff) : b); break;
+            case OP_OR:   result = a | (ins.useImm ? (b & 0xffff) : b); break;
+            case OP_XOR:  result = a ^ (ins.useImm ? (b & 0xffff) : b); break;
+            case OP_NOR:  result = ~(a | b); break;
+            case OP_SLT:  result = (int32_t)a < (int32_t)b; break;
+            case OP_SLTU: result = a < b; break;
+            // The shift amount is the second operand (immediate or register)
+            case OP_SLL:  result = a << (b & 31); break;
+            case OP_SRL:  result = a >> (b & 31); break;
+            case OP_SRA:  result = (uint32_t)((int32_t)a >> (b & 31)); break;
+            case OP_MUL:
+                result = (uint32_t)((int32_t)a * (int64_t)(int32_t)b);
+                st.mulDiv++;
+                st.cycles += MUL_LATENCY;
+                break;
+            case OP_DIV: case OP_DIVU: case OP_REM: case OP_REMU:
+                if (b == 0) return runtimeError(sim, pc, "division by zero (dividend %d)", a);
+                if (ins.op == OP_DIV) result = (int32_t)a == INT32_MIN && (int32_t)b == -1 ? a : (uint32_t)((int32_t)a / (int32_t)b);
+                else if (ins.op == OP_REM) result = (int32_t)b == -1 ? 0 : (uint32_t)((int32_t)a % (int32_t)b);
+                else if (ins.op == OP_DIVU) result = a / b;
+                else result = a % b;
+                st.mulDiv++;
+                st.cycles += DIV_LATENCY;
+                break;
+            case OP_SEQ: case OP_SNE: case OP_SLE: case OP_SLEU:
+            case OP_SGT: case OP_SGTU: case OP_SGE: case OP_SGEU:
+                result = compare(ins.op, a, b);
+                break;
+            case OP_ABS:  result = (int32_t)r[ins.rt] < 0 ? -r[ins.rt] : r[ins.rt]; break;
+            case OP_LI:   result = (uint32_t)ins.imm; break;
+            case OP_LUI:  result = (uint32_t)ins.imm << 16; break;
+
+            case OP_MULT: case OP_MULTU: {
+                uint64_t product = ins.op == OP_MULT ? (uint64_t)((int64_t)(int32_t)a * (int32_t)r[ins.rt])
+                                                     : (uint64_t)a * r[ins.rt];
+                sim.lo = (uint32_t)product;
+                sim.hi = (uint32_t)(product >> 32);
+                writeRd = false;
+                st.mulDiv++;
+                hiLoReady = st.cycles + MUL_LATENCY;
+                break;
+            }
+            case OP_DIV2: case OP_DIVU2: {
+                uint32_t d = r[ins.rt];
+                writeRd = false;
+                st.mulDiv++;
+                hiLoReady = st.cycles + DIV_LATENCY;
+                if (d == 0) break;               // Undefined HI/LO, no trap
+                if (ins.op == OP_DIV2 && (int32_t)a == INT32_MIN && (int32_t)d == -1) {
+                    sim.lo = a;                  // Overflow wraps, as on the R2000
+                    sim.hi = 0;
+                } else if (ins.op == OP_DIV2) {
+                    sim.lo = (uint32_t)((int32_t)a / (int32_t)d);
+                    sim.hi = (uint32_t)((int32_t)a % (int32_t)d);
+                } else {
+                    sim.lo = a / d;
+                    sim.hi = a % d;
+                }
+                break;
+            }
+            case OP_MFHI: result = sim.hi; break;
+            case OP_MFLO: result = sim.lo; break;
+            case OP_MTHI: sim.hi = a; writeRd = false; break;
+            case OP_MTLO: sim.lo = a; writeRd = false; break;
+
+            case OP_BEQ: case OP_BNE: case OP_BLT: case OP_BLE: case OP_BGT:
+            case OP_BGE: case OP_BLTU: case OP_BLEU: case OP_BGTU: case OP_BGEU:
+                writeRd = false;
+                st.branches++;
+                if (compare(ins.op, a, b)) {
+                    st.branchesTaken++;
+                    st.cycles += takenPenalty;
+                    next = ins.target;
+                    transfer = true;
+                }
+                break;
+            case OP_BC1T: case OP_BC1F:
+                writeRd = false;
+                st.branches++;
+                if (sim.fcc == (ins.op == OP_BC1T)) {
+                    st.branchesTaken++;
+                    st.cycles += takenPenalty;
+                    next = ins.target;
+                    transfer = true;
+                }
+                break;
+            case OP_J: case OP_JAL:
+                writeRd = false;
+                st.jumps++;
+                st.cycles += takenPenalty;
+                if (ins.op == OP_JAL) {
+                    st.calls++;
+                    r[31] = TEXT_BASE + 4 * (uint32_t)(pc + linkOffset);
+                }
+                next = ins.target;
+                transfer = true;
+                break;
+            case OP_JR: case OP_JALR: {
+                writeRd = false;
+                st.jumps++;
+                st.cycles += takenPenalty;
+                if (a < TEXT_BASE || (a - TEXT_BASE) % 4 != 0 || (a - TEXT_BASE) / 4 > (uint32_t)count) {
+                    return runtimeError(sim, pc, "jump to invalid address 0x%08x", a);
+                }
+                if (ins.op == OP_JALR) {
+                    st.calls++;
+                    r[ins.rd] = TEXT_BASE + 4 * (uint32_t)(pc + linkOffset);
+                }
+                next = (int)((a - TEXT_BASE) / 4);
+                transfer = true;
+                break;
+            }
+
+            case OP_LW: case OP_LH: case OP_LHU: case OP_LB: case OP_LBU: case OP_LWC1: {
+                uint32_t address = a + (uint32_t)ins.imm;
+                uint32_t size = ins.op == OP_LW || ins.op == OP_LWC1 ? 4 : ins.op == OP_LB || ins.op == OP_LBU ? 1 : 2;
+                uint8_t* p = address % size == 0 ? translate(sim, address, size) : NULL;
+                if (!p) return runtimeError(sim, pc, "invalid load from 0x%08x", address);
+                st.loads++;
+                writeRd = false;
+                uint32_t word = 0;
+                memcpy(&word, p, size);
+                switch (ins.op) {
+                    case OP_LH:   word = (uint32_t)(int32_t)(int16_t)word; break;
+                    case OP_LB:   word = (uint32_t)(int32_t)(int8_t)word; break;
+                    default:      break;
+                }
+                if (ins.op == OP_LWC1) f[ins.rt] = word;
+                else if (ins.rt != 0) r[ins.rt] = word;
+                break;
+            }
+            case OP_SW: case OP_SH: case OP_SB: case OP_SWC1: {
+                uint32_t address = a + (uint32_t)ins.imm;
+                uint32_t size = ins.op == OP_SW || ins.op == OP_SWC1 ? 4 : ins.op == OP_SB ? 1 : 2;
+                uint8_t* p = address % size == 0 ? translate(sim, address, size) : NULL;
+                if (!p) return runtimeError(sim, pc, "invalid store to 0x%08x", address);
+                st.stores++;
+                writeRd = false;
+                uint32_t word = ins.op == OP_SWC1 ? f[ins.rt] : r[ins.rt];
+                memcpy(p, &word, size);
+                break;
+            }
+            // Word-aligned, like the two lwc1/swc1 SPIM expands l.d/s.d into
+            case OP_LDC1: case OP_SDC1: {
+                uint32_t address = a + (uint32_t)ins.imm;
+                uint8_t* p = address % 4 == 0 ? translate(sim, address, 8) : NULL;
+                bool load = ins.op == OP_LDC1;
+                if (!p) return runtimeError(sim, pc, load ? "invalid load from 0x%08x" : "invalid store to 0x%08x", address);
+                if (load) {
+                    memcpy(&f[ins.rt], p, 4);
+                    memcpy(&f[ins.rt + 1], p + 4, 4);
+                    st.loads += 2;
+                } else {
+                    memcpy(p, &f[ins.rt], 4);
+                    memcpy(p + 4, &f[ins.rt + 1], 4);
+                    st.stores += 2;
+                }
+                writeRd = false;
+                break;
+            }
+
+            case OP_ADD_S: case OP_SUB_S: case OP_MUL_S: case OP_DIV_S: {
+                float x = asFloat(f[ins.rs]), y = asFloat(f[ins.rt]);
+                float z = ins.op == OP_ADD_S ? x + y : ins.op == OP_SUB_S ? x - y : ins.op == OP_MUL_S ? x * y : x / y;
+                f[ins.rd] = asBits(z);
+                writeRd = false;
+                st.fpOps++;
+                st.cycles += ins.op == OP_MUL_S ? FP_MUL_LATENCY : ins.op == OP_DIV_S ? FP_DIV_LATENCY : FP_ADD_LATENCY;
+                break;
+            }
+            case OP_NEG_S: case OP_ABS_S: case OP_MOV_S: case OP_SQRT_S: {
+                float x = asFloat(f[ins.rs]);
+                float z = ins.op == OP_NEG_S ? -x : ins.op == OP_ABS_S ? (x < 0 ? -x : x)
+                        : ins.op == OP_SQRT_S ? sqrtf(x) : x;
+                f[ins.rd] = asBits(z);
+                writeRd = false;
+                if (ins.op != OP_MOV_S) st.fpOps++;
+                if (ins.op == OP_SQRT_S) st.cycles += FP_DIV_LATENCY;
+                break;
+            }
+            case OP_CVT_S_W:
+                f[ins.rd] = asBits((float)(int32_t)f[ins.rs]);
+                writeRd = false;
+                st.fpOps++;
+                st.cycles += FP_ADD_LATENCY;
+                break;
+            case OP_CVT_W_S:
+                f[ins.rd] = (uint32_t)(int32_t)asFloat(f[ins.rs]);
+                writeRd = false;
+                st.fpOps++;
+                st.cycles += FP_ADD_LATENCY;
+                break;
+            case OP_C_EQ_S: case OP_C_LT_S: case OP_C_LE_S: {
+                float x = asFloat(f[ins.rs]), y = asFloat(f[ins.rt]);
+                sim.fcc = ins.op == OP_C_EQ_S ? x == y : ins.op == OP_C_LT_S ? x < y : x <= y;
+                writeRd = false;
+                st.fpOps++;
+                break;
+            }
+            case OP_MTC1: f[ins.rs] = r[ins.rt]; writeRd = false; break;
+            case OP_MFC1:
+                if (ins.rt != 0) r[ins.rt] = f[ins.rs];
+                writeRd = false;
+                break;
+            case OP_LI_S: f[ins.rd] = asBits(ins.fimm); writeRd = false; break;
+
+            case OP_ADD_D: case OP_SUB_D: case OP_MUL_D: case OP_DIV_D: {
+                double x = getDouble(f, ins.rs), y = getDouble(f, ins.rt);
+                double z = ins.op == OP_ADD_D ? x + y : ins.op == OP_SUB_D ? x - y : ins.op == OP_MUL_D ? x * y : x / y;
+                setDouble(f, ins.rd, z);
+                writeRd = false;
+                st.fpOps++;
+                st.cycles += ins.op == OP_MUL_D ? FP_MUL_LATENCY : ins.op == OP_DIV_D ? FP_DIV_LATENCY : FP_ADD_LATENCY;
+                break;
+            }
+            case OP_NEG_D: case OP_ABS_D: case OP_MOV_D: case OP_SQRT_D: {
+                double x = getDouble(f, ins.rs);
+                double z = ins.op == OP_NEG_D ? -x : ins.op == OP_ABS_D ? (x < 0 ? -x : x)
+                         : ins.op == OP_SQRT_D ? sqrt(x) : x;
+                setDouble(f, ins.rd, z);
+                writeRd = false;
+                if (ins.op != OP_MOV_D) st.fpOps++;
+                if (ins.op == OP_SQRT_D) st.cycles += FP_DIV_LATENCY;
+                break;
+            }
+            case OP_CVT_D_S: case OP_CVT_D_W:
+                setDouble(f, ins.rd, ins.op == OP_CVT_D_S ? (double)asFloat(f[ins.rs]) : (double)(int32_t)f[ins.rs]);
+                writeRd = false;
+                st.fpOps++;
+                st.cycles += FP_ADD_LATENCY;
+                break;
+            case OP_CVT_S_D: case OP_CVT_W_D: {
+                double x = getDouble(f, ins.rs);
+                f[ins.rd] = ins.op == OP_CVT_S_D ? asBits((float)x) : (uint32_t)(int32_t)x;
+                writeRd = false;
+                st.fpOps++;
+                st.cycles += FP_ADD_LATENCY;
+                break;
+            }
+            case OP_C_EQ_D: case OP_C_LT_D: case OP_C_LE_D: {
+                double x = getDouble(f, ins.rs), y = getDouble(f, ins.rt);
+                sim.fcc = ins.op == OP_C_EQ_D ? x == y : ins.op == OP_C_LT_D ? x < y : x <= y;
+                writeRd = false;
+                st.fpOps++;
+                break;
+            }
+        }
+
+        // move/neg/not read their operand through rt
+        if (writeRd) {
+            if (mnemonics[ins.mnemonic].format == F_RR && ins.op != OP_ABS) {
+                uint32_t x = r[ins.rt];
+                result = ins.op == OP_ADD ? x : ins.op == OP_SUB ? 0 - x : ~x;
+            }
+            if (ins.rd != 0) r[ins.rd] = result;
+        }
+        if (sim.delaySlots) {
+            int slotTarget = pendingTarget;
+            pendingTarget = transfer ? next : -1;
+            next = slotTarget >= 0 ? slotTarget : pc + 1;
+        }
+        pc = next;
+    }
+    // Fell off the end (or returned from main)
+    st.exitCode = 0;
+    return true;
+}
+
+/* ========== Reporting ========== */
+
+static void printStats(const Simulator& sim, SimulationStatsFormat format) {
+    const SimulationStats& st = sim.stats;
+    // Dynamic counts per mnemonic, most frequent first
+    map<string, long long> byName;
+    for (size_t i = 0; i < sim.text.size(); i++) {
+        if (sim.executed[i]) byName[mnemonics[sim.text[i].mnemonic].name] += sim.executed[i];
+    }
+    vector<pair<long long, string> > mix;
+    for (map<string, long long>::const_iterator it = byName.begin(); it != byName.end(); ++it) {
+        mix.push_back(make_pair(-it->second, it->first));
+    }
+    sort(mix.begin(), mix.end());
+    double cpi = st.machineInstructions ? (double)st.cycles / st.machineInstructions : 0.0;
+
+    if (format == SIM_STATS_JSON) {
+        fprintf(stderr, "{\"file\":\"");
+        for (const char* p = sim.path; *p; p++) {
+            if (*p == '"' || *p == '\\') fputc('\\', stderr);
+            fputc(*p, stderr);
+        }
+        fprintf(stderr, "\",\"exit_code\":%d,\"instructions\":%lld,\"machine_instructions\":%lld,"
+                "\"loads\":%lld,\"stores\":%lld,\"branches\":%lld,\"branches_taken\":%lld,"
+                "\"jumps\":%lld,\"calls\":%lld,\"syscalls\":%lld,\"mul_div\":%lld,\"fp_ops\":%lld,"
+                "\"load_use_stalls\":%lld,\"hilo_stalls\":%lld,\"cycles\":%lld,\"cpi\":%.3f,\"mix\":{",
+                st.exitCode, st.instructions, st.machineInstructions, st.loads, st.stores,
+                st.branches, st.branchesTaken, st.jumps, st.calls, st.syscalls, st.mulDiv,
+                st.fpOps, st.loadUseStalls, st.hiLoStalls, st.cycles, cpi);
+        for (size_t i = 0; i < mix.size(); i++) {
+            fprintf(stderr, "%s\"%s\":%lld", i ? "," : "", mix[i].second.c_str(), -mix[i].first);
+        }
+        fprintf(stderr, "}}\n");
+        return;
+    }
+
+    fprintf(stderr, "\n=== Simulation Statistics: %s ===\n", sim.path);
+    fprintf(stderr, "  Exit code:            %d\n", st.exitCode);
+    fprintf(stderr, "  Instructions:         %lld (%lld after pseudo-instruction expansion)\n",
+            st.instructions, st.machineInstructions);
+    fprintf(stderr, "  Loads / stores:       %lld / %lld\n", st.loads, st.stores);
+    fprintf(stderr, "  Branches (taken):     %lld (%lld)\n", st.branches, st.branchesTaken);
+    fprintf(stderr, "  Jumps (calls):        %lld (%lld)\n", st.jumps, st.calls);
+    fprintf(stderr, "  Syscalls:             %lld\n", st.syscalls);
+    fprintf(stderr, "  Multiply / divide:    %lld\n", st.mulDiv);
+    fprintf(stderr, "  FP operations:        %lld\n", st.fpOps);
+    fprintf(stderr, "  Load-use stalls:      %lld\n", st.loadUseStalls);
+    fprintf(stderr, "  HI/LO stall cycles:   %lld\n", st.hiLoStalls);
+    fprintf(stderr, "  Cycles (model):       %lld (CPI %.3f)\n", st.cycles, cpi);
+    fprintf(stderr, "  Instruction mix:     ");
+    for (size_t i = 0; i < mix.size() && i < 10; i++) {
+        fprintf(stderr, " %s %.1f%%", mix[i].second.c_str(),
+                st.instructions ? 100.0 * -mix[i].first / st.instructions : 0.0);
+    }
+    fprintf(stderr, "\n");
+}
+
+int simulateMIPSFile(const char* path, const SimulationOptions* options, SimulationStats* stats) {
+    // The simulator holds the whole machine state, so it lives on the heap
+    Simulator* sim = new Simulator();
+    sim->path = path;
+    if (options) {
+        sim->options = *options;
+    } else {
+        memset(&sim->options, 0, sizeof(sim->options));
+    }
+    sim->in = sim->options.input ? sim->options.input : stdin;
+    sim->out = sim->options.output ? sim->options.output : stdout;
+    memset(sim->regs, 0, sizeof(sim->regs));
+    memset(sim->fregs, 0, sizeof(sim->fregs));
+    sim->hi = sim->lo = 0;
+    sim->fcc = false;
+    sim->delaySlots = false;
+    memset(&sim->stats, 0, sizeof(sim->stats));
+
+    bool ok = loadProgram(*sim);
+    if (ok) {
+        sim->stack.assign(STACK_SIZE, 0);
+        sim->executed.assign(sim->text.size(), 0);
+        ok = run(*sim);
+        fflush(sim->out);
+        if (sim->options.statsFormat != SIM_STATS_OFF) {
+            printStats(*sim, sim->options.statsFormat);
+        }
+    }
+    if (stats) *stats = sim->stats;
+    delete sim;
+    return ok ? 0 : 1;
+}
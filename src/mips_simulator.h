@@ -0,0 +1,76 @@
+/**
+ * MIPS Simulator
+ * Runs the assembly produced by generateMIPSCode without SPIM: the
+ * integer, FPU and pseudo-instructions the code generator and its runtime
+ * library emit, the .data directives, and the SPIM console syscalls
+ * (print/read int, float, double, string and char, sbrk, exit). main receives
+ * argc/argv in $a0/$a1 with the file name as argv[0], as in SPIM.
+ *
+ * Besides running the program it counts what executed, so the cost of
+ * generated code can be measured offline. Cycles come from a simple
+ * in-order, single-issue model: one cycle per machine instruction
+ * (pseudo-instructions count as the instructions the SPIM assembler
+ * expands them to), plus R2000/R2010-style extra latencies for multiply,
+ * divide and FP operations, one stall cycle when an instruction uses the
+ * result of the load right before it, and one cycle for every taken branch
+ * or jump. mult/div run beside the pipeline: only mfhi/mflo and the next
+ * multiply or divide wait for them, so independent instructions in
+ * between are free. Programs with ".set noreorder" (the real-MIPS output) execute
+ * branch delay slots instead, and taken branches cost no extra cycle.
+ */
+
+#ifndef MIPS_SIMULATOR_H
+#define MIPS_SIMULATOR_H
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct SimulationStats {
+    long long instructions;          // Assembly instructions executed
+    long long machineInstructions;   // After pseudo-instruction expansion
+    long long loads;
+    long long stores;
+    long long branches;              // Conditional branches
+    long long branchesTaken;
+    long long jumps;                 // j, jal, jr, jalr
+    long long calls;                 // jal, jalr
+    long long syscalls;
+    long long mulDiv;                // Integer multiply, divide, remainder
+    long long fpOps;                 // FPU arithmetic, conversion, compare
+    long long loadUseStalls;
+    long long hiLoStalls;            // Cycles waiting for a multiply or divide
+    long long cycles;
+    int exitCode;
+} SimulationStats;
+
+typedef enum {
+    SIM_STATS_OFF,
+    SIM_STATS_TEXT,
+    SIM_STATS_JSON
+} SimulationStatsFormat;
+
+typedef struct SimulationOptions {
+    long long maxInstructions;       // Stop with an error after this many (0 = no limit)
+    SimulationStatsFormat statsFormat;   // Printed to stderr when the program ends
+    FILE* input;                     // Read syscalls (stdin when NULL)
+    FILE* output;                    // Print syscalls (stdout when NULL)
+    int argc;                        // Program arguments after the file name,
+    char** argv;                     // passed to main in $a0/$a1 like SPIM
+} SimulationOptions;
+
+/**
+ * Load and run the assembly file at `path`. Returns 0 when the program
+ * ran to completion (its exit code is in stats->exitCode), 1 if it could
+ * not be loaded or stopped on a runtime error; errors go to stderr.
+ * `stats` may be NULL.
+ */
+int simulateMIPSFile(const char* path, const SimulationOptions* options, SimulationStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MIPS_SIMULATOR_H
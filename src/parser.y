@@ -7,58 +7,13 @@
 #include <string.h>
 #include "ast.h"
 #include "symbol_table.h"
+#include "compiler_context.h"
 
-// Global variables used by the parser
-extern int yylineno;
-extern char* yytext;
-extern FILE* yyin;
-int error_count = 0;
-int semantic_error_count = 0;
-static int anonymous_union_counter = 0;
-static int anonymous_struct_counter = 0;
-static int current_enum_value = 0;  // Track current enum constant value
-int recovering_from_error = 0;
-int in_typedef = 0;
-int is_static = 0;  // Flag to track if current declaration is static
-int has_const_before_ptr = 0;  // Flag for "const int*" (pointer to const)
-int has_const_after_ptr = 0;   // Flag for "int* const" (const pointer)
-int in_function_body = 0;  // Flag to track if we're in a function body compound statement
-int param_count_temp = 0;  // Temporary counter for function parameters
-int parsing_function_decl = 0;  // Flag to indicate we're parsing a function declaration
-int in_function_definition = 0;  // Flag to indicate we're parsing a function definition (not just a declaration)
-char function_return_type[128] = "int";  // Save function return type before parsing parameters
-char saved_declaration_type[128] = "int";  // Save type from declaration_specifiers before declarator parsing
-int loop_depth = 0;  // Track nesting depth of loops (for break/continue validation)
-int switch_depth = 0;  // Track nesting depth of switch statements (for break validation)
-int parsing_parameters = 0;  // Flag to indicate we're parsing function/function pointer parameters
-int parsing_expression_context = 0;  // Flag to indicate we're parsing inside expression (e.g., sizeof)
-
-// Structure to track goto statements for validation
-typedef struct {
-    char label_name[256];
-    int line_number;
-} GotoRef;
-
-GotoRef pending_gotos[100]; 
-int pending_goto_count = 0;
-
-// Structure to store parameter information during parsing
-typedef struct {
-    char name[256];
-    char type[256];
-    int ptrLevel;
-    int isReference;
-} ParamInfo;
-
-ParamInfo pending_params[32];
-int pending_param_count = 0;
-
-// Global AST root, to be passed to the IR generator
-TreeNode* ast_root = NULL;
+// Parser flags, pending gotos/parameters and the AST root live in the
+// CompilerContext (see compiler_context.h); the parser is pure and the
+// scanner reentrant, so every compilation owns its own state.
 
 // Forward declarations
-extern int yylex();
-void yyerror(const char* msg);
 void semantic_error(const char* msg);
 int isFunctionDeclarator(TreeNode* node);
 int hasParameterListDescendant(TreeNode* node);
@@ -313,11 +268,11 @@ void buildFunctionPointerType(char* dest, const char* returnType, TreeNode* decl
     strcat(dest, " (*)(");
     
     // Use the pending_params array that was populated during parsing
-    for (int i = 0; i < pending_param_count; i++) {
+    for (int i = 0; i < ctx->pending_param_count; i++) {
         if (i > 0) {
             strcat(dest, ", ");
         }
-        strcat(dest, pending_params[i].type);
+        strcat(dest, ctx->pending_params[i].type);
     }
     
     strcat(dest, ")");
@@ -623,11 +578,26 @@ int isCharType(const char* type) {
 %code requires {
     #include "ast.h"
     #include "symbol_table.h"
+
+    #ifndef YY_TYPEDEF_YY_SCANNER_T
+    #define YY_TYPEDEF_YY_SCANNER_T
+    typedef void* yyscan_t;
+    #endif
+}
+
+%code provides {
+    int yylex(YYSTYPE* yylval_param, yyscan_t scanner);
+    char* yyget_text(yyscan_t scanner);
+    void yyerror(yyscan_t scanner, const char* msg);
 }
 
 /* ========================================================== */
 /* PART 3: Bison declarations                                 */
 /* ========================================================== */
+%define api.pure full
+%parse-param {yyscan_t scanner}
+%lex-param {yyscan_t scanner}
+
 %union {
     TreeNode* node;
 }
@@ -714,7 +684,7 @@ program:
     translation_unit {
         $$ = createNode(NODE_PROGRAM, "program");
         addChild($$, $1);
-        ast_root = $$;
+        ctx->ast_root = $$;
     }
     ;
 
@@ -791,7 +761,7 @@ function_definition:
         if (funcName) {
             // Extract return type from declaration_specifiers
             char funcRetType[128];
-            strcpy(funcRetType, currentType);
+            strcpy(funcRetType, ctx->currentType);
             
             if ($1 && $1->childCount > 0) {
                 for (int i = 0; i < $1->childCount; i++) {
@@ -809,22 +779,22 @@ function_definition:
                 }
             }
             
-            insertSymbol(funcName, funcRetType, 1, is_static);
+            insertSymbol(funcName, funcRetType, 1, ctx->is_static);
         }
-        is_static = 0;
+        ctx->is_static = 0;
         // Enter function scope
         enterFunctionScope(funcName);
         
         // Now insert the pending parameters that were stored during parsing
-        for (int i = 0; i < pending_param_count; i++) {
-            insertVariable(pending_params[i].name, pending_params[i].type, 0, NULL, 0, pending_params[i].ptrLevel, 0, 0, 0, pending_params[i].isReference);
+        for (int i = 0; i < ctx->pending_param_count; i++) {
+            insertVariable(ctx->pending_params[i].name, ctx->pending_params[i].type, 0, NULL, 0, ctx->pending_params[i].ptrLevel, 0, 0, 0, ctx->pending_params[i].isReference);
         }
         // Mark them as parameters
-        markRecentSymbolsAsParameters(pending_param_count);
-        param_count_temp = pending_param_count; 
-        pending_param_count = 0; 
+        markRecentSymbolsAsParameters(ctx->pending_param_count);
+        ctx->param_count_temp = ctx->pending_param_count; 
+        ctx->pending_param_count = 0; 
         
-        in_function_body = 1;
+        ctx->in_function_body = 1;
     }
     compound_statement
     {
@@ -833,47 +803,47 @@ function_definition:
         addChild($$, $2); // declarator (name)
         addChild($$, $4); // compound_statement (body)
         
-        for (int i = 0; i < pending_goto_count; i++) {
-            Symbol* label = lookupLabel(pending_gotos[i].label_name);
+        for (int i = 0; i < ctx->pending_goto_count; i++) {
+            Symbol* label = lookupLabel(ctx->pending_gotos[i].label_name);
             if (!label) {
-                type_error(pending_gotos[i].line_number, "Undefined label '%s'", 
-                          pending_gotos[i].label_name);
+                type_error(ctx->pending_gotos[i].line_number, "Undefined label '%s'", 
+                          ctx->pending_gotos[i].label_name);
             }
         }
-        pending_goto_count = 0; 
+        ctx->pending_goto_count = 0; 
         
-        in_function_body = 0;
-        param_count_temp = 0;
+        ctx->in_function_body = 0;
+        ctx->param_count_temp = 0;
         exitFunctionScope();
-        recovering_from_error = 0;
+        ctx->recovering_from_error = 0;
     }
     ;
 
 declaration:
     declaration_specifiers SEMICOLON {
-        if (in_typedef) {
-            type_error(yylineno, "typedef declaration does not declare anything");
+        if (ctx->in_typedef) {
+            type_error(currentLineNumber(), "typedef declaration does not declare anything");
         }
         
         $$ = createNode(NODE_DECLARATION, "declaration");
         addChild($$, $1);
-        in_typedef = 0;
-        is_static = 0;
-        has_const_before_ptr = 0;
-        has_const_after_ptr = 0;
-        recovering_from_error = 0;
-        pending_param_count = 0; 
+        ctx->in_typedef = 0;
+        ctx->is_static = 0;
+        ctx->has_const_before_ptr = 0;
+        ctx->has_const_after_ptr = 0;
+        ctx->recovering_from_error = 0;
+        ctx->pending_param_count = 0; 
     }
     | declaration_specifiers init_declarator_list SEMICOLON {
         $$ = createNode(NODE_DECLARATION, "declaration");
         addChild($$, $1);
         addChild($$, $2);
-        in_typedef = 0;
-        is_static = 0;
-        has_const_before_ptr = 0;
-        has_const_after_ptr = 0;
-        recovering_from_error = 0;
-        pending_param_count = 0; 
+        ctx->in_typedef = 0;
+        ctx->is_static = 0;
+        ctx->has_const_before_ptr = 0;
+        ctx->has_const_after_ptr = 0;
+        ctx->recovering_from_error = 0;
+        ctx->pending_param_count = 0; 
     }
     ;
 
@@ -881,11 +851,11 @@ declaration_specifiers:
     specifier {
         $$ = createNode(NODE_DECLARATION_SPECIFIERS, "decl_specs");
         addChild($$, $1);
-        $$->dataType = strdup(currentType);
+        $$->dataType = strdup(ctx->currentType);
         
-        if (!parsing_parameters && !parsing_expression_context) {
-            strncpy(saved_declaration_type, currentType, sizeof(saved_declaration_type) - 1);
-            saved_declaration_type[sizeof(saved_declaration_type) - 1] = '\0';
+        if (!ctx->parsing_parameters && !ctx->parsing_expression_context) {
+            strncpy(ctx->saved_declaration_type, ctx->currentType, sizeof(ctx->saved_declaration_type) - 1);
+            ctx->saved_declaration_type[sizeof(ctx->saved_declaration_type) - 1] = '\0';
         }
     }
     | declaration_specifiers specifier {
@@ -893,11 +863,11 @@ declaration_specifiers:
         addChild($$, $2);
 
         if ($$->dataType) free($$->dataType);
-        $$->dataType = strdup(currentType);
+        $$->dataType = strdup(ctx->currentType);
         
-        if (!parsing_parameters && !parsing_expression_context) {
-            strncpy(saved_declaration_type, currentType, sizeof(saved_declaration_type) - 1);
-            saved_declaration_type[sizeof(saved_declaration_type) - 1] = '\0';
+        if (!ctx->parsing_parameters && !ctx->parsing_expression_context) {
+            strncpy(ctx->saved_declaration_type, ctx->currentType, sizeof(ctx->saved_declaration_type) - 1);
+            ctx->saved_declaration_type[sizeof(ctx->saved_declaration_type) - 1] = '\0';
         }
     }
     ;
@@ -910,12 +880,12 @@ specifier:
 
 storage_class_specifier:
     TYPEDEF {
-        in_typedef = 1;
+        ctx->in_typedef = 1;
         $$ = createNode(NODE_STORAGE_CLASS_SPECIFIER, "typedef");
     }
     | EXTERN { $$ = createNode(NODE_STORAGE_CLASS_SPECIFIER, "extern"); }
     | STATIC {
-        is_static = 1;
+        ctx->is_static = 1;
         $$ = createNode(NODE_STORAGE_CLASS_SPECIFIER, "static");
     }
     | AUTO { $$ = createNode(NODE_STORAGE_CLASS_SPECIFIER, "auto"); }
@@ -973,7 +943,7 @@ type_specifier:
 
 type_qualifier:
     CONST { 
-        has_const_before_ptr = 1;  // Track that const appeared in declaration
+        ctx->has_const_before_ptr = 1;  // Track that const appeared in declaration
         $$ = createNode(NODE_TYPE_QUALIFIER, "const"); 
     }
     | VOLATILE { $$ = createNode(NODE_TYPE_QUALIFIER, "volatile"); }
@@ -991,7 +961,7 @@ struct_or_union_specifier:
     | STRUCT LBRACE struct_declaration_list RBRACE {
         // Anonymous struct - generate a name for size calculation
         char anonName[128];
-        sprintf(anonName, "__anon_struct_%d", anonymous_struct_counter++);
+        sprintf(anonName, "__anon_struct_%d", ctx->anonymous_struct_counter++);
         
         // Parse struct members and insert into struct table
         parseStructDefinition(anonName, $3);
@@ -1025,7 +995,7 @@ struct_or_union_specifier:
     | UNION LBRACE struct_declaration_list RBRACE {
         // Anonymous union - generate a name for size calculation
         char anonName[128];
-        sprintf(anonName, "__anon_union_%d", anonymous_union_counter++);
+        sprintf(anonName, "__anon_union_%d", ctx->anonymous_union_counter++);
         
         // Parse union members and insert into union table
         parseUnionDefinition(anonName, $3);
@@ -1077,7 +1047,7 @@ struct_declarator:
 enum_specifier:
     ENUM LBRACE enumerator_list RBRACE {
         setCurrentType("enum");
-        current_enum_value = 0;  // Reset enum counter
+        ctx->current_enum_value = 0;  // Reset enum counter
         $$ = createNode(NODE_ENUM_SPECIFIER, "enum");
         addChild($$, $3);
     }
@@ -1088,7 +1058,7 @@ enum_specifier:
     }
     | ENUM IDENTIFIER LBRACE enumerator_list RBRACE {
         setCurrentType("enum");
-        current_enum_value = 0;  // Reset enum counter
+        ctx->current_enum_value = 0;  // Reset enum counter
         $$ = createNode(NODE_ENUM_SPECIFIER, "enum");
         addChild($$, $2);
         addChild($$, $4);
@@ -1106,11 +1076,11 @@ enumerator:
             // Enum constants are integers, so size is 4 bytes
             insertVariable($1->value, "int", 0, NULL, 0, 0, 0, 0, 0, 0);  // Enum constants are not static or references
             // Update the last inserted symbol's kind to enum_constant and set its value
-            if (symCount > 0 && strcmp(symtab[symCount - 1].name, $1->value) == 0) {
-                strcpy(symtab[symCount - 1].kind, "enum_constant");
-                symtab[symCount - 1].offset = current_enum_value;  // Store enum value in offset field
+            if (ctx->symCount > 0 && strcmp(ctx->symtab[ctx->symCount - 1].name, $1->value) == 0) {
+                strcpy(ctx->symtab[ctx->symCount - 1].kind, "enum_constant");
+                ctx->symtab[ctx->symCount - 1].offset = ctx->current_enum_value;  // Store enum value in offset field
             }
-            current_enum_value++;  // Increment for next enum constant
+            ctx->current_enum_value++;  // Increment for next enum constant
         }
         $$ = $1;
     }
@@ -1122,11 +1092,11 @@ enumerator:
             // Enum constants are integers, so size is 4 bytes
             insertVariable($1->value, "int", 0, NULL, 0, 0, 0, 0, 0, 0);  // Enum constants are not static or references
             // Update the last inserted symbol's kind to enum_constant and set its value
-            if (symCount > 0 && strcmp(symtab[symCount - 1].name, $1->value) == 0) {
-                strcpy(symtab[symCount - 1].kind, "enum_constant");
-                symtab[symCount - 1].offset = enum_val;  // Store enum value in offset field
+            if (ctx->symCount > 0 && strcmp(ctx->symtab[ctx->symCount - 1].name, $1->value) == 0) {
+                strcpy(ctx->symtab[ctx->symCount - 1].kind, "enum_constant");
+                ctx->symtab[ctx->symCount - 1].offset = enum_val;  // Store enum value in offset field
             }
-            current_enum_value = enum_val + 1;  // Next enum constant will be enum_val + 1
+            ctx->current_enum_value = enum_val + 1;  // Next enum constant will be enum_val + 1
         }
         $$ = $1;
         addChild($$, $3);
@@ -1149,7 +1119,7 @@ init_declarator:
         
         // Use the saved declaration type (saved before parsing declarator)
         char savedCurrentType[256];
-        strncpy(savedCurrentType, saved_declaration_type, 255);
+        strncpy(savedCurrentType, ctx->saved_declaration_type, 255);
         savedCurrentType[255] = '\0';
         
         // Skip insertion for function declarators, but not for function pointers
@@ -1157,29 +1127,24 @@ init_declarator:
         int ptrLevel = countPointerLevels($1);
         int refLevel = countReferenceLevels($1);
         int isRef = (refLevel > 0);
-        int isFuncPtr = isFunctionPointer($1) || (ptrLevel > 0 && pending_param_count > 0);
+        int isFuncPtr = isFunctionPointer($1) || (ptrLevel > 0 && ctx->pending_param_count > 0);
         
-        if (varName && (pending_param_count == 0 || isFuncPtr)) {
+        if (varName && (ctx->pending_param_count == 0 || isFuncPtr)) {
             // ERROR A: Check for redeclaration of typedef name as variable
-            if (!in_typedef) {
+            if (!ctx->in_typedef) {
                 // Check if varName is already a typedef in current or outer scope
-                for (int i = symCount - 1; i >= 0; i--) {
-                    if (strcmp(symtab[i].name, varName) == 0) {
-                        if (strcmp(symtab[i].kind, "typedef") == 0) {
-                            type_error(yylineno, "redeclaration of '%s' as different kind of symbol (was typedef)", varName);
-                            break;
-                        }
-                    }
+                if (is_type_name(varName)) {
+                    type_error(currentLineNumber(), "redeclaration of '%s' as different kind of symbol (was typedef)", varName);
                 }
             }
             
             // FIX 2: Check for conflicting storage class on redeclaration/shadowing
             Symbol* existing = lookupSymbol(varName);
-            if (existing && existing->scope_level != current_scope) {
+            if (existing && existing->scope_level != ctx->current_scope) {
                 // This is shadowing (declaring in inner scope)
                 // Check if storage classes conflict
-                if (existing->is_static != is_static) {
-                    type_error(yylineno, "Conflicting storage class for re-declaration of '%s'", varName);
+                if (existing->is_static != ctx->is_static) {
+                    type_error(currentLineNumber(), "Conflicting storage class for re-declaration of '%s'", varName);
                 }
             }
             
@@ -1193,7 +1158,7 @@ init_declarator:
                 
                 // Check for error: array has empty brackets but no initializer
                 if (hasEmptyBrackets && numDims == 0) {
-                    type_error(yylineno, "array size missing and no initializer");
+                    type_error(currentLineNumber(), "array size missing and no initializer");
                 }
             }
             
@@ -1208,26 +1173,26 @@ init_declarator:
                 buildFullType(fullType, savedCurrentType, ptrLevel);
             }
             
-            if (in_typedef) {
+            if (ctx->in_typedef) {
                 // Insert the symbol and then manually set its kind to "typedef".
-                insertVariable(varName, fullType, isArray, arrayDims, numDims, ptrLevel, 0, has_const_before_ptr, has_const_after_ptr, isRef);  // Typedefs are not static
-                if (symCount > 0 && strcmp(symtab[symCount - 1].name, varName) == 0) {
-                    strcpy(symtab[symCount - 1].kind, "typedef");
+                insertVariable(varName, fullType, isArray, arrayDims, numDims, ptrLevel, 0, ctx->has_const_before_ptr, ctx->has_const_after_ptr, isRef);  // Typedefs are not static
+                if (ctx->symCount > 0 && strcmp(ctx->symtab[ctx->symCount - 1].name, varName) == 0) {
+                    markSymbolAsTypedef(&ctx->symtab[ctx->symCount - 1]);
                 }
             } else {
                 // Always insert the variable into the symbol table
                 // The symbol table will handle duplicates within the same scope/block
                 // has_const_before_ptr -> points_to_const, has_const_after_ptr -> is_const_ptr
-                insertVariable(varName, fullType, isArray, arrayDims, numDims, ptrLevel, is_static, has_const_before_ptr, has_const_after_ptr, isRef);
+                insertVariable(varName, fullType, isArray, arrayDims, numDims, ptrLevel, ctx->is_static, ctx->has_const_before_ptr, ctx->has_const_after_ptr, isRef);
                 // Mark as function pointer if needed
-                if (isFuncPtr && symCount > 0 && strcmp(symtab[symCount - 1].name, varName) == 0) {
-                    strcpy(symtab[symCount - 1].kind, "function_pointer");
+                if (isFuncPtr && ctx->symCount > 0 && strcmp(ctx->symtab[ctx->symCount - 1].name, varName) == 0) {
+                    strcpy(ctx->symtab[ctx->symCount - 1].kind, "function_pointer");
                     registerFunctionPointer(varName);  // Register for IR generation
                 }
                 
                 // Reset pending parameters for function pointers (they don't define functions)
                 if (isFuncPtr) {
-                    pending_param_count = 0;
+                    ctx->pending_param_count = 0;
                 }
             }
         }
@@ -1238,34 +1203,29 @@ init_declarator:
         
         // Use the saved declaration type (saved before parsing declarator)
         char savedCurrentType[256];
-        strncpy(savedCurrentType, saved_declaration_type, 255);
+        strncpy(savedCurrentType, ctx->saved_declaration_type, 255);
         savedCurrentType[255] = '\0';
         
-        if (varName && !in_typedef) {
+        if (varName && !ctx->in_typedef) {
             // ERROR A: Check for redeclaration of typedef name as variable
             // Check if varName is already a typedef in current or outer scope
-            for (int i = symCount - 1; i >= 0; i--) {
-                if (strcmp(symtab[i].name, varName) == 0) {
-                    if (strcmp(symtab[i].kind, "typedef") == 0) {
-                        type_error(yylineno, "redeclaration of '%s' as different kind of symbol (was typedef)", varName);
-                        break;
-                    }
-                }
+            if (is_type_name(varName)) {
+                type_error(currentLineNumber(), "redeclaration of '%s' as different kind of symbol (was typedef)", varName);
             }
             
             // FIX 2: Check for conflicting storage class on redeclaration/shadowing
             Symbol* existing = lookupSymbol(varName);
-            if (existing && existing->scope_level != current_scope) {
+            if (existing && existing->scope_level != ctx->current_scope) {
                 // This is shadowing (declaring in inner scope)
                 // Check if storage classes conflict
-                if (existing->is_static != is_static) {
-                    type_error(yylineno, "Conflicting storage class for re-declaration of '%s'", varName);
+                if (existing->is_static != ctx->is_static) {
+                    type_error(currentLineNumber(), "Conflicting storage class for re-declaration of '%s'", varName);
                 }
             }
             
             // FIX 3: Check for non-constant initializer on static variable
-            if (is_static && !isConstantExpression($3)) {
-                type_error(yylineno, "Initializer for static storage must be constant");
+            if (ctx->is_static && !isConstantExpression($3)) {
+                type_error(currentLineNumber(), "Initializer for static storage must be constant");
             }
             
             int ptrLevel = countPointerLevels($1);
@@ -1275,7 +1235,7 @@ init_declarator:
             int arrayDims[10] = {0};
             int numDims = 0;
             int hasEmptyBrackets = hasEmptyArrayBrackets($1);
-            int isFuncPtr = isFunctionPointer($1) || (ptrLevel > 0 && pending_param_count > 0);
+            int isFuncPtr = isFunctionPointer($1) || (ptrLevel > 0 && ctx->pending_param_count > 0);
             
             if (isArray) {
                 numDims = extractArrayDimensions($1, arrayDims, 10);
@@ -1283,7 +1243,7 @@ init_declarator:
                 // Check for negative array sizes in extracted dimensions
                 for (int i = 0; i < numDims; i++) {
                     if (arrayDims[i] < 0) {
-                        type_error(yylineno, "negative array size");
+                        type_error(currentLineNumber(), "negative array size");
                         break;
                     }
                 }
@@ -1297,7 +1257,7 @@ init_declarator:
                         arrayDims[0] = initCount;
                         numDims = 1;
                     } else {
-                        type_error(yylineno, "array size missing and no initializer");
+                        type_error(currentLineNumber(), "array size missing and no initializer");
                     }
                 } else if (numDims > 0 && arrayDims[0] > 0) {
                     // Validate: explicit size exists, check initializer count
@@ -1305,7 +1265,7 @@ init_declarator:
                     if (initCount > arrayDims[0]) {
                         char fullType[256];
                         buildFullType(fullType, savedCurrentType, ptrLevel);
-                        type_error(yylineno, "too many initializers for '%s[%d]'", 
+                        type_error(currentLineNumber(), "too many initializers for '%s[%d]'", 
                                   fullType, arrayDims[0]);
                     }
                     // Partial initialization is OK (initCount < arrayDims[0])
@@ -1342,9 +1302,9 @@ init_declarator:
                 // Trying to initialize non-pointer scalar with array
                 char* base_type = getArrayBaseType($3->dataType);
                 if (base_type) {
-                    type_error(yylineno, "cannot convert array type '%s' to '%s'", $3->dataType, base_type);
+                    type_error(currentLineNumber(), "cannot convert array type '%s' to '%s'", $3->dataType, base_type);
                 } else {
-                    type_error(yylineno, "cannot convert array type '%s' to '%s'", $3->dataType, fullType);
+                    type_error(currentLineNumber(), "cannot convert array type '%s' to '%s'", $3->dataType, fullType);
                 }
             }
             
@@ -1353,10 +1313,10 @@ init_declarator:
                 char* init_decayed = decayArrayToPointer($3->dataType);
                 // If initializer is not a pointer and not NULL, it's an error
                 if (!strstr(init_decayed, "*") && !isArithmeticType(init_decayed)) {
-                    type_error(yylineno, "initialization makes pointer from integer without a cast");
+                    type_error(currentLineNumber(), "initialization makes pointer from integer without a cast");
                 } else if (isArithmeticType(init_decayed)) {
                     // Integer to pointer (not NULL)
-                    type_error(yylineno, "initialization makes pointer from integer without a cast");
+                    type_error(currentLineNumber(), "initialization makes pointer from integer without a cast");
                 }
                 free(init_decayed);
             }
@@ -1366,15 +1326,15 @@ init_declarator:
                 char* init_decayed = decayArrayToPointer($3->dataType);
                 if (strstr(init_decayed, "*")) {
                     // Trying to initialize integer with pointer
-                    type_error(yylineno, "initialization makes integer from pointer without a cast");
+                    type_error(currentLineNumber(), "initialization makes integer from pointer without a cast");
                 }
                 free(init_decayed);
             }
             
-            insertVariable(varName, fullType, isArray, arrayDims, numDims, ptrLevel, is_static, has_const_before_ptr, has_const_after_ptr, isRef);
+            insertVariable(varName, fullType, isArray, arrayDims, numDims, ptrLevel, ctx->is_static, ctx->has_const_before_ptr, ctx->has_const_after_ptr, isRef);
             // Mark as function pointer if needed
-            if (isFuncPtr && symCount > 0 && strcmp(symtab[symCount - 1].name, varName) == 0) {
-                strcpy(symtab[symCount - 1].kind, "function_pointer");
+            if (isFuncPtr && ctx->symCount > 0 && strcmp(ctx->symtab[ctx->symCount - 1].name, varName) == 0) {
+                strcpy(ctx->symtab[ctx->symCount - 1].kind, "function_pointer");
                 registerFunctionPointer(varName);  // Register for IR generation
             }
             
@@ -1411,7 +1371,7 @@ declarator:
         /* TODO: This should update the pointer level for symbol table */
     }
     | MULTIPLY type_qualifier_list declarator {
-        has_const_after_ptr = 1;  // const appears after pointer (e.g., int* const)
+        ctx->has_const_after_ptr = 1;  // const appears after pointer (e.g., int* const)
         $$ = createNode(NODE_POINTER, "*");
         addChild($$, $2); // type_qualifier_list
         addChild($$, $3); // declarator
@@ -1444,16 +1404,16 @@ direct_declarator:
             // Check if the size expression is of integer type
             if ($3->dataType && !isIntegerType($3->dataType)) {
                 if ($3->value) {
-                    type_error(yylineno, "invalid array size '%s'", $3->value);
+                    type_error(currentLineNumber(), "invalid array size '%s'", $3->value);
                 } else {
-                    type_error(yylineno, "invalid array size (non-integer type)");
+                    type_error(currentLineNumber(), "invalid array size (non-integer type)");
                 }
             } 
             // Check if size is a negative constant
             else if ($3->value) {
                 int size = atoi($3->value);
                 if (size < 0) {
-                    type_error(yylineno, "negative array size");
+                    type_error(currentLineNumber(), "negative array size");
                 }
             }
             addChild($$, $3);  // Store the dimension
@@ -1461,12 +1421,12 @@ direct_declarator:
     }
     | direct_declarator LPAREN RPAREN {
         $$ = $1;
-        param_count_temp = 0;  // No parameters
-        pending_param_count = 0; // Reset for empty parameter list
+        ctx->param_count_temp = 0;  // No parameters
+        ctx->pending_param_count = 0; // Reset for empty parameter list
     }
-    | direct_declarator LPAREN { param_count_temp = 0; pending_param_count = 0; parsing_parameters = 1; } parameter_type_list RPAREN {
+    | direct_declarator LPAREN { ctx->param_count_temp = 0; ctx->pending_param_count = 0; ctx->parsing_parameters = 1; } parameter_type_list RPAREN {
         $$ = $1;
-        parsing_parameters = 0;  // Reset flag after parsing parameters
+        ctx->parsing_parameters = 0;  // Reset flag after parsing parameters
     }
     ;
 
@@ -1496,7 +1456,7 @@ parameter_declaration:
     declaration_specifiers declarator {
         // FIX 1: Check for illegal 'static' storage class on function parameters
         if (hasStorageClass($1, "static")) {
-            type_error(yylineno, "Illegal storage class 'static' on function parameter");
+            type_error(currentLineNumber(), "Illegal storage class 'static' on function parameter");
         }
         
         // Store parameter information instead of inserting it immediately
@@ -1507,7 +1467,7 @@ parameter_declaration:
         
         // Extract identifier name and count pointer/reference levels
         const char* paramName = extractIdentifierName($2);
-        if (paramName && pending_param_count < 32) {
+        if (paramName && ctx->pending_param_count < 32) {
             int ptrLevel = countPointerLevels($2);
             int refLevel = countReferenceLevels($2);
             int isRef = (refLevel > 0);
@@ -1520,23 +1480,23 @@ parameter_declaration:
             char fullType[256];
             if (isRef) {
                 // Build type with reference
-                buildFullTypeWithRefs(fullType, currentType, $2);
+                buildFullTypeWithRefs(fullType, ctx->currentType, $2);
             } else {
-                buildFullType(fullType, currentType, totalPtrLevel);
+                buildFullType(fullType, ctx->currentType, totalPtrLevel);
             }
             
             // Store parameter info for later insertion (if this is a definition)
-            strncpy(pending_params[pending_param_count].name, paramName, 255);
-            strncpy(pending_params[pending_param_count].type, fullType, 255);
-            pending_params[pending_param_count].ptrLevel = totalPtrLevel;
-            pending_params[pending_param_count].isReference = isRef;
-            pending_param_count++;
+            strncpy(ctx->pending_params[ctx->pending_param_count].name, paramName, 255);
+            strncpy(ctx->pending_params[ctx->pending_param_count].type, fullType, 255);
+            ctx->pending_params[ctx->pending_param_count].ptrLevel = totalPtrLevel;
+            ctx->pending_params[ctx->pending_param_count].isReference = isRef;
+            ctx->pending_param_count++;
         }
     }
     | declaration_specifiers abstract_declarator {
         // FIX 1: Check for illegal 'static' storage class on function parameters
         if (hasStorageClass($1, "static")) {
-            type_error(yylineno, "Illegal storage class 'static' on function parameter");
+            type_error(currentLineNumber(), "Illegal storage class 'static' on function parameter");
         }
         
         $$ = createNode(NODE_PARAMETER_DECLARATION, "param");
@@ -1544,7 +1504,7 @@ parameter_declaration:
         addChild($$, $2);
         
         // Extract type information for function pointers
-        if (pending_param_count < 32) {
+        if (ctx->pending_param_count < 32) {
             int refLevel = countReferenceLevels($2);
             int ptrLevel = countPointerLevels($2);
             int isRef = (refLevel > 0);
@@ -1552,38 +1512,38 @@ parameter_declaration:
             
             char fullType[256];
             if (isRef) {
-                buildFullTypeWithRefs(fullType, currentType, $2);
+                buildFullTypeWithRefs(fullType, ctx->currentType, $2);
             } else {
-                buildFullType(fullType, currentType, totalPtrLevel);
+                buildFullType(fullType, ctx->currentType, totalPtrLevel);
             }
             
-            strncpy(pending_params[pending_param_count].name, "", 255);  // No name for abstract declarator
-            strncpy(pending_params[pending_param_count].type, fullType, 255);
-            pending_params[pending_param_count].ptrLevel = totalPtrLevel;
-            pending_params[pending_param_count].isReference = isRef;
+            strncpy(ctx->pending_params[ctx->pending_param_count].name, "", 255);  // No name for abstract declarator
+            strncpy(ctx->pending_params[ctx->pending_param_count].type, fullType, 255);
+            ctx->pending_params[ctx->pending_param_count].ptrLevel = totalPtrLevel;
+            ctx->pending_params[ctx->pending_param_count].isReference = isRef;
         }
         
         // Also count parameters without names (for function pointers)
-        pending_param_count++;
+        ctx->pending_param_count++;
     }
     | declaration_specifiers { 
         // FIX 1: Check for illegal 'static' storage class on function parameters
         if (hasStorageClass($1, "static")) {
-            type_error(yylineno, "Illegal storage class 'static' on function parameter");
+            type_error(currentLineNumber(), "Illegal storage class 'static' on function parameter");
         }
         
         $$ = $1;
         
         // Extract type information for function pointers (plain type, no pointer/reference)
-        if (pending_param_count < 32) {
-            strncpy(pending_params[pending_param_count].name, "", 255);
-            strncpy(pending_params[pending_param_count].type, currentType, 255);
-            pending_params[pending_param_count].ptrLevel = 0;
-            pending_params[pending_param_count].isReference = 0;
+        if (ctx->pending_param_count < 32) {
+            strncpy(ctx->pending_params[ctx->pending_param_count].name, "", 255);
+            strncpy(ctx->pending_params[ctx->pending_param_count].type, ctx->currentType, 255);
+            ctx->pending_params[ctx->pending_param_count].ptrLevel = 0;
+            ctx->pending_params[ctx->pending_param_count].isReference = 0;
         }
         
         // Also count parameters with just type (for function pointers)
-        pending_param_count++;
+        ctx->pending_param_count++;
     }
     ;
 
@@ -1649,28 +1609,28 @@ labeled_statement:
 
 compound_statement:
     LBRACE {
-        if (!in_function_body) {
+        if (!ctx->in_function_body) {
             enterScope();  // Only enter scope for nested blocks, not function body
         }
-        in_function_body = 0;  // After first brace, we're past function body level
+        ctx->in_function_body = 0;  // After first brace, we're past function body level
     } RBRACE {
         $$ = createNode(NODE_COMPOUND_STATEMENT, "compound");
-        if (current_scope > 0) {
+        if (ctx->current_scope > 0) {
             exitScope();
         }
-        recovering_from_error = 0;
+        ctx->recovering_from_error = 0;
     }
     | LBRACE {
-        if (!in_function_body) {
+        if (!ctx->in_function_body) {
             enterScope();  // Only enter scope for nested blocks, not function body
         }
-        in_function_body = 0;  // After first brace, we're past function body level
+        ctx->in_function_body = 0;  // After first brace, we're past function body level
     } block_item_list RBRACE {
         $$ = $3; // Pass up the block_item_list node
-        if (current_scope > 0) {
+        if (ctx->current_scope > 0) {
             exitScope();
         }
-        recovering_from_error = 0;
+        ctx->recovering_from_error = 0;
     }
     ;
 
@@ -1694,16 +1654,16 @@ block_item:
 expression_statement:
     SEMICOLON {
         $$ = createNode(NODE_EXPRESSION_STATEMENT, ";");
-        recovering_from_error = 0;
+        ctx->recovering_from_error = 0;
     }
     | expression SEMICOLON {
         $$ = $1;
-        recovering_from_error = 0;
+        ctx->recovering_from_error = 0;
     }
     | error SEMICOLON {
         $$ = createNode(NODE_EXPRESSION_STATEMENT, "error_recovery");
         yyerrok;
-        recovering_from_error = 1;
+        ctx->recovering_from_error = 1;
     }
     ;
 
@@ -1711,7 +1671,7 @@ if_header:
     IF LPAREN expression RPAREN {
         // Check that the condition expression is not void
         if ($3 && $3->dataType && strcmp($3->dataType, "void") == 0) {
-            type_error(yylineno, "void value not ignored as it ought to be");
+            type_error(currentLineNumber(), "void value not ignored as it ought to be");
         }
         
         // ERROR 5: Validate that condition is scalar type
@@ -1745,7 +1705,7 @@ selection_statement:
         $$ = createNode(NODE_SELECTION_STATEMENT, "if");
         addChild($$, $1); // The expression from if_header
         addChild($$, $2); // The 'then' statement
-        recovering_from_error = 0;
+        ctx->recovering_from_error = 0;
     }
     | if_header statement ELSE {
         /* All emit logic from this MRA is REMOVED */
@@ -1756,24 +1716,24 @@ selection_statement:
         addChild($$, $1); // The expression from if_header
         addChild($$, $2); // The 'then' statement
         addChild($$, $5); // The 'else' statement
-        recovering_from_error = 0;
+        ctx->recovering_from_error = 0;
       }
     | SWITCH LPAREN expression RPAREN {
-        switch_depth++;  // Enter switch context
+        ctx->switch_depth++;  // Enter switch context
     } statement {
         /* All label, stack, and emit logic REMOVED */
-        switch_depth--;  // Exit switch context
+        ctx->switch_depth--;  // Exit switch context
         $$ = createNode(NODE_SELECTION_STATEMENT, "switch");
         addChild($$, $3); // The expression
         addChild($$, $6); // The statement
-        recovering_from_error = 0;
+        ctx->recovering_from_error = 0;
     }
     ;
 
 /* == Helper rules for do-while/until == */
 do_header:
     DO {
-        loop_depth++;  // Enter loop context
+        ctx->loop_depth++;  // Enter loop context
         $$ = createNode(NODE_MARKER, "do_header");
         /* All label, stack, and emit logic REMOVED */
     }
@@ -1784,7 +1744,7 @@ do_trailer:
         /* emit("IF_TRUE_GOTO", ...) REMOVED */
         // Check that the condition expression is not void
         if ($3 && $3->dataType && strcmp($3->dataType, "void") == 0) {
-            type_error(yylineno, "void value not ignored as it ought to be");
+            type_error(currentLineNumber(), "void value not ignored as it ought to be");
         }
         
         // ERROR 5: Validate that condition is scalar type
@@ -1799,7 +1759,7 @@ do_trailer:
         /* emit("IF_FALSE_GOTO", ...) REMOVED */
         // Check that the condition expression is not void
         if ($3 && $3->dataType && strcmp($3->dataType, "void") == 0) {
-            type_error(yylineno, "void value not ignored as it ought to be");
+            type_error(currentLineNumber(), "void value not ignored as it ought to be");
         }
         
         // ERROR 5: Validate that condition is scalar type
@@ -1828,7 +1788,7 @@ iteration_statement:
         /* emit("IF_FALSE_GOTO", ...) REMOVED */
         // Check that the condition expression is not void
         if ($4 && $4->dataType && strcmp($4->dataType, "void") == 0) {
-            type_error(yylineno, "void value not ignored as it ought to be");
+            type_error(currentLineNumber(), "void value not ignored as it ought to be");
         }
         
         // ERROR 5: Validate that condition is scalar type
@@ -1836,25 +1796,25 @@ iteration_statement:
             validateConditional($4);
         }
         
-        loop_depth++;  // Enter loop context
+        ctx->loop_depth++;  // Enter loop context
     }
     statement
     {
         /* All emit and popLoopLabels logic REMOVED */
-        loop_depth--;  // Exit loop context
+        ctx->loop_depth--;  // Exit loop context
         $$ = createNode(NODE_ITERATION_STATEMENT, "while");
         addChild($$, $4); // expression
         addChild($$, $7); // statement
         addChild($$, $3); // Add the marker node
-        recovering_from_error = 0;
+        ctx->recovering_from_error = 0;
     }
     | do_header statement do_trailer {
         /* All emit and popLoopLabels logic REMOVED */
-        loop_depth--;  // Exit loop context (entered in do_header)
+        ctx->loop_depth--;  // Exit loop context (entered in do_header)
         $$ = $3; // The node (do_while/do_until) created in do_trailer
         addChild($$, $1); // do_header marker
         addChild($$, $2); // statement
-        recovering_from_error = 0;
+        ctx->recovering_from_error = 0;
     }
     | FOR LPAREN
         expression_statement                  // $3: init
@@ -1866,27 +1826,27 @@ iteration_statement:
             if ($5 && $5->childCount > 0 && $5->children[0]) {
                 TreeNode* cond = $5->children[0];
                 if (cond->dataType && strcmp(cond->dataType, "void") == 0) {
-                    type_error(yylineno, "void value not ignored as it ought to be");
+                    type_error(currentLineNumber(), "void value not ignored as it ought to be");
                 }
                 
                 // ERROR 5: Validate that condition is scalar type
                 validateConditional(cond);
             }
-            loop_depth++;  // Enter loop context
+            ctx->loop_depth++;  // Enter loop context
         }
         for_increment_expression              // $7: incr (can be empty)
         RPAREN                                // $8
         statement                             // $9: body
         {
             /* All emit and popLoopLabels logic REMOVED */
-            loop_depth--;  // Exit loop context
+            ctx->loop_depth--;  // Exit loop context
             $$ = createNode(NODE_ITERATION_STATEMENT, "for");
             addChild($$, $3);  // init
             addChild($$, $5);  // cond
             if ($7) addChild($$, $7);  // incr (only if present)
             addChild($$, $9);  // statement body
             addChild($$, $4);  // Add the marker node
-            recovering_from_error = 0;
+            ctx->recovering_from_error = 0;
         }
     | FOR LPAREN
         {
@@ -1902,27 +1862,27 @@ iteration_statement:
             if ($6 && $6->childCount > 0 && $6->children[0]) {
                 TreeNode* cond = $6->children[0];
                 if (cond->dataType && strcmp(cond->dataType, "void") == 0) {
-                    type_error(yylineno, "void value not ignored as it ought to be");
+                    type_error(currentLineNumber(), "void value not ignored as it ought to be");
                 }
                 
                 // ERROR 5: Validate that condition is scalar type
                 validateConditional(cond);
             }
-            loop_depth++;  // Enter loop context
+            ctx->loop_depth++;  // Enter loop context
         }
         for_increment_expression              // $8: incr (can be empty)
         RPAREN                                // $9
         statement                             // $10: body
         {
             /* All emit and popLoopLabels logic REMOVED */
-            loop_depth--;  // Exit loop context
+            ctx->loop_depth--;  // Exit loop context
             $$ = createNode(NODE_ITERATION_STATEMENT, "for");
             addChild($$, $4);  // init (declaration)
             addChild($$, $6);  // cond
             if ($8) addChild($$, $8);  // incr (only if present)
             addChild($$, $10);  // statement body
             addChild($$, $5);  // Add the marker node
-            recovering_from_error = 0;
+            ctx->recovering_from_error = 0;
             
             // Exit the for loop scope
             exitScope();
@@ -1933,10 +1893,10 @@ jump_statement:
     GOTO IDENTIFIER SEMICOLON {
         /* emit("GOTO", ...) REMOVED */
         // Record goto for later validation (after all labels are defined)
-        if ($2 && $2->value && pending_goto_count < 100) {
-            strcpy(pending_gotos[pending_goto_count].label_name, $2->value);
-            pending_gotos[pending_goto_count].line_number = yylineno;
-            pending_goto_count++;
+        if ($2 && $2->value && ctx->pending_goto_count < 100) {
+            strcpy(ctx->pending_gotos[ctx->pending_goto_count].label_name, $2->value);
+            ctx->pending_gotos[ctx->pending_goto_count].line_number = currentLineNumber();
+            ctx->pending_goto_count++;
         }
         $$ = createNode(NODE_JUMP_STATEMENT, "goto");
         addChild($$, $2);
@@ -1944,16 +1904,16 @@ jump_statement:
     | CONTINUE SEMICOLON {
         /* All label logic and emit REMOVED */
         // Semantic check: continue must be inside a loop
-        if (loop_depth == 0) {
-            type_error(yylineno, "'continue' statement not in loop");
+        if (ctx->loop_depth == 0) {
+            type_error(currentLineNumber(), "'continue' statement not in loop");
         }
         $$ = createNode(NODE_JUMP_STATEMENT, "continue");
     }
     | BREAK SEMICOLON {
         /* All label logic and emit REMOVED */
         // Semantic check: break must be inside a loop or switch
-        if (loop_depth == 0 && switch_depth == 0) {
-            type_error(yylineno, "'break' statement not in loop or switch");
+        if (ctx->loop_depth == 0 && ctx->switch_depth == 0) {
+            type_error(currentLineNumber(), "'break' statement not in loop or switch");
         }
         $$ = createNode(NODE_JUMP_STATEMENT, "break");
     }
@@ -2328,7 +2288,7 @@ cast_expression:
         
         // Extract the cast type from the type_name node
         char cast_type[256];
-        strcpy(cast_type, currentType);
+        strcpy(cast_type, ctx->currentType);
         
         // Check if abstract_declarator adds pointer levels
         if ($2->childCount > 1) {
@@ -2446,9 +2406,9 @@ unary_expression:
         $$->dataType = strdup("int");
         /* $$->tacResult = ... REMOVED */
     }
-    | SIZEOF LPAREN { parsing_expression_context++; } type_name RPAREN {
+    | SIZEOF LPAREN { ctx->parsing_expression_context++; } type_name RPAREN {
         /* newTemp(), emit("ASSIGN") REMOVED */
-        parsing_expression_context--;  // Exit expression context
+        ctx->parsing_expression_context--;  // Exit expression context
         $$ = createNode(NODE_UNARY_EXPRESSION, "sizeof");
         addChild($$, $4); // Add the type_name node (shifted because of mid-rule action)
         $$->dataType = strdup("int");
@@ -2558,7 +2518,7 @@ primary_expression:
                 $$->isLValue = !sym->is_function;
             } else {
                 // Undeclared identifier - report semantic error
-                type_error(yylineno, "'%s' undeclared (first use in this function)", $1->value);
+                type_error(currentLineNumber(), "'%s' undeclared (first use in this function)", $1->value);
                 $$->dataType = strdup("int"); // Assume int to continue parsing
                 $$->isLValue = 1; // Assume lvalue
             }
@@ -2667,20 +2627,48 @@ argument_expression_list:
  * Only yyerror() remains, as it is tightly coupled with the parser.
  */
 
-void yyerror(const char* msg) {
-    if (!recovering_from_error) {
-        fprintf(stderr, "Syntax Error on line %d: %s", yylineno, msg);
-        if (yytext && strlen(yytext) > 0) {
-            fprintf(stderr, " at '%s'", yytext);
+void yyerror(yyscan_t scanner, const char* msg) {
+    if (!ctx->recovering_from_error) {
+        fprintf(stderr, "Syntax Error on line %d: %s", currentLineNumber(), msg);
+        const char* text = yyget_text(scanner);
+        if (text && strlen(text) > 0) {
+            fprintf(stderr, " at '%s'", text);
         }
         fprintf(stderr, "\n");
-        error_count++;
-        recovering_from_error = 1;
+        ctx->error_count++;
+        ctx->recovering_from_error = 1;
     }
 }
 
 void semantic_error(const char* msg) {
-    fprintf(stderr, "Semantic Error on line %d: %s\n", yylineno, msg);
-    semantic_error_count++;
-    error_count++;
+    fprintf(stderr, "Semantic Error on line %d: %s\n", currentLineNumber(), msg);
+    ctx->semantic_error_count++;
+    ctx->error_count++;
+}
+
+/* Reset parser flags and counters before parsing another translation unit */
+void resetParserState() {
+    ctx->error_count = 0;
+    ctx->semantic_error_count = 0;
+    ctx->anonymous_union_counter = 0;
+    ctx->anonymous_struct_counter = 0;
+    ctx->current_enum_value = 0;
+    ctx->recovering_from_error = 0;
+    ctx->in_typedef = 0;
+    ctx->is_static = 0;
+    ctx->has_const_before_ptr = 0;
+    ctx->has_const_after_ptr = 0;
+    ctx->in_function_body = 0;
+    ctx->param_count_temp = 0;
+    ctx->parsing_function_decl = 0;
+    ctx->in_function_definition = 0;
+    strcpy(ctx->function_return_type, "int");
+    strcpy(ctx->saved_declaration_type, "int");
+    ctx->loop_depth = 0;
+    ctx->switch_depth = 0;
+    ctx->parsing_parameters = 0;
+    ctx->parsing_expression_context = 0;
+    ctx->pending_goto_count = 0;
+    ctx->pending_param_count = 0;
+    ctx->ast_root = NULL;
 }
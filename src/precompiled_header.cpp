@@ -0,0 +1,339 @@
+#include "precompiled_header.h"
+#include "compiler_context.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+#define PCH_MAGIC "IRGPCH\n"
+#define PCH_VERSION 1
+
+/*
+ * Layout (native byte order, 32-bit integers, NUL-terminated strings):
+ *   magic[8] version
+ *   headerPath headerMtime headerSize (64-bit)
+ *   anonymousStructCounter anonymousUnionCounter
+ *   symbolCount  { Symbol fields, arrays trimmed to their used length }
+ *   structCount  { name memberCount totalSize { name type offset size } }
+ *   unionCount   { same as structs }
+ *   functionPointerCount { name }
+ */
+
+struct PrecompiledHeader {
+    void* map;
+    size_t length;
+    string headerPath;          // realpath of the header
+    const char* body;           // First byte after the header stamp
+};
+
+/* ========== Encoding ========== */
+
+static void putInt(string& out, int value) {
+    out.append((const char*)&value, sizeof(value));
+}
+
+static void putString(string& out, const char* text) {
+    out.append(text, strlen(text) + 1);
+}
+
+static void putStruct(string& out, const StructDef* def) {
+    putString(out, def->name);
+    putInt(out, def->member_count);
+    putInt(out, def->total_size);
+    for (int m = 0; m < def->member_count; m++) {
+        putString(out, def->members[m].name);
+        putString(out, def->members[m].type);
+        putInt(out, def->members[m].offset);
+        putInt(out, def->members[m].size);
+    }
+}
+
+static void putSymbol(string& out, const Symbol* sym) {
+    putString(out, sym->name);
+    putString(out, sym->type);
+    putString(out, sym->kind);
+    putInt(out, sym->scope_level);
+    putInt(out, sym->parent_scope);
+    putInt(out, sym->block_id);
+    putInt(out, sym->offset);
+    putInt(out, sym->size);
+    putInt(out, sym->is_array);
+    putInt(out, sym->num_dims);
+    for (int d = 0; d < sym->num_dims; d++) {
+        putInt(out, sym->array_dims[d]);
+    }
+    putInt(out, sym->ptr_level);
+    putInt(out, sym->is_function);
+    putString(out, sym->return_type);
+    putInt(out, sym->param_count);
+    for (int p = 0; p < sym->param_count; p++) {
+        putString(out, sym->param_types[p]);
+        putString(out, sym->param_names[p]);
+    }
+    putString(out, sym->function_scope);
+    putInt(out, sym->is_external);
+    putInt(out, sym->is_static);
+    putInt(out, sym->is_const);
+    putInt(out, sym->is_const_ptr);
+    putInt(out, sym->points_to_const);
+    putInt(out, sym->is_reference);
+}
+
+int writePrecompiledHeader(const char* outputPath, const char* headerPath) {
+    char resolved[PATH_MAX];
+    struct stat st;
+    if (!realpath(headerPath, resolved) || stat(resolved, &st) != 0) {
+        fprintf(stderr, "Error: Cannot stat header %s\n", headerPath);
+        return 1;
+    }
+
+    string out(PCH_MAGIC, sizeof(PCH_MAGIC));
+    putInt(out, PCH_VERSION);
+    putString(out, resolved);
+    long long mtime = (long long)st.st_mtime;
+    long long size = (long long)st.st_size;
+    out.append((const char*)&mtime, sizeof(mtime));
+    out.append((const char*)&size, sizeof(size));
+    putInt(out, ctx->anonymous_struct_counter);
+    putInt(out, ctx->anonymous_union_counter);
+
+    // Only the global scope survives the header
+    int globals = 0;
+    for (int i = 0; i < ctx->symCount; i++) {
+        if (ctx->symtab[i].scope_level == 0) globals++;
+    }
+    putInt(out, globals);
+    for (int i = 0; i < ctx->symCount; i++) {
+        if (ctx->symtab[i].scope_level == 0) putSymbol(out, &ctx->symtab[i]);
+    }
+    putInt(out, ctx->structCount);
+    for (int i = 0; i < ctx->structCount; i++) {
+        putStruct(out, &ctx->structTable[i]);
+    }
+    putInt(out, ctx->unionCount);
+    for (int i = 0; i < ctx->unionCount; i++) {
+        putStruct(out, &ctx->unionTable[i]);
+    }
+    putInt(out, ctx->function_pointer_count);
+    for (int i = 0; i < ctx->function_pointer_count; i++) {
+        putString(out, ctx->function_pointers[i]);
+    }
+
+    FILE* file = fopen(outputPath, "wb");
+    if (!file) {
+        fprintf(stderr, "Error: Cannot create precompiled header %s\n", outputPath);
+        return 1;
+    }
+    bool written = fwrite(out.data(), 1, out.size(), file) == out.size();
+    if (fclose(file) != 0 || !written) {
+        fprintf(stderr, "Error: Cannot write precompiled header %s\n", outputPath);
+        return 1;
+    }
+    return 0;
+}
+
+/* ========== Decoding ========== */
+
+struct Reader {
+    const char* p;
+    const char* end;
+    bool failed;
+
+    int getInt() {
+        int value = 0;
+        if (end - p < (long)sizeof(value)) {
+            failed = true;
+            return 0;
+        }
+        memcpy(&value, p, sizeof(value));
+        p += sizeof(value);
+        return value;
+    }
+
+    long long getLong() {
+        long long value = 0;
+        if (end - p < (long)sizeof(value)) {
+            failed = true;
+            return 0;
+        }
+        memcpy(&value, p, sizeof(value));
+        p += sizeof(value);
+        return value;
+    }
+
+    const char* getString() {
+        const char* text = p;
+        const char* nul = (const char*)memchr(p, '\0', end - p);
+        if (!nul) {
+            failed = true;
+            return "";
+        }
+        p = nul + 1;
+        return text;
+    }
+
+    void getString(char* dest, size_t capacity) {
+        const char* text = getString();
+        strncpy(dest, text, capacity - 1);
+        dest[capacity - 1] = '\0';
+    }
+
+    // Counts are bounded by the fixed-size tables they fill
+    int getCount(int limit) {
+        int count = getInt();
+        if (count < 0 || count > limit) {
+            failed = true;
+            return 0;
+        }
+        return count;
+    }
+};
+
+static void getStruct(Reader& in, StructDef* def) {
+    in.getString(def->name, sizeof(def->name));
+    def->member_count = in.getCount(MAX_STRUCT_MEMBERS);
+    def->total_size = in.getInt();
+    for (int m = 0; m < def->member_count; m++) {
+        in.getString(def->members[m].name, sizeof(def->members[m].name));
+        in.getString(def->members[m].type, sizeof(def->members[m].type));
+        def->members[m].offset = in.getInt();
+        def->members[m].size = in.getInt();
+    }
+}
+
+static void getSymbol(Reader& in, Symbol* sym) {
+    in.getString(sym->name, sizeof(sym->name));
+    in.getString(sym->type, sizeof(sym->type));
+    in.getString(sym->kind, sizeof(sym->kind));
+    sym->scope_level = in.getInt();
+    sym->parent_scope = in.getInt();
+    sym->block_id = in.getInt();
+    sym->offset = in.getInt();
+    sym->size = in.getInt();
+    sym->is_array = in.getInt();
+    sym->num_dims = in.getCount(10);
+    for (int d = 0; d < sym->num_dims; d++) {
+        sym->array_dims[d] = in.getInt();
+    }
+    sym->ptr_level = in.getInt();
+    sym->is_function = in.getInt();
+    in.getString(sym->return_type, sizeof(sym->return_type));
+    sym->param_count = in.getCount(16);
+    for (int p = 0; p < sym->param_count; p++) {
+        in.getString(sym->param_types[p], sizeof(sym->param_types[p]));
+        in.getString(sym->param_names[p], sizeof(sym->param_names[p]));
+    }
+    in.getString(sym->function_scope, sizeof(sym->function_scope));
+    sym->is_external = in.getInt();
+    sym->is_static = in.getInt();
+    sym->is_const = in.getInt();
+    sym->is_const_ptr = in.getInt();
+    sym->points_to_const = in.getInt();
+    sym->is_reference = in.getInt();
+}
+
+const PrecompiledHeader* loadPrecompiledHeader(const char* path) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+        fprintf(stderr, "Error: Cannot open precompiled header %s\n", path);
+        if (fd >= 0) close(fd);
+        return NULL;
+    }
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Error: Cannot map precompiled header %s\n", path);
+        return NULL;
+    }
+
+    Reader in;
+    in.p = (const char*)map;
+    in.end = in.p + st.st_size;
+    in.failed = false;
+    bool valid = st.st_size > (off_t)sizeof(PCH_MAGIC)
+                 && memcmp(in.p, PCH_MAGIC, sizeof(PCH_MAGIC)) == 0;
+    if (valid) {
+        in.p += sizeof(PCH_MAGIC);
+        valid = in.getInt() == PCH_VERSION;
+    }
+    if (!valid) {
+        fprintf(stderr, "Error: %s is not a precompiled header of this compiler version\n", path);
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+
+    const char* headerPath = in.getString();
+    long long mtime = in.getLong();
+    long long size = in.getLong();
+    struct stat header;
+    if (in.failed || stat(headerPath, &header) != 0
+        || (long long)header.st_mtime != mtime || (long long)header.st_size != size) {
+        fprintf(stderr, "Error: Precompiled header %s is out of date; rebuild it with --emit-pch\n", path);
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+
+    PrecompiledHeader* pch = new PrecompiledHeader();
+    pch->map = map;
+    pch->length = (size_t)st.st_size;
+    pch->headerPath = headerPath;
+    pch->body = in.p;
+    return pch;
+}
+
+int applyPrecompiledHeader(const PrecompiledHeader* pch) {
+    Reader in;
+    in.p = pch->body;
+    in.end = (const char*)pch->map + pch->length;
+    in.failed = false;
+
+    ctx->anonymous_struct_counter = in.getInt();
+    ctx->anonymous_union_counter = in.getInt();
+
+    int symbols = in.getCount(MAX_SYMBOLS - ctx->symCount);
+    for (int i = 0; i < symbols && !in.failed; i++) {
+        Symbol* sym = &ctx->symtab[ctx->symCount++];
+        getSymbol(in, sym);
+        if (strcmp(sym->kind, "typedef") == 0) {
+            markSymbolAsTypedef(sym);
+        }
+    }
+    int structs = in.getCount(MAX_STRUCTS - ctx->structCount);
+    for (int i = 0; i < structs && !in.failed; i++) {
+        getStruct(in, &ctx->structTable[ctx->structCount++]);
+    }
+    int unions = in.getCount(MAX_STRUCTS - ctx->unionCount);
+    for (int i = 0; i < unions && !in.failed; i++) {
+        getStruct(in, &ctx->unionTable[ctx->unionCount++]);
+    }
+    int functionPointers = in.getCount(MAX_SYMBOLS);
+    for (int i = 0; i < functionPointers && !in.failed; i++) {
+        registerFunctionPointer(in.getString());
+    }
+
+    if (in.failed) {
+        fprintf(stderr, "Error: Precompiled header for %s is corrupt\n", pch->headerPath.c_str());
+        return 1;
+    }
+    ctx->pch = pch;
+    return 0;
+}
+
+int precompiledHeaderCovers(const PrecompiledHeader* pch, const char* path) {
+    char resolved[PATH_MAX];
+    return realpath(path, resolved) && pch->headerPath == resolved;
+}
+
+void freePrecompiledHeader(const PrecompiledHeader* pch) {
+    if (!pch) return;
+    munmap(pch->map, pch->length);
+    delete pch;
+}
@@ -0,0 +1,50 @@
+/**
+ * Precompiled Headers
+ * Snapshot of the global-scope symbol table (symbols, struct and union
+ * definitions, function pointer names) left after parsing a header.
+ * A unit compiled with the snapshot starts with that state already in
+ * place, and the preprocessor drops the header's text when the unit
+ * includes it (its macros are still processed).
+ *
+ * The file is mapped once per process and decoded into each context.
+ */
+
+#ifndef PRECOMPILED_HEADER_H
+#define PRECOMPILED_HEADER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct PrecompiledHeader PrecompiledHeader;
+
+/**
+ * Write the global scope of the current context, parsed from
+ * `headerPath`, to `outputPath`. Returns 0 on success, 1 on error.
+ */
+int writePrecompiledHeader(const char* outputPath, const char* headerPath);
+
+/**
+ * Map and validate a snapshot; NULL (with a message) if it cannot be used,
+ * including when the header changed since it was written
+ */
+const PrecompiledHeader* loadPrecompiledHeader(const char* path);
+
+/**
+ * Install the snapshot into the current (freshly reset) context
+ * Returns 0 on success, 1 if the snapshot is malformed.
+ */
+int applyPrecompiledHeader(const PrecompiledHeader* pch);
+
+/**
+ * Whether `path` names the header the snapshot was built from
+ */
+int precompiledHeaderCovers(const PrecompiledHeader* pch, const char* path);
+
+void freePrecompiledHeader(const PrecompiledHeader* pch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PRECOMPILED_HEADER_H
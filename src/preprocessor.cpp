@@ -0,0 +1,1044 @@
+#include "preprocessor.h"
+#include "compiler_context.h"
+#include "precompiled_header.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <sys/stat.h>
+
+using namespace std;
+
+#define MAX_INCLUDE_DEPTH 200
+
+enum PPTokenKind {
+    PP_IDENT,
+    PP_NUMBER,
+    PP_STRING,
+    PP_CHAR,
+    PP_PUNCT
+};
+
+struct PPToken {
+    PPTokenKind kind;
+    string text;
+    bool space;                 // Preceded by whitespace
+    vector<string> hide;        // Macros that must not expand this token again
+};
+
+// One logical line: backslash-newlines and block comments may make it
+// span several physical lines
+struct PPLine {
+    int line;                   // Physical line it starts on
+    int physicalLines;
+    bool directive;
+    string name;                // Directive name ("" for text lines)
+    vector<PPToken> tokens;     // Tokens after the directive name, or the whole line
+    size_t rawStart, rawEnd;    // Source text of the line, without the final newline
+};
+
+struct SourceFile {
+    string path;
+    string storage;             // Contents of cached headers
+    const char* text;
+    size_t size;
+    vector<PPLine> lines;
+    string guard;               // Include-guard macro, "" if none
+    time_t mtime;
+    off_t fileSize;
+};
+
+struct Macro {
+    bool functionLike;
+    bool variadic;
+    vector<string> params;
+    vector<PPToken> body;
+};
+
+struct CondFrame {
+    bool parentActive;
+    bool active;
+    bool taken;                 // Some branch of this #if was already chosen
+    bool sawElse;
+};
+
+// Tokenized headers shared by every compilation in the process
+static mutex headerCacheMutex;
+static unordered_map<string, shared_ptr<SourceFile> > headerCache;
+
+/* ========== Tokenizer ========== */
+
+static bool isIdentStart(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static bool isIdentChar(char c) {
+    return isIdentStart(c) || (c >= '0' && c <= '9');
+}
+
+static bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static const char* const punctuators3[] = { "...", "<<=", ">>=", NULL };
+static const char* const punctuators2[] = {
+    "##", "->", "++", "--", "<<", ">>", "<=", ">=", "==", "!=", "&&", "||",
+    "+=", "-=", "*=", "/=", "%=", "&=", "|=", "^=", NULL
+};
+
+static size_t punctuatorLength(const char* p, const char* end) {
+    for (int i = 0; punctuators3[i]; i++) {
+        if (end - p >= 3 && strncmp(p, punctuators3[i], 3) == 0) return 3;
+    }
+    for (int i = 0; punctuators2[i]; i++) {
+        if (end - p >= 2 && strncmp(p, punctuators2[i], 2) == 0) return 2;
+    }
+    return 1;
+}
+
+// Split a file into logical lines of preprocessing tokens
+static void tokenizeFile(SourceFile& file) {
+    const char* text = file.text;
+    const char* end = text + file.size;
+    const char* p = text;
+    int line = 1;
+
+    while (p < end) {
+        PPLine current;
+        current.line = line;
+        current.physicalLines = 1;
+        current.directive = false;
+        current.rawStart = p - text;
+        bool space = false;
+        bool first = true;
+
+        while (p < end && *p != '\n') {
+            char c = *p;
+            if (c == '\\' && p + 1 < end && (p[1] == '\n' || (p[1] == '\r' && p + 2 < end && p[2] == '\n'))) {
+                p += (p[1] == '\n') ? 2 : 3;
+                current.physicalLines++;
+                continue;
+            }
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v') {
+                space = true;
+                p++;
+                continue;
+            }
+            if (c == '/' && p + 1 < end && p[1] == '/') {
+                while (p < end && *p != '\n') p++;
+                continue;
+            }
+            if (c == '/' && p + 1 < end && p[1] == '*') {
+                p += 2;
+                while (p < end && !(*p == '*' && p + 1 < end && p[1] == '/')) {
+                    if (*p == '\n') current.physicalLines++;
+                    p++;
+                }
+                p = (p < end) ? p + 2 : end;
+                space = true;
+                continue;
+            }
+
+            PPToken token;
+            token.space = space;
+            const char* start = p;
+            if (isIdentStart(c)) {
+                while (p < end && isIdentChar(*p)) p++;
+                token.kind = PP_IDENT;
+            } else if (isDigit(c) || (c == '.' && p + 1 < end && isDigit(p[1]))) {
+                while (p < end) {
+                    if ((*p == '+' || *p == '-') && (p[-1] == 'e' || p[-1] == 'E' || p[-1] == 'p' || p[-1] == 'P')) {
+                        p++;
+                    } else if (isIdentChar(*p) || *p == '.') {
+                        p++;
+                    } else {
+                        break;
+                    }
+                }
+                token.kind = PP_NUMBER;
+            } else if (c == '"' || c == '\'') {
+                p++;
+                while (p < end && *p != c && *p != '\n') {
+                    if (*p == '\\' && p + 1 < end && p[1] != '\n') p++;
+                    p++;
+                }
+                if (p < end && *p == c) p++;
+                token.kind = (c == '"') ? PP_STRING : PP_CHAR;
+            } else {
+                p += punctuatorLength(p, end);
+                token.kind = PP_PUNCT;
+            }
+            token.text.assign(start, p - start);
+            space = false;
+
+            if (first && token.kind == PP_PUNCT && token.text == "#") {
+                current.directive = true;
+            } else if (current.directive && current.name.empty() && current.tokens.empty()
+                       && token.kind == PP_IDENT) {
+                current.name = token.text;
+            } else {
+                current.tokens.push_back(token);
+            }
+            first = false;
+        }
+
+        current.rawEnd = p - text;
+        if (p < end) p++;  // the newline
+        line += current.physicalLines;
+        file.lines.push_back(current);
+    }
+}
+
+// "#ifndef G / #define G ... #endif" around the whole file
+static void detectIncludeGuard(SourceFile& file) {
+    size_t first = 0, last = file.lines.size();
+    while (first < last && !file.lines[first].directive && file.lines[first].tokens.empty()) first++;
+    while (last > first && !file.lines[last - 1].directive && file.lines[last - 1].tokens.empty()) last--;
+    if (last - first < 3) return;
+
+    const PPLine& open = file.lines[first];
+    const PPLine& define = file.lines[first + 1];
+    const PPLine& close = file.lines[last - 1];
+    if (open.name != "ifndef" || open.tokens.size() != 1 || define.name != "define"
+        || define.tokens.empty() || define.tokens[0].text != open.tokens[0].text
+        || close.name != "endif") {
+        return;
+    }
+
+    // The #endif must close the #ifndef, not a later conditional
+    int depth = 0;
+    for (size_t i = first; i < last; i++) {
+        const string& name = file.lines[i].name;
+        if (!file.lines[i].directive) continue;
+        if (name == "if" || name == "ifdef" || name == "ifndef") {
+            depth++;
+        } else if (name == "endif") {
+            depth--;
+            if (depth == 0 && i != last - 1) return;
+        }
+    }
+    file.guard = open.tokens[0].text;
+}
+
+static shared_ptr<SourceFile> loadHeader(const string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return shared_ptr<SourceFile>();
+    }
+
+    {
+        lock_guard<mutex> lock(headerCacheMutex);
+        unordered_map<string, shared_ptr<SourceFile> >::iterator it = headerCache.find(path);
+        if (it != headerCache.end() && it->second->mtime == st.st_mtime
+            && it->second->fileSize == st.st_size) {
+            return it->second;
+        }
+    }
+
+    FILE* in = fopen(path.c_str(), "rb");
+    if (!in) return shared_ptr<SourceFile>();
+    shared_ptr<SourceFile> file(new SourceFile());
+    file->path = path;
+    file->storage.resize((size_t)st.st_size);
+    size_t got = st.st_size > 0 ? fread(&file->storage[0], 1, file->storage.size(), in) : 0;
+    fclose(in);
+    file->storage.resize(got);
+    file->text = file->storage.data();
+    file->size = file->storage.size();
+    file->mtime = st.st_mtime;
+    file->fileSize = st.st_size;
+    tokenizeFile(*file);
+    detectIncludeGuard(*file);
+
+    lock_guard<mutex> lock(headerCacheMutex);
+    headerCache[path] = file;
+    return file;
+}
+
+/* ========== Preprocessor state ========== */
+
+struct Preprocessor {
+    string mainPath;
+    map<string, Macro> macros;
+    vector<CondFrame> conds;
+    set<string> onceFiles;
+    string out;
+    const SourceFile* file;     // File being processed (for diagnostics)
+    int line;
+
+    void error(const char* format, const string& detail);
+    bool active() const { return conds.empty() || conds.back().active; }
+
+    void processFile(const SourceFile& source, int depth);
+    void handleDirective(const SourceFile& source, const PPLine& current, int depth);
+    void defineMacro(const vector<PPToken>& tokens);
+    void include(const SourceFile& source, const PPLine& current, int depth);
+    bool evaluateCondition(const vector<PPToken>& tokens);
+
+    void expand(deque<PPToken>& input, vector<PPToken>& output);
+    bool collectArguments(deque<PPToken>& input, const Macro& macro,
+                          vector<vector<PPToken> >& args, PPToken& closeParen);
+    void substitute(const Macro& macro, const vector<vector<PPToken> >& args,
+                    const vector<string>& hide, vector<PPToken>& result);
+    bool needsMoreLines(const vector<PPToken>& tokens) const;
+    bool mentionsMacro(const vector<PPToken>& tokens) const;
+    void render(const vector<PPToken>& tokens);
+};
+
+void Preprocessor::error(const char* format, const string& detail) {
+    fprintf(stderr, "Preprocessor Error on line %d of %s: ", line, file ? file->path.c_str() : mainPath.c_str());
+    fprintf(stderr, format, detail.c_str());
+    fprintf(stderr, "\n");
+    ctx->error_count++;
+}
+
+/* ========== Macro expansion ========== */
+
+static bool inHideSet(const PPToken& token, const string& name) {
+    for (size_t i = 0; i < token.hide.size(); i++) {
+        if (token.hide[i] == name) return true;
+    }
+    return false;
+}
+
+static void addToHideSet(vector<string>& hide, const string& name) {
+    for (size_t i = 0; i < hide.size(); i++) {
+        if (hide[i] == name) return;
+    }
+    hide.push_back(name);
+}
+
+static int paramIndex(const Macro& macro, const string& name) {
+    for (size_t i = 0; i < macro.params.size(); i++) {
+        if (macro.params[i] == name) return (int)i;
+    }
+    return -1;
+}
+
+static PPToken stringize(const vector<PPToken>& arg) {
+    PPToken token;
+    token.kind = PP_STRING;
+    token.space = false;
+    token.text = "\"";
+    for (size_t i = 0; i < arg.size(); i++) {
+        if (i > 0 && arg[i].space) token.text += ' ';
+        if (arg[i].kind == PP_STRING || arg[i].kind == PP_CHAR) {
+            for (size_t j = 0; j < arg[i].text.size(); j++) {
+                char c = arg[i].text[j];
+                if (c == '"' || c == '\\') token.text += '\\';
+                token.text += c;
+            }
+        } else {
+            token.text += arg[i].text;
+        }
+    }
+    token.text += '"';
+    return token;
+}
+
+// Kind of the token formed by pasting two spellings together
+static PPTokenKind pastedKind(const string& text) {
+    if (text.empty()) return PP_PUNCT;
+    if (isIdentStart(text[0])) return PP_IDENT;
+    if (isDigit(text[0]) || text[0] == '.') return PP_NUMBER;
+    if (text[0] == '"') return PP_STRING;
+    if (text[0] == '\'') return PP_CHAR;
+    return PP_PUNCT;
+}
+
+bool Preprocessor::collectArguments(deque<PPToken>& input, const Macro& macro,
+                                    vector<vector<PPToken> >& args, PPToken& closeParen) {
+    // input starts at the '('
+    input.pop_front();
+    args.assign(1, vector<PPToken>());
+    int depth = 0;
+    while (!input.empty()) {
+        PPToken token = input.front();
+        input.pop_front();
+        if (token.kind == PP_PUNCT) {
+            if (token.text == "(") {
+                depth++;
+            } else if (token.text == ")") {
+                if (depth == 0) {
+                    closeParen = token;
+                    if (args.size() == 1 && args[0].empty() && macro.params.empty()) {
+                        args.clear();
+                    }
+                    return true;
+                }
+                depth--;
+            } else if (token.text == "," && depth == 0
+                       && !(macro.variadic && args.size() == macro.params.size())) {
+                args.push_back(vector<PPToken>());
+                continue;
+            }
+        }
+        args.back().push_back(token);
+    }
+    return false;
+}
+
+void Preprocessor::substitute(const Macro& macro, const vector<vector<PPToken> >& args,
+                              const vector<string>& hide, vector<PPToken>& result) {
+    const vector<PPToken>& body = macro.body;
+    bool pasteNext = false;
+    for (size_t i = 0; i < body.size(); i++) {
+        const PPToken& token = body[i];
+        size_t before = result.size();
+
+        if (token.kind == PP_PUNCT && token.text == "##") {
+            pasteNext = true;
+            continue;
+        }
+
+        int param = token.kind == PP_IDENT ? paramIndex(macro, token.text) : -1;
+        if (macro.functionLike && token.kind == PP_PUNCT && token.text == "#"
+            && i + 1 < body.size() && paramIndex(macro, body[i + 1].text) >= 0) {
+            PPToken str = stringize(args[paramIndex(macro, body[i + 1].text)]);
+            str.space = token.space;
+            result.push_back(str);
+            i++;
+        } else if (param >= 0) {
+            bool pasted = pasteNext || (i + 1 < body.size() && body[i + 1].kind == PP_PUNCT
+                                        && body[i + 1].text == "##");
+            if (pasted) {
+                result.insert(result.end(), args[param].begin(), args[param].end());
+            } else {
+                deque<PPToken> argInput(args[param].begin(), args[param].end());
+                vector<PPToken> expanded;
+                expand(argInput, expanded);
+                result.insert(result.end(), expanded.begin(), expanded.end());
+            }
+            if (result.size() > before) result[before].space = token.space;
+        } else {
+            result.push_back(token);
+        }
+
+        // Glue the first token of this operand onto the last one before it
+        if (pasteNext && result.size() > before && before > 0) {
+            PPToken& left = result[before - 1];
+            left.text += result[before].text;
+            left.kind = pastedKind(left.text);
+            result.erase(result.begin() + before);
+        }
+        pasteNext = false;
+    }
+
+    for (size_t i = 0; i < result.size(); i++) {
+        for (size_t j = 0; j < hide.size(); j++) {
+            addToHideSet(result[i].hide, hide[j]);
+        }
+    }
+}
+
+void Preprocessor::expand(deque<PPToken>& input, vector<PPToken>& output) {
+    while (!input.empty()) {
+        PPToken token = input.front();
+        input.pop_front();
+
+        map<string, Macro>::const_iterator it;
+        if (token.kind != PP_IDENT || inHideSet(token, token.text)
+            || (it = macros.find(token.text)) == macros.end()) {
+            output.push_back(token);
+            continue;
+        }
+        const Macro& macro = it->second;
+
+        vector<string> hide = token.hide;
+        vector<vector<PPToken> > args;
+        if (macro.functionLike) {
+            if (input.empty() || input.front().kind != PP_PUNCT || input.front().text != "(") {
+                output.push_back(token);
+                continue;
+            }
+            PPToken closeParen;
+            if (!collectArguments(input, macro, args, closeParen)) {
+                error("unterminated argument list invoking macro '%s'", token.text);
+                return;
+            }
+            size_t expected = macro.params.size();
+            if (args.size() < expected && macro.variadic && args.size() + 1 == expected) {
+                args.push_back(vector<PPToken>());
+            }
+            if (args.size() != expected) {
+                error("wrong number of arguments to macro '%s'", token.text);
+                continue;
+            }
+            // Only names hidden at both ends of the invocation stay hidden
+            vector<string> common;
+            for (size_t i = 0; i < hide.size(); i++) {
+                if (inHideSet(closeParen, hide[i])) common.push_back(hide[i]);
+            }
+            hide = common;
+        }
+        addToHideSet(hide, token.text);
+
+        vector<PPToken> replacement;
+        substitute(macro, args, hide, replacement);
+        if (!replacement.empty()) replacement[0].space = token.space;
+        // Rescan the replacement together with the rest of the input
+        input.insert(input.begin(), replacement.begin(), replacement.end());
+    }
+}
+
+// A function-like macro invocation whose ')' is on a later line
+bool Preprocessor::needsMoreLines(const vector<PPToken>& tokens) const {
+    for (size_t i = 0; i + 1 < tokens.size(); i++) {
+        if (tokens[i].kind != PP_IDENT || tokens[i + 1].text != "(") continue;
+        map<string, Macro>::const_iterator it = macros.find(tokens[i].text);
+        if (it == macros.end() || !it->second.functionLike) continue;
+        int depth = 0;
+        size_t j = i + 1;
+        for (; j < tokens.size(); j++) {
+            if (tokens[j].kind != PP_PUNCT) continue;
+            if (tokens[j].text == "(") depth++;
+            else if (tokens[j].text == ")" && --depth == 0) break;
+        }
+        if (j == tokens.size()) return true;
+    }
+    return false;
+}
+
+bool Preprocessor::mentionsMacro(const vector<PPToken>& tokens) const {
+    if (macros.empty()) return false;
+    for (size_t i = 0; i < tokens.size(); i++) {
+        if (tokens[i].kind == PP_IDENT && macros.count(tokens[i].text)) return true;
+    }
+    return false;
+}
+
+// Two tokens that would lex as one if written without a space
+static bool wouldMerge(const PPToken& left, const PPToken& right) {
+    if ((left.kind == PP_IDENT || left.kind == PP_NUMBER)
+        && (right.kind == PP_IDENT || right.kind == PP_NUMBER)) {
+        return true;
+    }
+    if (left.kind == PP_PUNCT && right.kind == PP_PUNCT) {
+        string joined = left.text.substr(left.text.size() - 1) + right.text.substr(0, 1);
+        if (joined == "//" || joined == "/*") return true;
+        for (int i = 0; punctuators2[i]; i++) {
+            if (joined == punctuators2[i]) return true;
+        }
+    }
+    return false;
+}
+
+void Preprocessor::render(const vector<PPToken>& tokens) {
+    for (size_t i = 0; i < tokens.size(); i++) {
+        if (i > 0 && (tokens[i].space || wouldMerge(tokens[i - 1], tokens[i]))) {
+            out += ' ';
+        }
+        out += tokens[i].text;
+    }
+}
+
+/* ========== #if expressions ========== */
+
+struct ConditionParser {
+    const vector<PPToken>& tokens;
+    size_t pos;
+    bool failed;
+    bool divideByZero;
+
+    ConditionParser(const vector<PPToken>& t) : tokens(t), pos(0), failed(false), divideByZero(false) {}
+
+    bool accept(const char* text) {
+        if (pos < tokens.size() && tokens[pos].kind == PP_PUNCT && tokens[pos].text == text) {
+            pos++;
+            return true;
+        }
+        return false;
+    }
+
+    long long primary() {
+        if (pos >= tokens.size()) {
+            failed = true;
+            return 0;
+        }
+        const PPToken& token = tokens[pos++];
+        if (token.kind == PP_NUMBER) {
+            return strtoll(token.text.c_str(), NULL, 0);
+        }
+        if (token.kind == PP_CHAR) {
+            const string& text = token.text;
+            if (text.size() >= 4 && text[1] == '\\') {
+                switch (text[2]) {
+                    case 'n': return '\n';
+                    case 't': return '\t';
+                    case 'r': return '\r';
+                    case '0': return 0;
+                    default: return text[2];
+                }
+            }
+            return text.size() >= 3 ? (unsigned char)text[1] : 0;
+        }
+        if (token.kind == PP_IDENT) {
+            // Names left after expansion are 0, as in C
+            return token.text == "true" ? 1 : 0;
+        }
+        if (token.kind == PP_PUNCT && token.text == "(") {
+            long long value = conditional();
+            if (!accept(")")) failed = true;
+            return value;
+        }
+        failed = true;
+        return 0;
+    }
+
+    long long unary() {
+        if (accept("-")) return -unary();
+        if (accept("+")) return unary();
+        if (accept("!")) return !unary();
+        if (accept("~")) return ~unary();
+        return primary();
+    }
+
+    long long multiplicative() {
+        long long value = unary();
+        for (;;) {
+            if (accept("*")) {
+                value *= unary();
+            } else if (accept("/") || accept("%")) {
+                bool isDivide = tokens[pos - 1].text == "/";
+                long long rhs = unary();
+                if (rhs == 0) {
+                    divideByZero = true;
+                    value = 0;
+                } else {
+                    value = isDivide ? value / rhs : value % rhs;
+                }
+            } else {
+                return value;
+            }
+        }
+    }
+
+    long long additive() {
+        long long value = multiplicative();
+        for (;;) {
+            if (accept("+")) value += multiplicative();
+            else if (accept("-")) value -= multiplicative();
+            else return value;
+        }
+    }
+
+    long long shift() {
+        long long value = additive();
+        for (;;) {
+            if (accept("<<")) value <<= additive();
+            else if (accept(">>")) value >>= additive();
+            else return value;
+        }
+    }
+
+    long long relational() {
+        long long value = shift();
+        for (;;) {
+            if (accept("<")) value = value < shift();
+            else if (accept(">")) value = value > shift();
+            else if (accept("<=")) value = value <= shift();
+            else if (accept(">=")) value = value >= shift();
+            else return value;
+        }
+    }
+
+    long long equality() {
+        long long value = relational();
+        for (;;) {
+            if (accept("==")) value = value == relational();
+            else if (accept("!=")) value = value != relational();
+            else return value;
+        }
+    }
+
+    long long bitAnd() {
+        long long value = equality();
+        while (accept("&")) value &= equality();
+        return value;
+    }
+
+    long long bitXor() {
+        long long value = bitAnd();
+        while (accept("^")) value ^= bitAnd();
+        return value;
+    }
+
+    long long bitOr() {
+        long long value = bitXor();
+        while (accept("|")) value |= bitXor();
+        return value;
+    }
+
+    long long logicalAnd() {
+        long long value = bitOr();
+        while (accept("&&")) {
+            long long rhs = bitOr();
+            value = value && rhs;
+        }
+        return value;
+    }
+
+    long long logicalOr() {
+        long long value = logicalAnd();
+        while (accept("||")) {
+            long long rhs = logicalAnd();
+            value = value || rhs;
+        }
+        return value;
+    }
+
+    long long conditional() {
+        long long value = logicalOr();
+        if (accept("?")) {
+            long long whenTrue = conditional();
+            if (!accept(":")) failed = true;
+            long long whenFalse = conditional();
+            return value ? whenTrue : whenFalse;
+        }
+        return value;
+    }
+};
+
+bool Preprocessor::evaluateCondition(const vector<PPToken>& tokens) {
+    // Resolve defined X / defined(X) before anything is expanded
+    deque<PPToken> input;
+    for (size_t i = 0; i < tokens.size(); i++) {
+        if (tokens[i].kind != PP_IDENT || tokens[i].text != "defined") {
+            input.push_back(tokens[i]);
+            continue;
+        }
+        bool paren = i + 1 < tokens.size() && tokens[i + 1].text == "(";
+        size_t nameAt = paren ? i + 2 : i + 1;
+        if (nameAt >= tokens.size() || tokens[nameAt].kind != PP_IDENT
+            || (paren && (nameAt + 1 >= tokens.size() || tokens[nameAt + 1].text != ")"))) {
+            error("%s", "operator 'defined' requires an identifier");
+            return false;
+        }
+        PPToken value;
+        value.kind = PP_NUMBER;
+        value.space = true;
+        value.text = macros.count(tokens[nameAt].text) ? "1" : "0";
+        input.push_back(value);
+        i = paren ? nameAt + 1 : nameAt;
+    }
+
+    vector<PPToken> expanded;
+    expand(input, expanded);
+    if (expanded.empty()) {
+        error("%s", "#if with no expression");
+        return false;
+    }
+    ConditionParser parser(expanded);
+    long long value = parser.conditional();
+    if (parser.failed || parser.pos != expanded.size()) {
+        error("%s", "invalid expression in #if");
+        return false;
+    }
+    if (parser.divideByZero) {
+        error("%s", "division by zero in #if");
+        return false;
+    }
+    return value != 0;
+}
+
+/* ========== Directives ========== */
+
+void Preprocessor::defineMacro(const vector<PPToken>& tokens) {
+    if (tokens.empty() || tokens[0].kind != PP_IDENT) {
+        error("%s", "macro name must be an identifier");
+        return;
+    }
+    const string& name = tokens[0].text;
+    if (name == "defined") {
+        error("%s", "'defined' cannot be used as a macro name");
+        return;
+    }
+
+    Macro macro;
+    macro.functionLike = false;
+    macro.variadic = false;
+    size_t bodyStart = 1;
+    if (tokens.size() > 1 && tokens[1].text == "(" && !tokens[1].space) {
+        macro.functionLike = true;
+        size_t i = 2;
+        bool closed = false;
+        if (i < tokens.size() && tokens[i].text == ")") {
+            closed = true;
+            i++;
+        }
+        while (!closed && i < tokens.size()) {
+            const PPToken& token = tokens[i++];
+            if (token.text == "...") {
+                macro.variadic = true;
+                macro.params.push_back("__VA_ARGS__");
+            } else if (token.kind == PP_IDENT) {
+                macro.params.push_back(token.text);
+            } else {
+                break;
+            }
+            if (i < tokens.size() && tokens[i].text == ")") {
+                closed = true;
+                i++;
+            } else if (macro.variadic || i >= tokens.size() || tokens[i].text != ",") {
+                break;
+            } else {
+                i++;
+            }
+        }
+        if (!closed) {
+            error("invalid parameter list in definition of '%s'", name);
+            return;
+        }
+        bodyStart = i;
+    }
+
+    macro.body.assign(tokens.begin() + bodyStart, tokens.end());
+    if (!macro.body.empty()) macro.body[0].space = false;
+    if ((!macro.body.empty() && macro.body.front().text == "##")
+        || (!macro.body.empty() && macro.body.back().text == "##")) {
+        error("'##' cannot appear at either end of macro '%s'", name);
+        return;
+    }
+    macros[name] = macro;
+}
+
+static string directoryOf(const string& path) {
+    size_t slash = path.find_last_of('/');
+    return slash == string::npos ? string() : path.substr(0, slash + 1);
+}
+
+void Preprocessor::include(const SourceFile& source, const PPLine& current, int depth) {
+    if (!current.tokens.empty() && current.tokens[0].text == "<") {
+        // Library headers are the parser's business
+        out.append(source.text + current.rawStart, current.rawEnd - current.rawStart);
+        out += '\n';
+        return;
+    }
+    if (current.tokens.size() != 1 || current.tokens[0].kind != PP_STRING) {
+        error("%s", "#include expects \"FILENAME\" or <FILENAME>");
+        out.append(current.physicalLines, '\n');
+        return;
+    }
+
+    const string& quoted = current.tokens[0].text;
+    string name = quoted.substr(1, quoted.size() - 2);
+    shared_ptr<SourceFile> header;
+    if (!name.empty() && name[0] == '/') {
+        header = loadHeader(name);
+    } else {
+        header = loadHeader(directoryOf(source.path) + name);
+        if (!header && directoryOf(source.path) != directoryOf(mainPath)) {
+            header = loadHeader(directoryOf(mainPath) + name);
+        }
+    }
+    if (!header) {
+        error("cannot open include file \"%s\"", name);
+        out.append(current.physicalLines, '\n');
+        return;
+    }
+    if (depth >= MAX_INCLUDE_DEPTH) {
+        error("#include nested too deeply at \"%s\"", name);
+        out.append(current.physicalLines, '\n');
+        return;
+    }
+    if (onceFiles.count(header->path) || (!header->guard.empty() && macros.count(header->guard))) {
+        out.append(current.physicalLines, '\n');
+        return;
+    }
+    if (ctx->pch && precompiledHeaderCovers(ctx->pch, header->path.c_str())) {
+        // Declarations come from the snapshot; only the macros are needed
+        string text;
+        text.swap(out);
+        processFile(*header, depth + 1);
+        out.swap(text);
+        out.append(current.physicalLines, '\n');
+        return;
+    }
+
+    out += "#line 1\n";
+    processFile(*header, depth + 1);
+    char marker[32];
+    snprintf(marker, sizeof(marker), "#line %d\n", current.line + current.physicalLines);
+    out += marker;
+}
+
+void Preprocessor::handleDirective(const SourceFile& source, const PPLine& current, int depth) {
+    const string& name = current.name;
+
+    if (name == "if" || name == "ifdef" || name == "ifndef") {
+        CondFrame frame;
+        frame.parentActive = active();
+        frame.sawElse = false;
+        bool value = false;
+        if (frame.parentActive) {
+            if (name == "if") {
+                value = evaluateCondition(current.tokens);
+            } else if (current.tokens.empty() || current.tokens[0].kind != PP_IDENT) {
+                error("#%s expects a macro name", name);
+            } else {
+                value = macros.count(current.tokens[0].text) != 0;
+                if (name == "ifndef") value = !value;
+            }
+        }
+        frame.active = frame.parentActive && value;
+        frame.taken = frame.active;
+        conds.push_back(frame);
+    } else if (name == "elif" || name == "else" || name == "endif") {
+        if (conds.empty()) {
+            error("#%s without #if", name);
+        } else if (name == "endif") {
+            conds.pop_back();
+        } else {
+            CondFrame& frame = conds.back();
+            if (frame.sawElse) {
+                error("#%s after #else", name);
+            }
+            if (name == "else") {
+                frame.active = frame.parentActive && !frame.taken;
+                frame.sawElse = true;
+            } else {
+                frame.active = frame.parentActive && !frame.taken && evaluateCondition(current.tokens);
+            }
+            frame.taken = frame.taken || frame.active;
+        }
+    } else if (!active()) {
+        // Other directives in skipped groups are ignored
+    } else if (name == "define") {
+        defineMacro(current.tokens);
+    } else if (name == "undef") {
+        if (current.tokens.empty() || current.tokens[0].kind != PP_IDENT) {
+            error("%s", "#undef expects a macro name");
+        } else {
+            macros.erase(current.tokens[0].text);
+        }
+    } else if (name == "include") {
+        include(source, current, depth);
+        return;
+    } else if (name == "line") {
+        out.append(source.text + current.rawStart, current.rawEnd - current.rawStart);
+        out += '\n';
+        return;
+    } else if (name == "error") {
+        string message;
+        for (size_t i = 0; i < current.tokens.size(); i++) {
+            if (i > 0) message += ' ';
+            message += current.tokens[i].text;
+        }
+        error("#error %s", message);
+    } else if (name == "pragma") {
+        if (!current.tokens.empty() && current.tokens[0].text == "once") {
+            onceFiles.insert(source.path);
+        }
+    } else if (!name.empty() || !current.tokens.empty()) {
+        error("invalid preprocessing directive #%s",
+              name.empty() ? current.tokens[0].text : name);
+    }
+    out.append(current.physicalLines, '\n');
+}
+
+void Preprocessor::processFile(const SourceFile& source, int depth) {
+    const SourceFile* outer = file;
+    int outerLine = line;
+    size_t condDepth = conds.size();
+    file = &source;
+
+    const vector<PPLine>& lines = source.lines;
+    for (size_t i = 0; i < lines.size(); i++) {
+        const PPLine& current = lines[i];
+        line = current.line;
+        if (current.directive) {
+            handleDirective(source, current, depth);
+            continue;
+        }
+        if (!active()) {
+            out.append(current.physicalLines, '\n');
+            continue;
+        }
+        if (!mentionsMacro(current.tokens)) {
+            out.append(source.text + current.rawStart, current.rawEnd - current.rawStart);
+            out += '\n';
+            continue;
+        }
+
+        // Invocations may continue on the following text lines; their
+        // newlines are emitted after the expansion to keep numbering
+        vector<PPToken> tokens = current.tokens;
+        int physicalLines = current.physicalLines;
+        while (needsMoreLines(tokens) && i + 1 < lines.size() && !lines[i + 1].directive) {
+            i++;
+            tokens.insert(tokens.end(), lines[i].tokens.begin(), lines[i].tokens.end());
+            physicalLines += lines[i].physicalLines;
+        }
+        deque<PPToken> input(tokens.begin(), tokens.end());
+        vector<PPToken> expanded;
+        expand(input, expanded);
+        render(expanded);
+        out.append(physicalLines, '\n');
+    }
+
+    if (conds.size() > condDepth) {
+        error("%s", "unterminated conditional directive");
+        conds.resize(condDepth);
+    }
+    file = outer;
+    line = outerLine;
+}
+
+/* ========== Entry points ========== */
+
+int needsPreprocessing(const char* source, size_t size) {
+    const char* end = source + size;
+    const char* p = source;
+    while (p < end) {
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+        if (p < end && *p == '#') {
+            p++;
+            while (p < end && (*p == ' ' || *p == '\t')) p++;
+            if (end - p < 7 || strncmp(p, "include", 7) != 0) return 1;
+            p += 7;
+            while (p < end && (*p == ' ' || *p == '\t')) p++;
+            if (p >= end || *p != '<') return 1;
+        }
+        const char* newline = (const char*)memchr(p, '\n', end - p);
+        if (!newline) break;
+        p = newline + 1;
+    }
+    return 0;
+}
+
+char* preprocessSource(const char* path, const char* source, size_t size, size_t* outSize) {
+    SourceFile mainFile;
+    mainFile.path = path;
+    mainFile.text = source;
+    mainFile.size = size;
+    mainFile.mtime = 0;
+    mainFile.fileSize = (off_t)size;
+    tokenizeFile(mainFile);
+
+    Preprocessor pp;
+    pp.mainPath = path;
+    pp.file = NULL;
+    pp.line = 0;
+    pp.out.reserve(size + size / 8 + 64);
+    pp.processFile(mainFile, 0);
+
+    char* result = (char*)malloc(pp.out.size() + 2);
+    if (!result) {
+        fprintf(stderr, "Error: Cannot allocate preprocessed source\n");
+        ctx->error_count++;
+        *outSize = 0;
+        return NULL;
+    }
+    memcpy(result, pp.out.data(), pp.out.size());
+    result[pp.out.size()] = '\0';
+    result[pp.out.size() + 1] = '\0';
+    *outSize = pp.out.size();
+    return result;
+}
@@ -0,0 +1,42 @@
+/**
+ * Preprocessor
+ * Integrated C preprocessor run on the source buffer before the scanner:
+ * object- and function-like macros (with #, ## and __VA_ARGS__),
+ * #if/#ifdef/#ifndef/#elif/#else/#endif, #undef, #error, #pragma once and
+ * quoted #include. Angle-bracket includes are passed through unchanged so
+ * the parser can still register the library functions they declare.
+ *
+ * Included files are tokenized once per process and cached (revalidated
+ * by size and mtime), and headers wrapped in an include guard are skipped
+ * without being rescanned once their guard macro is defined. A header the
+ * context's precompiled header was built from contributes only its macros.
+ */
+
+#ifndef PREPROCESSOR_H
+#define PREPROCESSOR_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Whether `source` contains any directive other than #include <...>;
+ * sources that do not are handed to the scanner untouched
+ */
+int needsPreprocessing(const char* source, size_t size);
+
+/**
+ * Preprocess `source` (the contents of `path`). Returns a malloc'd buffer
+ * followed by two NUL bytes, with its length in `*outSize`. Lines keep
+ * their numbers; included text is bracketed by #line markers. Errors are
+ * reported to stderr and counted in the current context's error_count.
+ */
+char* preprocessSource(const char* path, const char* source, size_t size, size_t* outSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PREPROCESSOR_H
@@ -1,39 +1,343 @@
 #include "symbol_table.h"
+#include "compiler_context.h"
 #include <iostream>
 #include <iomanip>
 #include <cstdio>
 #include <cstring>
 #include <cstdarg>
+#include <string>
+#include <deque>
+#include <vector>
+#include <unordered_map>
 
 using namespace std;
 
-extern int yylineno;
-extern int error_count;
-
-Symbol symtab[MAX_SYMBOLS];
-int symCount = 0;
-int current_scope = 0;
-int parent_scopes[100];  // Stack to track parent scope relationships
-int scope_depth = 0;     // Current depth in scope stack
-int current_offset = 0;
-char currentType[128] = "int";
-char current_function[128] = "";  // Track which function we're currently in
-int next_scope = 1;               // Always use 1 for function scopes (not sequential)
-int current_block_id = 0;         // Current nested block ID
-int next_block_id = 1;            // Counter for unique block IDs
-int parent_blocks[100];           // Stack of parent block IDs
-
-// Struct definition table
-StructDef structTable[MAX_STRUCTS];
-int structCount = 0;
-
-// Union definition table
-StructDef unionTable[MAX_STRUCTS];
-int unionCount = 0;
-
-// Function pointer registry
-char function_pointers[MAX_SYMBOLS][128];
-int function_pointer_count = 0;
+// Reset all symbol/struct/union tables so a new translation unit starts clean.
+// Only the used prefix of each table is cleared; insert* relies on zeroed slots.
+void resetSymbolTable() {
+    memset(ctx->symtab, 0, sizeof(Symbol) * ctx->symCount);
+    ctx->symCount = 0;
+    ctx->current_scope = 0;
+    ctx->scope_depth = 0;
+    ctx->current_offset = 0;
+    strcpy(ctx->currentType, "int");
+    ctx->current_function[0] = '\0';
+    ctx->next_scope = 1;
+    ctx->current_block_id = 0;
+    ctx->next_block_id = 1;
+    
+    memset(ctx->structTable, 0, sizeof(StructDef) * ctx->structCount);
+    ctx->structCount = 0;
+    memset(ctx->unionTable, 0, sizeof(StructDef) * ctx->unionCount);
+    ctx->unionCount = 0;
+    ctx->function_pointer_count = 0;
+    freeTypeTable(ctx->types);
+    ctx->types = NULL;
+}
+
+// ===== CANONICAL TYPE GRAPH =====
+
+// Owns the Type nodes of one compilation. Nodes are unique per shape
+// (hash-consing), spellings map to nodes after typedef resolution.
+// Also indexes typedef declarations so lookups do not scan symtab.
+struct TypeTable {
+    deque<Type> nodes;                                  // Stable addresses
+    deque<string> strings;                              // Backing store for names/signatures
+    unordered_map<string, const Type*> byShape;
+    unordered_map<string, const Type*> bySpelling;
+    unordered_map<string, vector<int> > typedefs;       // Name -> symtab indices, oldest first
+    unordered_map<string, const char*> resolvedTypedefs;
+    unordered_map<string, vector<string> > dependents;  // Spelling -> cached spellings resolved through it
+    vector<string> interning;                           // Spellings being interned or resolved, innermost last
+};
+
+void freeTypeTable(TypeTable* table) {
+    delete table;
+}
+
+static TypeTable* typeTable() {
+    if (!ctx->types) {
+        ctx->types = new TypeTable();
+    }
+    return ctx->types;
+}
+
+static const char* keepString(TypeTable* table, const string& text) {
+    table->strings.push_back(text);
+    return table->strings.back().c_str();
+}
+
+// The spelling being interned looked at `spelling`; its cache entries
+// must go when `spelling` starts to mean something else
+static void noteDependency(TypeTable* table, const string& spelling) {
+    if (!table->interning.empty() && table->interning.back() != spelling) {
+        table->dependents[spelling].push_back(table->interning.back());
+    }
+}
+
+// Drop the cached meaning of a spelling and of everything resolved through it
+static void forgetSpelling(TypeTable* table, const string& spelling) {
+    table->bySpelling.erase(spelling);
+    table->resolvedTypedefs.erase(spelling);
+    unordered_map<string, vector<string> >::iterator it = table->dependents.find(spelling);
+    if (it == table->dependents.end()) {
+        return;
+    }
+    vector<string> users;
+    users.swap(it->second);
+    table->dependents.erase(it);
+    for (size_t i = 0; i < users.size(); i++) {
+        forgetSpelling(table, users[i]);
+    }
+}
+
+// Return the unique node for a shape, creating it on first use
+static const Type* uniqueType(TypeKind kind, const Type* base, int length,
+                              const string& name, const string& signature) {
+    TypeTable* table = typeTable();
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix), "%d:%p:%d:", (int)kind, (const void*)base, length);
+    string key = string(prefix) + name + ":" + signature;
+    unordered_map<string, const Type*>::iterator it = table->byShape.find(key);
+    if (it != table->byShape.end()) {
+        return it->second;
+    }
+
+    Type node;
+    node.kind = kind;
+    node.base = base;
+    node.length = length;
+    node.name = keepString(table, name);
+    node.signature = signature.empty() ? NULL : keepString(table, signature);
+    node.size = -1;
+    node.align = -1;
+    table->nodes.push_back(node);
+    const Type* type = &table->nodes.back();
+    table->byShape[key] = type;
+    return type;
+}
+
+static string trimSpelling(const char* text, size_t length) {
+    size_t start = 0;
+    while (start < length && (text[start] == ' ' || text[start] == '\t')) start++;
+    while (length > start && (text[length - 1] == ' ' || text[length - 1] == '\t')) length--;
+    return string(text + start, length - start);
+}
+
+const Type* pointerToType(const Type* base) {
+    if (base->kind == TYPE_KIND_FUNCTION) {
+        return uniqueType(TYPE_KIND_POINTER, base, 0,
+                          string(base->base->name) + " (*)" + base->signature, "");
+    }
+    return uniqueType(TYPE_KIND_POINTER, base, 0, string(base->name) + "*", "");
+}
+
+const Type* arrayOfType(const Type* element, int length) {
+    char dim[32];
+    if (length > 0) {
+        snprintf(dim, sizeof(dim), "[%d]", length);
+    } else {
+        strcpy(dim, "[]");
+    }
+    // Dimensions are spelled outermost first: int[10][20] is 10 x int[20]
+    string name(element->name);
+    if (element->kind == TYPE_KIND_ARRAY) {
+        name.insert(name.find('['), dim);
+    } else {
+        name += dim;
+    }
+    return uniqueType(TYPE_KIND_ARRAY, element, length > 0 ? length : 0, name, "");
+}
+
+static const Type* functionType(const Type* returnType, const string& signature) {
+    return uniqueType(TYPE_KIND_FUNCTION, returnType, 0,
+                      string(returnType->name) + " " + signature, signature);
+}
+
+// Build the node for a spelling; the caller caches the result
+static const Type* parseTypeSpelling(const string& spelling) {
+    const char* text = spelling.c_str();
+
+    // Function pointer: "ret (*)(params)"
+    const char* fnptr = strstr(text, "(*");
+    if (fnptr) {
+        const Type* returnType = internType(trimSpelling(text, fnptr - text).c_str());
+        const char* close = strchr(fnptr, ')');
+        string signature = close ? trimSpelling(close + 1, strlen(close + 1)) : "()";
+        return pointerToType(functionType(returnType, signature));
+    }
+
+    // Array: "elem[d1][d2]..." (innermost dimension last)
+    const char* bracket = strchr(text, '[');
+    if (bracket) {
+        vector<int> dims;
+        for (const char* p = bracket; *p; p++) {
+            if (*p == '[') {
+                dims.push_back(atoi(p + 1));
+            }
+        }
+        const Type* type = internType(trimSpelling(text, bracket - text).c_str());
+        for (int i = (int)dims.size() - 1; i >= 0; i--) {
+            type = arrayOfType(type, dims[i]);
+        }
+        return type;
+    }
+
+    // Pointer: anything before the last '*' is the pointee
+    const char* star = strrchr(text, '*');
+    if (star) {
+        return pointerToType(internType(trimSpelling(text, star - text).c_str()));
+    }
+
+    if (strncmp(text, "struct ", 7) == 0) {
+        return uniqueType(TYPE_KIND_STRUCT, NULL, 0, "struct " + trimSpelling(text + 7, strlen(text + 7)), "");
+    }
+    if (strncmp(text, "union ", 6) == 0) {
+        return uniqueType(TYPE_KIND_UNION, NULL, 0, "union " + trimSpelling(text + 6, strlen(text + 6)), "");
+    }
+
+    // Typedef names stand for their underlying type
+    const char* resolved = resolvedTypedefName(text);
+    if (strcmp(resolved, text) != 0) {
+        return internType(resolved);
+    }
+    return uniqueType(TYPE_KIND_BASE, NULL, 0, spelling, "");
+}
+
+const Type* internType(const char* spelling) {
+    if (!spelling) spelling = "int";
+    TypeTable* table = typeTable();
+    noteDependency(table, spelling);
+    unordered_map<string, const Type*>::iterator it = table->bySpelling.find(spelling);
+    if (it != table->bySpelling.end()) {
+        return it->second;
+    }
+    table->interning.push_back(spelling);
+    const Type* type = parseTypeSpelling(trimSpelling(spelling, strlen(spelling)));
+    table->interning.pop_back();
+    table->bySpelling[spelling] = type;
+    return type;
+}
+
+// Arrays decay to a pointer to their innermost element (int[3][4] -> int*),
+// matching the flattened layout the IR generator uses
+const Type* decayType(const Type* type) {
+    if (type->kind != TYPE_KIND_ARRAY) return type;
+    const Type* element = type->base;
+    while (element->kind == TYPE_KIND_ARRAY) {
+        element = element->base;
+    }
+    return pointerToType(element);
+}
+
+static int baseTypeSize(const char* name) {
+    if (strcmp(name, "char") == 0) return 1;
+    if (strcmp(name, "short") == 0) return 2;
+    if (strcmp(name, "long") == 0) return 8;
+    if (strcmp(name, "double") == 0) return 8;
+    return 4;   // int, float, enum and anything unknown
+}
+
+int typeSize(const Type* type) {
+    if (type->size >= 0) return type->size;
+
+    int size = 4;
+    switch (type->kind) {
+        case TYPE_KIND_BASE:
+            size = baseTypeSize(type->name);
+            break;
+        case TYPE_KIND_POINTER:
+            size = POINTER_SIZE;
+            break;
+        case TYPE_KIND_ARRAY:
+            size = typeSize(type->base) * (type->length > 0 ? type->length : 1);
+            break;
+        case TYPE_KIND_STRUCT:
+        case TYPE_KIND_UNION: {
+            // Not cached until the definition has been seen
+            StructDef* def = (type->kind == TYPE_KIND_STRUCT) ? lookupStruct(type->name + 7)
+                                                             : lookupUnion(type->name + 6);
+            if (!def) return 0;
+            size = def->total_size;
+            break;
+        }
+        case TYPE_KIND_FUNCTION:
+            size = 4;
+            break;
+    }
+    ((Type*)type)->size = size;
+    return size;
+}
+
+int typeAlign(const Type* type) {
+    if (type->align >= 0) return type->align;
+
+    int align = 4;
+    switch (type->kind) {
+        case TYPE_KIND_BASE:
+            align = baseTypeSize(type->name);
+            break;
+        case TYPE_KIND_POINTER:
+            align = POINTER_SIZE;
+            break;
+        case TYPE_KIND_ARRAY:
+            align = typeAlign(type->base);
+            break;
+        case TYPE_KIND_STRUCT:
+        case TYPE_KIND_UNION: {
+            StructDef* def = (type->kind == TYPE_KIND_STRUCT) ? lookupStruct(type->name + 7)
+                                                             : lookupUnion(type->name + 6);
+            if (!def) return 1;
+            align = 1;
+            for (int i = 0; i < def->member_count; i++) {
+                int memberAlign = typeAlign(internType(def->members[i].type));
+                if (memberAlign > align) align = memberAlign;
+            }
+            break;
+        }
+        case TYPE_KIND_FUNCTION:
+            align = 4;
+            break;
+    }
+    ((Type*)type)->align = align;
+    return align;
+}
+
+int typeIsInteger(const Type* type) {
+    if (type->kind != TYPE_KIND_BASE) return 0;
+    const char* n = type->name;
+    return (strcmp(n, "int") == 0 || strcmp(n, "char") == 0 || strcmp(n, "short") == 0 ||
+            strcmp(n, "long") == 0 || strcmp(n, "enum") == 0 || strcmp(n, "_Bool") == 0 ||
+            strcmp(n, "bool") == 0);
+}
+
+int typeIsArithmetic(const Type* type) {
+    if (type->kind != TYPE_KIND_BASE) return 0;
+    const char* n = type->name;
+    // Enums are integer types in C, so they're arithmetic types
+    return (strcmp(n, "int") == 0 || strcmp(n, "char") == 0 || strcmp(n, "short") == 0 ||
+            strcmp(n, "long") == 0 || strcmp(n, "float") == 0 || strcmp(n, "double") == 0 ||
+            strcmp(n, "enum") == 0);
+}
+
+int typeIsPointer(const Type* type) {
+    return type->kind == TYPE_KIND_POINTER;
+}
+
+// Scalar types: arithmetic types and pointers (arrays decay to pointers)
+int typeIsScalar(const Type* type) {
+    return typeIsArithmetic(type) || type->kind == TYPE_KIND_POINTER || type->kind == TYPE_KIND_ARRAY;
+}
+
+int typesPointerCompatible(const Type* ptr1, const Type* ptr2) {
+    if (ptr1 == ptr2) return 1;
+    // Simplified: void* is compatible with any pointer
+    if ((ptr1->kind == TYPE_KIND_POINTER && strcmp(ptr1->base->name, "void") == 0) ||
+        (ptr2->kind == TYPE_KIND_POINTER && strcmp(ptr2->base->name, "void") == 0)) {
+        return 1;
+    }
+    return 0;
+}
 
 // Format function pointer type string
 void formatFunctionPointerType(Symbol* sym, char* out, int out_size) {
@@ -51,58 +355,58 @@ void formatFunctionPointerType(Symbol* sym, char* out, int out_size) {
 }
 
 void insertStruct(const char* name, StructMember* members, int member_count) {
-    if (structCount >= MAX_STRUCTS) {
+    if (ctx->structCount >= MAX_STRUCTS) {
         cerr << "Error: Struct table overflow" << endl;
         return;
     }
     
-    strcpy(structTable[structCount].name, name);
-    structTable[structCount].member_count = member_count;
+    strcpy(ctx->structTable[ctx->structCount].name, name);
+    ctx->structTable[ctx->structCount].member_count = member_count;
     
     int offset = 0;
     for (int i = 0; i < member_count; i++) {
-        structTable[structCount].members[i] = members[i];
-        structTable[structCount].members[i].offset = offset;
+        ctx->structTable[ctx->structCount].members[i] = members[i];
+        ctx->structTable[ctx->structCount].members[i].offset = offset;
         
         // Calculate size based on type
         int memberSize = getTypeSize(members[i].type);
-        structTable[structCount].members[i].size = memberSize;
+        ctx->structTable[ctx->structCount].members[i].size = memberSize;
         
         offset += memberSize;
     }
-    structTable[structCount].total_size = offset;
+    ctx->structTable[ctx->structCount].total_size = offset;
     
-    int saved_scope = current_scope;
-    int saved_depth = scope_depth;
-    current_scope = 0;
-    scope_depth = 0;
+    int saved_scope = ctx->current_scope;
+    int saved_depth = ctx->scope_depth;
+    ctx->current_scope = 0;
+    ctx->scope_depth = 0;
     
     // Insert struct tag as a type symbol in global scope
-    if (symCount < MAX_SYMBOLS) {
-        strcpy(symtab[symCount].name, name);
-        sprintf(symtab[symCount].type, "struct %s", name);
-        strcpy(symtab[symCount].kind, "struct_tag");
-        symtab[symCount].scope_level = 0;
-        symtab[symCount].parent_scope = -1;
-        symtab[symCount].size = offset;
-        symtab[symCount].is_function = 0;
-        symtab[symCount].is_external = 0;
-        symtab[symCount].is_static = 0;
-        strcpy(symtab[symCount].function_scope, "none");
-        symCount++;
+    if (ctx->symCount < MAX_SYMBOLS) {
+        strcpy(ctx->symtab[ctx->symCount].name, name);
+        sprintf(ctx->symtab[ctx->symCount].type, "struct %s", name);
+        strcpy(ctx->symtab[ctx->symCount].kind, "struct_tag");
+        ctx->symtab[ctx->symCount].scope_level = 0;
+        ctx->symtab[ctx->symCount].parent_scope = -1;
+        ctx->symtab[ctx->symCount].size = offset;
+        ctx->symtab[ctx->symCount].is_function = 0;
+        ctx->symtab[ctx->symCount].is_external = 0;
+        ctx->symtab[ctx->symCount].is_static = 0;
+        strcpy(ctx->symtab[ctx->symCount].function_scope, "none");
+        ctx->symCount++;
     }
     
     // Restore scope
-    current_scope = saved_scope;
-    scope_depth = saved_depth;
+    ctx->current_scope = saved_scope;
+    ctx->scope_depth = saved_depth;
     
-    structCount++;
+    ctx->structCount++;
 }
 
 StructDef* lookupStruct(const char* name) {
-    for (int i = 0; i < structCount; i++) {
-        if (strcmp(structTable[i].name, name) == 0) {
-            return &structTable[i];
+    for (int i = 0; i < ctx->structCount; i++) {
+        if (strcmp(ctx->structTable[i].name, name) == 0) {
+            return &ctx->structTable[i];
         }
     }
     return NULL;
@@ -124,61 +428,61 @@ int getStructSize(const char* struct_name) {
 
 // Insert union definition (size = max of member sizes)
 void insertUnion(const char* name, StructMember* members, int member_count) {
-    if (unionCount >= MAX_STRUCTS) {
+    if (ctx->unionCount >= MAX_STRUCTS) {
         cerr << "Error: Union table overflow" << endl;
         return;
     }
     
-    strcpy(unionTable[unionCount].name, name);
-    unionTable[unionCount].member_count = member_count;
+    strcpy(ctx->unionTable[ctx->unionCount].name, name);
+    ctx->unionTable[ctx->unionCount].member_count = member_count;
     
     int maxSize = 0;
     for (int i = 0; i < member_count; i++) {
-        unionTable[unionCount].members[i] = members[i];
-        unionTable[unionCount].members[i].offset = 0;  // All union members start at offset 0
+        ctx->unionTable[ctx->unionCount].members[i] = members[i];
+        ctx->unionTable[ctx->unionCount].members[i].offset = 0;  // All union members start at offset 0
         
         // Calculate size based on type
         int memberSize = getTypeSize(members[i].type);
-        unionTable[unionCount].members[i].size = memberSize;
+        ctx->unionTable[ctx->unionCount].members[i].size = memberSize;
         
         // Union size is the maximum of all member sizes
         if (memberSize > maxSize) {
             maxSize = memberSize;
         }
     }
-    unionTable[unionCount].total_size = maxSize;
+    ctx->unionTable[ctx->unionCount].total_size = maxSize;
     
-    int saved_scope = current_scope;
-    int saved_depth = scope_depth;
-    current_scope = 0;
-    scope_depth = 0;
+    int saved_scope = ctx->current_scope;
+    int saved_depth = ctx->scope_depth;
+    ctx->current_scope = 0;
+    ctx->scope_depth = 0;
     
     // Insert union tag as a type symbol in global scope
-    if (symCount < MAX_SYMBOLS) {
-        strcpy(symtab[symCount].name, name);
-        sprintf(symtab[symCount].type, "union %s", name);
-        strcpy(symtab[symCount].kind, "union_tag");
-        symtab[symCount].scope_level = 0;
-        symtab[symCount].parent_scope = -1;
-        symtab[symCount].size = maxSize;
-        symtab[symCount].is_function = 0;
-        symtab[symCount].is_external = 0;
-        symtab[symCount].is_static = 0;
-        strcpy(symtab[symCount].function_scope, "none");
-        symCount++;
+    if (ctx->symCount < MAX_SYMBOLS) {
+        strcpy(ctx->symtab[ctx->symCount].name, name);
+        sprintf(ctx->symtab[ctx->symCount].type, "union %s", name);
+        strcpy(ctx->symtab[ctx->symCount].kind, "union_tag");
+        ctx->symtab[ctx->symCount].scope_level = 0;
+        ctx->symtab[ctx->symCount].parent_scope = -1;
+        ctx->symtab[ctx->symCount].size = maxSize;
+        ctx->symtab[ctx->symCount].is_function = 0;
+        ctx->symtab[ctx->symCount].is_external = 0;
+        ctx->symtab[ctx->symCount].is_static = 0;
+        strcpy(ctx->symtab[ctx->symCount].function_scope, "none");
+        ctx->symCount++;
     }
     
     // Restore scope
-    current_scope = saved_scope;
-    scope_depth = saved_depth;
+    ctx->current_scope = saved_scope;
+    ctx->scope_depth = saved_depth;
     
-    unionCount++;
+    ctx->unionCount++;
 }
 
 StructDef* lookupUnion(const char* name) {
-    for (int i = 0; i < unionCount; i++) {
-        if (strcmp(unionTable[i].name, name) == 0) {
-            return &unionTable[i];
+    for (int i = 0; i < ctx->unionCount; i++) {
+        if (strcmp(ctx->unionTable[i].name, name) == 0) {
+            return &ctx->unionTable[i];
         }
     }
     return NULL;
@@ -198,79 +502,26 @@ int getUnionSize(const char* union_name) {
 }
 
 int getTypeSize(const char* type) {
-    if (strcmp(type, "char") == 0) return 1;
-    if (strcmp(type, "short") == 0) return 2;
-    if (strcmp(type, "int") == 0) return 4;
-    if (strcmp(type, "long") == 0) return 8;
-    if (strcmp(type, "float") == 0) return 4;
-    if (strcmp(type, "double") == 0) return 8;
-    if (strstr(type, "*")) return POINTER_SIZE;
-    // Check if it's a struct type
-    if (strncmp(type, "struct ", 7) == 0) {
-        return getStructSize(type);
-    }
-    
-    // Check if it's a union type
-    if (strncmp(type, "union ", 6) == 0) {
-        return getUnionSize(type);
-    }
-    
-    const char* bracket = strchr(type, '[');
-    if (bracket) {
-        // Extract base type (everything before '[')
-        char baseType[128];
-        int baseLen = bracket - type;
-        strncpy(baseType, type, baseLen);
-        baseType[baseLen] = '\0';
-        
-        // Get base type size
-        int baseSize = getTypeSize(baseType);
-        
-        // Calculate total size by multiplying all dimensions
-        int totalSize = baseSize;
-        const char* p = bracket;
-        while (*p) {
-            if (*p == '[') {
-                p++;
-                int dim = atoi(p);
-                if (dim > 0) {
-                    totalSize *= dim;
-                }
-                while (*p && *p != '[' && *p != ']') p++;
-                if (*p == ']') p++;
-            } else {
-                p++;
-            }
-        }
-        return totalSize;
-    }
-    
-    for (int i = 0; i < symCount; i++) {
-        if (strcmp(symtab[i].name, type) == 0 && strcmp(symtab[i].kind, "typedef") == 0) {
-            return getTypeSize(symtab[i].type);
-        }
-    }
-    
-    return 4;
+    return typeSize(internType(type));
 }
 
 void insertVariable(const char* name, const char* type, int is_array, int* dims, int num_dims, int ptr_level, int is_static, int points_to_const, int is_const_ptr, int is_reference) {
-    if (symCount >= MAX_SYMBOLS) {
+    if (ctx->symCount >= MAX_SYMBOLS) {
         cerr << "Error: Symbol table overflow" << endl;
         return;
     }
     
 
-    for (int i = symCount - 1; i >= 0; i--) {
-        if (strcmp(symtab[i].name, name) == 0 && 
-            symtab[i].scope_level == current_scope &&
-            symtab[i].block_id == current_block_id &&
-            strcmp(symtab[i].function_scope, current_function) == 0) {
+    for (int i = ctx->symCount - 1; i >= 0; i--) {
+        if (strcmp(ctx->symtab[i].name, name) == 0 && 
+            ctx->symtab[i].scope_level == ctx->current_scope &&
+            ctx->symtab[i].block_id == ctx->current_block_id &&
+            strcmp(ctx->symtab[i].function_scope, ctx->current_function) == 0) {
             return;
         }
     }
     
-    strcpy(symtab[symCount].name, name);
+    strcpy(ctx->symtab[ctx->symCount].name, name);
     
     char fullType[256];
     strcpy(fullType, type);
@@ -281,11 +532,11 @@ void insertVariable(const char* name, const char* type, int is_array, int* dims,
             sprintf(dimStr, "[%d]", dims[i]);
             strcat(fullType, dimStr);
         }
-        strcpy(symtab[symCount].type, fullType);
+        strcpy(ctx->symtab[ctx->symCount].type, fullType);
         if (is_static) {
-            strcpy(symtab[symCount].kind, "variable (static)");
+            strcpy(ctx->symtab[ctx->symCount].kind, "variable (static)");
         } else {
-            strcpy(symtab[symCount].kind, "variable");
+            strcpy(ctx->symtab[ctx->symCount].kind, "variable");
         }
     } else if (ptr_level > 0) {
         char cleaned_type[256];
@@ -299,75 +550,75 @@ void insertVariable(const char* name, const char* type, int is_array, int* dims,
         }
         cleaned_type[dst_idx] = '\0';
         
-        strcpy(symtab[symCount].type, cleaned_type);
+        strcpy(ctx->symtab[ctx->symCount].type, cleaned_type);
         if (is_static) {
-            strcpy(symtab[symCount].kind, "variable (static)");
+            strcpy(ctx->symtab[ctx->symCount].kind, "variable (static)");
         } else {
-            strcpy(symtab[symCount].kind, "variable");
+            strcpy(ctx->symtab[ctx->symCount].kind, "variable");
         }
     } else if (strcmp(type, "function_pointer") == 0) {
         char fp_type[256];
-        formatFunctionPointerType(&symtab[symCount], fp_type, sizeof(fp_type));
-        strcpy(symtab[symCount].type, fp_type);
-        strcpy(symtab[symCount].kind, "function_pointer");
+        formatFunctionPointerType(&ctx->symtab[ctx->symCount], fp_type, sizeof(fp_type));
+        strcpy(ctx->symtab[ctx->symCount].type, fp_type);
+        strcpy(ctx->symtab[ctx->symCount].kind, "function_pointer");
     } else {
-        strcpy(symtab[symCount].type, type);
+        strcpy(ctx->symtab[ctx->symCount].type, type);
         if (is_static) {
-            strcpy(symtab[symCount].kind, "variable (static)");
+            strcpy(ctx->symtab[ctx->symCount].kind, "variable (static)");
         } else {
-            strcpy(symtab[symCount].kind, "variable");
+            strcpy(ctx->symtab[ctx->symCount].kind, "variable");
         }
     }
     
-    symtab[symCount].scope_level = current_scope;
-    symtab[symCount].parent_scope = (scope_depth > 0) ? parent_scopes[scope_depth - 1] : -1;
-    symtab[symCount].block_id = (current_scope >= 2) ? current_block_id : 0;
-    symtab[symCount].offset = current_offset;
-    symtab[symCount].is_array = is_array;
-    symtab[symCount].ptr_level = ptr_level;
-    symtab[symCount].is_function = 0;
-    symtab[symCount].is_external = 0;
-    symtab[symCount].is_static = is_static;
-    symtab[symCount].points_to_const = points_to_const;
-    symtab[symCount].is_const_ptr = is_const_ptr;
-    symtab[symCount].is_const = (points_to_const || is_const_ptr);
-    symtab[symCount].is_reference = is_reference;
+    ctx->symtab[ctx->symCount].scope_level = ctx->current_scope;
+    ctx->symtab[ctx->symCount].parent_scope = (ctx->scope_depth > 0) ? ctx->parent_scopes[ctx->scope_depth - 1] : -1;
+    ctx->symtab[ctx->symCount].block_id = (ctx->current_scope >= 2) ? ctx->current_block_id : 0;
+    ctx->symtab[ctx->symCount].offset = ctx->current_offset;
+    ctx->symtab[ctx->symCount].is_array = is_array;
+    ctx->symtab[ctx->symCount].ptr_level = ptr_level;
+    ctx->symtab[ctx->symCount].is_function = 0;
+    ctx->symtab[ctx->symCount].is_external = 0;
+    ctx->symtab[ctx->symCount].is_static = is_static;
+    ctx->symtab[ctx->symCount].points_to_const = points_to_const;
+    ctx->symtab[ctx->symCount].is_const_ptr = is_const_ptr;
+    ctx->symtab[ctx->symCount].is_const = (points_to_const || is_const_ptr);
+    ctx->symtab[ctx->symCount].is_reference = is_reference;
     
     // Set the function scope name
-    strcpy(symtab[symCount].function_scope, current_function);
+    strcpy(ctx->symtab[ctx->symCount].function_scope, ctx->current_function);
     
     // Calculate size
     int base_size = getTypeSize(type);
     if (is_array) {
-        symtab[symCount].num_dims = num_dims;
+        ctx->symtab[ctx->symCount].num_dims = num_dims;
         int total_elements = 1;
         for (int i = 0; i < num_dims; i++) {
-            symtab[symCount].array_dims[i] = dims[i];
+            ctx->symtab[ctx->symCount].array_dims[i] = dims[i];
             total_elements *= dims[i];
         }
-        symtab[symCount].size = base_size * total_elements;
+        ctx->symtab[ctx->symCount].size = base_size * total_elements;
     } else if (is_reference) {
         // References are implemented as pointers (store an address)
-        symtab[symCount].size = POINTER_SIZE;
+        ctx->symtab[ctx->symCount].size = POINTER_SIZE;
     } else {
-        symtab[symCount].size = base_size;
+        ctx->symtab[ctx->symCount].size = base_size;
     }
     
-    current_offset += symtab[symCount].size;
-    symCount++;
+    ctx->current_offset += ctx->symtab[ctx->symCount].size;
+    ctx->symCount++;
 }
 
 void insertParameter(const char* name, const char* type, int ptr_level) {
-    if (symCount >= MAX_SYMBOLS) {
+    if (ctx->symCount >= MAX_SYMBOLS) {
         cerr << "Error: Symbol table overflow" << endl;
         return;
     }
     
     // Check for duplicate in current scope and current function
-    for (int i = symCount - 1; i >= 0; i--) {
-        if (strcmp(symtab[i].name, name) == 0 && 
-            symtab[i].scope_level == current_scope &&
-            strcmp(symtab[i].function_scope, current_function) == 0) {
+    for (int i = ctx->symCount - 1; i >= 0; i--) {
+        if (strcmp(ctx->symtab[i].name, name) == 0 && 
+            ctx->symtab[i].scope_level == ctx->current_scope &&
+            strcmp(ctx->symtab[i].function_scope, ctx->current_function) == 0) {
             return; // Already exists in this function scope
         }
     }
@@ -389,64 +640,64 @@ void insertParameter(const char* name, const char* type, int ptr_level) {
         strcpy(cleaned_type, type);
     }
     
-    strcpy(symtab[symCount].name, name);
-    strcpy(symtab[symCount].type, cleaned_type);
-    strcpy(symtab[symCount].kind, "parameter");  // Mark as parameter, not variable
-    symtab[symCount].scope_level = current_scope;
-    symtab[symCount].parent_scope = (scope_depth > 0) ? parent_scopes[scope_depth - 1] : -1;
-    symtab[symCount].block_id = 0;  // Parameters are at function scope, no block ID
-    symtab[symCount].offset = current_offset;
-    symtab[symCount].is_array = 0;
-    symtab[symCount].ptr_level = ptr_level;
-    symtab[symCount].is_function = 0;
-    symtab[symCount].is_external = 0;  // Parameters are never external
-    symtab[symCount].is_static = 0;  // Parameters are never static
+    strcpy(ctx->symtab[ctx->symCount].name, name);
+    strcpy(ctx->symtab[ctx->symCount].type, cleaned_type);
+    strcpy(ctx->symtab[ctx->symCount].kind, "parameter");  // Mark as parameter, not variable
+    ctx->symtab[ctx->symCount].scope_level = ctx->current_scope;
+    ctx->symtab[ctx->symCount].parent_scope = (ctx->scope_depth > 0) ? ctx->parent_scopes[ctx->scope_depth - 1] : -1;
+    ctx->symtab[ctx->symCount].block_id = 0;  // Parameters are at function scope, no block ID
+    ctx->symtab[ctx->symCount].offset = ctx->current_offset;
+    ctx->symtab[ctx->symCount].is_array = 0;
+    ctx->symtab[ctx->symCount].ptr_level = ptr_level;
+    ctx->symtab[ctx->symCount].is_function = 0;
+    ctx->symtab[ctx->symCount].is_external = 0;  // Parameters are never external
+    ctx->symtab[ctx->symCount].is_static = 0;  // Parameters are never static
     
     // Set the function scope name
-    strcpy(symtab[symCount].function_scope, current_function);
+    strcpy(ctx->symtab[ctx->symCount].function_scope, ctx->current_function);
     
     // Get size based on type (handles pointers correctly)
-    symtab[symCount].size = getTypeSize(type);
+    ctx->symtab[ctx->symCount].size = getTypeSize(type);
     
-    current_offset += symtab[symCount].size;
-    symCount++;
+    ctx->current_offset += ctx->symtab[ctx->symCount].size;
+    ctx->symCount++;
 }
 
 void insertFunction(const char* name, const char* ret_type, int param_count, char params[][128], char param_names[][128], int is_static) {
-    if (symCount >= MAX_SYMBOLS) {
+    if (ctx->symCount >= MAX_SYMBOLS) {
         cerr << "Error: Symbol table overflow" << endl;
         return;
     }
     
-    strcpy(symtab[symCount].name, name);
-    strcpy(symtab[symCount].return_type, ret_type);
+    strcpy(ctx->symtab[ctx->symCount].name, name);
+    strcpy(ctx->symtab[ctx->symCount].return_type, ret_type);
     if (is_static) {
-        strcpy(symtab[symCount].kind, "function (static)");
+        strcpy(ctx->symtab[ctx->symCount].kind, "function (static)");
     } else {
-        strcpy(symtab[symCount].kind, "function");
-    }
-    symtab[symCount].scope_level = 0;  // Functions are always at global scope
-    symtab[symCount].parent_scope = -1; // No parent for global scope
-    symtab[symCount].block_id = 0;  // Functions don't have block IDs
-    symtab[symCount].is_function = 1;
-    symtab[symCount].param_count = param_count;
-    strcpy(symtab[symCount].function_scope, "");  // Functions are in global scope
-    symtab[symCount].is_external = 0;  // User-defined functions are not external
-    symtab[symCount].is_static = is_static;  // Set static flag
-    symtab[symCount].size = 0;  // Functions have size 0
+        strcpy(ctx->symtab[ctx->symCount].kind, "function");
+    }
+    ctx->symtab[ctx->symCount].scope_level = 0;  // Functions are always at global scope
+    ctx->symtab[ctx->symCount].parent_scope = -1; // No parent for global scope
+    ctx->symtab[ctx->symCount].block_id = 0;  // Functions don't have block IDs
+    ctx->symtab[ctx->symCount].is_function = 1;
+    ctx->symtab[ctx->symCount].param_count = param_count;
+    strcpy(ctx->symtab[ctx->symCount].function_scope, "");  // Functions are in global scope
+    ctx->symtab[ctx->symCount].is_external = 0;  // User-defined functions are not external
+    ctx->symtab[ctx->symCount].is_static = is_static;  // Set static flag
+    ctx->symtab[ctx->symCount].size = 0;  // Functions have size 0
     
     if (params && param_names) {
         for (int i = 0; i < param_count; i++) {
-            strcpy(symtab[symCount].param_types[i], params[i]);
-            strcpy(symtab[symCount].param_names[i], param_names[i]);
+            strcpy(ctx->symtab[ctx->symCount].param_types[i], params[i]);
+            strcpy(ctx->symtab[ctx->symCount].param_names[i], param_names[i]);
         }
     }
     
-    symCount++;
+    ctx->symCount++;
 }
 
 void insertExternalFunction(const char* name, const char* ret_type) {
-    if (symCount >= MAX_SYMBOLS) {
+    if (ctx->symCount >= MAX_SYMBOLS) {
         cerr << "Error: Symbol table overflow" << endl;
         return;
     }
@@ -463,81 +714,81 @@ void insertExternalFunction(const char* name, const char* ret_type) {
     }
     // printf, scanf, etc. default to int (which is correct)
     
-    strcpy(symtab[symCount].name, name);
-    strcpy(symtab[symCount].return_type, actual_ret_type);
-    strcpy(symtab[symCount].kind, "function (external)");  // Mark as external in kind
-    symtab[symCount].scope_level = 0;  // Functions are always at global scope
-    symtab[symCount].parent_scope = -1; // No parent for global scope
-    symtab[symCount].block_id = 0;  // Functions don't have block IDs
-    symtab[symCount].is_function = 1;
-    symtab[symCount].param_count = 0;  // Don't know params for external functions
-    strcpy(symtab[symCount].function_scope, "");  // Functions are in global scope
-    symtab[symCount].is_external = 1;  // Mark as external/library function
-    symtab[symCount].is_static = 0;  // External functions are not static
-    symtab[symCount].size = 0;  // Functions have size 0
-    
-    symCount++;
+    strcpy(ctx->symtab[ctx->symCount].name, name);
+    strcpy(ctx->symtab[ctx->symCount].return_type, actual_ret_type);
+    strcpy(ctx->symtab[ctx->symCount].kind, "function (external)");  // Mark as external in kind
+    ctx->symtab[ctx->symCount].scope_level = 0;  // Functions are always at global scope
+    ctx->symtab[ctx->symCount].parent_scope = -1; // No parent for global scope
+    ctx->symtab[ctx->symCount].block_id = 0;  // Functions don't have block IDs
+    ctx->symtab[ctx->symCount].is_function = 1;
+    ctx->symtab[ctx->symCount].param_count = 0;  // Don't know params for external functions
+    strcpy(ctx->symtab[ctx->symCount].function_scope, "");  // Functions are in global scope
+    ctx->symtab[ctx->symCount].is_external = 1;  // Mark as external/library function
+    ctx->symtab[ctx->symCount].is_static = 0;  // External functions are not static
+    ctx->symtab[ctx->symCount].size = 0;  // Functions have size 0
+    
+    ctx->symCount++;
 }
 
 void insertLabel(const char* name) {
-    if (symCount >= MAX_SYMBOLS) {
+    if (ctx->symCount >= MAX_SYMBOLS) {
         fprintf(stderr, "Error: Symbol table overflow\n");
         return;
     }
     
     // Check for duplicate label in the current function (labels have function scope in C)
-    for (int i = 0; i < symCount; i++) {
-        if (strcmp(symtab[i].name, name) == 0 && 
-            strcmp(symtab[i].kind, "label") == 0 &&
-            strcmp(symtab[i].function_scope, current_function) == 0) {
+    for (int i = 0; i < ctx->symCount; i++) {
+        if (strcmp(ctx->symtab[i].name, name) == 0 && 
+            strcmp(ctx->symtab[i].kind, "label") == 0 &&
+            strcmp(ctx->symtab[i].function_scope, ctx->current_function) == 0) {
             // Duplicate label found in same function
-            type_error(yylineno, "Duplicate label '%s'", name);
+            type_error(currentLineNumber(), "Duplicate label '%s'", name);
             return;  // Don't insert duplicate
         }
     }
     
-    strcpy(symtab[symCount].name, name);
-    strcpy(symtab[symCount].type, "-");  // Labels don't have a type
-    strcpy(symtab[symCount].kind, "label");
-    symtab[symCount].scope_level = current_scope;
-    symtab[symCount].parent_scope = (scope_depth > 0) ? parent_scopes[scope_depth - 1] : -1;
-    symtab[symCount].block_id = (current_scope >= 2) ? current_block_id : 0;
-    symtab[symCount].is_function = 0;
-    symtab[symCount].is_array = 0;
-    symtab[symCount].ptr_level = 0;
-    symtab[symCount].num_dims = 0;
-    strcpy(symtab[symCount].function_scope, current_function);
-    symtab[symCount].is_external = 0;
-    symtab[symCount].is_static = 0;
-    symtab[symCount].size = 0;  // Labels don't occupy storage
+    strcpy(ctx->symtab[ctx->symCount].name, name);
+    strcpy(ctx->symtab[ctx->symCount].type, "-");  // Labels don't have a type
+    strcpy(ctx->symtab[ctx->symCount].kind, "label");
+    ctx->symtab[ctx->symCount].scope_level = ctx->current_scope;
+    ctx->symtab[ctx->symCount].parent_scope = (ctx->scope_depth > 0) ? ctx->parent_scopes[ctx->scope_depth - 1] : -1;
+    ctx->symtab[ctx->symCount].block_id = (ctx->current_scope >= 2) ? ctx->current_block_id : 0;
+    ctx->symtab[ctx->symCount].is_function = 0;
+    ctx->symtab[ctx->symCount].is_array = 0;
+    ctx->symtab[ctx->symCount].ptr_level = 0;
+    ctx->symtab[ctx->symCount].num_dims = 0;
+    strcpy(ctx->symtab[ctx->symCount].function_scope, ctx->current_function);
+    ctx->symtab[ctx->symCount].is_external = 0;
+    ctx->symtab[ctx->symCount].is_static = 0;
+    ctx->symtab[ctx->symCount].size = 0;  // Labels don't occupy storage
     
-    symCount++;
+    ctx->symCount++;
 }
 
 Symbol* lookupLabel(const char* name) {
     // Labels have function scope in C, so search within current function
-    for (int i = 0; i < symCount; i++) {
-        if (strcmp(symtab[i].name, name) == 0 && 
-            strcmp(symtab[i].kind, "label") == 0 &&
-            strcmp(symtab[i].function_scope, current_function) == 0) {
-            return &symtab[i];
+    for (int i = 0; i < ctx->symCount; i++) {
+        if (strcmp(ctx->symtab[i].name, name) == 0 && 
+            strcmp(ctx->symtab[i].kind, "label") == 0 &&
+            strcmp(ctx->symtab[i].function_scope, ctx->current_function) == 0) {
+            return &ctx->symtab[i];
         }
     }
     return NULL;
 }
 
 Symbol* lookupSymbol(const char* name) {
-    for (int i = symCount - 1; i >= 0; i--) {
-        if (strcmp(symtab[i].name, name) == 0) {
+    for (int i = ctx->symCount - 1; i >= 0; i--) {
+        if (strcmp(ctx->symtab[i].name, name) == 0) {
             
-            int check_scope = current_scope;
-            int check_block = current_block_id;
-            int depth_idx = scope_depth - 1; // Index into parent_scopes/parent_blocks arrays
+            int check_scope = ctx->current_scope;
+            int check_block = ctx->current_block_id;
+            int depth_idx = ctx->scope_depth - 1; // Index into parent_scopes/parent_blocks arrays
             
             while (check_scope >= 0) {
-                if (symtab[i].scope_level == check_scope) {
-                    if (symtab[i].block_id == check_block || symtab[i].block_id == 0) {
-                        return &symtab[i];
+                if (ctx->symtab[i].scope_level == check_scope) {
+                    if (ctx->symtab[i].block_id == check_block || ctx->symtab[i].block_id == 0) {
+                        return &ctx->symtab[i];
                     } else {
                         
                         break;
@@ -549,8 +800,8 @@ Symbol* lookupSymbol(const char* name) {
                 
                 // Move up one level in the scope hierarchy
                 if (depth_idx >= 0) {
-                    check_scope = parent_scopes[depth_idx];
-                    check_block = parent_blocks[depth_idx];
+                    check_scope = ctx->parent_scopes[depth_idx];
+                    check_block = ctx->parent_blocks[depth_idx];
                     depth_idx--;
                 } else {
                     check_scope = 0; // Go to global
@@ -564,58 +815,58 @@ Symbol* lookupSymbol(const char* name) {
 
 void enterFunctionScope(const char* func_name) {
     // All functions use scope level 1 (not sequential)
-    current_scope = 1;
+    ctx->current_scope = 1;
     
     // Track the function name
-    strcpy(current_function, func_name);
+    strcpy(ctx->current_function, func_name);
     
     // Push onto scope stack
-    if (scope_depth < 100) {
-        parent_scopes[scope_depth] = 0;  // Parent is always global scope (0)
-        scope_depth++;
+    if (ctx->scope_depth < 100) {
+        ctx->parent_scopes[ctx->scope_depth] = 0;  // Parent is always global scope (0)
+        ctx->scope_depth++;
     }
 }
 
 void exitFunctionScope() {
     // Exit function scope
-    if (scope_depth > 0) {
-        scope_depth--;
+    if (ctx->scope_depth > 0) {
+        ctx->scope_depth--;
     }
-    current_scope = 0;  // Return to global scope
-    strcpy(current_function, "");  // Clear current function
+    ctx->current_scope = 0;  // Return to global scope
+    strcpy(ctx->current_function, "");  // Clear current function
 }
 
 void enterScope() {
     // Push current scope and block onto parent stacks
-    if (scope_depth < 100) {
-        parent_scopes[scope_depth] = current_scope;
-        parent_blocks[scope_depth] = current_block_id;
-        scope_depth++;
+    if (ctx->scope_depth < 100) {
+        ctx->parent_scopes[ctx->scope_depth] = ctx->current_scope;
+        ctx->parent_blocks[ctx->scope_depth] = ctx->current_block_id;
+        ctx->scope_depth++;
     }
     // Increment scope level for nested blocks
-    current_scope++;
+    ctx->current_scope++;
     // Assign unique block ID for this nested block
-    current_block_id = next_block_id++;
+    ctx->current_block_id = ctx->next_block_id++;
 }
 
 void exitScope() {
-    if (scope_depth > 0) {
-        scope_depth--;
-        current_scope = parent_scopes[scope_depth];
-        current_block_id = parent_blocks[scope_depth];
+    if (ctx->scope_depth > 0) {
+        ctx->scope_depth--;
+        ctx->current_scope = ctx->parent_scopes[ctx->scope_depth];
+        ctx->current_block_id = ctx->parent_blocks[ctx->scope_depth];
     } else {
-        current_scope = 0;
-        current_block_id = 0;
+        ctx->current_scope = 0;
+        ctx->current_block_id = 0;
     }
 }
 
 void moveRecentSymbolsToCurrentScope(int count) {
     int moved = 0;
-    for (int i = symCount - 1; i >= 0 && moved < count; i--) {
-        if (!symtab[i].is_function && symtab[i].scope_level == 0) {
-            symtab[i].scope_level = current_scope;
-            symtab[i].parent_scope = (scope_depth > 0) ? parent_scopes[scope_depth - 1] : -1;
-            strcpy(symtab[i].function_scope, current_function);  // Set function scope
+    for (int i = ctx->symCount - 1; i >= 0 && moved < count; i--) {
+        if (!ctx->symtab[i].is_function && ctx->symtab[i].scope_level == 0) {
+            ctx->symtab[i].scope_level = ctx->current_scope;
+            ctx->symtab[i].parent_scope = (ctx->scope_depth > 0) ? ctx->parent_scopes[ctx->scope_depth - 1] : -1;
+            strcpy(ctx->symtab[i].function_scope, ctx->current_function);  // Set function scope
             moved++;
         }
     }
@@ -625,21 +876,21 @@ void markRecentSymbolsAsParameters(int count) {
     int marked = 0;
     Symbol* params[16];  // Store pointers to parameter symbols
     
-    for (int i = symCount - 1; i >= 0 && marked < count; i--) {
-        if (!symtab[i].is_function && symtab[i].scope_level == current_scope) {
-            strcpy(symtab[i].kind, "parameter");
-            params[marked] = &symtab[i];
+    for (int i = ctx->symCount - 1; i >= 0 && marked < count; i--) {
+        if (!ctx->symtab[i].is_function && ctx->symtab[i].scope_level == ctx->current_scope) {
+            strcpy(ctx->symtab[i].kind, "parameter");
+            params[marked] = &ctx->symtab[i];
             marked++;
         }
     }
     
-    for (int i = symCount - 1; i >= 0; i--) {
-        if (symtab[i].is_function && strcmp(symtab[i].name, current_function) == 0) {
-            symtab[i].param_count = count;
+    for (int i = ctx->symCount - 1; i >= 0; i--) {
+        if (ctx->symtab[i].is_function && strcmp(ctx->symtab[i].name, ctx->current_function) == 0) {
+            ctx->symtab[i].param_count = count;
             // Copy parameter types and names (in reverse order since we collected them backwards)
             for (int j = 0; j < count; j++) {
-                strcpy(symtab[i].param_types[j], params[count - 1 - j]->type);
-                strcpy(symtab[i].param_names[j], params[count - 1 - j]->name);
+                strcpy(ctx->symtab[i].param_types[j], params[count - 1 - j]->type);
+                strcpy(ctx->symtab[i].param_names[j], params[count - 1 - j]->name);
             }
             break;
         }
@@ -655,16 +906,16 @@ void insertSymbol(const char* name, const char* type, int is_function, int is_st
 }
 
 void registerFunctionPointer(const char* name) {
-    if (function_pointer_count < MAX_SYMBOLS) {
-        strncpy(function_pointers[function_pointer_count], name, 127);
-        function_pointers[function_pointer_count][127] = '\0';
-        function_pointer_count++;
+    if (ctx->function_pointer_count < MAX_SYMBOLS) {
+        strncpy(ctx->function_pointers[ctx->function_pointer_count], name, 127);
+        ctx->function_pointers[ctx->function_pointer_count][127] = '\0';
+        ctx->function_pointer_count++;
     }
 }
 
 int isFunctionPointerName(const char* name) {
-    for (int i = 0; i < function_pointer_count; i++) {
-        if (strcmp(function_pointers[i], name) == 0) {
+    for (int i = 0; i < ctx->function_pointer_count; i++) {
+        if (strcmp(ctx->function_pointers[i], name) == 0) {
             return 1;
         }
     }
@@ -672,51 +923,33 @@ int isFunctionPointerName(const char* name) {
 }
 
 int is_type_name(const char* name) {
-    for (int i = 0; i < symCount; i++) {
-        if (strcmp(symtab[i].name, name) == 0 &&
-            strcmp(symtab[i].kind, "typedef") == 0) {
-            return 1;
-        }
-    }
-    return 0;
+    return ctx->types && ctx->types->typedefs.count(name) > 0;
+}
+
+// Turn a just-inserted symbol into a typedef; spellings interned before
+// that resolved through its name may now mean something else.
+// The index is not scoped: the IR generator resolves typedef names after
+// the parser has left every block, so entries are never popped and the
+// most recent declaration of a name wins, as with the old symtab scan.
+void markSymbolAsTypedef(Symbol* sym) {
+    strcpy(sym->kind, "typedef");
+    TypeTable* table = typeTable();
+    table->typedefs[sym->name].push_back((int)(sym - ctx->symtab));
+    forgetSpelling(table, sym->name);
 }
 
 int isArithmeticType(const char* type) {
     if (!type) return 0;
-    
-    // Resolve typedef first to get underlying type
-    char* resolved = resolveTypedef(type);
-    const char* actual_type = resolved ? resolved : type;
-    
-    // Enums are integer types in C, so they're arithmetic types
-    int result = (strcmp(actual_type, "int") == 0 || strcmp(actual_type, "char") == 0 ||
-            strcmp(actual_type, "short") == 0 || strcmp(actual_type, "long") == 0 ||
-            strcmp(actual_type, "float") == 0 || strcmp(actual_type, "double") == 0 ||
-            strcmp(actual_type, "enum") == 0);
-    
-    if (resolved) free(resolved);
-    return result;
+    return typeIsArithmetic(internType(type));
 }
 
 int isIntegerType(const char* type) {
     if (!type) return 0;
-    
-    // Resolve typedef first
-    char* resolved = resolveTypedef(type);
-    const char* actual_type = resolved ? resolved : type;
-    
-    // Check for basic integer types (including bool and _Bool)
-    int result = (strcmp(actual_type, "int") == 0 || strcmp(actual_type, "char") == 0 ||
-            strcmp(actual_type, "short") == 0 || strcmp(actual_type, "long") == 0 ||
-            strcmp(actual_type, "enum") == 0 || strcmp(actual_type, "_Bool") == 0 ||
-            strcmp(actual_type, "bool") == 0);
-    
-    if (resolved) free(resolved);
-    return result;
+    return typeIsInteger(internType(type));
 }
 
 char* usualArithConv(const char* t1, const char* t2) {
-    static char result[32];
+    static thread_local char result[32];
     if (strcmp(t1, "double") == 0 || strcmp(t2, "double") == 0) 
         strcpy(result, "double");
     else if (strcmp(t1, "float") == 0 || strcmp(t2, "float") == 0) 
@@ -729,20 +962,22 @@ char* usualArithConv(const char* t1, const char* t2) {
 }
 
 int isAssignable(const char* lhs_type, const char* rhs_type) {
-    if (strcmp(lhs_type, rhs_type) == 0) return 1;
-    if (isArithmeticType(lhs_type) && isArithmeticType(rhs_type)) return 1;
-    if (strstr(lhs_type, "*") && strstr(rhs_type, "*")) return 1;
+    const Type* lhs = internType(lhs_type);
+    const Type* rhs = internType(rhs_type);
+    if (lhs == rhs) return 1;
+    if (typeIsArithmetic(lhs) && typeIsArithmetic(rhs)) return 1;
+    if (typeIsPointer(lhs) && typeIsPointer(rhs)) return 1;
     return 0;
 }
 
 void setCurrentType(const char* type) {
-    strcpy(currentType, type);
+    strcpy(ctx->currentType, type);
 }
 
 // Helper function to clean up typedef type display
 // Removes anonymous struct/union tags for cleaner output
 const char* getDisplayType(const Symbol* sym) {
-    static char display_type[128];
+    static thread_local char display_type[128];
     
     // If it's a typedef, clean up the type string
     if (strcmp(sym->kind, "typedef") == 0) {
@@ -769,8 +1004,8 @@ void printSymbolTable() {
     
     // Count user-defined symbols in global scope
     int global_user_symbols = 0;
-    for (int i = 0; i < symCount; i++) {
-        if (symtab[i].scope_level == 0 && !symtab[i].is_external) {
+    for (int i = 0; i < ctx->symCount; i++) {
+        if (ctx->symtab[i].scope_level == 0 && !ctx->symtab[i].is_external) {
             global_user_symbols++;
         }
     }
@@ -778,26 +1013,26 @@ void printSymbolTable() {
     // Print global scope (0) - only user-defined symbols
     if (global_user_symbols > 0) {
         cout << ">>> GLOBAL <<<" << endl;
-        for (int i = 0; i < symCount; i++) {
-            if (symtab[i].scope_level == 0 && !symtab[i].is_external) {
+        for (int i = 0; i < ctx->symCount; i++) {
+            if (ctx->symtab[i].scope_level == 0 && !ctx->symtab[i].is_external) {
                 const char* display_type;
-                if (symtab[i].is_function) {
-                    display_type = symtab[i].return_type;
+                if (ctx->symtab[i].is_function) {
+                    display_type = ctx->symtab[i].return_type;
                 } else {
-                    display_type = getDisplayType(&symtab[i]);
+                    display_type = getDisplayType(&ctx->symtab[i]);
                 }
                 
-                cout << left << setw(20) << symtab[i].name
+                cout << left << setw(20) << ctx->symtab[i].name
                      << setw(20) << display_type
-                     << setw(20) << symtab[i].kind
-                     << setw(5) << symtab[i].scope_level
+                     << setw(20) << ctx->symtab[i].kind
+                     << setw(5) << ctx->symtab[i].scope_level
                      << setw(20) << "none";
                 
                 // Show "-" for labels, actual size for others
-                if (strcmp(symtab[i].kind, "label") == 0) {
+                if (strcmp(ctx->symtab[i].kind, "label") == 0) {
                     cout << setw(4) << "-" << endl;
                 } else {
-                    cout << setw(4) << symtab[i].size << endl;
+                    cout << setw(4) << ctx->symtab[i].size << endl;
                 }
             }
         }
@@ -805,8 +1040,8 @@ void printSymbolTable() {
     
     // Print function scope (1) - group by function
     bool has_function_scope = false;
-    for (int i = 0; i < symCount; i++) {
-        if (symtab[i].scope_level == 1) {
+    for (int i = 0; i < ctx->symCount; i++) {
+        if (ctx->symtab[i].scope_level == 1) {
             has_function_scope = true;
             break;
         }
@@ -817,9 +1052,9 @@ void printSymbolTable() {
         char processed_functions[100][128];
         int processed_count = 0;
         
-        for (int i = 0; i < symCount; i++) {
-            if (symtab[i].scope_level == 1 && strlen(symtab[i].function_scope) > 0) {
-                const char* func_name = symtab[i].function_scope;
+        for (int i = 0; i < ctx->symCount; i++) {
+            if (ctx->symtab[i].scope_level == 1 && strlen(ctx->symtab[i].function_scope) > 0) {
+                const char* func_name = ctx->symtab[i].function_scope;
                 
                 // Check if we've already processed this function
                 bool already_processed = false;
@@ -839,19 +1074,19 @@ void printSymbolTable() {
                     cout << ">>> " << func_name << " <<<" << endl;
                     
                     // Print all symbols in this function's scope
-                    for (int j = 0; j < symCount; j++) {
-                        if (symtab[j].scope_level == 1 && strcmp(symtab[j].function_scope, func_name) == 0) {
-                            cout << left << setw(20) << symtab[j].name
-                                 << setw(20) << getDisplayType(&symtab[j])
-                                 << setw(20) << symtab[j].kind
-                                 << setw(5) << symtab[j].scope_level
+                    for (int j = 0; j < ctx->symCount; j++) {
+                        if (ctx->symtab[j].scope_level == 1 && strcmp(ctx->symtab[j].function_scope, func_name) == 0) {
+                            cout << left << setw(20) << ctx->symtab[j].name
+                                 << setw(20) << getDisplayType(&ctx->symtab[j])
+                                 << setw(20) << ctx->symtab[j].kind
+                                 << setw(5) << ctx->symtab[j].scope_level
                                  << setw(20) << func_name;
                             
                             // Show "-" for labels, actual size for others
-                            if (strcmp(symtab[j].kind, "label") == 0) {
+                            if (strcmp(ctx->symtab[j].kind, "label") == 0) {
                                 cout << setw(4) << "-" << endl;
                             } else {
-                                cout << setw(4) << symtab[j].size << endl;
+                                cout << setw(4) << ctx->symtab[j].size << endl;
                             }
                         }
                     }
@@ -862,9 +1097,9 @@ void printSymbolTable() {
     
     // Find max scope level first
     int max_scope = 0;
-    for (int i = 0; i < symCount; i++) {
-        if (symtab[i].scope_level > max_scope) {
-            max_scope = symtab[i].scope_level;
+    for (int i = 0; i < ctx->symCount; i++) {
+        if (ctx->symtab[i].scope_level > max_scope) {
+            max_scope = ctx->symtab[i].scope_level;
         }
     }
     
@@ -878,10 +1113,10 @@ void printSymbolTable() {
         BlockInfo processed_blocks[100];
         int processed_count = 0;
         
-        for (int i = 0; i < symCount; i++) {
-            if (symtab[i].scope_level == scope_level && strlen(symtab[i].function_scope) > 0) {
-                const char* func_name = symtab[i].function_scope;
-                int block_id = symtab[i].block_id;
+        for (int i = 0; i < ctx->symCount; i++) {
+            if (ctx->symtab[i].scope_level == scope_level && strlen(ctx->symtab[i].function_scope) > 0) {
+                const char* func_name = ctx->symtab[i].function_scope;
+                int block_id = ctx->symtab[i].block_id;
                 
                 // Check if we've already processed this function+block combination
                 bool already_processed = false;
@@ -903,22 +1138,22 @@ void printSymbolTable() {
                     cout << ">>> SCOPE LEVEL " << scope_level << " (" << func_name << " - block_" << block_id << ") <<<" << endl;
                     
                     // Print all symbols in this scope and block
-                    for (int j = 0; j < symCount; j++) {
-                        if (symtab[j].scope_level == scope_level && 
-                            strcmp(symtab[j].function_scope, func_name) == 0 &&
-                            symtab[j].block_id == block_id) {
+                    for (int j = 0; j < ctx->symCount; j++) {
+                        if (ctx->symtab[j].scope_level == scope_level && 
+                            strcmp(ctx->symtab[j].function_scope, func_name) == 0 &&
+                            ctx->symtab[j].block_id == block_id) {
                             
-                            cout << left << setw(20) << symtab[j].name
-                                 << setw(20) << getDisplayType(&symtab[j])
-                                 << setw(20) << symtab[j].kind
-                                 << setw(5) << symtab[j].scope_level
+                            cout << left << setw(20) << ctx->symtab[j].name
+                                 << setw(20) << getDisplayType(&ctx->symtab[j])
+                                 << setw(20) << ctx->symtab[j].kind
+                                 << setw(5) << ctx->symtab[j].scope_level
                                  << setw(20) << func_name;
                             
                             // Show "-" for labels, actual size for others
-                            if (strcmp(symtab[j].kind, "label") == 0) {
+                            if (strcmp(ctx->symtab[j].kind, "label") == 0) {
                                 cout << setw(4) << "-" << endl;
                             } else {
-                                cout << setw(4) << symtab[j].size << endl;
+                                cout << setw(4) << ctx->symtab[j].size << endl;
                             }
                         }
                     }
@@ -929,18 +1164,26 @@ void printSymbolTable() {
     
     // Count user-defined symbols
     int user_symbol_count = 0;
-    for (int i = 0; i < symCount; i++) {
-        if (!symtab[i].is_external) {
+    for (int i = 0; i < ctx->symCount; i++) {
+        if (!ctx->symtab[i].is_external) {
             user_symbol_count++;
         }
     }
     
     cout << string(89, '-') << endl;
-    cout << "Symbols: " << user_symbol_count << " | Max scope: " << max_scope << " | External: " << (symCount - user_symbol_count) << endl;
+    cout << "Symbols: " << user_symbol_count << " | Max scope: " << max_scope << " | External: " << (ctx->symCount - user_symbol_count) << endl;
 }
 
 // ===== ENHANCED TYPE CHECKING FUNCTIONS =====
 
+// Spelling of an operand after array-to-pointer decay (caller must free)
+static char* decayedSpelling(const char* spelling, const Type* type) {
+    if (type->kind == TYPE_KIND_ARRAY) {
+        return strdup(decayType(type)->name);
+    }
+    return strdup(spelling);
+}
+
 // Enhanced binary operator type checking
 TypeCheckResult checkBinaryOp(const char* op, TreeNode* left, TreeNode* right, char** result_type) {
     if (!left->dataType || !right->dataType) {
@@ -952,96 +1195,74 @@ TypeCheckResult checkBinaryOp(const char* op, TreeNode* left, TreeNode* right, c
     const char* rtype = right->dataType;
     
     // Apply array-to-pointer decay for binary operators (not for sizeof or &)
-    char* ltype_decayed = decayArrayToPointer(ltype);
-    char* rtype_decayed = decayArrayToPointer(rtype);
+    const Type* lt = decayType(internType(ltype));
+    const Type* rt = decayType(internType(rtype));
+    bool larith = typeIsArithmetic(lt);
+    bool rarith = typeIsArithmetic(rt);
+    bool lptr = typeIsPointer(lt);
+    bool rptr = typeIsPointer(rt);
     
     // Arithmetic operators: +, -, *, /, %
     if (strcmp(op, "+") == 0) {
         // Case 1: both arithmetic
-        if (isArithmeticType(ltype_decayed) && isArithmeticType(rtype_decayed)) {
-            *result_type = strdup(usualArithConv(ltype_decayed, rtype_decayed));
-            free(ltype_decayed);
-            free(rtype_decayed);
+        if (larith && rarith) {
+            *result_type = strdup(usualArithConv(lt->name, rt->name));
             return TYPE_OK;
         }
         // Case 2: pointer + integer (or array + integer after decay)
-        if (strstr(ltype_decayed, "*") && isArithmeticType(rtype_decayed)) {
-            *result_type = strdup(ltype_decayed);
-            free(ltype_decayed);
-            free(rtype_decayed);
+        if (lptr && rarith) {
+            *result_type = decayedSpelling(ltype, internType(ltype));
             return TYPE_OK;
         }
         // Case 3: integer + pointer (or integer + array after decay)
-        if (isArithmeticType(ltype_decayed) && strstr(rtype_decayed, "*")) {
-            *result_type = strdup(rtype_decayed);
-            free(ltype_decayed);
-            free(rtype_decayed);
+        if (larith && rptr) {
+            *result_type = decayedSpelling(rtype, internType(rtype));
             return TYPE_OK;
         }
-        type_error(yylineno, "invalid operands to binary '+' (have '%s' and '%s')", ltype, rtype);
-        free(ltype_decayed);
-        free(rtype_decayed);
+        type_error(currentLineNumber(), "invalid operands to binary '+' (have '%s' and '%s')", ltype, rtype);
         return TYPE_ERROR;
     }
     
     if (strcmp(op, "-") == 0) {
         // Case 1: both arithmetic
-        if (isArithmeticType(ltype_decayed) && isArithmeticType(rtype_decayed)) {
-            *result_type = strdup(usualArithConv(ltype_decayed, rtype_decayed));
-            free(ltype_decayed);
-            free(rtype_decayed);
+        if (larith && rarith) {
+            *result_type = strdup(usualArithConv(lt->name, rt->name));
             return TYPE_OK;
         }
         // Case 2: pointer - integer (or array - integer after decay)
-        if (strstr(ltype_decayed, "*") && isArithmeticType(rtype_decayed)) {
-            *result_type = strdup(ltype_decayed);
-            free(ltype_decayed);
-            free(rtype_decayed);
+        if (lptr && rarith) {
+            *result_type = decayedSpelling(ltype, internType(ltype));
             return TYPE_OK;
         }
         // Case 3: pointer - pointer (same base type)
-        if (strstr(ltype_decayed, "*") && strstr(rtype_decayed, "*")) {
-            if (isPointerCompatible(ltype_decayed, rtype_decayed)) {
+        if (lptr && rptr) {
+            if (typesPointerCompatible(lt, rt)) {
                 *result_type = strdup("int"); // ptrdiff_t
-                free(ltype_decayed);
-                free(rtype_decayed);
                 return TYPE_OK;
             }
-            type_error(yylineno, "invalid operands to binary '-' (incompatible pointer types)");
-            free(ltype_decayed);
-            free(rtype_decayed);
+            type_error(currentLineNumber(), "invalid operands to binary '-' (incompatible pointer types)");
             return TYPE_ERROR;
         }
-        type_error(yylineno, "invalid operands to binary '-' (have '%s' and '%s')", ltype, rtype);
-        free(ltype_decayed);
-        free(rtype_decayed);
+        type_error(currentLineNumber(), "invalid operands to binary '-' (have '%s' and '%s')", ltype, rtype);
         return TYPE_ERROR;
     }
     
     if (strcmp(op, "*") == 0 || strcmp(op, "/") == 0) {
-        if (isArithmeticType(ltype_decayed) && isArithmeticType(rtype_decayed)) {
-            *result_type = strdup(usualArithConv(ltype_decayed, rtype_decayed));
-            free(ltype_decayed);
-            free(rtype_decayed);
+        if (larith && rarith) {
+            *result_type = strdup(usualArithConv(lt->name, rt->name));
             return TYPE_OK;
         }
-        type_error(yylineno, "invalid operands to binary '%s' (have '%s' and '%s')", op, ltype, rtype);
-        free(ltype_decayed);
-        free(rtype_decayed);
+        type_error(currentLineNumber(), "invalid operands to binary '%s' (have '%s' and '%s')", op, ltype, rtype);
         return TYPE_ERROR;
     }
     
     if (strcmp(op, "%") == 0) {
         // Modulo requires integer operands (not float/double)
-        if (isIntegerType(ltype_decayed) && isIntegerType(rtype_decayed)) {
+        if (typeIsInteger(lt) && typeIsInteger(rt)) {
             *result_type = strdup("int");
-            free(ltype_decayed);
-            free(rtype_decayed);
             return TYPE_OK;
         }
-        type_error(yylineno, "invalid operands to binary '%%' (have '%s' and '%s')", ltype, rtype);
-        free(ltype_decayed);
-        free(rtype_decayed);
+        type_error(currentLineNumber(), "invalid operands to binary '%%' (have '%s' and '%s')", ltype, rtype);
         return TYPE_ERROR;
     }
     
@@ -1049,63 +1270,44 @@ TypeCheckResult checkBinaryOp(const char* op, TreeNode* left, TreeNode* right, c
     if (strcmp(op, "<") == 0 || strcmp(op, ">") == 0 || 
         strcmp(op, "<=") == 0 || strcmp(op, ">=") == 0) {
         // Both arithmetic OR both compatible pointers
-        if ((isArithmeticType(ltype_decayed) && isArithmeticType(rtype_decayed)) ||
-            (strstr(ltype_decayed, "*") && strstr(rtype_decayed, "*") && isPointerCompatible(ltype_decayed, rtype_decayed))) {
+        if ((larith && rarith) || (lptr && rptr && typesPointerCompatible(lt, rt))) {
             *result_type = strdup("int");
-            free(ltype_decayed);
-            free(rtype_decayed);
             return TYPE_OK;
         }
-        type_error(yylineno, "invalid operands to binary '%s' (have '%s' and '%s')", op, ltype, rtype);
-        free(ltype_decayed);
-        free(rtype_decayed);
+        type_error(currentLineNumber(), "invalid operands to binary '%s' (have '%s' and '%s')", op, ltype, rtype);
         return TYPE_ERROR;
     }
     
     // Equality operators: ==, !=
     if (strcmp(op, "==") == 0 || strcmp(op, "!=") == 0) {
         // Both arithmetic, or both pointers, or pointer vs null
-        if ((isArithmeticType(ltype_decayed) && isArithmeticType(rtype_decayed)) ||
-            (strstr(ltype_decayed, "*") && strstr(rtype_decayed, "*")) ||
-            (strstr(ltype_decayed, "*") && isNullPointer(right)) ||
-            (isNullPointer(left) && strstr(rtype_decayed, "*"))) {
+        if ((larith && rarith) || (lptr && rptr) ||
+            (lptr && isNullPointer(right)) || (isNullPointer(left) && rptr)) {
             *result_type = strdup("int");
-            free(ltype_decayed);
-            free(rtype_decayed);
             return TYPE_OK;
         }
-        type_error(yylineno, "invalid operands to binary '%s' (have '%s' and '%s')", op, ltype, rtype);
-        free(ltype_decayed);
-        free(rtype_decayed);
+        type_error(currentLineNumber(), "invalid operands to binary '%s' (have '%s' and '%s')", op, ltype, rtype);
         return TYPE_ERROR;
     }
     
     // Bitwise operators: &, |, ^, <<, >>
     if (strcmp(op, "&") == 0 || strcmp(op, "|") == 0 || strcmp(op, "^") == 0) {
         // Bitwise operators require integer operands (not float/double)
-        if (isIntegerType(ltype_decayed) && isIntegerType(rtype_decayed)) {
+        if (typeIsInteger(lt) && typeIsInteger(rt)) {
             *result_type = strdup("int");
-            free(ltype_decayed);
-            free(rtype_decayed);
             return TYPE_OK;
         }
-        type_error(yylineno, "invalid operands to binary '%s' (have '%s' and '%s')", op, ltype, rtype);
-        free(ltype_decayed);
-        free(rtype_decayed);
+        type_error(currentLineNumber(), "invalid operands to binary '%s' (have '%s' and '%s')", op, ltype, rtype);
         return TYPE_ERROR;
     }
     
     if (strcmp(op, "<<") == 0 || strcmp(op, ">>") == 0) {
         // Shift operators require integer operands (not float/double)
-        if (isIntegerType(ltype_decayed) && isIntegerType(rtype_decayed)) {
-            *result_type = strdup(ltype_decayed); // Result type is left operand type
-            free(ltype_decayed);
-            free(rtype_decayed);
+        if (typeIsInteger(lt) && typeIsInteger(rt)) {
+            *result_type = strdup(ltype); // Result type is left operand type
             return TYPE_OK;
         }
-        type_error(yylineno, "invalid operands to binary '%s' (have '%s' and '%s')", op, ltype, rtype);
-        free(ltype_decayed);
-        free(rtype_decayed);
+        type_error(currentLineNumber(), "invalid operands to binary '%s' (have '%s' and '%s')", op, ltype, rtype);
         return TYPE_ERROR;
     }
     
@@ -1113,13 +1315,9 @@ TypeCheckResult checkBinaryOp(const char* op, TreeNode* left, TreeNode* right, c
     if (strcmp(op, "&&") == 0 || strcmp(op, "||") == 0) {
         // Any scalar type can be converted to boolean
         *result_type = strdup("int");
-        free(ltype_decayed);
-        free(rtype_decayed);
         return TYPE_OK;
     }
     
-    free(ltype_decayed);
-    free(rtype_decayed);
     *result_type = strdup("int");
     return TYPE_ERROR;
 }
@@ -1138,7 +1336,7 @@ TypeCheckResult checkUnaryOp(const char* op, TreeNode* operand, char** result_ty
             *result_type = strdup(optype);
             return TYPE_OK;
         }
-        type_error(yylineno, "wrong type argument to unary '%s' (have '%s')", op, optype);
+        type_error(currentLineNumber(), "wrong type argument to unary '%s' (have '%s')", op, optype);
         return TYPE_ERROR;
     }
     
@@ -1153,7 +1351,7 @@ TypeCheckResult checkUnaryOp(const char* op, TreeNode* operand, char** result_ty
             *result_type = strdup("int");
             return TYPE_OK;
         }
-        type_error(yylineno, "wrong type argument to unary '~' (have '%s')", optype);
+        type_error(currentLineNumber(), "wrong type argument to unary '~' (have '%s')", optype);
         return TYPE_ERROR;
     }
     
@@ -1161,7 +1359,7 @@ TypeCheckResult checkUnaryOp(const char* op, TreeNode* operand, char** result_ty
         if (strstr(optype, "*")) {
             // Check if trying to dereference a void pointer
             if (strncmp(optype, "void*", 5) == 0 || strncmp(optype, "void *", 6) == 0) {
-                type_error(yylineno, "invalid use of void expression: cannot dereference void pointer");
+                type_error(currentLineNumber(), "invalid use of void expression: cannot dereference void pointer");
                 *result_type = strdup("void");
                 return TYPE_ERROR;
             }
@@ -1189,13 +1387,13 @@ TypeCheckResult checkUnaryOp(const char* op, TreeNode* operand, char** result_ty
             }
             return TYPE_OK;
         }
-        type_error(yylineno, "invalid type argument of unary '*' (have '%s')", optype);
+        type_error(currentLineNumber(), "invalid type argument of unary '*' (have '%s')", optype);
         return TYPE_ERROR;
     }
     
     if (strcmp(op, "&") == 0) {
         if (!operand->isLValue) {
-            type_error(yylineno, "lvalue required as unary '&' operand");
+            type_error(currentLineNumber(), "lvalue required as unary '&' operand");
             return TYPE_ERROR;
         }
         // Create pointer type
@@ -1207,14 +1405,14 @@ TypeCheckResult checkUnaryOp(const char* op, TreeNode* operand, char** result_ty
     
     if (strcmp(op, "++") == 0 || strcmp(op, "--") == 0) {
         if (!operand->isLValue) {
-            type_error(yylineno, "lvalue required as %s operand", op);
+            type_error(currentLineNumber(), "lvalue required as %s operand", op);
             return TYPE_ERROR;
         }
         if (isArithmeticType(optype) || strstr(optype, "*")) {
             *result_type = strdup(optype);
             return TYPE_OK;
         }
-        type_error(yylineno, "wrong type argument to %s (have '%s')", op, optype);
+        type_error(currentLineNumber(), "wrong type argument to %s (have '%s')", op, optype);
         return TYPE_ERROR;
     }
     
@@ -1225,7 +1423,7 @@ TypeCheckResult checkUnaryOp(const char* op, TreeNode* operand, char** result_ty
 // Enhanced assignment checking
 TypeCheckResult checkAssignment(TreeNode* lhs, TreeNode* rhs) {
     if (!lhs->isLValue) {
-        type_error(yylineno, "lvalue required as left operand of assignment");
+        type_error(currentLineNumber(), "lvalue required as left operand of assignment");
         return TYPE_ERROR;
     }
     
@@ -1233,19 +1431,18 @@ TypeCheckResult checkAssignment(TreeNode* lhs, TreeNode* rhs) {
         return TYPE_ERROR;
     }
     
-    char* ltype_resolved = resolveTypedef(lhs->dataType);
-    char* rtype_resolved = resolveTypedef(rhs->dataType);
-    const char* ltype = ltype_resolved ? ltype_resolved : lhs->dataType;
-    const char* rtype_raw = rtype_resolved ? rtype_resolved : rhs->dataType;
+    // Interned types have typedefs resolved
+    const Type* lt = internType(lhs->dataType);
+    const Type* rt_raw = internType(rhs->dataType);
+    const char* ltype = lt->name;
+    const char* rtype_raw = rt_raw->name;
     
     // Check for const violations
     // Case 1: Direct assignment to const pointer (e.g., int* const ptr = ...; ptr = &y;)
     if (lhs->type == NODE_IDENTIFIER) {
         Symbol* sym = lookupSymbol(lhs->value);
         if (sym && sym->is_const_ptr) {
-            type_error(yylineno, "assignment of read-only variable '%s'", lhs->value);
-            if (ltype_resolved) free(ltype_resolved);
-            if (rtype_resolved) free(rtype_resolved);
+            type_error(currentLineNumber(), "assignment of read-only variable '%s'", lhs->value);
             return TYPE_ERROR;
         }
     }
@@ -1257,111 +1454,78 @@ TypeCheckResult checkAssignment(TreeNode* lhs, TreeNode* rhs) {
         if (ptr_node->type == NODE_IDENTIFIER) {
             Symbol* sym = lookupSymbol(ptr_node->value);
             if (sym && sym->points_to_const) {
-                type_error(yylineno, "assignment of read-only location '*%s'", ptr_node->value);
-                if (ltype_resolved) free(ltype_resolved);
-                if (rtype_resolved) free(rtype_resolved);
+                type_error(currentLineNumber(), "assignment of read-only location '*%s'", ptr_node->value);
                 return TYPE_ERROR;
             }
         }
     }
     
-    if (isArrayType(ltype)) {
-        type_error(yylineno, "cannot assign arrays");
-        if (ltype_resolved) free(ltype_resolved);
-        if (rtype_resolved) free(rtype_resolved);
+    if (lt->kind == TYPE_KIND_ARRAY) {
+        type_error(currentLineNumber(), "cannot assign arrays");
         return TYPE_ERROR;
     }
     
     // Check if trying to assign array to scalar (before decay)
-    if (isArrayType(rtype_raw) && !strstr(ltype, "*")) {
+    if (rt_raw->kind == TYPE_KIND_ARRAY && !typeIsPointer(lt)) {
         char* base_type = getArrayBaseType(rtype_raw);
         if (base_type) {
-            type_error(yylineno, "cannot convert array type '%s' to '%s'", rtype_raw, base_type);
+            type_error(currentLineNumber(), "cannot convert array type '%s' to '%s'", rtype_raw, base_type);
         } else {
-            type_error(yylineno, "cannot convert array type '%s' to '%s'", rtype_raw, ltype);
+            type_error(currentLineNumber(), "cannot convert array type '%s' to '%s'", rtype_raw, ltype);
         }
-        if (ltype_resolved) free(ltype_resolved);
-        if (rtype_resolved) free(rtype_resolved);
         return TYPE_ERROR;
     }
     
     // Apply array-to-pointer decay on RHS (arrays decay when used as rvalues)
-    char* rtype_decayed = decayArrayToPointer(rtype_raw);
-    const char* rtype = rtype_decayed;
+    const Type* rt = decayType(rt_raw);
+    const char* rtype = rt->name;
     
     // Same type
-    if (strcmp(ltype, rtype) == 0) {
-        free(rtype_decayed);
-        if (ltype_resolved) free(ltype_resolved);
-        if (rtype_resolved) free(rtype_resolved);
+    if (lt == rt) {
         return TYPE_OK;
     }
     
     // Enum and int are compatible in C
-    if ((strcmp(ltype, "enum") == 0 && isIntegerType(rtype)) ||
-        (strcmp(rtype, "enum") == 0 && isIntegerType(ltype))) {
-        free(rtype_decayed);
-        if (ltype_resolved) free(ltype_resolved);
-        if (rtype_resolved) free(rtype_resolved);
+    if ((strcmp(ltype, "enum") == 0 && typeIsInteger(rt)) ||
+        (strcmp(rtype, "enum") == 0 && typeIsInteger(lt))) {
         return TYPE_OK;
     }
     
     // Arithmetic conversion
-    if (isArithmeticType(ltype) && isArithmeticType(rtype)) {
+    if (typeIsArithmetic(lt) && typeIsArithmetic(rt)) {
         if (strcmp(ltype, "char") == 0 && strcmp(rtype, "int") == 0) {
-            type_warning(yylineno, "conversion from 'int' to 'char' may alter value");
+            type_warning(currentLineNumber(), "conversion from 'int' to 'char' may alter value");
         }
-        free(rtype_decayed);
-        if (ltype_resolved) free(ltype_resolved);
-        if (rtype_resolved) free(rtype_resolved);
         return TYPE_OK;
     }
     
     // Pointer assignments (including array-to-pointer decay)
-    if (strstr(ltype, "*") && strstr(rtype, "*")) {
-        if (isPointerCompatible(ltype, rtype)) {
-            free(rtype_decayed);
-            if (ltype_resolved) free(ltype_resolved);
-            if (rtype_resolved) free(rtype_resolved);
+    if (typeIsPointer(lt) && typeIsPointer(rt)) {
+        if (typesPointerCompatible(lt, rt)) {
             return TYPE_OK;
         }
-        type_warning(yylineno, "assignment from incompatible pointer type");
-        free(rtype_decayed);
-        if (ltype_resolved) free(ltype_resolved);
-        if (rtype_resolved) free(rtype_resolved);
+        type_warning(currentLineNumber(), "assignment from incompatible pointer type");
         return TYPE_WARNING;
     }
     
     // Pointer = NULL
-    if (strstr(ltype, "*") && isNullPointer(rhs)) {
-        free(rtype_decayed);
-        if (ltype_resolved) free(ltype_resolved);
-        if (rtype_resolved) free(rtype_resolved);
+    if (typeIsPointer(lt) && isNullPointer(rhs)) {
         return TYPE_OK;
     }
     
     // Pointer = integer (error unless 0)
-    if (strstr(ltype, "*") && isArithmeticType(rtype)) {
-        type_error(yylineno, "assignment makes pointer from integer without a cast");
-        free(rtype_decayed);
-        if (ltype_resolved) free(ltype_resolved);
-        if (rtype_resolved) free(rtype_resolved);
+    if (typeIsPointer(lt) && typeIsArithmetic(rt)) {
+        type_error(currentLineNumber(), "assignment makes pointer from integer without a cast");
         return TYPE_ERROR;
     }
     
     // Integer = pointer (error)
-    if (isArithmeticType(ltype) && strstr(rtype, "*")) {
-        type_error(yylineno, "assignment makes integer from pointer without a cast");
-        free(rtype_decayed);
-        if (ltype_resolved) free(ltype_resolved);
-        if (rtype_resolved) free(rtype_resolved);
+    if (typeIsArithmetic(lt) && typeIsPointer(rt)) {
+        type_error(currentLineNumber(), "assignment makes integer from pointer without a cast");
         return TYPE_ERROR;
     }
     
-    type_error(yylineno, "incompatible types when assigning to type '%s' from type '%s'", ltype, rtype);
-    free(rtype_decayed);
-    if (ltype_resolved) free(ltype_resolved);
-    if (rtype_resolved) free(rtype_resolved);
+    type_error(currentLineNumber(), "incompatible types when assigning to type '%s' from type '%s'", ltype, rtype);
     return TYPE_ERROR;
 }
 
@@ -1657,14 +1821,14 @@ int isScanfTypeCompatible(const char* arg_type, const FormatSpec* spec) {
 // Validate printf call
 TypeCheckResult validatePrintf(TreeNode* args) {
     if (!args || args->childCount == 0) {
-        type_error(yylineno, "too few arguments to function 'printf'");
+        type_error(currentLineNumber(), "too few arguments to function 'printf'");
         return TYPE_ERROR;
     }
     
     // First argument must be a string literal (format string)
     TreeNode* format_arg = args->children[0];
     if (format_arg->type != NODE_STRING_LITERAL) {
-        type_warning(yylineno, "format not a string literal (potentially insecure)");
+        type_warning(currentLineNumber(), "format not a string literal (potentially insecure)");
         return TYPE_WARNING;
     }
     
@@ -1675,12 +1839,12 @@ TypeCheckResult validatePrintf(TreeNode* args) {
     // Check argument count
     int provided_args = args->childCount - 1; // Exclude format string
     if (provided_args < spec_count) {
-        type_error(yylineno, "too few arguments for format (expected %d, got %d)", 
+        type_error(currentLineNumber(), "too few arguments for format (expected %d, got %d)", 
                   spec_count, provided_args);
         return TYPE_ERROR;
     }
     if (provided_args > spec_count) {
-        type_error(yylineno, "too many arguments for format (expected %d, got %d)", 
+        type_error(currentLineNumber(), "too many arguments for format (expected %d, got %d)", 
                   spec_count, provided_args);
         return TYPE_ERROR;
     }
@@ -1694,7 +1858,7 @@ TypeCheckResult validatePrintf(TreeNode* args) {
         if (!isPrintfTypeCompatible(arg->dataType, &specs[i])) {
             const char* expected = getPrintfExpectedType(&specs[i]);
             char* arg_decayed = decayArrayToPointer(arg->dataType);
-            type_error(yylineno, "format '%%%c' expects argument of type '%s', but argument %d has type '%s'",
+            type_error(currentLineNumber(), "format '%%%c' expects argument of type '%s', but argument %d has type '%s'",
                       specs[i].specifier, expected, i + 2, arg_decayed);
             free(arg_decayed);
             result = TYPE_ERROR;
@@ -1707,14 +1871,14 @@ TypeCheckResult validatePrintf(TreeNode* args) {
 // Validate scanf call
 TypeCheckResult validateScanf(TreeNode* args) {
     if (!args || args->childCount == 0) {
-        type_error(yylineno, "too few arguments to function 'scanf'");
+        type_error(currentLineNumber(), "too few arguments to function 'scanf'");
         return TYPE_ERROR;
     }
     
     // First argument must be a string literal (format string)
     TreeNode* format_arg = args->children[0];
     if (format_arg->type != NODE_STRING_LITERAL) {
-        type_warning(yylineno, "format not a string literal (potentially insecure)");
+        type_warning(currentLineNumber(), "format not a string literal (potentially insecure)");
         return TYPE_WARNING;
     }
     
@@ -1725,12 +1889,12 @@ TypeCheckResult validateScanf(TreeNode* args) {
     // Check argument count
     int provided_args = args->childCount - 1; // Exclude format string
     if (provided_args < spec_count) {
-        type_error(yylineno, "too few arguments for format (expected %d, got %d)", 
+        type_error(currentLineNumber(), "too few arguments for format (expected %d, got %d)", 
                   spec_count, provided_args);
         return TYPE_ERROR;
     }
     if (provided_args > spec_count) {
-        type_error(yylineno, "too many arguments for format (expected %d, got %d)", 
+        type_error(currentLineNumber(), "too many arguments for format (expected %d, got %d)", 
                   spec_count, provided_args);
         return TYPE_ERROR;
     }
@@ -1746,7 +1910,7 @@ TypeCheckResult validateScanf(TreeNode* args) {
         
         // Check if it's a pointer type
         if (!strstr(arg_decayed, "*") && specs[i].specifier != 's') {
-            type_error(yylineno, "format '%%%c' expects argument of type '%s', but argument %d has type '%s' (missing '&'?)",
+            type_error(currentLineNumber(), "format '%%%c' expects argument of type '%s', but argument %d has type '%s' (missing '&'?)",
                       specs[i].specifier, getScanfExpectedType(&specs[i]), i + 2, arg_decayed);
             free(arg_decayed);
             result = TYPE_ERROR;
@@ -1756,7 +1920,7 @@ TypeCheckResult validateScanf(TreeNode* args) {
         // Check pointer type compatibility
         if (!isScanfTypeCompatible(arg_decayed, &specs[i])) {
             const char* expected = getScanfExpectedType(&specs[i]);
-            type_error(yylineno, "format '%%%c' expects argument of type '%s', but argument %d has type '%s'",
+            type_error(currentLineNumber(), "format '%%%c' expects argument of type '%s', but argument %d has type '%s'",
                       specs[i].specifier, expected, i + 2, arg_decayed);
             free(arg_decayed);
             result = TYPE_ERROR;
@@ -1773,13 +1937,13 @@ TypeCheckResult checkFunctionCall(const char* func_name, TreeNode* args, char**
     Symbol* func_sym = lookupSymbol(func_name);
     
     if (!func_sym) {
-        type_error(yylineno, "implicit declaration of function '%s'", func_name);
+        type_error(currentLineNumber(), "implicit declaration of function '%s'", func_name);
         *result_type = strdup("int");
         return TYPE_ERROR;
     }
     
     if (!func_sym->is_function && strcmp(func_sym->kind, "function_pointer") != 0) {
-        type_error(yylineno, "called object '%s' is not a function or function pointer", func_name);
+        type_error(currentLineNumber(), "called object '%s' is not a function or function pointer", func_name);
         return TYPE_ERROR;
     }
     
@@ -1863,7 +2027,7 @@ TypeCheckResult checkFunctionCall(const char* func_name, TreeNode* args, char**
         if (strcmp(func_name, "atoi") == 0 || strcmp(func_name, "atol") == 0 || 
             strcmp(func_name, "atof") == 0) {
             if (provided_args != 1) {
-                type_error(yylineno, "incorrect number of arguments to '%s' (expected 1, got %d)", 
+                type_error(currentLineNumber(), "incorrect number of arguments to '%s' (expected 1, got %d)", 
                           func_name, provided_args);
                 return TYPE_ERROR;
             }
@@ -1873,7 +2037,7 @@ TypeCheckResult checkFunctionCall(const char* func_name, TreeNode* args, char**
                 
                 // Must be char* or const char* (pointer to char)
                 if (strcmp(arg_decayed, "char*") != 0 && strcmp(arg_decayed, "const char*") != 0) {
-                    type_error(yylineno, "incorrect argument type to '%s' (expected 'char*', have '%s')", 
+                    type_error(currentLineNumber(), "incorrect argument type to '%s' (expected 'char*', have '%s')", 
                               func_name, arg_decayed);
                     free(arg_decayed);
                     return TYPE_ERROR;
@@ -1884,7 +2048,7 @@ TypeCheckResult checkFunctionCall(const char* func_name, TreeNode* args, char**
         // Check abs - expects single int argument
         else if (strcmp(func_name, "abs") == 0) {
             if (provided_args != 1) {
-                type_error(yylineno, "incorrect number of arguments to 'abs' (expected 1, got %d)", 
+                type_error(currentLineNumber(), "incorrect number of arguments to 'abs' (expected 1, got %d)", 
                           provided_args);
                 return TYPE_ERROR;
             }
@@ -1894,7 +2058,7 @@ TypeCheckResult checkFunctionCall(const char* func_name, TreeNode* args, char**
                 
                 // Must be int (not float, double, or other types)
                 if (strcmp(arg_decayed, "int") != 0) {
-                    type_error(yylineno, "incorrect argument type to 'abs' (expected 'int', have '%s')", 
+                    type_error(currentLineNumber(), "incorrect argument type to 'abs' (expected 'int', have '%s')", 
                               arg_decayed);
                     free(arg_decayed);
                     return TYPE_ERROR;
@@ -1908,7 +2072,7 @@ TypeCheckResult checkFunctionCall(const char* func_name, TreeNode* args, char**
     if (!func_sym->is_external && strcmp(func_sym->kind, "function_pointer") != 0) {
         int provided_args = args ? args->childCount : 0;
         if (provided_args != func_sym->param_count) {
-            type_error(yylineno, "too %s arguments to function '%s' (expected %d, got %d)",
+            type_error(currentLineNumber(), "too %s arguments to function '%s' (expected %d, got %d)",
                       provided_args < func_sym->param_count ? "few" : "many",
                       func_name, func_sym->param_count, provided_args);
             return TYPE_ERROR;
@@ -1922,7 +2086,7 @@ TypeCheckResult checkFunctionCall(const char* func_name, TreeNode* args, char**
                     char* arg_type_decayed = decayArrayToPointer(args->children[i]->dataType);
                     
                     if (!canImplicitConvert(arg_type_decayed, func_sym->param_types[i])) {
-                        type_error(yylineno, "incompatible type for argument %d of '%s'", i+1, func_name);
+                        type_error(currentLineNumber(), "incompatible type for argument %d of '%s'", i+1, func_name);
                         free(arg_type_decayed);
                         return TYPE_ERROR;
                     }
@@ -1947,7 +2111,7 @@ TypeCheckResult checkArrayAccess(TreeNode* array, TreeNode* index, char** result
     
     // Index must be integer type (not float or double)
     if (!isIntegerType(index_decayed)) {
-        type_error(yylineno, "array subscript has non-integer type '%s'", index_decayed);
+        type_error(currentLineNumber(), "array subscript has non-integer type '%s'", index_decayed);
         free(index_decayed);
         *result_type = strdup("int");
         return TYPE_ERROR;
@@ -1985,7 +2149,7 @@ TypeCheckResult checkArrayAccess(TreeNode* array, TreeNode* index, char** result
         return TYPE_OK;
     }
     
-    type_error(yylineno, "subscripted value is not an array or pointer");
+    type_error(currentLineNumber(), "subscripted value is not an array or pointer");
     free(array_decayed);
     return TYPE_ERROR;
 }
@@ -2006,7 +2170,7 @@ TypeCheckResult checkMemberAccess(TreeNode* struct_expr, const char* member, con
     // ERROR 4: Check operator validity
     if (strcmp(op, ".") == 0 && is_pointer) {
         // Using DOT on a pointer - should use ARROW
-        type_error(yylineno, "member reference type '%s' is a pointer; did you mean to use '->'?", struct_type);
+        type_error(currentLineNumber(), "member reference type '%s' is a pointer; did you mean to use '->'?", struct_type);
         if (resolved_type) free(resolved_type);
         *result_type = strdup("int");
         return TYPE_ERROR;
@@ -2014,7 +2178,7 @@ TypeCheckResult checkMemberAccess(TreeNode* struct_expr, const char* member, con
     
     if (strcmp(op, "->") == 0 && !is_pointer) {
         // Using ARROW on a non-pointer - should use DOT
-        type_error(yylineno, "member reference type '%s' is not a pointer; did you mean to use '.'?", struct_type);
+        type_error(currentLineNumber(), "member reference type '%s' is not a pointer; did you mean to use '.'?", struct_type);
         if (resolved_type) free(resolved_type);
         *result_type = strdup("int");
         return TYPE_ERROR;
@@ -2052,7 +2216,7 @@ TypeCheckResult checkMemberAccess(TreeNode* struct_expr, const char* member, con
         is_union = 1;
     } else {
         // Not a struct or union type
-        type_error(yylineno, "request for member '%s' in something not a structure or union", member);
+        type_error(currentLineNumber(), "request for member '%s' in something not a structure or union", member);
         if (resolved_type) free(resolved_type);
         *result_type = strdup("int");
         return TYPE_ERROR;
@@ -2061,7 +2225,7 @@ TypeCheckResult checkMemberAccess(TreeNode* struct_expr, const char* member, con
     // Look up the struct or union definition
     StructDef* def = is_union ? lookupUnion(tag_name) : lookupStruct(tag_name);
     if (!def) {
-        type_error(yylineno, "invalid use of undefined %s '%s'", 
+        type_error(currentLineNumber(), "invalid use of undefined %s '%s'", 
                   is_union ? "union" : "struct", tag_name);
         if (resolved_type) free(resolved_type);
         *result_type = strdup("int");
@@ -2080,7 +2244,7 @@ TypeCheckResult checkMemberAccess(TreeNode* struct_expr, const char* member, con
     }
     
     // Member not found
-    type_error(yylineno, "'%s %s' has no member named '%s'", 
+    type_error(currentLineNumber(), "'%s %s' has no member named '%s'", 
               is_union ? "union" : "struct", tag_name, member);
     if (resolved_type) free(resolved_type);
     *result_type = strdup("int");
@@ -2098,7 +2262,7 @@ int isArrayType(const char* type) {
 char* getArrayBaseType(const char* arrayType) {
     if (!arrayType) return NULL;
     
-    static char baseType[128];
+    static thread_local char baseType[128];
     const char* bracket = strchr(arrayType, '[');
     if (bracket) {
         size_t len = bracket - arrayType;
@@ -2129,12 +2293,7 @@ char* decayArrayToPointer(const char* type) {
 }
 
 int isPointerCompatible(const char* ptr1, const char* ptr2) {
-    // Simplified: void* is compatible with any pointer
-    if (strstr(ptr1, "void*") || strstr(ptr2, "void*")) {
-        return 1;
-    }
-    // Otherwise, base types must match
-    return strcmp(ptr1, ptr2) == 0;
+    return typesPointerCompatible(internType(ptr1), internType(ptr2));
 }
 
 int isNullPointer(TreeNode* expr) {
@@ -2171,8 +2330,10 @@ int canImplicitConvert(const char* from_type, const char* to_type) {
         if (result) return 1;
     }
     
-    if (isArithmeticType(from_type) && isArithmeticType(to_type)) return 1;
-    if (strstr(from_type, "*") && strstr(to_type, "*")) return isPointerCompatible(from_type, to_type);
+    const Type* from = internType(from_type);
+    const Type* to = internType(to_type);
+    if (typeIsArithmetic(from) && typeIsArithmetic(to)) return 1;
+    if (typeIsPointer(from) && typeIsPointer(to)) return typesPointerCompatible(from, to);
     return 0;
 }
 
@@ -2192,7 +2353,7 @@ void type_error(int line, const char* msg, ...) {
     vfprintf(stderr, msg, args);
     fprintf(stderr, "\n");
     va_end(args);
-    error_count++;  // Increment error count to prevent IR generation
+    ctx->error_count++;  // Increment error count to prevent IR generation
 }
 
 void type_warning(int line, const char* msg, ...) {
@@ -2208,39 +2369,7 @@ void type_warning(int line, const char* msg, ...) {
 // Scalar types: arithmetic types (int, float, char, etc.) and pointer types
 int isScalarType(const char* type) {
     if (!type) return 0;
-    
-    // CRITICAL: Resolve typedef first
-    char* resolved = resolveTypedef(type);
-    const char* actual_type = resolved ? resolved : type;
-    
-    // Pointer types are scalar
-    if (strstr(actual_type, "*") != NULL) {
-        if (resolved) free(resolved);
-        return 1;
-    }
-    
-    // Arithmetic types are scalar
-    if (isArithmeticType(actual_type)) {
-        if (resolved) free(resolved);
-        return 1;
-    }
-    
-    // Array types decay to pointers, so they're effectively scalar
-    if (isArrayType(actual_type)) {
-        if (resolved) free(resolved);
-        return 1;
-    }
-    
-    // Struct and union types are NOT scalar
-    if (strncmp(actual_type, "struct ", 7) == 0 || strncmp(actual_type, "union ", 6) == 0) {
-        // Check if it's a pointer to struct/union (already handled above)
-        // If we reach here, it's a direct struct/union, which is not scalar
-        if (resolved) free(resolved);
-        return 0;
-    }
-    
-    if (resolved) free(resolved);
-    return 0;  // Unknown types are not scalar
+    return typeIsScalar(internType(type));
 }
 
 // ERROR 5: Validate conditional expression (must be scalar type)
@@ -2252,7 +2381,7 @@ TypeCheckResult validateConditional(TreeNode* expr) {
     
     // Warn if array is used directly in conditional (even though it decays to pointer)
     if (isArrayType(expr->dataType)) {
-        type_warning(yylineno, "array '%s' used in conditional context will always evaluate to true", 
+        type_warning(currentLineNumber(), "array '%s' used in conditional context will always evaluate to true", 
                      expr->dataType);
     }
     
@@ -2260,7 +2389,7 @@ TypeCheckResult validateConditional(TreeNode* expr) {
     char* decayed_type = decayArrayToPointer(expr->dataType);
     
     if (!isScalarType(decayed_type)) {
-        type_error(yylineno, "conditional expression has non-scalar type '%s'", decayed_type);
+        type_error(currentLineNumber(), "conditional expression has non-scalar type '%s'", decayed_type);
         free(decayed_type);
         return TYPE_ERROR;
     }
@@ -2269,46 +2398,42 @@ TypeCheckResult validateConditional(TreeNode* expr) {
     return TYPE_OK;
 }
 
-// Recursively resolve typedef aliases to their base type
-// If the type is a typedef, follow the chain until reaching a non-typedef base type
-char* resolveTypedef(const char* type) {
+// Follow typedef aliases to the underlying type spelling. The most recent
+// typedef of a name wins. Results are memoized until a name on the chain
+// is declared as a typedef again; the returned string is owned by the
+// compilation context.
+const char* resolvedTypedefName(const char* type) {
     if (!type) return NULL;
     
-    // Protect against infinite recursion with a depth limit
-    int max_depth = 50;
-    int depth = 0;
-    
-    char* current_type = strdup(type);
-    char* resolved_type = NULL;
+    TypeTable* table = typeTable();
+    noteDependency(table, type);
+    unordered_map<string, const char*>::iterator hit = table->resolvedTypedefs.find(type);
+    if (hit != table->resolvedTypedefs.end()) {
+        return hit->second;
+    }
     
-    while (depth < max_depth) {
-        // Search for typedef with this name in symbol table
-        Symbol* typedef_sym = NULL;
-        
-        // Search from most recent to oldest (to respect scope)
-        for (int i = symCount - 1; i >= 0; i--) {
-            if (strcmp(symtab[i].kind, "typedef") == 0 && 
-                strcmp(symtab[i].name, current_type) == 0) {
-                typedef_sym = &symtab[i];
-                break;
-            }
-        }
-        
-        if (!typedef_sym) {
-            // Not a typedef - this is the base type
-            return current_type;
+    // Depth limit protects against circular typedefs (shouldn't happen in valid code)
+    table->interning.push_back(type);
+    const char* current = type;
+    for (int depth = 0; depth < 50; depth++) {
+        noteDependency(table, current);
+        unordered_map<string, vector<int> >::iterator it = table->typedefs.find(current);
+        if (it == table->typedefs.end()) {
+            break;
         }
-        
-        // Found a typedef - get its underlying type
-        resolved_type = strdup(typedef_sym->type);
-        free(current_type);
-        current_type = resolved_type;
-        depth++;
+        current = ctx->symtab[it->second.back()].type;
     }
+    table->interning.pop_back();
     
-    // Max depth reached - possible circular typedef (shouldn't happen in valid code)
-    // Return what we have
-    return current_type;
+    const char* resolved = keepString(table, current);
+    table->resolvedTypedefs[type] = resolved;
+    return resolved;
+}
+
+// Recursively resolve typedef aliases to their base type (caller must free)
+char* resolveTypedef(const char* type) {
+    if (!type) return NULL;
+    return strdup(resolvedTypedefName(type));
 }
 
 // Helper function to check if declaration_specifiers contains a specific storage class
@@ -28,6 +28,27 @@ typedef struct StructDef {
     int total_size;
 } StructDef;
 
+// Canonical type graph. Types are hash-consed per compilation, so two
+// types are equal exactly when their Type pointers are equal.
+typedef enum {
+    TYPE_KIND_BASE,        // int, char, float, enum, void, ...
+    TYPE_KIND_POINTER,
+    TYPE_KIND_ARRAY,
+    TYPE_KIND_STRUCT,
+    TYPE_KIND_UNION,
+    TYPE_KIND_FUNCTION
+} TypeKind;
+
+typedef struct Type {
+    TypeKind kind;
+    const char* name;          // Canonical spelling ("int*", "struct Point", "int[10][20]")
+    const struct Type* base;   // Pointee, array element or function return type
+    int length;                // Array length (0 = unspecified)
+    const char* signature;     // Function parameter list, e.g. "(int, int)"
+    int size;                  // Cached size in bytes (-1 until known)
+    int align;                 // Cached alignment in bytes (-1 until known)
+} Type;
+
 typedef struct Symbol {
     char name[128];
     char type[128];
@@ -56,30 +77,7 @@ typedef struct Symbol {
 } Symbol;
 
 
-extern Symbol symtab[MAX_SYMBOLS];
-extern int symCount;
-extern int current_scope;
-extern int parent_scopes[100];
-extern int scope_depth;
-extern int current_offset;
-extern char currentType[128];
-extern char current_function[128];
-extern int next_scope;
-extern int current_block_id;
-extern int next_block_id;
-extern int parent_blocks[100];
-
-// Struct definition table
-extern StructDef structTable[MAX_STRUCTS];
-extern int structCount;
-
-// Union definition table
-extern StructDef unionTable[MAX_STRUCTS];
-extern int unionCount;
-
-// Function pointer registry
-extern char function_pointers[MAX_SYMBOLS][128];
-extern int function_pointer_count;
+// Symbol table state lives in CompilerContext (compiler_context.h)
 
 // Function prototypes
 void insertVariable(const char* name, const char* type, int is_array, int* dims, int num_dims, int ptr_level, int is_static, int points_to_const, int is_const_ptr, int is_reference);
@@ -105,6 +103,7 @@ int isFunctionPointerName(const char* name);
 void moveRecentSymbolsToCurrentScope(int count);
 void markRecentSymbolsAsParameters(int count);
 int is_type_name(const char* name);
+void markSymbolAsTypedef(Symbol* sym);
 int getTypeSize(const char* type);
 int isArithmeticType(const char* type);
 int isIntegerType(const char* type);
@@ -112,6 +111,7 @@ char* usualArithConv(const char* t1, const char* t2);
 int isAssignable(const char* lhs_type, const char* rhs_type);
 void setCurrentType(const char* type);
 void printSymbolTable();
+void resetSymbolTable();
 
 // Type checking results
 typedef enum {
@@ -139,6 +139,22 @@ char* getCommonType(const char* type1, const char* type2);
 
 // Typedef resolution
 char* resolveTypedef(const char* type);
+const char* resolvedTypedefName(const char* type);
+
+// Type graph: intern a type spelling (typedefs resolved) or build types
+struct TypeTable;
+const Type* internType(const char* spelling);
+const Type* pointerToType(const Type* base);
+const Type* arrayOfType(const Type* element, int length);
+const Type* decayType(const Type* type);
+int typeSize(const Type* type);
+int typeAlign(const Type* type);
+int typeIsArithmetic(const Type* type);
+int typeIsInteger(const Type* type);
+int typeIsPointer(const Type* type);
+int typeIsScalar(const Type* type);
+int typesPointerCompatible(const Type* ptr1, const Type* ptr2);
+void freeTypeTable(struct TypeTable* table);
 
 // Enhanced validation functions
 int validateBreakContinue(const char* stmt_type);
@@ -0,0 +1,235 @@
+#include "time_report.h"
+#include "compiler_context.h"
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <atomic>
+#include <sys/resource.h>
+
+struct PhaseStats {
+    int runs;
+    double wallMs;
+    double cpuMs;
+    long peakRssKb;              // Process high-water mark at the end of the phase
+    long items[2];               // What the phase produced, sampled at its end
+    double wallStart;
+    double cpuStart;
+};
+
+struct TimeReport {
+    bool active;
+    double wallStart;
+    double cpuStart;
+    std::atomic<long long> workerCpuNs;  // Added by worker threads as they exit
+    PhaseStats phases[PHASE_COUNT];
+};
+
+static const char* const phaseNames[PHASE_COUNT] = {
+    "load_pch",
+    "read_input",
+    "parse",
+    "generate_ir",
+    "print_ir",
+    "analyze_ir",
+    "activation_records",
+    "generate_mips"
+};
+
+static double elapsedMs(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// CPU time of this unit: the compiling thread's own, plus that of the
+// analysis and codegen workers that have finished. Other units compiled
+// by the same process (--batch, --server) are not counted.
+static double cpuMs(const TimeReport* report) {
+    return elapsedMs(CLOCK_THREAD_CPUTIME_ID) + report->workerCpuNs.load() / 1e6;
+}
+
+static double wallMs() {
+    return elapsedMs(CLOCK_MONOTONIC);
+}
+
+// Whole process, shared by every unit it compiles; labelled as such
+static long peakRssKb() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return usage.ru_maxrss;      // Kilobytes on Linux
+}
+
+static TimeReport* activeReport() {
+    TimeReport* report = ctx ? ctx->timeReport : NULL;
+    return report && report->active ? report : NULL;
+}
+
+void startTimeReport(void) {
+    if (!ctx->timeReport) {
+        ctx->timeReport = new TimeReport();
+    }
+    TimeReport* report = ctx->timeReport;
+    memset(report->phases, 0, sizeof(report->phases));
+    report->active = true;
+    report->workerCpuNs = 0;
+    report->wallStart = wallMs();
+    report->cpuStart = cpuMs(report);
+}
+
+void resetTimeReport(void) {
+    if (ctx->timeReport) ctx->timeReport->active = false;
+}
+
+void freeTimeReport(TimeReport* report) {
+    delete report;
+}
+
+void addWorkerThreadCpuTime(void) {
+    TimeReport* report = activeReport();
+    if (!report) return;
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    report->workerCpuNs += ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// What each phase produced, counted in these units (NULL = unused)
+static const char* const phaseUnits[PHASE_COUNT][2] = {
+    { "symbols", NULL },
+    { "lines", "bytes" },
+    { "tokens", "ast_nodes" },
+    { "quads", NULL },
+    { "quads", NULL },
+    { "blocks", NULL },
+    { "functions", NULL },
+    { "mips_lines", NULL }
+};
+
+static void samplePhaseItems(CompilePhase phase, long items[2]) {
+    items[1] = 0;
+    switch (phase) {
+        case PHASE_LOAD_PCH:           items[0] = ctx->symCount; break;
+        case PHASE_READ_INPUT:         items[0] = ctx->lineCount; items[1] = (long)ctx->sourceSize; break;
+        case PHASE_PARSE:              items[0] = ctx->tokenCount; items[1] = ctx->astNodeCount; break;
+        case PHASE_GENERATE_IR:
+        case PHASE_PRINT_IR:           items[0] = ctx->irCount; break;
+        case PHASE_ANALYZE_IR:         items[0] = ctx->blockCount; break;
+        case PHASE_ACTIVATION_RECORDS: items[0] = ctx->activationRecordCount; break;
+        case PHASE_GENERATE_MIPS:      items[0] = ctx->mipsLineCount; break;
+        default:                       items[0] = 0; break;
+    }
+}
+
+void beginPhase(CompilePhase phase) {
+    TimeReport* report = activeReport();
+    if (!report) return;
+    report->phases[phase].wallStart = wallMs();
+    report->phases[phase].cpuStart = cpuMs(report);
+}
+
+void endPhase(CompilePhase phase) {
+    TimeReport* report = activeReport();
+    if (!report) return;
+    PhaseStats* stats = &report->phases[phase];
+    stats->runs++;
+    stats->wallMs += wallMs() - stats->wallStart;
+    stats->cpuMs += cpuMs(report) - stats->cpuStart;
+    stats->peakRssKb = peakRssKb();
+    samplePhaseItems(phase, stats->items);
+}
+
+static void printJsonString(const char* text) {
+    fputc('"', stderr);
+    for (const unsigned char* p = (const unsigned char*)text; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fprintf(stderr, "\\%c", *p);
+        } else if (*p < 0x20) {
+            fprintf(stderr, "\\u%04x", *p);
+        } else {
+            fputc(*p, stderr);
+        }
+    }
+    fputc('"', stderr);
+}
+
+static void printText(const TimeReport* report, const char* inputPath, double totalWall, double totalCpu) {
+    fprintf(stderr, "\nTime report for %s\n", inputPath);
+    fprintf(stderr, "  %-20s %11s %11s %22s  %s\n", "phase", "wall (ms)", "cpu (ms)", "process peak RSS (KB)", "items");
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        const PhaseStats* stats = &report->phases[p];
+        if (stats->runs == 0) continue;
+        fprintf(stderr, "  %-20s %11.3f %11.3f %22ld ", phaseNames[p], stats->wallMs, stats->cpuMs, stats->peakRssKb);
+        for (int i = 0; i < 2 && phaseUnits[p][i]; i++) {
+            fprintf(stderr, "%s %ld %s", i ? "," : "", stats->items[i], phaseUnits[p][i]);
+        }
+        fprintf(stderr, "\n");
+    }
+    fprintf(stderr, "  %-20s %11.3f %11.3f %22ld\n", "total", totalWall, totalCpu, peakRssKb());
+}
+
+static void printJson(const TimeReport* report, const char* inputPath, double totalWall, double totalCpu) {
+    fprintf(stderr, "{\"file\":");
+    printJsonString(inputPath);
+    fprintf(stderr, ",\"errors\":%d,\"phases\":[", ctx->error_count);
+    bool first = true;
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        const PhaseStats* stats = &report->phases[p];
+        if (stats->runs == 0) continue;
+        fprintf(stderr, "%s{\"name\":\"%s\",\"runs\":%d,\"wall_ms\":%.3f,\"cpu_ms\":%.3f,\"process_peak_rss_kb\":%ld",
+                first ? "" : ",", phaseNames[p], stats->runs, stats->wallMs, stats->cpuMs, stats->peakRssKb);
+        for (int i = 0; i < 2 && phaseUnits[p][i]; i++) {
+            fprintf(stderr, ",\"%s\":%ld", phaseUnits[p][i], stats->items[i]);
+        }
+        fprintf(stderr, "}");
+        first = false;
+    }
+    fprintf(stderr, "],\"total\":{\"wall_ms\":%.3f,\"cpu_ms\":%.3f,\"process_peak_rss_kb\":%ld}}\n",
+            totalWall, totalCpu, peakRssKb());
+}
+
+static void printCsvField(const char* text) {
+    if (!strpbrk(text, ",\"\n")) {
+        fputs(text, stderr);
+        return;
+    }
+    fputc('"', stderr);
+    for (const char* p = text; *p; p++) {
+        if (*p == '"') fputc('"', stderr);
+        fputc(*p, stderr);
+    }
+    fputc('"', stderr);
+}
+
+static void printCsv(const TimeReport* report, const char* inputPath, double totalWall, double totalCpu) {
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        const PhaseStats* stats = &report->phases[p];
+        if (stats->runs == 0) continue;
+        printCsvField(inputPath);
+        fprintf(stderr, ",%s,%d,%.3f,%.3f,%ld", phaseNames[p], stats->runs, stats->wallMs, stats->cpuMs, stats->peakRssKb);
+        for (int i = 0; i < 2; i++) {
+            if (phaseUnits[p][i]) {
+                fprintf(stderr, ",%ld,%s", stats->items[i], phaseUnits[p][i]);
+            } else {
+                fprintf(stderr, ",,");
+            }
+        }
+        fprintf(stderr, "\n");
+    }
+    printCsvField(inputPath);
+    fprintf(stderr, ",total,1,%.3f,%.3f,%ld,%d,errors,,\n", totalWall, totalCpu, peakRssKb(), ctx->error_count);
+}
+
+void finishTimeReport(const char* inputPath, TimeReportFormat format) {
+    TimeReport* report = activeReport();
+    if (!report) return;
+    report->active = false;
+    double totalWall = wallMs() - report->wallStart;
+    double totalCpu = cpuMs(report) - report->cpuStart;
+    if (format == TIME_REPORT_JSON) {
+        printJson(report, inputPath, totalWall, totalCpu);
+    } else if (format == TIME_REPORT_CSV) {
+        printCsv(report, inputPath, totalWall, totalCpu);
+    } else if (format == TIME_REPORT_TEXT) {
+        printText(report, inputPath, totalWall, totalCpu);
+    }
+    fflush(stderr);
+}
@@ -0,0 +1,71 @@
+/**
+ * Time Report
+ * Per-phase wall time, CPU time, peak resident set size and item counts
+ * of one compilation (--time-report). CPU time is the unit's own: the
+ * compiling thread plus its worker threads. Peak RSS is the process's, so
+ * it is shared by all units compiled in one process. Phases that run more
+ * than once in a unit accumulate. Hooks are no-ops unless a report was
+ * started for the current context.
+ */
+
+#ifndef TIME_REPORT_H
+#define TIME_REPORT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    PHASE_LOAD_PCH,
+    PHASE_READ_INPUT,                // Mapping and preprocessing the source
+    PHASE_PARSE,
+    PHASE_GENERATE_IR,
+    PHASE_PRINT_IR,
+    PHASE_ANALYZE_IR,
+    PHASE_ACTIVATION_RECORDS,
+    PHASE_GENERATE_MIPS,
+    PHASE_COUNT
+} CompilePhase;
+
+typedef enum {
+    TIME_REPORT_OFF,
+    TIME_REPORT_TEXT,
+    TIME_REPORT_JSON,
+    TIME_REPORT_CSV                  // file,phase,runs,wall_ms,cpu_ms,process_peak_rss_kb,count,unit,count,unit
+} TimeReportFormat;
+
+struct TimeReport;
+
+/**
+ * Start collecting a report for the unit compiled by the current context
+ */
+void startTimeReport(void);
+
+/**
+ * Print the collected report for `inputPath` to stderr and stop collecting
+ * (TIME_REPORT_JSON prints a single line, one object per unit;
+ * TIME_REPORT_CSV one row per phase and a "total" row, without a header)
+ */
+void finishTimeReport(const char* inputPath, TimeReportFormat format);
+
+/**
+ * Stop collecting without printing; called when the context is reset
+ */
+void resetTimeReport(void);
+
+void freeTimeReport(struct TimeReport* report);
+
+/**
+ * Called by a worker thread of the current context just before it exits:
+ * adds the thread's CPU time to the unit's
+ */
+void addWorkerThreadCpuTime(void);
+
+void beginPhase(CompilePhase phase);
+void endPhase(CompilePhase phase);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TIME_REPORT_H
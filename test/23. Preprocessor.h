@@ -0,0 +1,17 @@
+// Header for "23. Preprocessor.txt": included twice, the guard must
+// keep its definitions from being seen a second time
+#ifndef PREPROCESSOR_TEST_H
+#define PREPROCESSOR_TEST_H
+
+#define GREETING "Hello from the header\n"
+#define HEADER_VALUE 7
+#define USE_DOUBLING
+
+int header_calls = 0;
+
+int triple(int x) {
+    header_calls = header_calls + 1;
+    return 3 * x;
+}
+
+#endif